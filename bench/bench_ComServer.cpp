@@ -0,0 +1,561 @@
+/*
+ * This file is part of LSST ts_m2cellcpp benchmarks.
+ *
+ * Developed for the Vera C. Rubin Observatory Telescope & Site Software Systems.
+ * This product includes software developed by the Vera C.Rubin Observatory Project
+ * (https://www.lsst.org). See the COPYRIGHT file at the top-level directory of
+ * this distribution for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/// Load a `ComServer` running `ComControl` connections and measure command
+/// throughput and latency. Each connection sends a repeating mix of
+/// commands, first open-loop at a fixed rate and then closed-loop, keeping
+/// the server's command window full, to find the saturation throughput.
+/// Open-loop latencies are measured from when each command was scheduled to
+/// be sent, so a stalled server is not hidden by a stalled sender.
+/// The results, including the time to receive the welcome message, are
+/// printed and written to a json report so runs can be compared.
+/// Everything is run twice with the same load, once with the server threads
+/// sharing one io_context and once with an io_context per thread.
+/// Last, a connect storm opens many connections at once to a server with one
+/// acceptor, and then to one with an acceptor per thread sharing the port
+/// with SO_REUSEPORT, timing how long it takes for all of them to get the
+/// welcome message.
+/// usage: bench_ComServer [connections [seconds [rate [mix [report [storm]]]]]]
+///   connections - number of client connections, default 4.
+///   seconds - length of each phase, default 5.
+///   rate - open-loop commands per second per connection, default 200, 0 skips the phase.
+///   mix - commands and weights, default "echo:4,ack:2,noack:1,power:1".
+///   report - path of the json report, default "bench_ComServer.json".
+///   storm - number of connections in the connect storm, default 200, 0 skips it.
+
+// System headers
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Third party headers
+#include <nlohmann/json.hpp>
+
+// Project headers
+#include "control/Context.h"
+#include "control/FpgaIo.h"
+#include "control/MotionEngine.h"
+#include "control/PowerSystem.h"
+#include "faultmgr/FaultMgr.h"
+#include "simulator/SimCore.h"
+#include "system/ComClientAsync.h"
+#include "system/ComControl.h"
+#include "system/ComServer.h"
+#include "system/Config.h"
+#include "system/Globals.h"
+#include "util/LatencyHistogram.h"
+#include "util/Log.h"
+
+using namespace std;
+using namespace LSST::m2cellcpp;
+using json = nlohmann::json;
+
+namespace {
+
+/// Longest wait for any one response.
+auto const RESPONSE_TIMEOUT = chrono::seconds(10);
+
+/// Number of threads opening connections in the connect storm.
+int const STORM_THREADS = 8;
+
+/// A `ComServer` running `ComControl` connections that share one
+/// `NetCommandFactory`. Each connection checks its own "sequence_id"s, as
+/// several connections sending at once can't keep them increasing across all of them.
+class BenchServer : public system::ComServer {
+public:
+    static shared_ptr<BenchServer> create(system::IoContextPtr const& ioContext) {
+        return shared_ptr<BenchServer>(new BenchServer(ioContext));
+    }
+
+    system::ComConnection::Ptr newComConnection(system::IoContextPtr const& ioContext, uint64_t connId,
+                                                shared_ptr<system::ComServer> const& server) override {
+        return system::ComControl::create(ioContext, connId, server, _cmdFactory);
+    }
+
+private:
+    /// Listen on an ephemeral port.
+    BenchServer(system::IoContextPtr const& ioContext)
+            : system::ComServer(ioContext, 0), _cmdFactory(control::NetCommandFactory::create()) {
+        system::ComControl::setupNormalFactory(_cmdFactory);
+        _cmdFactory->setSeqIdPolicy(control::SeqIdValidator::PER_CONNECTION, 0);
+    }
+
+    control::NetCommandFactory::Ptr _cmdFactory;  ///< Creates commands for all connections.
+};
+
+/// @return the command `name` with "sequence_id" `seqId`.
+string makeCommand(string const& name, uint64_t seqId) {
+    string seq = to_string(seqId);
+    if (name == "echo") {
+        return R"({"id":"cmd_echo","sequence_id":)" + seq + R"(,"msg":"bench"})";
+    }
+    if (name == "ack") {
+        return R"({"id":"cmd_ack","sequence_id":)" + seq + "}";
+    }
+    if (name == "noack") {
+        return R"({"id":"cmd_noack","sequence_id":)" + seq + "}";
+    }
+    if (name == "power") {
+        // Turning COMM power off is harmless in any state.
+        return R"({"id":"cmd_power","sequence_id":)" + seq + R"(,"powerType":2,"status":false})";
+    }
+    throw invalid_argument("unknown command in mix " + name);
+}
+
+/// @return the command names of `mixStr`, like "echo:4,ack:1", with each
+///     name repeated by its weight. Commands are sent by cycling through it.
+vector<string> parseMix(string const& mixStr) {
+    vector<string> cycle;
+    stringstream strm(mixStr);
+    string entry;
+    while (getline(strm, entry, ',')) {
+        auto pos = entry.find(':');
+        string name = entry.substr(0, pos);
+        int weight = (pos == string::npos) ? 1 : stoi(entry.substr(pos + 1));
+        makeCommand(name, 0);  // Check that the name is known.
+        for (int j = 0; j < weight; ++j) {
+            cycle.push_back(name);
+        }
+    }
+    if (cycle.empty()) {
+        throw invalid_argument("empty mix " + mixStr);
+    }
+    return cycle;
+}
+
+/// @return `sec` seconds as a clock duration.
+util::CLOCK::duration toDuration(double sec) {
+    return chrono::duration_cast<util::CLOCK::duration>(chrono::duration<double>(sec));
+}
+
+/// @return json of the percentiles in `hist`, in microseconds.
+json histJson(util::LatencyHistogram const& hist) {
+    json js;
+    js["count"] = hist.getCount();
+    js["min"] = hist.getMin();
+    js["p50"] = hist.getPercentile(50.0);
+    js["p90"] = hist.getPercentile(90.0);
+    js["p99"] = hist.getPercentile(99.0);
+    js["p999"] = hist.getPercentile(99.9);
+    js["max"] = hist.getMax();
+    js["mean"] = hist.getMean();
+    return js;
+}
+
+/// Totals for one phase, from all connections.
+struct PhaseResult {
+    mutex mtx;                   ///< Protects everything else.
+    uint64_t sent = 0;           ///< Commands sent.
+    uint64_t acked = 0;          ///< "ack" responses.
+    uint64_t noacked = 0;        ///< "noack" responses, other than busy ones.
+    uint64_t busy = 0;           ///< Commands the server was too busy to take.
+    uint64_t succeeded = 0;      ///< "success" final responses.
+    uint64_t failed = 0;         ///< "fail" final responses.
+    uint64_t lost = 0;           ///< Commands missing a response.
+    util::LatencyHistogram ack;  ///< Microseconds until the ack was read.
+    util::LatencyHistogram fin;  ///< Microseconds until the final response was read.
+    double seconds = 0.0;        ///< Length of the phase.
+
+    /// @return the totals, throughput, and latency percentiles.
+
+    json getJson() const {
+        json js;
+        js["seconds"] = seconds;
+        js["sent"] = sent;
+        js["acked"] = acked;
+        js["noacked"] = noacked;
+        js["busy"] = busy;
+        js["succeeded"] = succeeded;
+        js["failed"] = failed;
+        js["lost"] = lost;
+        js["throughput"] = (seconds > 0.0) ? (succeeded + failed) / seconds : 0.0;
+        js["ackLatency"] = histJson(ack);
+        js["finalLatency"] = histJson(fin);
+        return js;
+    }
+};
+
+/// A command waiting for its responses.
+struct InFlight {
+    util::TIMEPOINT start;                   ///< When the command was, or should have been, sent.
+    system::ComClientAsync::Responses resp;  ///< The futures for its responses.
+};
+
+/// Wait for the responses to `cmd` and add them to `result`.
+void collect(InFlight& cmd, PhaseResult& result) {
+    auto micros = [&cmd](util::TIMEPOINT end) {
+        return uint64_t(chrono::duration_cast<chrono::microseconds>(end - cmd.start).count());
+    };
+    try {
+        if (cmd.resp.ack.wait_for(RESPONSE_TIMEOUT) != future_status::ready ||
+            cmd.resp.fin.wait_for(RESPONSE_TIMEOUT) != future_status::ready) {
+            lock_guard<mutex> lg(result.mtx);
+            ++result.lost;
+            return;
+        }
+        json ackJ = cmd.resp.ack.get();
+        json finJ = cmd.resp.fin.get();
+        auto const& times = *cmd.resp.readTimes;
+        lock_guard<mutex> lg(result.mtx);
+        if (finJ.is_null()) {
+            ++result.busy;
+            return;
+        }
+        (ackJ.value("id", "") == "ack") ? ++result.acked : ++result.noacked;
+        (finJ.value("id", "") == "success") ? ++result.succeeded : ++result.failed;
+        result.ack.record(micros(times.ack));
+        result.fin.record(micros(times.fin));
+    } catch (exception const& ex) {
+        LWARN("bench_ComServer lost command ", ex.what());
+        lock_guard<mutex> lg(result.mtx);
+        ++result.lost;
+    }
+}
+
+/// Send commands from `cycle` on `client` for `seconds`, starting with
+/// "sequence_id" `seqId`. If `rate` is more than 0, commands are sent at
+/// that many per second, otherwise up to `window` commands are kept in flight.
+void runConnection(system::ComClientAsync& client, uint64_t& seqId, vector<string> const& cycle,
+                   util::TIMEPOINT phaseStart, double seconds, double rate, unsigned int window,
+                   PhaseResult& result) {
+    deque<InFlight> queue;
+    unsigned int outstanding = 0;  // Sent, but not yet collected.
+    bool sendDone = false;
+    mutex mtx;
+    condition_variable cv;
+
+    thread collector([&]() {
+        while (true) {
+            unique_lock<mutex> ulock(mtx);
+            cv.wait(ulock, [&]() { return !queue.empty() || sendDone; });
+            if (queue.empty()) {
+                return;
+            }
+            InFlight cmd = move(queue.front());
+            queue.pop_front();
+            ulock.unlock();
+            collect(cmd, result);
+            ulock.lock();
+            --outstanding;
+            ulock.unlock();
+            cv.notify_all();
+        }
+    });
+
+    auto phaseEnd = phaseStart + toDuration(seconds);
+    uint64_t sent = 0;
+    for (size_t k = 0;; ++k) {
+        util::TIMEPOINT start;
+        if (rate > 0.0) {
+            start = phaseStart + toDuration(k / rate);
+            if (start >= phaseEnd) {
+                break;
+            }
+            this_thread::sleep_until(start);
+        } else {
+            unique_lock<mutex> ulock(mtx);
+            cv.wait(ulock, [&]() { return outstanding < window; });
+            start = util::CLOCK::now();
+            if (start >= phaseEnd) {
+                break;
+            }
+        }
+        ++seqId;
+        InFlight cmd;
+        cmd.start = start;
+        try {
+            cmd.resp = client.send(makeCommand(cycle[k % cycle.size()], seqId), seqId);
+        } catch (exception const& ex) {
+            LERROR("bench_ComServer send failed ", ex.what());
+            break;
+        }
+        ++sent;
+        {
+            lock_guard<mutex> lg(mtx);
+            queue.push_back(move(cmd));
+            ++outstanding;
+        }
+        cv.notify_all();
+    }
+    {
+        lock_guard<mutex> lg(mtx);
+        sendDone = true;
+    }
+    cv.notify_all();
+    collector.join();
+    lock_guard<mutex> lg(result.mtx);
+    result.sent += sent;
+}
+
+/// Run one phase on all `clients` and return the totals.
+void runPhase(vector<system::ComClientAsync::Ptr> const& clients, vector<uint64_t>& seqIds,
+              vector<string> const& cycle, double seconds, double rate, unsigned int window,
+              PhaseResult& result) {
+    auto phaseStart = util::CLOCK::now();
+    vector<thread> threads;
+    for (size_t j = 0; j < clients.size(); ++j) {
+        threads.emplace_back(runConnection, ref(*clients[j]), ref(seqIds[j]), cref(cycle), phaseStart,
+                             seconds, rate, window, ref(result));
+    }
+    for (auto& thrd : threads) {
+        thrd.join();
+    }
+    result.seconds = chrono::duration<double>(util::CLOCK::now() - phaseStart).count();
+}
+
+/// Settings for a run, from the command line.
+struct Settings {
+    int connections = 4;                             ///< Number of client connections.
+    double seconds = 5.0;                            ///< Length of each phase.
+    double rate = 200.0;                             ///< Open-loop commands per second per connection.
+    string mixStr = "echo:4,ack:2,noack:1,power:1";  ///< Commands and their weights.
+    string reportPath = "bench_ComServer.json";      ///< Path of the json report.
+    int stormConnections = 200;                      ///< Connections in the connect storm.
+};
+
+/// Print a summary of `result` for phase `name`.
+void printPhase(string const& name, PhaseResult const& result) {
+    json js = result.getJson();
+    cout << name << ": sent=" << result.sent << " busy=" << result.busy << " lost=" << result.lost
+         << " throughput=" << js["throughput"].get<double>() << "/s\n";
+    cout << "  ack(us)   " << result.ack.getSummary() << "\n";
+    cout << "  final(us) " << result.fin.getSummary() << "\n";
+}
+
+/// Run both phases against a new server, with an io_context for each
+/// server thread if `perThread` is true.
+/// @return the results for the report, or null if a connection failed.
+json runMode(bool perThread, Settings const& settings, vector<string> const& cycle) {
+    system::IoContextPtr ioContext = make_shared<boost::asio::io_context>();
+    auto serv = BenchServer::create(ioContext);
+    serv->setCommandRateLimit(0.0, 1.0);
+    serv->setMaxConnections(settings.connections + 1);
+    serv->setIoContextPerThread(perThread);
+    int port = serv->getPort();
+    thread servThrd([&serv]() { serv->run(); });
+    for (int j = 0; serv->getState() != system::ComServer::RUNNING && j < 100; ++j) {
+        this_thread::sleep_for(100ms);
+    }
+    unsigned int window = serv->getCommandWindow();
+
+    // Connect, timing how long the welcome message takes to arrive.
+    system::IoContextPtr clientIoContext = make_shared<boost::asio::io_context>();
+    vector<system::ComClientAsync::Ptr> clients;
+    util::LatencyHistogram welcome;
+    for (int j = 0; j < settings.connections; ++j) {
+        auto start = util::CLOCK::now();
+        auto client = system::ComClientAsync::create(clientIoContext, "127.0.0.1", port);
+        if (client->waitForId("summaryFaultsStatus", RESPONSE_TIMEOUT).is_null()) {
+            cout << "no welcome message on connection " << j << endl;
+            serv->shutdown();
+            ioContext->stop();
+            servThrd.join();
+            return json();
+        }
+        welcome.record(chrono::duration_cast<chrono::microseconds>(util::CLOCK::now() - start).count());
+        clients.push_back(client);
+    }
+    vector<uint64_t> seqIds(settings.connections, 0);
+
+    PhaseResult openLoop;
+    if (settings.rate > 0.0) {
+        runPhase(clients, seqIds, cycle, settings.seconds, settings.rate, window, openLoop);
+    }
+    PhaseResult closedLoop;
+    runPhase(clients, seqIds, cycle, settings.seconds, 0.0, window, closedLoop);
+
+    for (auto& client : clients) {
+        client->close();
+    }
+    serv->shutdown();
+    ioContext->stop();
+    servThrd.join();
+
+    string mode = perThread ? "ioContextPerThread" : "sharedIoContext";
+    cout << mode << " window=" << window << "\n";
+    cout << "welcome(us) " << welcome.getSummary() << "\n";
+    json js;
+    js["window"] = window;
+    js["welcomeLatency"] = histJson(welcome);
+    if (settings.rate > 0.0) {
+        printPhase("open-loop", openLoop);
+        js["openLoop"] = openLoop.getJson();
+    }
+    printPhase("closed-loop", closedLoop);
+    js["closedLoop"] = closedLoop.getJson();
+    return js;
+}
+
+/// Open `settings.stormConnections` connections from `STORM_THREADS`
+/// threads at once to a new server with `acceptors` acceptors and an
+/// io_context per thread.
+/// @return the results for the report.
+json runStorm(unsigned int acceptors, Settings const& settings) {
+    system::IoContextPtr ioContext = make_shared<boost::asio::io_context>();
+    auto serv = BenchServer::create(ioContext);
+    serv->setMaxConnections(settings.stormConnections + 1);
+    serv->setIoContextPerThread(true);
+    serv->setAcceptorCount(acceptors);
+    int port = serv->getPort();
+    thread servThrd([&serv]() { serv->run(); });
+    for (int j = 0; serv->getState() != system::ComServer::RUNNING && j < 100; ++j) {
+        this_thread::sleep_for(100ms);
+    }
+
+    system::IoContextPtr clientIoContext = make_shared<boost::asio::io_context>();
+    mutex mtx;
+    vector<system::ComClientAsync::Ptr> clients;  // Kept open until the storm is over.
+    util::LatencyHistogram welcome;
+    int failed = 0;
+    auto stormStart = util::CLOCK::now();
+    vector<thread> threads;
+    for (int t = 0; t < STORM_THREADS; ++t) {
+        threads.emplace_back([&, t]() {
+            util::LatencyHistogram hist;
+            vector<system::ComClientAsync::Ptr> opened;
+            int fails = 0;
+            for (int j = t; j < settings.stormConnections; j += STORM_THREADS) {
+                auto start = util::CLOCK::now();
+                try {
+                    auto client = system::ComClientAsync::create(clientIoContext, "127.0.0.1", port);
+                    if (client->waitForId("summaryFaultsStatus", RESPONSE_TIMEOUT).is_null()) {
+                        ++fails;
+                        continue;
+                    }
+                    hist.record(
+                            chrono::duration_cast<chrono::microseconds>(util::CLOCK::now() - start).count());
+                    opened.push_back(client);
+                } catch (boost::system::system_error const&) {
+                    ++fails;
+                }
+            }
+            lock_guard<mutex> lg(mtx);
+            welcome.merge(hist);
+            failed += fails;
+            clients.insert(clients.end(), opened.begin(), opened.end());
+        });
+    }
+    for (auto& thrd : threads) {
+        thrd.join();
+    }
+    double seconds = chrono::duration<double>(util::CLOCK::now() - stormStart).count();
+
+    for (auto& client : clients) {
+        client->close();
+    }
+    serv->shutdown();
+    ioContext->stop();
+    servThrd.join();
+
+    cout << "connect storm acceptors=" << acceptors << " connections=" << settings.stormConnections
+         << " failed=" << failed << " seconds=" << seconds << "\n";
+    cout << "  welcome(us) " << welcome.getSummary() << "\n";
+    json js;
+    js["acceptors"] = acceptors;
+    js["backlog"] = serv->getAcceptBacklog();
+    js["connections"] = settings.stormConnections;
+    js["failed"] = failed;
+    js["seconds"] = seconds;
+    js["connectsPerSecond"] = (seconds > 0.0) ? welcome.getCount() / seconds : 0.0;
+    js["welcomeLatency"] = histJson(welcome);
+    return js;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    util::Log::getLog().useEnvironmentLogLvl();
+    Settings settings;
+    if (argc > 1) {
+        settings.connections = stoi(argv[1]);
+    }
+    if (argc > 2) {
+        settings.seconds = stod(argv[2]);
+    }
+    if (argc > 3) {
+        settings.rate = stod(argv[3]);
+    }
+    if (argc > 4) {
+        settings.mixStr = argv[4];
+    }
+    if (argc > 5) {
+        settings.reportPath = argv[5];
+    }
+    if (argc > 6) {
+        settings.stormConnections = stoi(argv[6]);
+    }
+    vector<string> cycle = parseMix(settings.mixStr);
+
+    string cfgPath = system::Config::getEnvironmentCfgPath("../configs");
+    system::Config::setup(cfgPath + "unitTestCfg.yaml");
+    system::Globals::setup(system::Config::get());
+
+    // The controller is needed for the power commands, without its loops.
+    simulator::SimCore::Ptr simCore(new simulator::SimCore());
+    faultmgr::FaultMgr::setup();
+    control::FpgaIo::setup(simCore);
+    control::MotionEngine::setup();
+    control::Context::setup();
+    control::Context::get()->model.getPowerSystem()->stopTimeoutLoop();
+    control::FpgaIo::getPtr()->stopLoop();
+    control::MotionEngine::getPtr()->engineStop();
+
+    cout << "connections=" << settings.connections << " seconds=" << settings.seconds
+         << " rate=" << settings.rate << " mix=" << settings.mixStr
+         << " threads=" << system::Config::get().getControlServerThreads() << "\n";
+    json report;
+    report["connections"] = settings.connections;
+    report["seconds"] = settings.seconds;
+    report["rate"] = settings.rate;
+    report["mix"] = settings.mixStr;
+    report["threads"] = system::Config::get().getControlServerThreads();
+    for (bool perThread : {false, true}) {
+        json js = runMode(perThread, settings, cycle);
+        if (js.is_null()) {
+            return 1;
+        }
+        report[perThread ? "ioContextPerThread" : "sharedIoContext"] = js;
+    }
+    if (settings.stormConnections > 0) {
+        report["connectStorm"] = json::array();
+        unsigned int threadCount = system::Config::get().getControlServerThreads();
+        for (unsigned int acceptors : {1u, max(threadCount, 2u)}) {
+            report["connectStorm"].push_back(runStorm(acceptors, settings));
+        }
+    }
+
+    ofstream reportFile(settings.reportPath);
+    reportFile << report.dump(2) << endl;
+    if (!reportFile) {
+        cout << "failed to write " << settings.reportPath << endl;
+        return 1;
+    }
+    cout << "report written to " << settings.reportPath << endl;
+    return 0;
+}
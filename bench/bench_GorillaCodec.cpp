@@ -0,0 +1,139 @@
+/*
+ * This file is part of LSST ts_m2cellcpp benchmarks.
+ *
+ * Developed for the Vera C. Rubin Observatory Telescope & Site Software Systems.
+ * This product includes software developed by the Vera C.Rubin Observatory Project
+ * (https://www.lsst.org). See the COPYRIGHT file at the top-level directory of
+ * this distribution for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/// Compare the size of `TItemAxialForce` telemetry sent as json with the
+/// same data encoded by `GorillaBlockEncoder`, and measure encode and
+/// decode throughput.
+/// usage: bench_GorillaCodec [rows]
+
+// System headers
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Project headers
+#include "system/TelemetryCom.h"
+#include "system/TelemetryItemDefs.h"
+#include "util/GorillaCodec.h"
+
+using namespace std;
+using namespace LSST::m2cellcpp;
+
+namespace {
+
+/// Number of actuators in each `TItemAxialForce` vector.
+int const ACTUATORS = 72;
+
+/// Fill `row` with the 5 vectors of a synthetic `TItemAxialForce` at tick `tick`.
+/// The look up table values drift slowly, the measured forces have load cell noise.
+void makeRow(int tick, mt19937_64& rng, vector<double>& row) {
+    normal_distribution<double> noise(0.0, 0.05);
+    row.resize(5 * ACTUATORS);
+    for (int j = 0; j < ACTUATORS; ++j) {
+        double lutGravity = 100.0 + j + 20.0 * cos(tick * 0.0001 + j);
+        double lutTemperature = 0.5 * sin(j) + tick * 1.0e-6;
+        double applied = lutGravity + lutTemperature;
+        double measured = round((applied + noise(rng)) * 1000.0) / 1000.0;
+        double hardpointCorrection = 0.1 * sin(tick * 0.01 + j);
+        row[j] = lutGravity;
+        row[ACTUATORS + j] = lutTemperature;
+        row[2 * ACTUATORS + j] = applied;
+        row[3 * ACTUATORS + j] = measured;
+        row[4 * ACTUATORS + j] = hardpointCorrection;
+    }
+}
+
+/// Return the elapsed seconds since `start`.
+double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int rows = 3000;  // 1 minute at 50Hz
+    if (argc > 1) {
+        rows = stoi(argv[1]);
+    }
+
+    mt19937_64 rng(29);
+    vector<vector<double>> data(rows);
+    vector<int64_t> stamps(rows);
+    int64_t const t0 = chrono::system_clock::now().time_since_epoch().count();
+    for (int r = 0; r < rows; ++r) {
+        makeRow(r, rng, data[r]);
+        // 20ms ticks with a little jitter.
+        stamps[r] = t0 + int64_t(r) * 20000000 + int64_t(rng() % 50000);
+    }
+
+    // Size as json, the current wire format.
+    system::TItemAxialForce item;
+    size_t jsonBytes = 0;
+    auto jsonStart = chrono::steady_clock::now();
+    for (int r = 0; r < rows; ++r) {
+        auto beg = data[r].begin();
+        item.getLutGravity().setVals(vector<double>(beg, beg + ACTUATORS));
+        item.getLutTemperature().setVals(vector<double>(beg + ACTUATORS, beg + 2 * ACTUATORS));
+        item.getApplied().setVals(vector<double>(beg + 2 * ACTUATORS, beg + 3 * ACTUATORS));
+        item.getMeasured().setVals(vector<double>(beg + 3 * ACTUATORS, beg + 4 * ACTUATORS));
+        item.getHardpointCorrection().setVals(vector<double>(beg + 4 * ACTUATORS, beg + 5 * ACTUATORS));
+        jsonBytes += item.getJson().dump().size() + string(system::TelemetryCom::TERMINATOR()).size();
+    }
+    double jsonSec = secondsSince(jsonStart);
+
+    // Encode
+    auto encStart = chrono::steady_clock::now();
+    util::GorillaBlockEncoder enc(5 * ACTUATORS);
+    for (int r = 0; r < rows; ++r) {
+        enc.addRow(stamps[r], data[r]);
+    }
+    vector<uint8_t> block = enc.getBlock();
+    double encSec = secondsSince(encStart);
+
+    // Decode and verify
+    auto decStart = chrono::steady_clock::now();
+    util::GorillaBlockDecoder dec(block.data(), block.size());
+    int64_t ts;
+    vector<double> vals;
+    int r = 0;
+    bool match = true;
+    while (dec.nextRow(ts, vals)) {
+        match = match && ts == stamps[r] && memcmp(vals.data(), data[r].data(), vals.size() * sizeof(double)) == 0;
+        ++r;
+    }
+    double decSec = secondsSince(decStart);
+
+    size_t rawBytes = size_t(rows) * (5 * ACTUATORS + 1) * sizeof(double);
+    size_t values = size_t(rows) * 5 * ACTUATORS;
+    cout << "rows=" << rows << " columns=" << 5 * ACTUATORS << " roundTrip=" << (match ? "ok" : "FAILED") << "\n";
+    cout << "json bytes=" << jsonBytes << " build sec=" << jsonSec << "\n";
+    cout << "raw bytes=" << rawBytes << "\n";
+    cout << "gorilla bytes=" << block.size() << " ratio json=" << double(jsonBytes) / block.size()
+         << " ratio raw=" << double(rawBytes) / block.size() << "\n";
+    cout << "encode sec=" << encSec << " Mvalues/sec=" << values / encSec / 1.0e6 << "\n";
+    cout << "decode sec=" << decSec << " Mvalues/sec=" << values / decSec / 1.0e6 << "\n";
+    return match ? 0 : 1;
+}
@@ -0,0 +1,88 @@
+/*
+ * This file is part of LSST ts_m2cellcpp benchmarks.
+ *
+ * Developed for the Vera C. Rubin Observatory Telescope & Site Software Systems.
+ * This product includes software developed by the Vera C.Rubin Observatory Project
+ * (https://www.lsst.org). See the COPYRIGHT file at the top-level directory of
+ * this distribution for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/// Run a `TelemetryCom` server with several clients and report the number of
+/// socket system calls the server made per telemetry message.
+/// usage: bench_TelemetryCom [clients [seconds [port]]]
+
+// System headers
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Project headers
+#include "system/TelemetryCom.h"
+#include "system/TelemetryMap.h"
+#include "util/Log.h"
+
+using namespace std;
+using namespace LSST::m2cellcpp;
+
+int main(int argc, char* argv[]) {
+    util::Log::getLog().useEnvironmentLogLvl();
+    int clientCount = 10;
+    int seconds = 5;
+    int port = 10099;
+    if (argc > 1) {
+        clientCount = stoi(argv[1]);
+    }
+    if (argc > 2) {
+        seconds = stoi(argv[2]);
+    }
+    if (argc > 3) {
+        port = stoi(argv[3]);
+    }
+
+    auto servMap = system::TelemetryMap::Ptr(new system::TelemetryMap());
+    auto serv = system::TelemetryCom::create(servMap, port);
+    serv->startServer();
+    if (!serv->waitForServerRunning(5)) {
+        cout << "server failed to start on port " << port << endl;
+        return 1;
+    }
+
+    vector<system::TelemetryCom::Ptr> clients;
+    vector<thread> clientThreads;
+    for (int j = 0; j < clientCount; ++j) {
+        auto client = system::TelemetryCom::create(system::TelemetryMap::Ptr(new system::TelemetryMap()), port);
+        clients.push_back(client);
+        clientThreads.emplace_back(&system::TelemetryCom::client, client, j);
+    }
+    this_thread::sleep_for(chrono::seconds(seconds));
+    serv->shutdownCom();
+    for (auto& thrd : clientThreads) {
+        thrd.join();
+    }
+
+    auto const& stats = serv->getIoStats();
+    uint64_t sendCalls = stats.sendCalls;
+    uint64_t msgsSent = stats.msgsSent;
+    uint64_t bytesSent = stats.bytesSent;
+    cout << "clients=" << clientCount << " seconds=" << seconds << "\n";
+    cout << "msgsSent=" << msgsSent << " bytesSent=" << bytesSent << " sendCalls=" << sendCalls << "\n";
+    if (msgsSent > 0) {
+        cout << "sendCalls/msg=" << double(sendCalls) / msgsSent << " (one send per message is 1.0)\n";
+    }
+    cout << "msgs/sec=" << double(msgsSent) / seconds << " bytes/sec=" << double(bytesSent) / seconds << endl;
+    return 0;
+}
@@ -0,0 +1,99 @@
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+// System headers
+#include <atomic>
+#include <csignal>
+#include <set>
+#include <sstream>
+#include <thread>
+
+// Project headers
+#include "system/Config.h"
+#include "system/TelemetryRelay.h"
+#include "util/Log.h"
+
+using namespace std;
+using namespace LSST::m2cellcpp;
+
+namespace {
+atomic<bool> relayLoop{true};
+
+void signalHandler(int sig) {
+    if (sig == SIGPIPE) {
+        return;
+    }
+    relayLoop = false;
+}
+}  // namespace
+
+/// The telemetry relay application connects to the `TelemetryServer` in the
+/// configuration file and re-serves its telemetry on `TelemetryRelay: port`.
+/// Usage: m2relay [upstreamHost [upstreamPort [relayPort]]]
+/// Command line arguments override the configuration file values.
+int main(int argc, const char* argv[]) {
+    // If environment LOGLVL is undefined, defaults to `trace`.
+    util::Log::getLog().useEnvironmentLogLvl();
+    util::Log& log = util::Log::getLog();
+    log.setOutputDest(util::Log::MIRRORED);
+
+    LINFO("Reading Config");
+    string cfgPath = system::Config::getEnvironmentCfgPath("./configs");
+    system::Config::setup(cfgPath + "m2cellCfg.yaml");
+    system::Config& sysCfg = system::Config::get();
+
+    string upHost = sysCfg.getTelemetryServerHost();
+    int upPort = sysCfg.getTelemetryServerPort();
+    int relayPort = sysCfg.getTelemetryRelayPort();
+    if (argc > 1) upHost = argv[1];
+    if (argc > 2) upPort = stoi(argv[2]);
+    if (argc > 3) relayPort = stoi(argv[3]);
+
+    set<string> filter;
+    stringstream itemStrm(sysCfg.getTelemetryRelayItems());
+    string item;
+    while (getline(itemStrm, item, ',')) {
+        if (!item.empty()) {
+            filter.insert(item);
+        }
+    }
+
+    signal(SIGPIPE, signalHandler);
+    signal(SIGINT, signalHandler);
+    signal(SIGTERM, signalHandler);
+
+    LINFO("Starting relay upstream=", upHost, ":", upPort, " relayPort=", relayPort,
+          " filter size=", filter.size());
+    auto relay = system::TelemetryRelay::create(upHost, upPort, relayPort, filter);
+    relay->start();
+    if (!relay->waitForServerRunning(5)) {
+        LCRITICAL("Telemetry relay failed to start.");
+        exit(-1);
+    }
+
+    while (relayLoop) {
+        this_thread::sleep_for(1s);
+    }
+    LINFO("Stopping relay");
+    relay->shutdown();
+    LINFO("Relay stopped");
+    return 0;
+}
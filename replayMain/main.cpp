@@ -0,0 +1,140 @@
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+// System headers
+#include <ctime>
+#include <iostream>
+#include <thread>
+
+// Project headers
+#include "control/Context.h"
+#include "control/FpgaIo.h"
+#include "control/MotionEngine.h"
+#include "faultmgr/FaultMgr.h"
+#include "simulator/SimCore.h"
+#include "system/ComControl.h"
+#include "system/ComControlServer.h"
+#include "system/Config.h"
+#include "system/Globals.h"
+#include "system/JournalReplay.h"
+#include "util/CommandJournal.h"
+#include "util/Log.h"
+
+using namespace std;
+using namespace LSST::m2cellcpp;
+
+/// The replay application reads a command journal written by m2cell, starts
+/// a fresh controller and simulator with a `ComControlServer`, and sends it
+/// the journaled commands. The replay is journaled to
+/// `<journalPrefix>_replay_<start time>`, and its state transitions are
+/// compared with the recorded ones.
+/// Usage: m2replay journalPrefix [speed [port]]
+/// `speed` 1.0 keeps the recorded pace, 0.0, the default, is as fast as possible.
+/// `port` defaults to `ControlServer: port` from the configuration file.
+int main(int argc, const char* argv[]) {
+    if (argc < 2) {
+        cerr << "Usage: m2replay journalPrefix [speed [port]]" << endl;
+        return 2;
+    }
+    util::Log::getLog().useEnvironmentLogLvl();
+    util::Log& log = util::Log::getLog();
+    log.setOutputDest(util::Log::MIRRORED);
+
+    LINFO("Reading Config");
+    string cfgPath = system::Config::getEnvironmentCfgPath("./configs");
+    system::Config::setup(cfgPath + "m2cellCfg.yaml");
+    system::Config& sysCfg = system::Config::get();
+
+    string journalPrefix = argv[1];
+    double speed = (argc > 2) ? stod(argv[2]) : 0.0;
+    int port = (argc > 3) ? stoi(argv[3]) : sysCfg.getControlServerPort();
+
+    vector<util::CommandJournal::Record> recorded;
+    unsigned int segments = util::CommandJournal::readAll(journalPrefix, recorded);
+    if (segments == 0) {
+        LCRITICAL("No journal segments found for ", journalPrefix);
+        return 1;
+    }
+    LINFO("Read ", recorded.size(), " records from ", segments, " segments");
+
+    char startStr[32];
+    time_t now = time(nullptr);
+    strftime(startStr, sizeof(startStr), "_replay_%Y%m%d_%H%M%S", gmtime(&now));
+    string replayPrefix = journalPrefix + startStr;
+    size_t segmentSize = size_t(sysCfg.getCommandJournalSegmentMB()) * 1024 * 1024;
+    auto journal = util::CommandJournal::create(replayPrefix, segmentSize,
+                                                chrono::milliseconds(sysCfg.getCommandJournalCommitMs()));
+    util::CommandJournal::setGlobal(journal);
+
+    // Start the controller the same way as m2cell.
+    system::Globals::setup(sysCfg);
+    simulator::SimCore::Ptr simCore(new simulator::SimCore());
+    simCore->start();
+    faultmgr::FaultMgr::setup();
+    control::FpgaIo::setup(simCore);
+    control::MotionEngine::setup();
+    control::Context::setup();
+    auto context = control::Context::get();
+    control::FpgaIo::get().registerPowerSys(context->model.getPowerSystem());
+    context->model.ctrlSetup();
+    context->model.ctrlStart();
+    context->model.waitForCtrlReady();
+
+    system::IoContextPtr ioContext = make_shared<boost::asio::io_context>();
+    auto cmdFactory = control::NetCommandFactory::create();
+    system::ComControl::setupNormalFactory(cmdFactory);
+    auto serv = system::ComControlServer::create(ioContext, port, cmdFactory);
+    // The recorded commands were already accepted once, don't rate limit them.
+    serv->setCommandRateLimit(0.0, 1.0);
+    thread servThrd([&serv]() { serv->run(); });
+    for (int j = 0; serv->getState() != system::ComServer::RUNNING && j < 15; ++j) {
+        this_thread::sleep_for(1s);
+    }
+
+    system::JournalReplay replay(recorded, speed);
+    auto result = replay.run(ioContext, "127.0.0.1", port);
+    cout << result.getSummary() << endl;
+
+    serv->shutdown();
+    ioContext->stop();
+    servThrd.join();
+    context->model.ctrlStop();
+    context->model.ctrlJoin();
+    util::CommandJournal::setGlobal(nullptr);
+    journal->close();
+
+    vector<util::CommandJournal::Record> replayed;
+    util::CommandJournal::readAll(replayPrefix, replayed);
+    auto recStates = system::JournalReplay::getStateTransitions(recorded);
+    auto repStates = system::JournalReplay::getStateTransitions(replayed);
+    if (recStates != repStates) {
+        cout << "State transitions differ, recorded=" << recStates.size() << " replayed=" << repStates.size()
+             << endl;
+        for (size_t j = 0; j < max(recStates.size(), repStates.size()); ++j) {
+            string rec = (j < recStates.size()) ? recStates[j] : "-";
+            string rep = (j < repStates.size()) ? repStates[j] : "-";
+            cout << (rec == rep ? "  " : "! ") << rec << " | " << rep << endl;
+        }
+        return 1;
+    }
+    cout << "State transitions match, count=" << recStates.size() << endl;
+    return 0;
+}
@@ -39,6 +39,7 @@
 #include "system/TelemetryCom.h"
 #include "system/TelemetryMap.h"
 #include "util/Bug.h"
+#include "util/CommandJournal.h"
 #include "util/Log.h"
 
 using namespace std;
@@ -92,6 +93,28 @@ void ControlMain::_cMain() {
     // Setup global items.
     system::Globals::setup(sysCfg);
 
+    // Start the command journal before anything can change state.
+    string journalPrefix = sysCfg.getCommandJournalPathPrefix();
+    if (!journalPrefix.empty()) {
+        // Each run gets its own journal, named for its start time, and all of
+        // them share `maxSegments`. A run that crashed left its last segment
+        // at full size, so trim it first.
+        string journalGroup = journalPrefix + "_";
+        util::CommandJournal::trimSegments(journalGroup);
+        char startStr[32];
+        time_t now = time(nullptr);
+        strftime(startStr, sizeof(startStr), "_%Y%m%d_%H%M%S", gmtime(&now));
+        size_t segmentSize = size_t(sysCfg.getCommandJournalSegmentMB()) * 1024 * 1024;
+        chrono::milliseconds commitInterval(sysCfg.getCommandJournalCommitMs());
+        unsigned int maxSegments = sysCfg.getCommandJournalMaxSegments();
+        try {
+            util::CommandJournal::setGlobal(util::CommandJournal::create(
+                    journalPrefix + startStr, segmentSize, commitInterval, maxSegments, journalGroup));
+        } catch (util::Issue const& ex) {
+            LERROR("ControlMain running without a command journal ", ex.what());
+        }
+    }
+
     // Setup a simple signal handler to handle when clients closing connection results in SIGPIPE.
     signal(SIGPIPE, signalHandler);
 
@@ -123,6 +146,10 @@ void ControlMain::_cMain() {
     // DM-39974 FUTURE: get the correct entries into `system::Config`.
     int const telemPort = 50001;
     auto servTelemetryMap = system::TelemetryMap::Ptr(new system::TelemetryMap());
+    servTelemetryMap->setExternalStaleLimitSec(sysCfg.getTelemetryServerExternalStaleLimitSec());
+    servTelemetryMap->setExternalStaleCallback([](bool stale, string const& msg) {
+        faultmgr::FaultMgr::get().reportExternalFeedStale(stale, msg);
+    });
     auto telemetryServ = system::TelemetryCom::create(servTelemetryMap, telemPort);
 
     telemetryServ->startServer();
@@ -142,6 +169,9 @@ void ControlMain::_cMain() {
     int port = system::Config::get().getControlServerPort();
     auto cmdFactory = control::NetCommandFactory::create();
     system::ComControl::setupNormalFactory(cmdFactory);
+    cmdFactory->setSeqIdPolicy(
+            control::SeqIdValidator::parsePolicy(system::Config::get().getControlServerSeqIdPolicy()),
+            system::Config::get().getControlServerSeqIdWindow());
     _comServer = system::ComControlServer::create(ioContext, port, cmdFactory, true);
     LINFO("ComControlServer created port=", port);
 
@@ -180,6 +210,8 @@ void ControlMain::_cMain() {
     LINFO("ComControlServer is running, waiting for server shutdown");
     while (_comServer->getState() != system::ComServer::STOPPED) {
         this_thread::sleep_for(1s);
+        // External feeds only set faults on changes, so checking often is cheap.
+        servTelemetryMap->checkExternalStale(util::CLOCK::now());
     }
     LINFO("ComControlServer has been shutdown");
 
@@ -200,6 +232,12 @@ void ControlMain::_cMain() {
     LINFO("joining server");
     comControlServThrd.join();
     LINFO("server joined");
+
+    auto journal = util::CommandJournal::getGlobal();
+    if (journal != nullptr) {
+        util::CommandJournal::setGlobal(nullptr);
+        journal->close();
+    }
 }
 
 void ControlMain::stop() {
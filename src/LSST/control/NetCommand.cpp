@@ -23,6 +23,8 @@
 #include "control/NetCommand.h"
 
 // System headers
+#include <climits>
+#include <cstdio>
 
 // Third party headers
 
@@ -36,36 +38,140 @@ namespace LSST {
 namespace m2cellcpp {
 namespace control {
 
-NetCommand::NetCommand(JsonPtr const& inJson_) : inJson(inJson_) {
+namespace {
+
+/// Append `str` to `out` as a quoted json string, escaped the same way
+/// nlohmann::json::dump() does it.
+void appendJsonStr(string& out, string_view str) {
+    out += '"';
+    for (char c : str) {
+        switch (c) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\b':
+                out += "\\b";
+                break;
+            case '\f':
+                out += "\\f";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned int>(c));
+                    out += buf;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+/// Fields of `NCmdEcho`.
+constexpr array<NetField<NCmdEcho::Params>, 1> echoFields{{{"msg", &NCmdEcho::Params::msg}}};
+
+}  // namespace
+
+NetCommandArgs::NetCommandArgs(JsonPtr const& inJson) : _scan(string_view()) {
     if (inJson == nullptr) {
         throw NetCommandException(ERR_LOC, "NetCommand constructor inJson=null");
     }
     try {
         _name = inJson->at("id");
         _seqId = inJson->at("sequence_id");
-        LDEBUG("NetCommand constructor id=", " seqId=", _seqId);
     } catch (json::exception const& ex) {
         string eMsg = string("NetCommand constructor error in ") + inJson->dump() + " what=" + ex.what();
         LERROR(eMsg);
         throw NetCommandException(ERR_LOC, eMsg);
     }
+    _ownedText = inJson->dump();
+    _text = _ownedText;
+    _scan = util::JsonScan(_text);
+}
+
+void NetCommandArgs::get(string_view key, bool& out) const {
+    string_view raw = _scan.getRaw(key);
+    if (raw == "true" || raw == "false") {
+        out = (raw == "true");
+        return;
+    }
+    _getSlow(key, raw, out);
+}
+
+void NetCommandArgs::get(string_view key, int& out) const {
+    int64_t val;
+    if (_scan.getInt64(key, val) && val >= INT_MIN && val <= INT_MAX) {
+        out = val;
+        return;
+    }
+    _getSlow(key, _scan.getRaw(key), out);
+}
+
+void NetCommandArgs::get(string_view key, uint64_t& out) const {
+    if (_scan.getUInt64(key, out)) {
+        return;
+    }
+    _getSlow(key, _scan.getRaw(key), out);
+}
+
+void NetCommandArgs::get(string_view key, double& out) const { _getSlow(key, _scan.getRaw(key), out); }
+
+void NetCommandArgs::get(string_view key, string& out) const {
+    string_view val;
+    if (_scan.getString(key, val) && val.find('\\') == string_view::npos) {
+        out.assign(val);
+        return;
+    }
+    _getSlow(key, _scan.getRaw(key), out);
+}
+
+template <typename T>
+void NetCommandArgs::_getSlow(string_view key, string_view raw, T& out) const {
+    if (raw.empty()) {
+        _throwField(key, "missing");
+    }
+    try {
+        out = json::parse(raw.begin(), raw.end()).get<T>();
+    } catch (json::exception const& ex) {
+        _throwField(key, ex.what());
+    }
+}
+
+void NetCommandArgs::_throwField(string_view key, string const& what) const {
+    string eMsg = _name + " constructor error in " + string(_text) + " key=" + string(key) + " what=" + what;
+    LERROR(eMsg);
+    throw NetCommandException(ERR_LOC, eMsg);
+}
 
-    ackJson["sequence_id"] = _seqId;
-    ackJson["user_info"] = string("invalid:") + _name;
-    respJson["sequence_id"] = _seqId;
+NetCommand::NetCommand(NetCommandArgs const& args)
+        : _name(args.getName()), _seqId(args.getSeqId()), _ackUserInfo(string("invalid:") + _name) {
+    LDEBUG("NetCommand constructor id=", _name, " seqId=", _seqId);
 }
 
-NetCommand::JsonPtr NetCommand::parse(string const& inStr) {
+NetCommand::JsonPtr NetCommand::parse(string_view inStr) {
     JsonPtr inJson = std::shared_ptr<nlohmann::json>(new nlohmann::json());
     // Not much can be done if parsing fails.
     try {
-        *inJson = json::parse(inStr);
+        *inJson = json::parse(inStr.begin(), inStr.end());
     } catch (json::parse_error& ex) {
-        string eMsg = string("NetCommand::parse error ") + ex.what() + " " + inStr;
+        string eMsg = string("NetCommand::parse error ") + ex.what() + " " + string(inStr);
         LERROR(eMsg);
         throw NetCommandException(ERR_LOC, eMsg);
     }
-    LDEBUG("NetCommand::parse inStr=", inStr, "\njson=", inJson->dump(2));
+    LDEBUG("NetCommand::parse inStr=", inStr);
     // All commands must have at least id and sequence_id
     try {
         string id = inJson->at("id");
@@ -84,81 +190,84 @@ bool NetCommand::run() {
     LDEBUG("NetCommand run action for seqId=", _seqId, " ", getName());
     bool result = action();
     if (result) {
-        respJson["id"] = "success";
+        _respId = "success";
     } else {
-        respJson["id"] = "fail";
+        _respId = "fail";
     }
     return result;
 }
 
-string NetCommand::getAckJsonStr() { return ackJson.dump(); }
+string NetCommand::getAckJsonStr() { return _writeMsg(_ackId, _ackUserInfo, nullptr); }
 
-string NetCommand::getRespJsonStr() { return respJson.dump(); }
+string NetCommand::getRespJsonStr() { return _writeMsg(_respId, _respUserInfo, &respJsonExtra); }
 
-void NetCommand::throwNetCommandException(util::Issue::Context const& errLoc, std::string const& funcName,
-                                          JsonPtr const& inJson, json::exception const& ex) const {
-    string eMsg = getCommandName() + " " + funcName + " constructor error in " + inJson->dump() +
-                  " what=" + ex.what();
-    LERROR(eMsg);
-    throw NetCommandException(errLoc, eMsg);
+json NetCommand::getRespJson() const {
+    json js = respJsonExtra.is_null() ? json::object() : respJsonExtra;
+    js["id"] = _respId;
+    js["sequence_id"] = _seqId;
+    js["user_info"] = _respUserInfo;
+    return js;
 }
 
-NCmdAck::Ptr NCmdAck::create(JsonPtr const& inJson_) {
-    auto cmd = Ptr(new NCmdAck(inJson_));
-    return cmd;
+string NetCommand::_writeMsg(string const& id, string const& userInfo, json const* extra) const {
+    if (extra != nullptr && !extra->is_null()) {
+        // Uncommon, let nlohmann::json merge and order the fields.
+        json js = *extra;
+        js["id"] = id;
+        js["sequence_id"] = _seqId;
+        js["user_info"] = userInfo;
+        return js.dump();
+    }
+    // The same text nlohmann::json::dump() produces, which sorts the keys.
+    string out;
+    out.reserve(48 + id.size() + userInfo.size());
+    out += "{\"id\":";
+    appendJsonStr(out, id);
+    out += ",\"sequence_id\":";
+    out += to_string(_seqId);
+    out += ",\"user_info\":";
+    appendJsonStr(out, userInfo);
+    out += '}';
+    return out;
 }
 
-NCmdAck::NCmdAck(JsonPtr const& inJson) : NetCommand(inJson) {
-    ackJson["id"] = "ack";
-    ackJson["user_info"] = "ack";
-}
+NCmdAck::Ptr NCmdAck::create(JsonPtr const& inJson) { return Ptr(new NCmdAck(NetCommandArgs(inJson))); }
 
-NetCommand::Ptr NCmdAck::createNewNetCommand(JsonPtr const& inJson) {
-    NCmdAck::Ptr cmd = NCmdAck::create(inJson);
-    return cmd;
+NCmdAck::NCmdAck(NetCommandArgs const& args) : NetCommand(args) {
+    setAckId("ack");
+    setAckUserInfo("ack");
 }
 
-NCmdNoAck::Ptr NCmdNoAck::create(JsonPtr const& inJson_) {
-    auto cmd = Ptr(new NCmdNoAck(inJson_));
-    return cmd;
+NetCommand::Ptr NCmdAck::createNewNetCommand(NetCommandArgs const& args) {
+    return NCmdAck::Ptr(new NCmdAck(args));
 }
 
-NCmdNoAck::NCmdNoAck(JsonPtr const& inJson) : NetCommand(inJson) {
-    ackJson["id"] = "noack";
-    ackJson["user_info"] = "noack";
-}
+NCmdNoAck::Ptr NCmdNoAck::create(JsonPtr const& inJson) { return Ptr(new NCmdNoAck(NetCommandArgs(inJson))); }
 
-NetCommand::Ptr NCmdNoAck::createNewNetCommand(JsonPtr const& inJson) {
-    NCmdNoAck::Ptr cmd = NCmdNoAck::create(inJson);
-    return cmd;
+NCmdNoAck::NCmdNoAck(NetCommandArgs const& args) : NetCommand(args) {
+    setAckId("noack");
+    setAckUserInfo("noack");
 }
 
-NCmdEcho::Ptr NCmdEcho::create(JsonPtr const& inJson_) {
-    auto cmd = Ptr(new NCmdEcho(inJson_));
-    return cmd;
+NetCommand::Ptr NCmdNoAck::createNewNetCommand(NetCommandArgs const& args) {
+    return NCmdNoAck::Ptr(new NCmdNoAck(args));
 }
 
-NCmdEcho::NCmdEcho(JsonPtr const& inJson) : NetCommand(inJson) {
-    try {
-        _msg = inJson->at("msg");
-        LDEBUG("NCmdEcho seqId=", getSeqId(), " msg=", _msg);
-    } catch (json::exception const& ex) {
-        string eMsg = string("NCmdEcho constructor error in ") + inJson->dump() + " what=" + ex.what();
-        LERROR(eMsg);
-        throw NetCommandException(ERR_LOC, eMsg);
-    }
+NCmdEcho::Ptr NCmdEcho::create(JsonPtr const& inJson) { return Ptr(new NCmdEcho(NetCommandArgs(inJson))); }
 
-    ackJson["id"] = "ack";
-    ackJson["user_info"] = "echo";
+NCmdEcho::NCmdEcho(NetCommandArgs const& args) : NetCommand(args) {
+    args.decode(echoFields, _params);
+    LDEBUG("NCmdEcho seqId=", getSeqId(), " msg=", _params.msg);
+    setAckId("ack");
+    setAckUserInfo("echo");
 }
 
-NetCommand::Ptr NCmdEcho::createNewNetCommand(JsonPtr const& inJson) {
-    NCmdEcho::Ptr cmd = NCmdEcho::create(inJson);
-    return cmd;
+NetCommand::Ptr NCmdEcho::createNewNetCommand(NetCommandArgs const& args) {
+    return NCmdEcho::Ptr(new NCmdEcho(args));
 }
 
 bool NCmdEcho::action() {
-    respJson["msg"] = _msg;
+    respJsonExtra["msg"] = _params.msg;
     return true;
 }
 
@@ -22,15 +22,22 @@
 #define LSST_M2CELLCPP_CONTROL_NETCOMMAND_H
 
 // System headers
+#include <array>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <string_view>
+#include <variant>
 
 // Third party headers
 #include <nlohmann/json.hpp>
 
 // Project headers
+#include "control/SeqIdValidator.h"
+#include "util/clock_defs.h"
+#include "util/CommandExecutor.h"
 #include "util/Issue.h"
+#include "util/JsonScan.h"
 
 namespace LSST {
 namespace m2cellcpp {
@@ -47,15 +54,112 @@ public:
     NetCommandException(Context const& ctx, std::string const& msg) : util::Issue(ctx, msg) {}
 };
 
+/// Describes one command specific field. The value for `key` in the
+/// incoming json is decoded into `member` of the command's parameter
+/// struct `P`. Commands list their fields in a constexpr array of these.
+/// @see NetCommandArgs::decode
+template <typename P>
+struct NetField {
+    using Member = std::variant<bool P::*, int P::*, uint64_t P::*, double P::*, std::string P::*>;
+    char const* key;  ///< json key of the field.
+    Member member;    ///< Member of `P` that is set to the value.
+};
+
+/// The "id" and "sequence_id" of a received command, and a `util::JsonScan`
+/// of its text that command specific fields are decoded from.
+/// Instances only live while a command is being created, the text must
+/// outlive them.
+///
+/// unit test: test_NetCommand.cpp
+class NetCommandArgs {
+public:
+    using JsonPtr = std::shared_ptr<nlohmann::json>;
+
+    /// Use the `scan` of `text`, and the `name` and `seqId` already found in it.
+    NetCommandArgs(std::string_view text, util::JsonScan const& scan, std::string_view name, uint64_t seqId)
+            : _text(text), _scan(scan), _name(name), _seqId(seqId) {}
+
+    /// Arguments with only a `name` and `seqId`, and no other fields.
+    NetCommandArgs(std::string_view name, uint64_t seqId)
+            : _scan(std::string_view()), _name(name), _seqId(seqId) {}
+
+    /// Arguments from a parsed json object.
+    /// @throws NetCommandException if `inJson` is nullptr or is missing
+    ///         "id" or "sequence_id".
+    explicit NetCommandArgs(JsonPtr const& inJson);
+
+    NetCommandArgs() = delete;
+    NetCommandArgs(NetCommandArgs const&) = delete;
+    NetCommandArgs& operator=(NetCommandArgs const&) = delete;
+    ~NetCommandArgs() = default;
+
+    /// @return the command name, the value of "id".
+    std::string const& getName() const { return _name; }
+
+    /// @return the value of "sequence_id".
+    uint64_t getSeqId() const { return _seqId; }
+
+    /// Set the validator "sequence_id" is checked with, so commands made
+    /// while creating this one, like `NCmdBatch` items, are checked the same way.
+    void setSeqIds(SeqIdValidator::Ptr const& seqIds) { _seqIds = seqIds; }
+
+    /// @return the validator "sequence_id" is checked with, nullptr for the factory's.
+    SeqIdValidator::Ptr const& getSeqIds() const { return _seqIds; }
+
+    /// @return the text of the command.
+    std::string_view getText() const { return _text; }
+
+    /// @return the raw text of the value for `key`, or an empty view if it's missing.
+    std::string_view getRaw(std::string_view key) const { return _scan.getRaw(key); }
+
+    /// Set the members of `params` listed in `fields`.
+    /// @throws NetCommandException if a field is missing or has the wrong type.
+    template <typename P, size_t N>
+    void decode(std::array<NetField<P>, N> const& fields, P& params) const {
+        for (auto const& field : fields) {
+            std::visit([this, &field, &params](auto member) { get(field.key, params.*member); },
+                       field.member);
+        }
+    }
+
+    /// Set `out` to the value of `key`. Values that can't be read directly
+    /// from the text are converted by nlohmann::json, so the accepted values
+    /// are the same as a full parse.
+    /// @throws NetCommandException if `key` is missing or has the wrong type.
+    void get(std::string_view key, bool& out) const;
+    void get(std::string_view key, int& out) const;       ///< @see get(std::string_view, bool&)
+    void get(std::string_view key, uint64_t& out) const;  ///< @see get(std::string_view, bool&)
+    void get(std::string_view key, double& out) const;    ///< @see get(std::string_view, bool&)
+    void get(std::string_view key, std::string& out) const;  ///< @see get(std::string_view, bool&)
+
+private:
+    /// Set `out` from the json value in `raw`.
+    template <typename T>
+    void _getSlow(std::string_view key, std::string_view raw, T& out) const;
+
+    /// Throw a `NetCommandException` about `key`.
+    [[noreturn]] void _throwField(std::string_view key, std::string const& what) const;
+
+    std::string _ownedText;  ///< Text of a json object when it isn't provided.
+    std::string_view _text;  ///< Text of the command.
+    util::JsonScan _scan;    ///< Scan of `_text`.
+    std::string _name;       ///< Value of "id".
+    uint64_t _seqId = 0;     ///< Value of "sequence_id".
+    SeqIdValidator::Ptr _seqIds;  ///< Validator for "sequence_id", nullptr for the factory's.
+};
+
 /// The base class for all commands received over the network.
 ///
-/// The children of this class can be created from a `json` object
+/// The children of this class are created from `NetCommandArgs`
 /// where the "id" defines which child class will be used. "id"
-/// and "sequence_id" are the only parameters expected in all `json`
-/// objects. The child classes may require other keys be set.
-/// They should set `ackJson["id"] = "ack";` after all expected
-/// items have been parsed successfully, and throw
+/// and "sequence_id" are the only parameters expected in all
+/// commands. The child classes may require other keys be set, and
+/// list them in a constexpr table of `NetField` so they are decoded
+/// directly into a struct. They should call `setAckId("ack")` after all
+/// expected items have been decoded successfully, and throw
 /// NetCommandException when required items are missing/invalid.
+/// The ack and final response are written directly from their fields,
+/// producing the same text nlohmann::json would.
 ///
 /// The NetCommandFactory requires `FactoryVersions` of all the
 /// child classes it should understand. It uses the `FactoryVersion`
@@ -66,6 +170,10 @@ public:
 /// return a `FactoryVersion` instance of the child class.
 /// See `NCmdAck::createFactoryVersion()` for an example.
 ///
+/// Each command records the time it reached each `Stage` on its way from
+/// being read to its final response being written, which `NetCommandStats`
+/// turns into latency histograms.
+///
 /// Since basic communications errors should not crash the program,
 /// this class and its ilk should throw NetCommandException
 /// when problems arise so they can be caught before causing undue
@@ -78,6 +186,19 @@ public:
     using Ptr = std::shared_ptr<NetCommand>;
     using JsonPtr = std::shared_ptr<nlohmann::json>;
 
+    /// Points in the life of a command, in the order they happen.
+    enum Stage {
+        RECEIVED = 0,  ///< The command was read from the connection.
+        SCANNED,       ///< "id" and "sequence_id" were found.
+        LOOKED_UP,     ///< The `FactoryVersion` for "id" was found, or not.
+        CREATED,       ///< The command was created and its fields decoded.
+        ACK_SENT,      ///< The ack was written.
+        ACTION_START,  ///< `run()` was called.
+        ACTION_END,    ///< `run()` returned.
+        FINAL_SENT,    ///< The final response was written.
+        STAGE_COUNT
+    };
+
     NetCommand(NetCommand const&) = delete;
     NetCommand& operator=(NetCommand const&) = delete;
     virtual ~NetCommand() = default;
@@ -87,15 +208,19 @@ public:
     ///     a valid "id" and "sequence_id".
     /// @throw NetCommandException if there are issues with parsing
     ///     `inStr`
-    static JsonPtr parse(std::string const& inStr);
+    static JsonPtr parse(std::string_view inStr);
 
-    /// @return a new NetCommand child class object based on 'inJson'.
+    /// @return a new NetCommand child class object based on 'args'.
     /// This method is meant for use by NetCommandFactory. The child
     /// class implementations should return a new object of their
     /// class. The NCmdAck class should return a NCmdAck object,
     /// NCmdEcho should return a NCmdEcho object, etc.
     /// @throws NetCommandException if there are any problems.
-    virtual Ptr createNewNetCommand(JsonPtr const& inJson) = 0;
+    virtual Ptr createNewNetCommand(NetCommandArgs const& args) = 0;
+
+    /// @return a new NetCommand child class object based on 'inJson'.
+    /// @throws NetCommandException if there are any problems.
+    Ptr createNewNetCommand(JsonPtr const& inJson) { return createNewNetCommand(NetCommandArgs(inJson)); }
 
     /// @return the name of the command this specific class handles.
     /// Each child class should have a unique value returned for this command
@@ -105,6 +230,16 @@ public:
     /// same NetCommandFactory.
     virtual std::string getCommandName() const = 0;
 
+    /// @return the priority class of this command, commands in higher lanes
+    ///         are run before routine ones that are waiting for a thread.
+    virtual util::CommandExecutor::Lane getLane() const { return util::CommandExecutor::ROUTINE; }
+
+    /// @return true if this command only reads state, so it may run alongside,
+    ///         and finish before, earlier commands from the same connection.
+    ///         Commands that change anything must return false, the default,
+    ///         so they run one at a time in the order they were received.
+    virtual bool isIndependent() const { return false; }
+
     /// @return the command name that was parsed from `inJson`.
     std::string getName() const { return _name; }
 
@@ -112,10 +247,10 @@ public:
     uint64_t getSeqId() const { return _seqId; }
 
     /// Set the user_info json field.
-    void setAckUserInfo(std::string const& msg) { ackJson["user_info"] = msg; };
+    void setAckUserInfo(std::string const& msg) { _ackUserInfo = msg; };
 
-    /// Run the action function and set respJson["id"] to success or fail.
-    /// If the action() was successful, set respJson["id"] to "success".
+    /// Run the action function and set the response "id" to success or fail.
+    /// If the action() was successful, set the response "id" to "success".
     /// Otherwise, set it to "fail"
     /// @return true if the action() was successful.
     /// This will probably need to run in its own thread.
@@ -127,40 +262,66 @@ public:
     /// @return a json string version of the final response
     std::string getRespJsonStr();
 
+    /// @return the final response as json.
+    nlohmann::json getRespJson() const;
+
+    /// @return true if the command was acked, false if it will be noacked.
+    bool isAcked() const { return _ackId == "ack"; }
+
+    /// @return the "user_info" of the ack.
+    std::string getAckUserInfo() const { return _ackUserInfo; }
+
+    /// Record that the command reached `stage` at `tm`. Stages are set
+    /// by one thread at a time as the command is passed along.
+    void markStage(Stage stage, util::TIMEPOINT tm = util::CLOCK::now()) { _stageTimes[stage] = tm; }
+
+    /// @return the time `stage` was reached, or a default TIMEPOINT if it wasn't.
+    util::TIMEPOINT getStageTime(Stage stage) const { return _stageTimes[stage]; }
+
+    /// @return true if the command reached `stage`.
+    bool hasStage(Stage stage) const { return _stageTimes[stage] != util::TIMEPOINT(); }
+
 protected:
     /// Protected to ensure proper construction of enable_shared_From_this object.
-    /// @param json must contain "id" and "sequence_id" fields.
-    NetCommand(JsonPtr const& json);
+    NetCommand(NetCommandArgs const& args);
 
     /// Execute the action this particular NetCommand needs to take.
     /// @return true if successful.
     virtual bool action() = 0;
 
-    /// Throw a `NetCommandException` using the parameters given.
-    /// @param errLoc - The location where the error was caught.
-    /// @param funcName - The name of function where the error was caught
-    /// @param inJson - The command being handled.
-    /// @param ex - The json exception that was caught.
-    void throwNetCommandException(util::Issue::Context const& errLoc, std::string const& funcName,
-                                  JsonPtr const& inJson, nlohmann::json::exception const& ex) const;
+    /// Set the "id" of the ack, "ack" or "noack".
+    void setAckId(std::string const& id) { _ackId = id; }
+
+    /// Set the "user_info" of the final response.
+    void setRespUserInfo(std::string const& msg) { _respUserInfo = msg; }
 
     /// This consturctor is ONLY to be used in createFactoryVersion()/
     /// This constructor makes a dummy version of the object that is only
     /// used to create new instances of that class.
     /// The `action()` method of FactoryVersion instances should never be run.
-    /// @see NetCommandFactory::getCommandFor(std::string const& jsonStr)
-    /// @see createNewNetCommand(JsonPtr const& inJson)
+    /// @see NetCommandFactory::getCommandFor(std::string_view jsonStr)
+    /// @see createNewNetCommand(NetCommandArgs const& args)
     /// @see child class createFactoryVersion()
     NetCommand() = default;
-    JsonPtr inJson;  ///< json representation of the received command.
-    /// json used to create return ack.
-    nlohmann::json ackJson = {{"id", "noack"}, {"sequence_id", 0}, {"user_info", ""}};
-    /// json used to create the final response
-    nlohmann::json respJson = {{"id", "fail"}, {"sequence_id", 0}, {"user_info", ""}};
+
+    /// Fields added to the final response, other than "id", "sequence_id",
+    /// and "user_info". This is null unless a command sets something.
+    nlohmann::json respJsonExtra;
 
 private:
+    /// Return the json text for a message with `id` and `userInfo` and
+    /// the members of `extra`, if it is not null.
+    std::string _writeMsg(std::string const& id, std::string const& userInfo,
+                          nlohmann::json const* extra) const;
+
     std::string _name = "none";  ///< Name of the command as parsed from `inJson`.
     uint64_t _seqId = 0;         ///< Sequence number of command.
+    std::string _ackId = "noack";  ///< "id" of the ack.
+    std::string _ackUserInfo;      ///< "user_info" of the ack.
+    std::string _respId = "fail";  ///< "id" of the final response.
+    std::string _respUserInfo;     ///< "user_info" of the final response.
+
+    std::array<util::TIMEPOINT, STAGE_COUNT> _stageTimes{};  ///< Time each `Stage` was reached.
 };
 
 /// NetCommand to simply respond with an ack, and a success.
@@ -185,15 +346,18 @@ public:
     /// @return the name of the command this specific class handles.
     std::string getCommandName() const override { return "cmd_ack"; }
 
-    /// @return a new NCmdAck object using the parameters in 'inJson'
-    NetCommand::Ptr createNewNetCommand(JsonPtr const& inJson) override;
+    /// @return true, this doesn't change anything.
+    bool isIndependent() const override { return true; }
+
+    /// @return a new NCmdAck object using the parameters in 'args'
+    NetCommand::Ptr createNewNetCommand(NetCommandArgs const& args) override;
 
 protected:
     /// NCmdAck always succeeds
     bool action() override { return true; }
 
 private:
-    NCmdAck(JsonPtr const& json);
+    NCmdAck(NetCommandArgs const& args);
     NCmdAck() : NetCommand() {}
 };
 
@@ -221,26 +385,34 @@ public:
     /// @return the name of the command this specific class handles.
     std::string getCommandName() const override { return "cmd_noack"; }
 
-    /// @return a new NCmdNoAck object using the parameters in 'inJson'
-    NetCommand::Ptr createNewNetCommand(JsonPtr const& inJson) override;
+    /// @return true, this doesn't change anything.
+    bool isIndependent() const override { return true; }
+
+    /// @return a new NCmdNoAck object using the parameters in 'args'
+    NetCommand::Ptr createNewNetCommand(NetCommandArgs const& args) override;
 
 protected:
     // NCmdNoAck always fails
     bool action() override { return false; }
 
 private:
-    NCmdNoAck(JsonPtr const& json);
+    NCmdNoAck(NetCommandArgs const& args);
     NCmdNoAck() : NetCommand() {}
 };
 
-/// This class sends back the `inJson["msg"]` value in `respJson["msg"]`.
-/// `inJson["msg"]` is a required field for this command.
+/// This class sends back the "msg" value of the command in the "msg"
+/// of the final response. "msg" is a required field for this command.
 ///
 /// unit test: test_NetCommand.cpp
 class NCmdEcho : public NetCommand {
 public:
     using Ptr = std::shared_ptr<NCmdEcho>;
 
+    /// Fields of the command.
+    struct Params {
+        std::string msg;  ///< The message to echo.
+    };
+
     /// @return a new NCmdEcho object based on inJson.
     static Ptr create(JsonPtr const& inJson);
 
@@ -252,18 +424,21 @@ public:
     /// @return the name of the command this specific class handles.
     std::string getCommandName() const override { return "cmd_echo"; }
 
-    /// @return a new NCmdEcho object using the parameters in 'inJson'
-    NetCommand::Ptr createNewNetCommand(JsonPtr const& inJson) override;
+    /// @return true, this doesn't change anything.
+    bool isIndependent() const override { return true; }
+
+    /// @return a new NCmdEcho object using the parameters in 'args'
+    NetCommand::Ptr createNewNetCommand(NetCommandArgs const& args) override;
 
 protected:
     /// NCmdEcho echo back the message.
     bool action() override;
 
 private:
-    NCmdEcho(JsonPtr const& json);
+    NCmdEcho(NetCommandArgs const& args);
     NCmdEcho() : NetCommand() {}
 
-    std::string _msg;  ///< The message to echo.
+    Params _params;  ///< Decoded fields of the command.
 };
 
 }  // namespace control
@@ -23,15 +23,19 @@
 #include "control/NetCommandDefs.h"
 
 // System headers
+#include <algorithm>
 
 // Third party headers
 
 // Project headers
 #include "control/Context.h"
+#include "control/NetCommandFactory.h"
 #include "control/PowerSystem.h"
 #include "state/Model.h"
 #include "system/ComControlServer.h"
 #include "system/Globals.h"
+#include "system/NetStats.h"
+#include "util/JsonScan.h"
 #include "util/Log.h"
 
 using namespace std;
@@ -41,29 +45,35 @@ namespace LSST {
 namespace m2cellcpp {
 namespace control {
 
-NCmdSwitchCommandSource::Ptr NCmdSwitchCommandSource::create(JsonPtr const& inJson_) {
-    auto cmd = Ptr(new NCmdSwitchCommandSource(inJson_));
-    return cmd;
-}
+namespace {
 
-NCmdSwitchCommandSource::NCmdSwitchCommandSource(JsonPtr const& inJson) : NetCommand(inJson) {
-    try {
-        _isRemote = inJson->at("isRemote");
-        LDEBUG(__func__, " ", getCommandName(), " seqId=", getSeqId(), " isRemote=", _isRemote);
-    } catch (json::exception const& ex) {
-        throwNetCommandException(ERR_LOC, __func__, inJson, ex);
-    }
+/// Fields of `NCmdSwitchCommandSource`.
+constexpr array<NetField<NCmdSwitchCommandSource::Params>, 1> switchCommandSourceFields{
+        {{"isRemote", &NCmdSwitchCommandSource::Params::isRemote}}};
+
+/// Fields of `NCmdPower`.
+constexpr array<NetField<NCmdPower::Params>, 2> powerFields{
+        {{"powerType", &NCmdPower::Params::powerType}, {"status", &NCmdPower::Params::status}}};
 
-    ackJson["id"] = "ack";
-    ackJson["user_info"] = getCommandName() + " " + to_string(_isRemote);
+}  // namespace
+
+NCmdSwitchCommandSource::Ptr NCmdSwitchCommandSource::create(JsonPtr const& inJson) {
+    return Ptr(new NCmdSwitchCommandSource(NetCommandArgs(inJson)));
 }
 
-NetCommand::Ptr NCmdSwitchCommandSource::createNewNetCommand(JsonPtr const& inJson) {
-    return NCmdSwitchCommandSource::create(inJson);
+NCmdSwitchCommandSource::NCmdSwitchCommandSource(NetCommandArgs const& args) : NetCommand(args) {
+    args.decode(switchCommandSourceFields, _params);
+    LDEBUG(__func__, " ", getCommandName(), " seqId=", getSeqId(), " isRemote=", _params.isRemote);
+    setAckId("ack");
+    setAckUserInfo(getCommandName() + " " + to_string(_params.isRemote));
+}
+
+NetCommand::Ptr NCmdSwitchCommandSource::createNewNetCommand(NetCommandArgs const& args) {
+    return Ptr(new NCmdSwitchCommandSource(args));
 }
 
 bool NCmdSwitchCommandSource::action() {
-    bool result = system::Globals::get().setCommandSourceIsRemote(_isRemote);
+    bool result = system::Globals::get().setCommandSourceIsRemote(_params.isRemote);
     // This sets the CommandableByDds global, which needs to be broadcast.
     // This could be a duplicate broadcast, which is expected to be harmless.
     string msg = to_string(system::Globals::get().getCommandableByDdsJson());
@@ -74,34 +84,28 @@ bool NCmdSwitchCommandSource::action() {
     return result;
 }
 
-NCmdPower::Ptr NCmdPower::create(JsonPtr const& inJson_) {
-    auto cmd = Ptr(new NCmdPower(inJson_));
-    return cmd;
-}
+NCmdPower::Ptr NCmdPower::create(JsonPtr const& inJson) { return Ptr(new NCmdPower(NetCommandArgs(inJson))); }
 
-NCmdPower::NCmdPower(JsonPtr const& inJson) : NetCommand(inJson) {
-    LTRACE("NCmdPower::NCmdPower ", to_string(*inJson));
-    try {
-        int powerVal = inJson->at("powerType");
-        _powerType = intToPowerSystemType(powerVal);
-        _status = inJson->at("status");
-    } catch (json::exception const& ex) {
-        throwNetCommandException(ERR_LOC, __func__, inJson, ex);
-    }
+NCmdPower::NCmdPower(NetCommandArgs const& args) : NetCommand(args) {
+    LTRACE("NCmdPower::NCmdPower ", args.getText());
+    args.decode(powerFields, _params);
+    _powerType = intToPowerSystemType(_params.powerType);
     if (_powerType == UNKNOWNPOWERSYSTEM) {
-        throw NetCommandException(ERR_LOC, "unknown powerType in " + inJson->dump());
+        throw NetCommandException(ERR_LOC, "unknown powerType in " + string(args.getText()));
     }
     LDEBUG(__func__, " ", getCommandName(), " seqId=", getSeqId(),
-           " powerType=", getPowerSystemTypeStr(_powerType), " status=", _status);
-    ackJson["id"] = "ack";
-    ackJson["user_info"] = getCommandName() + " " + getPowerSystemTypeStr(_powerType) + to_string(_status);
+           " powerType=", getPowerSystemTypeStr(_powerType), " status=", _params.status);
+    setAckId("ack");
+    setAckUserInfo(getCommandName() + " " + getPowerSystemTypeStr(_powerType) + to_string(_params.status));
 }
 
-NetCommand::Ptr NCmdPower::createNewNetCommand(JsonPtr const& inJson) { return NCmdPower::create(inJson); }
+NetCommand::Ptr NCmdPower::createNewNetCommand(NetCommandArgs const& args) {
+    return Ptr(new NCmdPower(args));
+}
 
 bool NCmdPower::action() {
     auto context = Context::get();
-    bool result = context->model.getCurrentState()->cmdPower(_powerType, _status);
+    bool result = context->model.getCurrentState()->cmdPower(_powerType, _params.status);
 
     // Message that looks something like this needs to be broadcast
     // {'powerType': 2, 'status': True, 'id': 'cmd_power', 'sequence_id': 123}
@@ -118,17 +122,17 @@ bool NCmdPower::action() {
     return result;
 }
 
-NCmdSystemShutdown::Ptr NCmdSystemShutdown::create(JsonPtr const& inJson_) {
-    return Ptr(new NCmdSystemShutdown(inJson_));
+NCmdSystemShutdown::Ptr NCmdSystemShutdown::create(JsonPtr const& inJson) {
+    return Ptr(new NCmdSystemShutdown(NetCommandArgs(inJson)));
 }
 
-NCmdSystemShutdown::NCmdSystemShutdown(JsonPtr const& inJson) : NetCommand(inJson) {
-    ackJson["id"] = "ack";
-    ackJson["user_info"] = getCommandName();
+NCmdSystemShutdown::NCmdSystemShutdown(NetCommandArgs const& args) : NetCommand(args) {
+    setAckId("ack");
+    setAckUserInfo(getCommandName());
 }
 
-NetCommand::Ptr NCmdSystemShutdown::createNewNetCommand(JsonPtr const& inJson) {
-    return NCmdSystemShutdown::create(inJson);
+NetCommand::Ptr NCmdSystemShutdown::createNewNetCommand(NetCommandArgs const& args) {
+    return Ptr(new NCmdSystemShutdown(args));
 }
 
 bool NCmdSystemShutdown::action() {
@@ -143,6 +147,98 @@ bool NCmdSystemShutdown::action() {
     return true;
 }
 
+NCmdGetCommandStats::NCmdGetCommandStats(NetCommandArgs const& args, NetCommandStats::Ptr const& stats)
+        : NetCommand(args), _stats(stats) {
+    setAckId("ack");
+    setAckUserInfo(getCommandName());
+}
+
+NetCommand::Ptr NCmdGetCommandStats::createNewNetCommand(NetCommandArgs const& args) {
+    return Ptr(new NCmdGetCommandStats(args, _stats));
+}
+
+bool NCmdGetCommandStats::action() {
+    respJsonExtra["commandStats"] = _stats->getJson();
+    return true;
+}
+
+NCmdGetNetStats::NCmdGetNetStats(NetCommandArgs const& args) : NetCommand(args) {
+    setAckId("ack");
+    setAckUserInfo(getCommandName());
+}
+
+NetCommand::Ptr NCmdGetNetStats::createNewNetCommand(NetCommandArgs const& args) {
+    return Ptr(new NCmdGetNetStats(args));
+}
+
+bool NCmdGetNetStats::action() {
+    respJsonExtra["netStats"] = system::NetStats::getAllJson();
+    return true;
+}
+
+NCmdBatch::NCmdBatch(NetCommandArgs const& args, shared_ptr<NetCommandFactory> const& factory)
+        : NetCommand(args), _factory(factory) {
+    if (factory == nullptr) {
+        throw NetCommandException(ERR_LOC, "cmd_batch factory is gone");
+    }
+    vector<string_view> texts;
+    string_view raw = args.getRaw("commands");
+    if (raw.empty() || !util::JsonScan::splitArray(raw, texts)) {
+        throw NetCommandException(ERR_LOC, "cmd_batch commands missing or not an array");
+    }
+    if (texts.empty() || texts.size() > MAX_ITEMS) {
+        throw NetCommandException(ERR_LOC, "cmd_batch must have 1 to " + to_string(MAX_ITEMS) +
+                                                   " commands, found " + to_string(texts.size()));
+    }
+    _items.reserve(texts.size());
+    for (auto text : texts) {
+        util::JsonScan scan(text);
+        string_view itemId;
+        if (scan.getString("id", itemId) && itemId == getCommandName()) {
+            throw NetCommandException(ERR_LOC, "cmd_batch can't contain cmd_batch");
+        }
+        // Items are checked the same way as commands sent by themselves,
+        // including their sequence_id.
+        auto item = factory->getCommandFor(text, args.getSeqIds());
+        if (!item->isAcked()) {
+            throw NetCommandException(ERR_LOC, "cmd_batch item sequence_id=" + to_string(item->getSeqId()) +
+                                                       " " + item->getAckUserInfo());
+        }
+        _lane = max(_lane, item->getLane());
+        _independent = _independent && item->isIndependent();
+        _items.push_back(item);
+    }
+    LDEBUG(__func__, " ", getCommandName(), " seqId=", getSeqId(), " items=", _items.size());
+    setAckId("ack");
+    setAckUserInfo(getCommandName() + " " + to_string(_items.size()));
+}
+
+NetCommand::Ptr NCmdBatch::createNewNetCommand(NetCommandArgs const& args) {
+    return Ptr(new NCmdBatch(args, _factory.lock()));
+}
+
+bool NCmdBatch::action() {
+    json results = json::array();
+    bool ok = true;
+    for (auto const& item : _items) {
+        if (ok) {
+            ok = item->run();
+            results.push_back(item->getRespJson());
+            continue;
+        }
+        json js;
+        js["id"] = "fail";
+        js["sequence_id"] = item->getSeqId();
+        js["user_info"] = "not run, an earlier item failed";
+        results.push_back(move(js));
+    }
+    respJsonExtra["results"] = move(results);
+    if (!ok) {
+        setRespUserInfo("an item failed");
+    }
+    return ok;
+}
+
 }  // namespace control
 }  // namespace m2cellcpp
 }  // namespace LSST
@@ -22,12 +22,15 @@
 #define LSST_M2CELLCPP_CONTROL_NETCOMMANDDEFS_H
 
 // System headers
+#include <memory>
+#include <vector>
 
 // Third party headers
 
 // Project headers
 #include "control/control_defs.h"
 #include "control/NetCommand.h"
+#include "control/NetCommandStats.h"
 
 namespace LSST {
 namespace m2cellcpp {
@@ -44,6 +47,11 @@ class NCmdSwitchCommandSource : public NetCommand {
 public:
     using Ptr = std::shared_ptr<NCmdSwitchCommandSource>;
 
+    /// Fields of the command.
+    struct Params {
+        bool isRemote = true;  ///< Value of "isRemote" section of message.
+    };
+
     /// @return a new NCmdSwitchCommandSource object based on inJson.
     static Ptr create(JsonPtr const& inJson);
 
@@ -55,8 +63,8 @@ public:
     /// @return the name of the command this specific class handles.
     std::string getCommandName() const override { return "cmd_switchCommandSource"; }
 
-    /// @return a new NCmdNoAck object using the parameters in 'inJson'
-    NetCommand::Ptr createNewNetCommand(JsonPtr const& inJson) override;
+    /// @return a new NCmdSwitchCommandSource object using the parameters in 'args'
+    NetCommand::Ptr createNewNetCommand(NetCommandArgs const& args) override;
 
 protected:
     /// Set the value of `Globals::_commandableByDds` to the value of "isRemote",
@@ -64,10 +72,10 @@ protected:
     bool action() override;
 
 private:
-    NCmdSwitchCommandSource(JsonPtr const& json);
+    NCmdSwitchCommandSource(NetCommandArgs const& args);
     NCmdSwitchCommandSource() : NetCommand() {}
 
-    bool _isRemote = true;  ///< Value of "isRemote" section of message.
+    Params _params;  ///< Decoded fields of the command.
 };
 
 /// This class handles the "cmd_power" json message from a client.
@@ -85,6 +93,12 @@ class NCmdPower : public NetCommand {
 public:
     using Ptr = std::shared_ptr<NCmdPower>;
 
+    /// Fields of the command.
+    struct Params {
+        int powerType = 0;    ///< Value of "powerType", where 1 is `MOTOR` and 2 is `COMM`.
+        bool status = false;  ///< Value of "status", `true` means turn on.
+    };
+
     /// @return a new NCmdPower object based on inJson.
     static Ptr create(JsonPtr const& inJson);
 
@@ -96,22 +110,24 @@ public:
     /// @return the name of the command this specific class handles.
     std::string getCommandName() const override { return "cmd_power"; }
 
-    /// @return a new NCmdPower object using the parameters in 'inJson'
-    NetCommand::Ptr createNewNetCommand(JsonPtr const& inJson) override;
+    /// @return `POWER`, power changes go ahead of routine commands.
+    util::CommandExecutor::Lane getLane() const override { return util::CommandExecutor::POWER; }
+
+    /// @return a new NCmdPower object using the parameters in 'args'
+    NetCommand::Ptr createNewNetCommand(NetCommandArgs const& args) override;
 
 protected:
     /// Turn the `MOTOR` or `COMM` power on or off.
     bool action() override;
 
 private:
-    NCmdPower(JsonPtr const& json);
+    NCmdPower(NetCommandArgs const& args);
     NCmdPower() : NetCommand() {}
 
-    /// Value of "powerType" section of message, where 1 is `MOTOR` and 2 is `COMM`.
+    Params _params;  ///< Decoded fields of the command.
+
+    /// `PowerSystemType` of the "powerType" section of message.
     PowerSystemType _powerType = PowerSystemType::MOTOR;
-    /// Value of "status" section of message, where `true` means turn on, and `false`
-    /// means turn off.
-    bool _status = false;
 };
 
 /// This class handles the "cmd_systemShutdown" message.
@@ -134,18 +150,154 @@ public:
     /// @return the name of the command this specific class handles.
     std::string getCommandName() const override { return "cmd_systemShutdown"; }
 
-    /// @return a new NCmdSystemShutdown object using the parameters in 'inJson'
-    NetCommand::Ptr createNewNetCommand(JsonPtr const& inJson) override;
+    /// @return `SAFETY`, shutting down goes ahead of everything else.
+    util::CommandExecutor::Lane getLane() const override { return util::CommandExecutor::SAFETY; }
+
+    /// @return a new NCmdSystemShutdown object using the parameters in 'args'
+    NetCommand::Ptr createNewNetCommand(NetCommandArgs const& args) override;
 
 protected:
     /// Shutdown the entire system.
     bool action() override;
 
 private:
-    NCmdSystemShutdown(JsonPtr const& json);
+    NCmdSystemShutdown(NetCommandArgs const& args);
     NCmdSystemShutdown() : NetCommand() {}
 };
 
+/// This class handles the "cmd_getCommandStats" message, which returns the
+/// latency statistics of the commands handled by the factory.
+/// Expected message form is: {'id': 'cmd_getCommandStats', 'sequence_id': 123}
+/// The final response has "commandStats" with the json from `NetCommandStats::getJson()`.
+///
+/// unit test: test_ComControl.cpp
+class NCmdGetCommandStats : public NetCommand {
+public:
+    using Ptr = std::shared_ptr<NCmdGetCommandStats>;
+
+    virtual ~NCmdGetCommandStats() = default;
+
+    /// @return a version of NCmdGetCommandStats to be used to generate commands
+    ///         that report on `stats`.
+    static Ptr createFactoryVersion(NetCommandStats::Ptr const& stats) {
+        return Ptr(new NCmdGetCommandStats(stats));
+    }
+
+    /// @return the name of the command this specific class handles.
+    std::string getCommandName() const override { return "cmd_getCommandStats"; }
+
+    /// @return true, this only reads statistics.
+    bool isIndependent() const override { return true; }
+
+    /// @return a new NCmdGetCommandStats object using the parameters in 'args'
+    NetCommand::Ptr createNewNetCommand(NetCommandArgs const& args) override;
+
+protected:
+    /// Put the statistics in the final response.
+    bool action() override;
+
+private:
+    NCmdGetCommandStats(NetCommandArgs const& args, NetCommandStats::Ptr const& stats);
+    NCmdGetCommandStats(NetCommandStats::Ptr const& stats) : NetCommand(), _stats(stats) {}
+
+    NetCommandStats::Ptr _stats;  ///< The statistics to report.
+};
+
+/// This class handles the "cmd_getNetStats" message, which returns the
+/// network statistics of every server registered with `system::NetStats`.
+/// Expected message form is: {'id': 'cmd_getNetStats', 'sequence_id': 123}
+/// The final response has "netStats" with the json from `NetStats::getAllJson()`.
+///
+/// unit test: test_ComControl.cpp
+class NCmdGetNetStats : public NetCommand {
+public:
+    using Ptr = std::shared_ptr<NCmdGetNetStats>;
+
+    virtual ~NCmdGetNetStats() = default;
+
+    /// @return a version of NCmdGetNetStats to be used to generate commands.
+    static Ptr createFactoryVersion() { return Ptr(new NCmdGetNetStats()); }
+
+    /// @return the name of the command this specific class handles.
+    std::string getCommandName() const override { return "cmd_getNetStats"; }
+
+    /// @return true, this only reads statistics.
+    bool isIndependent() const override { return true; }
+
+    /// @return a new NCmdGetNetStats object using the parameters in 'args'
+    NetCommand::Ptr createNewNetCommand(NetCommandArgs const& args) override;
+
+protected:
+    /// Put the statistics in the final response.
+    bool action() override;
+
+private:
+    NCmdGetNetStats(NetCommandArgs const& args);
+    NCmdGetNetStats() : NetCommand() {}
+};
+
+/// This class handles the "cmd_batch" message, which carries an array of
+/// commands that are acked, run, and answered together.
+/// Expected message form is:
+/// {'id': 'cmd_batch', 'sequence_id': 123, 'commands': [
+///     {'id': 'cmd_echo', 'sequence_id': 124, 'msg': 'a'}, {'id': 'cmd_ack', 'sequence_id': 125}]}
+/// Each item must have a "sequence_id" larger than the one before it, as if
+/// it had been sent by itself. Batches can't be nested.
+/// If any item would be noacked, the batch is noacked and nothing is run.
+/// Otherwise the items are run in order, stopping at the first one that
+/// fails, and the final response has "results" with the final response of
+/// every item. Items after a failure are given "fail" without being run.
+/// The batch waits in the highest lane of its items, and is only
+/// independent of other commands if all of its items are.
+///
+/// unit test: test_NetCommand.cpp
+class NCmdBatch : public NetCommand {
+public:
+    using Ptr = std::shared_ptr<NCmdBatch>;
+
+    /// Maximum number of commands in one batch.
+    static constexpr size_t MAX_ITEMS = 100;
+
+    virtual ~NCmdBatch() = default;
+
+    /// @return a version of NCmdBatch to be used to generate commands,
+    ///         where the items are created by `factory`.
+    static Ptr createFactoryVersion(std::shared_ptr<NetCommandFactory> const& factory) {
+        return Ptr(new NCmdBatch(factory));
+    }
+
+    /// @return the name of the command this specific class handles.
+    std::string getCommandName() const override { return "cmd_batch"; }
+
+    /// @return a new NCmdBatch object using the parameters in 'args'
+    NetCommand::Ptr createNewNetCommand(NetCommandArgs const& args) override;
+
+    /// @return the highest lane of the items.
+    util::CommandExecutor::Lane getLane() const override { return _lane; }
+
+    /// @return true if all of the items are independent.
+    bool isIndependent() const override { return _independent; }
+
+    /// @return the commands in the batch.
+    std::vector<NetCommand::Ptr> const& getItems() const { return _items; }
+
+protected:
+    /// Run the items in order, stopping at the first failure.
+    bool action() override;
+
+private:
+    NCmdBatch(NetCommandArgs const& args, std::shared_ptr<NetCommandFactory> const& factory);
+    NCmdBatch(std::shared_ptr<NetCommandFactory> const& factory) : NetCommand(), _factory(factory) {}
+
+    /// Factory used to create the items, weak so the factory and its
+    /// `FactoryVersion`s don't keep each other alive.
+    std::weak_ptr<NetCommandFactory> _factory;
+
+    std::vector<NetCommand::Ptr> _items;              ///< The commands in the batch.
+    util::CommandExecutor::Lane _lane = util::CommandExecutor::ROUTINE;  ///< Highest lane of `_items`.
+    bool _independent = true;  ///< True if all `_items` are independent.
+};
+
 }  // namespace control
 }  // namespace m2cellcpp
 }  // namespace LSST
@@ -27,6 +27,8 @@
 // Third party headers
 
 // Project headers
+#include "util/Bug.h"
+#include "util/JsonScan.h"
 #include "util/Log.h"
 
 using namespace std;
@@ -44,6 +46,11 @@ NetCommandFactory::Ptr NetCommandFactory::create() {
 void NetCommandFactory::addNetCommand(NetCommand::Ptr const& cmd) {
     lock_guard<mutex> lg(_mtx);
     string cmdName = cmd->getCommandName();
+    if (_frozen) {
+        string eMsg = string("addNetCommand failed as the factory is frozen ") + cmdName;
+        LERROR(eMsg);
+        throw NetCommandException(ERR_LOC, eMsg);
+    }
     auto result = _cmdMap.emplace(cmdName, cmd);
     if (result.second == false) {
         string eMsg = string("addNetCommand failed as this command was already in the map ") + cmdName;
@@ -52,55 +59,123 @@ void NetCommandFactory::addNetCommand(NetCommand::Ptr const& cmd) {
     }
 }
 
-NetCommand::Ptr NetCommandFactory::getCommandFor(std::string const& jsonStr) {
-    auto inJson = NetCommand::parse(jsonStr);
+void NetCommandFactory::freeze() {
     lock_guard<mutex> lg(_mtx);
-    // If parse didn't throw, there must be a valid id and sequence_id.
-    string cmdId = inJson->at("id");
-    uint64_t seqId = inJson->at("sequence_id");
-    NetCommand::Ptr cmdOut;
-    // Check if seqId is valid (must be larger than the previous one)
-    if (seqId <= _prevSeqId) {
-        string badSeqId = string("Bad sequence_id ") + to_string(seqId) + " " + cmdId +
-                          " previous sequence_id was " + to_string(_prevSeqId);
+    _frozen = true;
+}
+
+NetCommand::Ptr NetCommandFactory::getCommandFor(std::string_view jsonStr,
+                                                 SeqIdValidator::Ptr const& seqIds) {
+    // Find the id and sequence_id without building a json tree.
+    util::JsonScan scan(jsonStr);
+    string_view idView;
+    uint64_t seqId = 0;
+    if (!scan.isValid() || scan.hasEscapedKeys() || !scan.getString("id", idView) ||
+        !scan.getUInt64("sequence_id", seqId) || idView.find('\\') != string_view::npos) {
+        // Broken or unusual, the full parser will throw on anything that's really wrong.
+        // `scan` only accepts valid json, so text that isn't json always throws here,
+        // before its sequence_id is checked.
+        // Escaped keys may duplicate others once unescaped, so nlohmann::json decides.
+        // An id with escapes can't be a valid command, but its name should be unescaped.
+        auto inJson = NetCommand::parse(jsonStr);
+        NetCommandArgs args(inJson);
+        args.setSeqIds(seqIds);
+        return _getCommandFor(args, util::CLOCK::now());
+    }
+    NetCommandArgs args(jsonStr, scan, idView, seqId);
+    args.setSeqIds(seqIds);
+    return _getCommandFor(args, util::CLOCK::now());
+}
+
+void NetCommandFactory::setSeqIdPolicy(SeqIdValidator::Policy policy, unsigned int window) {
+    if (policy == SeqIdValidator::WINDOWED && (window == 0 || window > SeqIdValidator::MAX_WINDOW)) {
+        throw util::Bug(ERR_LOC, "NetCommandFactory windowed sequence_id window must be 1 to " +
+                                         to_string(SeqIdValidator::MAX_WINDOW) + " not " + to_string(window));
+    }
+    LINFO("NetCommandFactory sequence_id policy ", SeqIdValidator::getPolicyName(policy), " window=", window);
+    _seqIdWindow = (policy == SeqIdValidator::WINDOWED) ? window : 0;
+    _seqIdPolicy = policy;
+}
+
+SeqIdValidator::Ptr NetCommandFactory::makeSeqIdValidator() {
+    if (_seqIdPolicy == SeqIdValidator::STRICT) {
+        return _seqIds;
+    }
+    return SeqIdValidator::create(_seqIdWindow);
+}
+
+NetCommand::Ptr NetCommandFactory::_getCommandFor(NetCommandArgs const& args, util::TIMEPOINT scanned) {
+    string const& cmdId = args.getName();
+    uint64_t seqId = args.getSeqId();
+    // Check if seqId is valid, which doesn't lock.
+    auto const& seqIds = (args.getSeqIds() != nullptr) ? args.getSeqIds() : _seqIds;
+    string why;
+    if (!seqIds->check(seqId, why)) {
+        string badSeqId = string("Bad sequence_id ") + to_string(seqId) + " " + cmdId + " " + why;
         LWARN("getCommandFor sequence_id ", seqId, " ", cmdId, badSeqId, " returning ",
               _defaultNoAck->getCommandName());
-        cmdOut = _defaultNoAck->createNewNetCommand(inJson);
-        cmdOut->setAckUserInfo(badSeqId);
-        return cmdOut;
+        return _stamp(_makeNoAck(cmdId, seqId, badSeqId), scanned, util::TIMEPOINT());
     }
-    _prevSeqId = seqId;
-    auto iter = _cmdMap.find(cmdId);
-    if (iter == _cmdMap.end()) {
+
+    NetCommand::Ptr cmdFactory = _findCommand(cmdId);
+    auto lookedUp = util::CLOCK::now();
+    if (cmdFactory == nullptr) {
         LWARN("getCommandFor ", cmdId, " not found. Returning defaultNoAck", _defaultNoAck->getCommandName());
-        cmdOut = _defaultNoAck->createNewNetCommand(inJson);
-        cmdOut->setAckUserInfo(string("Original command not found " + cmdId));
-        return cmdOut;
+        return _stamp(_makeNoAck(cmdId, seqId, string("Original command not found " + cmdId)), scanned,
+                      lookedUp);
     }
-    auto& cmdFactory = iter->second;
-    // If there are errors in 'inJson', this should throw NetCommandException.
+    // If there are errors in 'args', this should throw NetCommandException.
     try {
-        cmdOut = cmdFactory->createNewNetCommand(inJson);
+        return _stamp(cmdFactory->createNewNetCommand(args), scanned, lookedUp);
     } catch (NetCommandException const& ex) {
         LWARN("getCommandFor invalid json ", ex.what(), " Returning defaultNoAck",
               _defaultNoAck->getCommandName());
-        cmdOut = _defaultNoAck->createNewNetCommand(inJson);
-        cmdOut->setAckUserInfo(string("Invalid json ") + ex.what());
-        return cmdOut;
+        return _stamp(_makeNoAck(cmdId, seqId, string("Invalid json ") + ex.what()), scanned, lookedUp);
+    }
+}
+
+NetCommand::Ptr NetCommandFactory::_stamp(NetCommand::Ptr const& cmd, util::TIMEPOINT scanned,
+                                          util::TIMEPOINT lookedUp) {
+    cmd->markStage(NetCommand::SCANNED, scanned);
+    cmd->markStage(NetCommand::LOOKED_UP, lookedUp);
+    cmd->markStage(NetCommand::CREATED);
+    return cmd;
+}
+
+util::CommandExecutor::Lane NetCommandFactory::getLaneFor(string_view cmdId) {
+    auto cmdFactory = _findCommand(cmdId);
+    return (cmdFactory == nullptr) ? util::CommandExecutor::ROUTINE : cmdFactory->getLane();
+}
+
+NetCommand::Ptr NetCommandFactory::_findCommand(string_view cmdId) {
+    // Once frozen, `_cmdMap` never changes and can be read without locking.
+    if (_frozen) {
+        auto iter = _cmdMap.find(cmdId);
+        return (iter == _cmdMap.end()) ? nullptr : iter->second;
     }
+    lock_guard<mutex> lg(_mtx);
+    auto iter = _cmdMap.find(cmdId);
+    return (iter == _cmdMap.end()) ? nullptr : iter->second;
+}
+
+NetCommand::Ptr NetCommandFactory::_makeNoAck(string const& cmdId, uint64_t seqId, string const& userInfo) {
+    // The noack only needs the id and sequence_id.
+    auto cmdOut = _defaultNoAck->createNewNetCommand(NetCommandArgs(cmdId, seqId));
+    cmdOut->setAckUserInfo(userInfo);
     return cmdOut;
 }
 
+NetCommand::Ptr NetCommandFactory::getBusyNoAck(uint64_t seqId, string const& userInfo) {
+    return _makeNoAck("busy", seqId, userInfo);
+}
+
 NetCommand::Ptr NetCommandFactory::getNoAck() {
     // If this function is being called, the incoming message is probably too
     // garbled to be parsed. Make a fake one.
     // The client should proabably break the connection when it sees a bad
     // sequence number.
-    NetCommand::JsonPtr inJson = std::shared_ptr<nlohmann::json>(new nlohmann::json());
-    nlohmann::json& js = *inJson;
-    js["id"] = "noack";  // This will be overwritten by the default.
-    js["sequence_id"] = 0;
-    auto cmdOut = _defaultNoAck->createNewNetCommand(inJson);
+    // "noack" will be overwritten by the default.
+    auto cmdOut = _defaultNoAck->createNewNetCommand(NetCommandArgs("noack", 0));
     cmdOut->setAckUserInfo("factory default noack");
     return cmdOut;
 }
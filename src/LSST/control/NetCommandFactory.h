@@ -22,14 +22,19 @@
 #define LSST_M2CELLCPP_CONTROL_NETCOMMANDFACTORY_H
 
 // System headers
+#include <atomic>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <string_view>
 
 // Third party headers
 
 // Project headers
 #include "control/NetCommand.h"
+#include "control/NetCommandStats.h"
+#include "control/SeqIdValidator.h"
 
 namespace LSST {
 namespace m2cellcpp {
@@ -45,6 +50,15 @@ namespace control {
 /// The list of commands is represented by a list of `FactoryVersion` of NetCommand
 /// child instances. The child instances are used to return a new instance of
 /// the same class using the virtual `createNewNetCommand` member function.
+/// Once the commands have been added, `freeze()` is called and the map of
+/// commands is read without locking from then on.
+/// Commands are given the times they were scanned, looked up, and created,
+/// and the factory's `NetCommandStats` collects their latencies.
+///
+/// The "sequence_id" of each command is checked by a `SeqIdValidator`.
+/// With the STRICT policy, every connection uses the factory's `_seqIds`,
+/// otherwise each connection gets its own from `makeSeqIdValidator()`, so
+/// connections sharing the factory don't reject each other's ids.
 ///
 /// unit test: test_NetCommand.cpp
 class NetCommandFactory : public std::enable_shared_from_this<NetCommandFactory> {
@@ -55,14 +69,44 @@ public:
     static Ptr create();
 
     /// Add a NetCommand to the map of know commands.
-    /// @throws NetCommandException if the cmd is already in the map.
+    /// @throws NetCommandException if the cmd is already in the map or
+    ///         `freeze()` has been called.
     void addNetCommand(NetCommand::Ptr const& cmd);
 
+    /// Prevent any more commands from being added, after which looking up
+    /// commands doesn't need a lock.
+    void freeze();
+
+    /// @return true if `freeze()` has been called.
+    bool isFrozen() const { return _frozen; }
+
     /// Get the NetCommand appropriate for the jsonStr.
+    /// The "id" and "sequence_id" are found with `util::JsonScan`, and
+    /// `jsonStr` is only fully parsed once it is known which command will
+    /// be created from it. Text that isn't valid json throws before its
+    /// "sequence_id" is checked, so it doesn't use up that "sequence_id".
+    /// @param seqIds - checks the "sequence_id", nullptr uses `_seqIds`.
     /// @return Appropriate NetCommand. _defaultNoAck is returned on
     ///         unknown commands that have a parsable id and sequence_id.
     /// @throws NetCommandException if there are any problems.
-    NetCommand::Ptr getCommandFor(std::string const& jsonStr);
+    NetCommand::Ptr getCommandFor(std::string_view jsonStr, SeqIdValidator::Ptr const& seqIds = nullptr);
+
+    /// @return the lane of the `FactoryVersion` for `cmdId`, ROUTINE if there
+    ///         isn't one. A `cmd_batch` is ROUTINE here, as its items are unknown.
+    util::CommandExecutor::Lane getLaneFor(std::string_view cmdId);
+
+    /// Set how "sequence_id"s are checked for connections that call
+    /// `makeSeqIdValidator()` after this, `window` is only used by WINDOWED.
+    /// The default is STRICT.
+    /// @throws util::Bug if `window` is 0 or too large for WINDOWED.
+    void setSeqIdPolicy(SeqIdValidator::Policy policy, unsigned int window);
+
+    /// @return the policy for checking "sequence_id"s.
+    SeqIdValidator::Policy getSeqIdPolicy() const { return _seqIdPolicy; }
+
+    /// @return the validator for a new connection to pass to `getCommandFor()`,
+    ///         which is `_seqIds` for STRICT and a new one otherwise.
+    SeqIdValidator::Ptr makeSeqIdValidator();
 
     /// Used to change the value of _defaultNoAck if NCmdNoAck is incorrect.
     void setDefaultNoAck();
@@ -70,16 +114,48 @@ public:
     /// @return an instance of the `_defaultNoAck` command with seqId=0.
     NetCommand::Ptr getNoAck();
 
+    /// @return an instance of the `_defaultNoAck` command for a command with
+    ///         `seqId` that was rejected before being parsed, with the ack
+    ///         "user_info" set to `userInfo`. The previous seqId isn't changed.
+    NetCommand::Ptr getBusyNoAck(uint64_t seqId, std::string const& userInfo);
+
+    /// @return the latency statistics for commands from this factory.
+    NetCommandStats::Ptr getStats() const { return _stats; }
+
 private:
     NetCommandFactory() = default;
 
+    /// Return the NetCommand for `args`, which had "id" and "sequence_id" found at `scanned`.
+    /// The "sequence_id" is checked with `args.getSeqIds()`, or `_seqIds` if that is nullptr.
+    NetCommand::Ptr _getCommandFor(NetCommandArgs const& args, util::TIMEPOINT scanned);
+
+    /// Return `cmd` after giving it the times it was scanned and looked up,
+    /// and now as the time it was created.
+    static NetCommand::Ptr _stamp(NetCommand::Ptr const& cmd, util::TIMEPOINT scanned,
+                                  util::TIMEPOINT lookedUp);
+
+    /// Return the `FactoryVersion` for `cmdId`, or nullptr if there isn't one.
+    NetCommand::Ptr _findCommand(std::string_view cmdId);
+
+    /// Return an instance of `_defaultNoAck` for `cmdId` and `seqId` with the
+    /// ack "user_info" set to `userInfo`.
+    NetCommand::Ptr _makeNoAck(std::string const& cmdId, uint64_t seqId, std::string const& userInfo);
+
     /// The command to use when there are lesser parsing problems
     /// or unknown commands.
     NetCommand::Ptr _defaultNoAck{NCmdNoAck::createFactoryVersion()};
 
-    std::mutex _mtx;  ///< protects _cmdMap, _prevSeqId;
-    std::map<std::string, std::shared_ptr<NetCommand>> _cmdMap;
-    uint64_t _prevSeqId = 0;  ///< Value of the previous seqId.
+    std::mutex _mtx;  ///< protects _cmdMap until `_frozen` is true.
+    /// Map of command names to `FactoryVersion`s.
+    std::map<std::string, std::shared_ptr<NetCommand>, std::less<>> _cmdMap;
+    std::atomic<bool> _frozen{false};  ///< Set to true by `freeze()`.
+
+    /// Checks ids for all connections with the STRICT policy.
+    SeqIdValidator::Ptr _seqIds{SeqIdValidator::create()};
+    std::atomic<SeqIdValidator::Policy> _seqIdPolicy{SeqIdValidator::STRICT};  ///< See `setSeqIdPolicy()`.
+    std::atomic<unsigned int> _seqIdWindow{0};  ///< Window for new WINDOWED validators.
+
+    NetCommandStats::Ptr _stats{NetCommandStats::create()};  ///< Latencies of commands.
 };
 
 }  // namespace control
@@ -0,0 +1,157 @@
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+// Class header
+#include "control/NetCommandStats.h"
+
+// System headers
+#include <sstream>
+
+// Third party headers
+
+// Project headers
+#include "util/Log.h"
+
+using namespace std;
+using json = nlohmann::json;
+
+namespace LSST {
+namespace m2cellcpp {
+namespace control {
+
+namespace {
+
+/// The stages that begin and end each `NetCommandStats::Interval`.
+struct IntervalStages {
+    NetCommand::Stage begin;
+    NetCommand::Stage end;
+};
+
+constexpr array<IntervalStages, NetCommandStats::INTERVAL_COUNT> intervalStages{
+        {{NetCommand::RECEIVED, NetCommand::SCANNED},
+         {NetCommand::SCANNED, NetCommand::LOOKED_UP},
+         {NetCommand::LOOKED_UP, NetCommand::CREATED},
+         {NetCommand::CREATED, NetCommand::ACK_SENT},
+         {NetCommand::ACK_SENT, NetCommand::ACTION_START},
+         {NetCommand::ACTION_START, NetCommand::ACTION_END},
+         {NetCommand::ACTION_END, NetCommand::FINAL_SENT},
+         {NetCommand::RECEIVED, NetCommand::FINAL_SENT}}};
+
+}  // namespace
+
+string NetCommandStats::getIntervalName(Interval interval) {
+    switch (interval) {
+        case SCAN:
+            return "scan";
+        case LOOKUP:
+            return "lookup";
+        case CREATE:
+            return "create";
+        case ACK_WRITE:
+            return "ackWrite";
+        case QUEUE:
+            return "queue";
+        case ACTION:
+            return "action";
+        case FINAL_WRITE:
+            return "finalWrite";
+        case TOTAL:
+            return "total";
+        default:
+            return "unknown";
+    }
+}
+
+void NetCommandStats::record(NetCommand const& cmd) {
+    {
+        lock_guard<mutex> lg(_mtx);
+        Histograms& hists = _stats[cmd.getName()];
+        for (unsigned int j = 0; j < INTERVAL_COUNT; ++j) {
+            auto const& st = intervalStages[j];
+            if (!cmd.hasStage(st.begin) || !cmd.hasStage(st.end)) {
+                continue;
+            }
+            auto diff = cmd.getStageTime(st.end) - cmd.getStageTime(st.begin);
+            auto micros = chrono::duration_cast<chrono::microseconds>(diff).count();
+            hists[j].record((micros < 0) ? 0 : micros);
+        }
+        if (_logInterval.count() == 0) {
+            return;
+        }
+        auto now = util::CLOCK::now();
+        if (now - _lastLog < _logInterval) {
+            return;
+        }
+        _lastLog = now;
+    }
+    // Logging is done without holding `_mtx`.
+    LINFO("NetCommandStats\n", getSummary());
+}
+
+void NetCommandStats::setLogInterval(unsigned int seconds) {
+    lock_guard<mutex> lg(_mtx);
+    _logInterval = chrono::seconds(seconds);
+    _lastLog = util::CLOCK::now();
+}
+
+NetCommandStats::Histograms NetCommandStats::getHistograms(string const& cmdName) const {
+    lock_guard<mutex> lg(_mtx);
+    auto iter = _stats.find(cmdName);
+    return (iter == _stats.end()) ? Histograms() : iter->second;
+}
+
+json NetCommandStats::getJson() const {
+    lock_guard<mutex> lg(_mtx);
+    json js = json::object();
+    for (auto const& [name, hists] : _stats) {
+        json& jCmd = js[name];
+        for (unsigned int j = 0; j < INTERVAL_COUNT; ++j) {
+            auto const& hist = hists[j];
+            json& jInt = jCmd[getIntervalName(static_cast<Interval>(j))];
+            jInt["count"] = hist.getCount();
+            jInt["min"] = hist.getMin();
+            jInt["p50"] = hist.getPercentile(50.0);
+            jInt["p90"] = hist.getPercentile(90.0);
+            jInt["p99"] = hist.getPercentile(99.0);
+            jInt["max"] = hist.getMax();
+            jInt["mean"] = hist.getMean();
+        }
+    }
+    return js;
+}
+
+string NetCommandStats::getSummary() const {
+    lock_guard<mutex> lg(_mtx);
+    stringstream os;
+    for (auto const& [name, hists] : _stats) {
+        os << name << " total(us) " << hists[TOTAL].getSummary() << "\n";
+    }
+    return os.str();
+}
+
+void NetCommandStats::reset() {
+    lock_guard<mutex> lg(_mtx);
+    _stats.clear();
+}
+
+}  // namespace control
+}  // namespace m2cellcpp
+}  // namespace LSST
@@ -0,0 +1,114 @@
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+#ifndef LSST_M2CELLCPP_CONTROL_NETCOMMANDSTATS_H
+#define LSST_M2CELLCPP_CONTROL_NETCOMMANDSTATS_H
+
+// System headers
+#include <array>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Third party headers
+#include "nlohmann/json.hpp"
+
+// Project headers
+#include "control/NetCommand.h"
+#include "util/clock_defs.h"
+#include "util/LatencyHistogram.h"
+
+namespace LSST {
+namespace m2cellcpp {
+namespace control {
+
+/// This class keeps latency histograms, per command name, of the time
+/// NetCommands spend between the `NetCommand::Stage`s they pass through.
+/// `record()` is called once a command's final response has been written.
+/// If a log interval is set, a summary is logged from `record()` at most
+/// once per interval.
+///
+/// unit test: test_NetCommand.cpp
+class NetCommandStats {
+public:
+    using Ptr = std::shared_ptr<NetCommandStats>;
+
+    /// Spans of time between two `NetCommand::Stage`s.
+    enum Interval {
+        SCAN = 0,     ///< RECEIVED to SCANNED.
+        LOOKUP,       ///< SCANNED to LOOKED_UP.
+        CREATE,       ///< LOOKED_UP to CREATED.
+        ACK_WRITE,    ///< CREATED to ACK_SENT.
+        QUEUE,        ///< ACK_SENT to ACTION_START, time waiting in the CommandExecutor.
+        ACTION,       ///< ACTION_START to ACTION_END.
+        FINAL_WRITE,  ///< ACTION_END to FINAL_SENT.
+        TOTAL,        ///< RECEIVED to FINAL_SENT.
+        INTERVAL_COUNT
+    };
+
+    /// Histograms for each `Interval`.
+    using Histograms = std::array<util::LatencyHistogram, INTERVAL_COUNT>;
+
+    static Ptr create() { return Ptr(new NetCommandStats()); }
+
+    NetCommandStats(NetCommandStats const&) = delete;
+    NetCommandStats& operator=(NetCommandStats const&) = delete;
+    ~NetCommandStats() = default;
+
+    /// @return the name of `interval`, as used in `getJson()`.
+    static std::string getIntervalName(Interval interval);
+
+    /// Add the intervals of `cmd` to the histograms for its name. Intervals
+    /// where either stage wasn't reached are skipped.
+    void record(NetCommand const& cmd);
+
+    /// Log a summary from `record()` no more than once every `seconds`,
+    /// 0 turns logging off.
+    void setLogInterval(unsigned int seconds);
+
+    /// @return a copy of the histograms for `cmdName`, which are empty
+    ///         if no commands with that name were recorded.
+    Histograms getHistograms(std::string const& cmdName) const;
+
+    /// @return json with count, min, p50, p90, p99, max, and mean in
+    ///         microseconds for every interval of every command recorded.
+    nlohmann::json getJson() const;
+
+    /// @return one line per command with the summary of its TOTAL interval.
+    std::string getSummary() const;
+
+    /// Remove all recorded values.
+    void reset();
+
+private:
+    NetCommandStats() = default;
+
+    mutable std::mutex _mtx;                   ///< Protects all members.
+    std::map<std::string, Histograms> _stats;  ///< Histograms with the key being command name.
+    std::chrono::seconds _logInterval{0};      ///< Time between log summaries, 0 is off.
+    util::TIMEPOINT _lastLog;                  ///< Time of the last log summary.
+};
+
+}  // namespace control
+}  // namespace m2cellcpp
+}  // namespace LSST
+
+#endif  // LSST_M2CELLCPP_CONTROL_NETCOMMANDSTATS_H
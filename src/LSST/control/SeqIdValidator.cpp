@@ -0,0 +1,118 @@
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+// Class header
+#include "control/SeqIdValidator.h"
+
+// Project headers
+#include "util/Bug.h"
+
+using namespace std;
+
+namespace LSST {
+namespace m2cellcpp {
+namespace control {
+
+SeqIdValidator::SeqIdValidator(unsigned int window) : _window(window) {
+    if (_window > MAX_WINDOW) {
+        throw util::Bug(ERR_LOC, "SeqIdValidator window " + to_string(_window) + " is larger than " +
+                                         to_string(MAX_WINDOW));
+    }
+    if (_window > 0) {
+        _slots.reset(new atomic<uint64_t>[_window]);
+        for (unsigned int j = 0; j < _window; ++j) {
+            _slots[j] = 0;
+        }
+    }
+}
+
+SeqIdValidator::Policy SeqIdValidator::parsePolicy(string const& name) {
+    if (name == "strict") {
+        return STRICT;
+    }
+    if (name == "perConnection") {
+        return PER_CONNECTION;
+    }
+    if (name == "windowed") {
+        return WINDOWED;
+    }
+    throw util::Bug(ERR_LOC, "SeqIdValidator unknown policy " + name);
+}
+
+string SeqIdValidator::getPolicyName(Policy policy) {
+    switch (policy) {
+        case STRICT:
+            return "strict";
+        case PER_CONNECTION:
+            return "perConnection";
+        case WINDOWED:
+            return "windowed";
+    }
+    return "unknown";
+}
+
+bool SeqIdValidator::check(uint64_t seqId, string& why) {
+    bool ok = (_window == 0) ? _checkIncreasing(seqId, why) : _checkWindowed(seqId, why);
+    if (!ok) {
+        ++_rejectedCount;
+    }
+    return ok;
+}
+
+bool SeqIdValidator::_checkIncreasing(uint64_t seqId, string& why) {
+    uint64_t highest = _highest;
+    do {
+        if (seqId <= highest) {
+            why = "previous sequence_id was " + to_string(highest);
+            return false;
+        }
+    } while (!_highest.compare_exchange_weak(highest, seqId));
+    return true;
+}
+
+bool SeqIdValidator::_checkWindowed(uint64_t seqId, string& why) {
+    uint64_t highest = _highest;
+    // Written so it can't overflow for ids near UINT64_MAX.
+    if (seqId == 0 || (highest >= _window && seqId <= highest - _window)) {
+        why = "more than " + to_string(_window) + " below highest sequence_id " + to_string(highest);
+        return false;
+    }
+    // Only one caller can change the slot from an older id to `seqId`.
+    auto& slot = _slots[seqId % _window];
+    uint64_t prev = slot;
+    do {
+        if (prev == seqId) {
+            why = "sequence_id " + to_string(seqId) + " was already used";
+            return false;
+        }
+        if (prev > seqId) {
+            why = "more than " + to_string(_window) + " below sequence_id " + to_string(prev);
+            return false;
+        }
+    } while (!slot.compare_exchange_weak(prev, seqId));
+    while (seqId > highest && !_highest.compare_exchange_weak(highest, seqId)) {
+    }
+    return true;
+}
+
+}  // namespace control
+}  // namespace m2cellcpp
+}  // namespace LSST
@@ -0,0 +1,114 @@
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+#ifndef LSST_M2CELLCPP_CONTROL_SEQIDVALIDATOR_H
+#define LSST_M2CELLCPP_CONTROL_SEQIDVALIDATOR_H
+
+// System headers
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Project headers
+
+namespace LSST {
+namespace m2cellcpp {
+namespace control {
+
+/// This class checks that the "sequence_id" of each command is new,
+/// using compare-and-swap instead of a lock.
+///
+/// With a window of 0, each id must be larger than the highest one
+/// accepted so far. With a window of N, ids up to N below the highest are
+/// also accepted, but only once each, so commands that were pipelined, or
+/// sent from several threads, may arrive somewhat out of order. Each id is
+/// claimed in a slot for `id % N`, which is what rejects repeats. The
+/// highest id is raised after the slot is claimed, so an id accepted at the
+/// same moment the highest passes it may be slightly older than the window.
+///
+/// `NetCommandFactory` uses one validator for all connections with the
+/// STRICT policy, and gives each connection its own otherwise.
+///
+/// unit test: test_NetCommand.cpp
+class SeqIdValidator {
+public:
+    using Ptr = std::shared_ptr<SeqIdValidator>;
+
+    /// How "sequence_id"s are checked.
+    enum Policy {
+        STRICT = 0,      ///< Ids must increase across all connections.
+        PER_CONNECTION,  ///< Ids must increase on each connection.
+        WINDOWED         ///< Ids on each connection must be new and within the window.
+    };
+
+    /// Largest window allowed.
+    static constexpr unsigned int MAX_WINDOW = 4096;
+
+    /// Return a new validator, where a `window` of 0 requires increasing ids.
+    /// @throws util::Bug if `window` is larger than `MAX_WINDOW`.
+    static Ptr create(unsigned int window = 0) { return Ptr(new SeqIdValidator(window)); }
+
+    /// Return the Policy for `name`, which is "strict", "perConnection", or "windowed".
+    /// @throws util::Bug if `name` isn't one of them.
+    static Policy parsePolicy(std::string const& name);
+
+    /// Return the name of `policy`, as used by `parsePolicy`.
+    static std::string getPolicyName(Policy policy);
+
+    SeqIdValidator() = delete;
+    SeqIdValidator(SeqIdValidator const&) = delete;
+    SeqIdValidator& operator=(SeqIdValidator const&) = delete;
+    ~SeqIdValidator() = default;
+
+    /// Accept `seqId` if it is new, this is safe to call from any thread.
+    /// @return true if `seqId` was accepted, otherwise `why` is set to the reason.
+    bool check(uint64_t seqId, std::string& why);
+
+    /// Return the highest id accepted, 0 if there are none.
+    uint64_t getHighest() const { return _highest; }
+
+    /// Return the window, 0 if ids must increase.
+    unsigned int getWindow() const { return _window; }
+
+    /// Return the number of ids rejected.
+    uint64_t getRejectedCount() const { return _rejectedCount; }
+
+private:
+    explicit SeqIdValidator(unsigned int window);
+
+    /// Accept `seqId` if it's larger than `_highest`.
+    bool _checkIncreasing(uint64_t seqId, std::string& why);
+
+    /// Accept `seqId` if it's within the window and its slot hasn't had it.
+    bool _checkWindowed(uint64_t seqId, std::string& why);
+
+    unsigned int const _window;               ///< Ids allowed below `_highest`, 0 for none.
+    std::atomic<uint64_t> _highest{0};        ///< Highest id accepted.
+    std::atomic<uint64_t> _rejectedCount{0};  ///< Number of ids rejected.
+    /// The latest id accepted for each `id % _window`, null when `_window` is 0.
+    std::unique_ptr<std::atomic<uint64_t>[]> _slots;
+};
+
+}  // namespace control
+}  // namespace m2cellcpp
+}  // namespace LSST
+
+#endif  // LSST_M2CELLCPP_CONTROL_SEQIDVALIDATOR_H
@@ -130,6 +130,24 @@ void FaultMgr::reportMotionEngineTimeout(bool errorLvl, std::string const& msg)
     }
 }
 
+void FaultMgr::reportExternalFeedStale(bool stale, std::string const& msg) {
+    FaultStatusBits staleMask;
+    staleMask.setBitAt(FaultStatusBits::LOSS_OF_TMA_WARN);
+    if (!stale) {
+        LINFO("FaultMgr::reportExternalFeedStale recovered msg=", msg);
+        resetFaults(staleMask);
+        return;
+    }
+    FaultStatusBits changed;
+    {
+        lock_guard<mutex> lgSummary(_summarySystemFaultsMtx);
+        changed = _summarySystemFaultsStatus.mergeFaults(staleMask);
+    }
+    if (changed.getBitmap() != 0) {
+        LWARN("FaultMgr::reportExternalFeedStale changed=", changed.getAllSetBitEnums(), " msg=", msg);
+    }
+}
+
 void FaultMgr::updatePowerFaults(FaultStatusBits currentFaults, BasicFaultMgr::CrioSubsystem subsystem) {
     BasicFaultMgr bfm;
     {
@@ -88,6 +88,12 @@ public:
     /// @param `msg` - a test message with more information about the error.
     void reportMotionEngineTimeout(bool errorLvl, std::string const& msg);
 
+    /// Report that an external telemetry feed, such as `tel_elevation` from the TMA,
+    /// has become stale or recovered, setting or clearing `LOSS_OF_TMA_WARN`.
+    /// @param `stale` - `true` if the feed is stale, `false` if it has recovered.
+    /// @param `msg` - a test message with more information about the feed.
+    void reportExternalFeedStale(bool stale, std::string const& msg);
+
     /// Returns the system summary faults from `_summarySystemFaultsStatus`,
     /// this is the primary copy of the system summary faults.
     FaultStatusBits getSummaryFaults() const;
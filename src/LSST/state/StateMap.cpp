@@ -25,6 +25,7 @@
 // System headers
 
 // Project headers
+#include "util/CommandJournal.h"
 #include "util/Log.h"
 
 using namespace std;
@@ -153,6 +154,8 @@ bool StateMap::_changeState(State::Ptr const& newState) {
 
     if (acceptable) {
         LINFO("Changing state from ", oldState->getName(), " to ", newState->getName());
+        util::CommandJournal::appendGlobal(util::CommandJournal::STATE, 0,
+                                           oldState->getName() + " " + newState->getName());
         _currentState->onExitState(newState);
         _currentState = newState;
         newState->onEnterState(oldState);
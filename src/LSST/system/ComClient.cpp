@@ -26,6 +26,7 @@
 #include "nlohmann/json.hpp"
 
 // Project headers
+#include "util/Bug.h"
 #include "util/Log.h"
 
 using namespace std;
@@ -129,6 +130,46 @@ tuple<nlohmann::json, nlohmann::json> ComClient::cmdSendRecv(string const& jStr,
     return {ackJ, finJ};
 }
 
+void ComClient::cmdSendPipelined(string const& jStr, uint64_t seqId) {
+    _pipelined[seqId];
+    writeCommand(jStr);
+}
+
+tuple<nlohmann::json, nlohmann::json> ComClient::cmdRecvPipelined(uint64_t seqId, string const& note) {
+    auto iter = _pipelined.find(seqId);
+    if (iter == _pipelined.end()) {
+        throw util::Bug(ERR_LOC, note + " cmdRecvPipelined unknown seqId=" + to_string(seqId));
+    }
+    while (!iter->second.done) {
+        _readPipelined(note);
+    }
+    tuple<nlohmann::json, nlohmann::json> result{move(iter->second.ack), move(iter->second.fin)};
+    _pipelined.erase(iter);
+    return result;
+}
+
+void ComClient::_readPipelined(string const& note) {
+    string inStr = readCommand();
+    LDEBUG(note, "_readPipelined:read ", inStr);
+    nlohmann::json js = nlohmann::json::parse(inStr);
+    auto seqIter = js.find("sequence_id");
+    auto pIter = (seqIter == js.end()) ? _pipelined.end() : _pipelined.find(seqIter->get<uint64_t>());
+    if (pIter == _pipelined.end()) {
+        _jMsgMap.insert(js["id"], js);
+        return;
+    }
+    Pipelined& pl = pIter->second;
+    string id = js["id"];
+    if (id == "ack" || id == "noack") {
+        // A busy server doesn't send a final message.
+        pl.done = (id == "noack" && js.value("user_info", "").rfind("busy", 0) == 0);
+        pl.ack = move(js);
+    } else {
+        pl.fin = move(js);
+        pl.done = true;
+    }
+}
+
 nlohmann::json ComClient::cmdRecvSeqId(uint seqId, string const& note) {
     bool found = false;
     nlohmann::json js;
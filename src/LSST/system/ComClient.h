@@ -23,6 +23,7 @@
 
 // System headers
 #include <deque>
+#include <map>
 #include <memory>
 #include <string>
 
@@ -83,8 +84,11 @@ private:
 
 /// A class used for testing ComServer by making a connection to the server
 /// and running commands.
+/// Commands can be pipelined by sending several with `cmdSendPipelined()`
+/// before reading any responses, and then collecting the responses for each
+/// with `cmdRecvPipelined()` in any order.
 ///
-/// unit test: test_com.cpp
+/// unit test: tests/test_Com.cpp
 class ComClient {
 public:
     typedef std::shared_ptr<ComClient> Ptr;
@@ -119,6 +123,28 @@ public:
     std::tuple<nlohmann::json, nlohmann::json> cmdSendRecv(std::string const& jStr, uint seqId,
                                                            std::string const& note);
 
+    /// Send a command to the server without waiting for any responses, the
+    /// responses are collected with `cmdRecvPipelined()`.
+    /// @param `jStr` a string containing the json formatted command to send to the server.
+    /// @param `seqId` the numeric sequence ID associated with this command.
+    void cmdSendPipelined(std::string const& jStr, uint64_t seqId);
+
+    /// Return the "ack" or "noack" and final messages for the command with `seqId`
+    /// sent by `cmdSendPipelined()`, reading until the final message arrives.
+    /// Responses for other pipelined commands are kept until they are asked
+    /// for, and other messages are stored in `_jMsgMap`.
+    /// @param `seqId` the numeric sequence ID associated with the command.
+    /// @param `note` a string describing what is responsible for sending the command.
+    /// @return ack - the resulting "ack" or "noack" message associated with `seqId`.
+    /// @return fin - the resulting "success" or "fail" message associated with `seqId`,
+    ///         which is null if the server was too busy to accept the command.
+    /// @throws util::Bug if `seqId` was not sent with `cmdSendPipelined()`.
+    std::tuple<nlohmann::json, nlohmann::json> cmdRecvPipelined(uint64_t seqId, std::string const& note);
+
+    /// Return the number of commands sent by `cmdSendPipelined()` that have
+    /// not been returned by `cmdRecvPipelined()`.
+    size_t getPipelinedCount() const { return _pipelined.size(); }
+
     /// Receive commands from the server until "id" == `targetId` is found.
     /// This function will continue to read commands until `targetId` is
     /// read. Other messages received will be stored in `_jMsgMap`.
@@ -154,6 +180,16 @@ private:
 
     void _setup(std::string const& servIp, int port);
 
+    /// Responses received for a command sent by `cmdSendPipelined()`.
+    struct Pipelined {
+        nlohmann::json ack;  ///< The "ack" or "noack" message.
+        nlohmann::json fin;  ///< The "success" or "fail" message.
+        bool done = false;   ///< True when no more messages are expected.
+    };
+
+    /// Read one message and store it with its pipelined command, or in `_jMsgMap`.
+    void _readPipelined(std::string const& note);
+
     /// Buffer for asio to store incoming TCP data.
     /// asio may read more into the buffer than needed, so
     /// the same buffer needs to be used repeatedly.
@@ -163,6 +199,9 @@ private:
     /// A map where the key is the "id" of the json message and the value is
     /// a deque of json messages received with that "id".
     JsonMsgMap _jMsgMap;
+
+    /// Commands sent by `cmdSendPipelined()` with the key being "sequence_id".
+    std::map<uint64_t, Pipelined> _pipelined;
 };
 
 }  // namespace system
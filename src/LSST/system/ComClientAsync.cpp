@@ -0,0 +1,220 @@
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+// Class header
+#include "system/ComClientAsync.h"
+
+// System headers
+#include <stdexcept>
+#include <vector>
+
+// Project headers
+#include "util/Bug.h"
+#include "util/Log.h"
+
+using namespace std;
+namespace io = boost::asio;
+
+namespace LSST {
+namespace m2cellcpp {
+namespace system {
+
+ComClientAsync::ComClientAsync(IoContextPtr const& ioContext, string const& servIp, int port)
+        : _ioContext(ioContext), _socket(*_ioContext) {
+    LDEBUG("ComClientAsync ", servIp, " ", port);
+    io::ip::tcp::resolver resolv(*_ioContext);
+    boost::system::error_code ec;
+    auto endpoints = resolv.resolve(servIp, to_string(port), ec);
+    if (ec) {
+        LERROR("ComClientAsync resolve ec:", ec.message());
+        throw boost::system::system_error(ec);
+    }
+    io::connect(_socket, endpoints);
+    _reader = thread(&ComClientAsync::_readLoop, this);
+}
+
+ComClientAsync::~ComClientAsync() { close(); }
+
+void ComClientAsync::close() {
+    if (_closed.exchange(true)) {
+        return;
+    }
+    LDEBUG("ComClientAsync::close");
+    // Shutting down the socket makes the blocked read in `_reader` return.
+    boost::system::error_code ec;
+    _socket.shutdown(io::ip::tcp::socket::shutdown_both, ec);
+    if (_reader.joinable()) {
+        _reader.join();
+    }
+    _socket.close(ec);
+}
+
+ComClientAsync::Responses ComClientAsync::send(string const& jStr, uint64_t seqId) {
+    Responses resp;
+    {
+        lock_guard<mutex> lg(_mtx);
+        if (!_connected) {
+            throw boost::system::system_error(io::error::not_connected);
+        }
+        auto [iter, inserted] = _pending.try_emplace(seqId);
+        if (!inserted) {
+            throw util::Bug(ERR_LOC, "ComClientAsync::send seqId already pending " + to_string(seqId));
+        }
+        resp.ack = iter->second.ack.get_future();
+        resp.fin = iter->second.fin.get_future();
+        resp.readTimes = iter->second.readTimes;
+    }
+    boost::system::error_code ec;
+    {
+        lock_guard<mutex> lg(_writeMtx);
+        io::write(_socket, io::buffer(jStr + ComConnection::getDelimiter()), ec);
+    }
+    if (ec) {
+        LERROR("ComClientAsync::send error ec=", ec.message());
+        lock_guard<mutex> lg(_mtx);
+        _pending.erase(seqId);
+        throw boost::system::system_error(ec);
+    }
+    LDEBUG("ComClientAsync::send ", jStr);
+    return resp;
+}
+
+void ComClientAsync::_readLoop() {
+    string const delim = ComConnection::getDelimiter();
+    string pending;  // Data read but not yet split into messages.
+    size_t searchPos = 0;
+    vector<char> chunk(READ_CHUNK_SIZE);
+    while (true) {
+        size_t pos = pending.find(delim, searchPos);
+        if (pos == string::npos) {
+            // The delimiter could start in the last byte already searched.
+            searchPos = (pending.size() < delim.size()) ? 0 : pending.size() - delim.size() + 1;
+            boost::system::error_code ec;
+            size_t len = _socket.read_some(io::buffer(chunk), ec);
+            if (ec) {
+                if (!_closed) {
+                    LWARN("ComClientAsync::_readLoop ec=", ec.message());
+                }
+                _failAll("connection lost " + ec.message());
+                return;
+            }
+            pending.append(chunk.data(), len);
+            continue;
+        }
+        string inStr = pending.substr(0, pos);
+        pending.erase(0, pos + delim.size());
+        searchPos = 0;
+        LTRACE("ComClientAsync::_readLoop ", inStr);
+        try {
+            _dispatch(nlohmann::json::parse(inStr));
+        } catch (nlohmann::json::exception const& ex) {
+            LERROR("ComClientAsync::_readLoop bad message ", ex.what(), " ", inStr);
+        }
+    }
+}
+
+void ComClientAsync::_dispatch(nlohmann::json&& js) {
+    auto now = util::CLOCK::now();
+    string id = js.value("id", "");
+    {
+        lock_guard<mutex> lg(_mtx);
+        auto seqIter = js.find("sequence_id");
+        auto pIter = (seqIter == js.end() || !seqIter->is_number_unsigned())
+                             ? _pending.end()
+                             : _pending.find(seqIter->get<uint64_t>());
+        if (pIter != _pending.end()) {
+            Pending& pend = pIter->second;
+            if (id == "ack" || id == "noack") {
+                // A busy server doesn't send a final message.
+                bool busy = (id == "noack" && js.value("user_info", "").rfind("busy", 0) == 0);
+                pend.readTimes->ack = now;
+                pend.ack.set_value(move(js));
+                pend.ackSet = true;
+                if (busy) {
+                    pend.readTimes->fin = now;
+                    pend.fin.set_value(nlohmann::json());
+                    _pending.erase(pIter);
+                }
+            } else {
+                if (!pend.ackSet) {
+                    pend.readTimes->ack = now;
+                    pend.ack.set_value(nlohmann::json());
+                }
+                pend.readTimes->fin = now;
+                pend.fin.set_value(move(js));
+                _pending.erase(pIter);
+            }
+            return;
+        }
+        _idQueues[id].push_back(move(js));
+    }
+    _idCv.notify_all();
+}
+
+void ComClientAsync::_failAll(string const& why) {
+    {
+        lock_guard<mutex> lg(_mtx);
+        _connected = false;
+        for (auto& [seqId, pend] : _pending) {
+            string msg = "ComClientAsync seqId=" + to_string(seqId) + " " + why;
+            auto ex = make_exception_ptr(runtime_error(msg));
+            if (!pend.ackSet) {
+                pend.ack.set_exception(ex);
+            }
+            pend.fin.set_exception(ex);
+        }
+        _pending.clear();
+    }
+    _idCv.notify_all();
+}
+
+nlohmann::json ComClientAsync::waitForId(string const& id, chrono::milliseconds timeout) {
+    unique_lock<mutex> ulock(_mtx);
+    auto ready = [this, &id]() {
+        auto iter = _idQueues.find(id);
+        return !_connected || (iter != _idQueues.end() && !iter->second.empty());
+    };
+    if (!_idCv.wait_for(ulock, timeout, ready)) {
+        return nlohmann::json();
+    }
+    auto iter = _idQueues.find(id);
+    if (iter == _idQueues.end() || iter->second.empty()) {
+        return nlohmann::json();
+    }
+    nlohmann::json js = move(iter->second.front());
+    iter->second.pop_front();
+    return js;
+}
+
+size_t ComClientAsync::getQueuedCount(string const& id) const {
+    lock_guard<mutex> lg(_mtx);
+    auto iter = _idQueues.find(id);
+    return (iter == _idQueues.end()) ? 0 : iter->second.size();
+}
+
+size_t ComClientAsync::getPendingCount() const {
+    lock_guard<mutex> lg(_mtx);
+    return _pending.size();
+}
+
+}  // namespace system
+}  // namespace m2cellcpp
+}  // namespace LSST
@@ -0,0 +1,160 @@
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+#ifndef LSST_M2CELLCPP_SYSTEM_COMCLIENTASYNC_H
+#define LSST_M2CELLCPP_SYSTEM_COMCLIENTASYNC_H
+
+// System headers
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Third party headers
+#include <boost/asio.hpp>
+#include <nlohmann/json.hpp>
+
+// Project headers
+#include "system/ComConnection.h"
+#include "util/clock_defs.h"
+
+namespace LSST {
+namespace m2cellcpp {
+namespace system {
+
+/// A client for ComServer where a background thread reads all messages
+/// from the server, so many commands can be in progress at once.
+/// `send()` returns futures for the ack and final messages of a command,
+/// which are fulfilled by the reader when messages with the command's
+/// "sequence_id" arrive. All other messages are put in a queue for their
+/// "id", which can be waited on with `waitForId()`.
+/// If the connection is lost, all unfulfilled futures get an exception.
+///
+/// unit test: test_ComClientAsync.cpp
+class ComClientAsync {
+public:
+    using Ptr = std::shared_ptr<ComClientAsync>;
+
+    /// When the responses to a command were read, each time is valid once
+    /// the matching future is ready.
+    struct ReadTimes {
+        util::TIMEPOINT ack;  ///< When the "ack" or "noack" message was read.
+        util::TIMEPOINT fin;  ///< When the "success" or "fail" message was read.
+    };
+
+    /// Futures for the responses to a command.
+    struct Responses {
+        std::future<nlohmann::json> ack;  ///< The "ack" or "noack" message.
+        /// The "success" or "fail" message, which is null if the server was
+        /// too busy to accept the command.
+        std::future<nlohmann::json> fin;
+        std::shared_ptr<ReadTimes> readTimes;  ///< When the messages were read.
+    };
+
+    /// Connect to the server at `servIp`:`port` and start reading.
+    /// @throw boost::system::system_error if the connection can't be made.
+    static Ptr create(IoContextPtr const& ioContext, std::string const& servIp, int port) {
+        return Ptr(new ComClientAsync(ioContext, servIp, port));
+    }
+
+    ComClientAsync() = delete;
+    ComClientAsync(ComClientAsync const&) = delete;
+    ComClientAsync& operator=(ComClientAsync const&) = delete;
+
+    /// Calls `close()`.
+    ~ComClientAsync();
+
+    /// Send `jStr`, a json command with "sequence_id" `seqId`, to the server.
+    /// This is safe to call from any thread.
+    /// @return futures for the ack and final responses.
+    /// @throw util::Bug if a command with `seqId` is already waiting for responses.
+    /// @throw boost::system::system_error if the command can't be written.
+    Responses send(std::string const& jStr, uint64_t seqId);
+
+    /// Wait up to `timeout` for a message with "id" == `id` that wasn't a
+    /// response to `send()`, and remove it from its queue.
+    /// @return the message, or null if none arrived in time or the connection was lost.
+    nlohmann::json waitForId(std::string const& id, std::chrono::milliseconds timeout);
+
+    /// Return the number of messages with "id" == `id` waiting in its queue.
+    size_t getQueuedCount(std::string const& id) const;
+
+    /// Return the number of commands sent that have not received their final message.
+    size_t getPendingCount() const;
+
+    /// Return true until the connection is lost or closed.
+    bool isConnected() const { return _connected; }
+
+    /// Close the connection and stop the reader thread.
+    void close();
+
+private:
+    ComClientAsync(IoContextPtr const& ioContext, std::string const& servIp, int port);
+
+    /// Promises for the responses to a command.
+    struct Pending {
+        std::promise<nlohmann::json> ack;  ///< Fulfilled by the "ack" or "noack" message.
+        std::promise<nlohmann::json> fin;  ///< Fulfilled by the "success" or "fail" message.
+        bool ackSet = false;               ///< True once `ack` has been fulfilled.
+        /// Each time is set before its promise is fulfilled.
+        std::shared_ptr<ReadTimes> readTimes = std::make_shared<ReadTimes>();
+    };
+
+    /// Maximum number of bytes read from `_socket` at one time.
+    static constexpr size_t READ_CHUNK_SIZE = 8192;
+
+    /// Read messages from the server until the connection is lost.
+    void _readLoop();
+
+    /// Give `js` to the `Pending` for its "sequence_id" or to the queue for its "id".
+    void _dispatch(nlohmann::json&& js);
+
+    /// Give every unfulfilled promise an exception, and wake `waitForId()`.
+    void _failAll(std::string const& why);
+
+    IoContextPtr _ioContext;  ///< Maintains the io_context that holds _socket.
+    boost::asio::ip::tcp::socket _socket;
+    std::mutex _writeMtx;  ///< Serializes writes to `_socket`.
+
+    /// Commands waiting for responses with the key being "sequence_id".
+    std::map<uint64_t, Pending> _pending;
+
+    /// Messages that aren't responses to `send()` with the key being "id".
+    std::map<std::string, std::deque<nlohmann::json>> _idQueues;
+
+    mutable std::mutex _mtx;       ///< Protects `_pending` and `_idQueues`.
+    std::condition_variable _idCv;  ///< Notified when a message is added to `_idQueues`.
+
+    std::atomic<bool> _connected{true};  ///< False once the connection is lost or closed.
+    std::atomic<bool> _closed{false};    ///< Set to true by `close()`.
+    std::thread _reader;                 ///< Runs `_readLoop()`.
+};
+
+}  // namespace system
+}  // namespace m2cellcpp
+}  // namespace LSST
+
+#endif  // LSST_M2CELLCPP_SYSTEM_COMCLIENTASYNC_H
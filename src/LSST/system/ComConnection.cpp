@@ -23,18 +23,19 @@
 #include "system/ComConnection.h"
 
 // System headers
+#include <algorithm>
 #include <cerrno>
 #include <cstring>
 #include <ctime>
 #include <functional>
 #include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <stdexcept>
 
 // Third party headers
-#include "nlohmann/json.hpp"
 
 // Project headers
-#include "faultmgr/FaultMgr.h"
 #include "system/ComServer.h"
 #include "system/Config.h"
 #include "system/Globals.h"
@@ -43,8 +44,6 @@
 using namespace std;
 using namespace std::placeholders;
 
-using json = nlohmann::json;
-
 namespace {
 
 bool isErrorCode(boost::system::error_code const& ec, string const& note) {
@@ -59,6 +58,11 @@ bool isErrorCode(boost::system::error_code const& ec, string const& note) {
     return false;
 }
 
+/// Return true if `ec` is a socket error, rather than the connection being closed.
+bool isSocketError(boost::system::error_code const& ec) {
+    return ec.value() != 0 && ec != boost::asio::error::eof && ec != boost::asio::error::operation_aborted;
+}
+
 }  // namespace
 
 namespace LSST {
@@ -74,23 +78,48 @@ ComConnection::Ptr ComConnection::create(IoContextPtr const& ioContext, uint64_t
 
 ComConnection::ComConnection(IoContextPtr const& ioContext, uint64_t connId,
                              shared_ptr<ComServer> const& server)
-        : _socket(*ioContext), _ioContext(ioContext), _connId(connId), _server(server) {}
+        : _socket(*ioContext),
+          _ioContext(ioContext),
+          _strand(boost::asio::make_strand(*ioContext)),
+          _netStats(NetStats::create(server->getNetStats())),
+          _connId(connId),
+          _server(server),
+          _commandWindow(server->getCommandWindow()),
+          _idleTimer(_strand),
+          _heartbeatTimer(_strand),
+          _cmdBucket(0.0, 1.0) {}
 
 ComConnection::~ComConnection() { shutdown(); }
 
-void ComConnection::_syncWrite(string const& inMsg) {
-    string msg = inMsg + getDelimiter();
-    size_t bytesWritten = 0;
-    LDEBUG("ComConnection::_syncWrite ", msg);
-    while (bytesWritten < msg.length()) {
-        size_t bytesToSend = msg.length() - bytesWritten;
-        bytesWritten += _socket.write_some(boost::asio::buffer(msg.c_str() + bytesWritten, bytesToSend));
-    }
-}
-
 void ComConnection::beginProtocol() {
     LTRACE("ComConnection::beginProtocol()");
     _connectionActive = true;
+    // Acks and final responses are small separate writes. With Nagle's
+    // algorithm a final response waits for the client's delayed ack of
+    // the previous write, adding about 40ms to every command.
+    boost::system::error_code ec;
+    _socket.set_option(boost::asio::ip::tcp::no_delay(true), ec);
+    if (ec) {
+        LWARN("ComConnection::beginProtocol connId=", _connId, " no_delay failed ", ec.message());
+    }
+    // The server creates connections before they are accepted, so the
+    // rate limit and timeouts are set now in case they changed.
+    auto serv = _server.lock();
+    if (serv != nullptr) {
+        _cmdBucket = util::TokenBucket(serv->getCommandRate(), serv->getCommandBurst());
+        _idleTimeout = serv->getIdleTimeout();
+        _heartbeatInterval = serv->getHeartbeatInterval();
+        // Unacknowledged data, such as heartbeats to a dead client, fails the
+        // connection after this instead of the many minutes of retries allowed by default.
+        unsigned int tcpUserMs = serv->getTcpUserTimeout().count();
+        if (tcpUserMs > 0 && setsockopt(_socket.native_handle(), IPPROTO_TCP, TCP_USER_TIMEOUT, &tcpUserMs,
+                                        sizeof(tcpUserMs)) != 0) {
+            LWARN("ComConnection::beginProtocol connId=", _connId, " TCP_USER_TIMEOUT failed ",
+                  strerror(errno));
+        }
+    }
+    auto self = shared_from_this();
+    boost::asio::dispatch(_strand, [self]() { self->_startTimers(); });
     // This seems a bit early to set this, but it's what the gui expects.
     Globals::get().setTcpIpConnected(true);
     _sendWelcomeMsg();
@@ -101,173 +130,13 @@ void ComConnection::_sendWelcomeMsg() {
     if (!_doSendWelcomeMsg) {
         return;
     }
-
-    // Send a bunch of one-time messages that indicate various system states.
-    // Seems like this should happen at telemetry startup.
-
-    Globals& globals = Globals::get();
-
-    // send tcp connected message
-    {
-        json js;
-        js["id"] = "tcpIpConnected";
-        js["isConnected"] = globals.getTcpIpConnected();
-        _syncWrite(to_string(js));
-    }
-
-    _syncWrite(to_string(globals.getCommandableByDdsJson()));
-
-    // send hardpoint information mock_server.py:281 await
-    // self._message_event.write_hardpoint_list(hardpoints)
-    {
-        json js;
-        js["id"] = "hardpointList";
-        js["actuators"] = globals.getHardPointList();
-        _syncWrite(to_string(js));
-    }
-
-    // send interlock mock_server.py:283 await self._message_event.write_interlock(False)
-    {
-        json js;
-        js["id"] = "interlock";
-        js["state"] = globals.getInterlock();
-        _syncWrite(to_string(js));
-    }
-
-    // elev external source  mock_server.py:290 await
-    // self._message_event.write_inclination_telemetry_source(is_external_source)
-    {
-        json js;
-        js["id"] = "inclinationTelemetrySource";
-        js["source"] = globals.getTelemetrySource();
-        _syncWrite(to_string(js));
-    }
-
-    // temp offset mock_server.py:292 await self._message_event.write_temperature_offset(
-    {
-        json js;
-        js["id"] = "temperatureOffset";
-        js["ring"] = globals.getTemperatureOffsetsRing();
-        js["intake"] = globals.getTemperatureOffsetsIntake();
-        js["exhaust"] = globals.getTemperatureOffsetsExhaust();
-        _syncWrite(to_string(js));
-    }
-
-    // FUTURE: This is only for backward compatibility and will not be needed if the final version
-    {
-        json js;
-        js["id"] = "summaryState";
-        globals.setSummaryState(5);
-        js["summaryState"] = globals.getSummaryState();
-        _syncWrite(to_string(js));
-    }
-
-    // # Send the digital input and output
-    // digital_input = self.model.get_digital_input()
-    // await self._message_event.write_digital_input(digital_input)
-    {
-        json js;
-        js["id"] = "digitalInput";
-        js["value"] = globals.getDigitalInput();
-        _syncWrite(to_string(js));
-    }
-
-    // digital_output = self.model.get_digital_output()
-    // await self._message_event.write_digital_output(digital_output)
-    {
-        json js;
-        js["id"] = "digitalOutput";
-        js["value"] = globals.getDigitalOutput();
-        _syncWrite(to_string(js));
-    }
-
-    // await self._message_event.write_config()
-    // TODO: It looks like all of these values should come out of the configuration PLACEHOLDER DM-40317
-    // FUTURE: Also, can the gui (and future systems) be capable of handling a dump of the entire config in
-    // the json msg? Probably useful.
-    {
-        json js;
-        js["id"] = "config";
-        js["configuration"] = "Configurable_File_Description_20180831T092556_surrogate_handling.csv";
-        js["version"] = "20180831T092556";
-        js["controlParameters"] = "CtrlParameterFiles_2018-07-19_104314_surg";
-        js["lutParameters"] = "FinalHandlingLUTs";
-        js["powerWarningMotor"] = 5.0;
-        js["powerFaultMotor"] = 10.0;
-        js["powerThresholdMotor"] = 20.0;
-        js["powerWarningComm"] = 5.0;
-        js["powerFaultComm"] = 10.0;
-        js["powerThresholdComm"] = 10.0;
-        js["inPositionAxial"] = 0.158;
-        js["inPositionTangent"] = 1.1;
-        js["inPositionSample"] = 1.0;
-        js["timeoutSal"] = 15.0;
-        js["timeoutCrio"] = 1.0;
-        js["timeoutIlc"] = 3;
-        js["inclinometerDelta"] = 2.0;
-        js["inclinometerDiffEnabled"] = true;
-        js["cellTemperatureDelta"] = 2.0;
-        _syncWrite(to_string(js));
-    }
-
-    // await self._message_event.write_closed_loop_control_mode( ClosedLoopControlMode.Idle )
-    {
-        json js;
-        js["id"] = "closedLoopControlMode";
-        js["mode"] = globals.getClosedLoopControlMode();
-        _syncWrite(to_string(js));
-    }
-
-    // await self._message_event.write_enabled_faults_mask( self.model.error_handler.enabled_faults_mask )
-    {
-        json js;
-        js["id"] = "enabledFaultsMask";
-        js["mask"] = faultmgr::FaultMgr::get().getFaultEnableMask().getBitmap();
-        _syncWrite(to_string(js));
-    }
-
-    // await self._message_event.write_configuration_files()
-    // FUTURE: These files need to be located and added to this project DM-40317
-    // PLACEHOLDER
-    {
-        json js;
-        js["id"] = "configurationFiles";
-        js["files"] = {"Configurable_File_Description_PLACEHOLDER_M2_optical.csv",
-                       "Configurable_File_Description_PLACEHOLDER_M2_handling.csv",
-                       "Configurable_File_Description_PLACEHOLDER_surrogate_optical.csv",
-                       "Configurable_File_Description_PLACEHOLDER_surrogate_handling.csv"};
-        _syncWrite(to_string(js));
-    }
-
-    // FUTURE: This is only for backward compatibility and will not be needed if the final version
-    // PLACEHOLDER
-    {
-        json js;
-        js["id"] = "summaryState";
-        globals.setSummaryState(3);
-        js["summaryState"] = globals.getSummaryState();
-        _syncWrite(to_string(js));
-    }
-
-    // FUTURE: This is only for backward compatibility and will not be needed if the final version
-    // PLACEHOLDER
-    {
-        json js;
-        js["id"] = "forceBalanceSystemStatus";
-        js["status"] = false;
-        _syncWrite(to_string(js));
-    }
-
-    {
-        json js;
-        js["id"] = "summaryFaultsStatus";
-        // The value from the ts_m2gui simulator produces this value for
-        // 'js["status"] = 144115188075855872;'.
-        // FUTURE: Should see how this compares to the simulator as
-        // more systems are implemented.
-        js["status"] = faultmgr::FaultMgr::get().getSummaryFaults().getBitmap();
-        _syncWrite(to_string(js));
+    auto serv = _server.lock();
+    if (serv == nullptr) {
+        LERROR("ComConnection::_sendWelcomeMsg server already destroyed");
+        return;
     }
+    // All of the welcome messages go out in one write.
+    _queueOut(serv->getWelcomeMsg()->getMsg(), nullptr);
 }
 
 void ComConnection::_receiveCommand() {
@@ -275,39 +144,78 @@ void ComConnection::_receiveCommand() {
     if (_shutdown) {
         return;
     }
-    boost::asio::async_read_until(_socket, _streamBuf, getDelimiter(),
-                                  bind(&ComConnection::_readCommand, shared_from_this(), _1, _2));
+    boost::asio::async_read_until(
+            _socket, _streamBuf, getDelimiter(),
+            boost::asio::bind_executor(_strand,
+                                       bind(&ComConnection::_readCommand, shared_from_this(), _1, _2)));
 }
 
 void ComConnection::_readCommand(boost::system::error_code const& ec, size_t xfer) {
     assert(_streamBuf.size() >= xfer);
 
-    if (::isErrorCode(ec, __func__)) return;
+    if (::isErrorCode(ec, __func__)) {
+        if (::isSocketError(ec)) {
+            _netStats->recordError();
+        }
+        return;
+    }
+    auto received = util::CLOCK::now();
+    _lastRead = received;
+    _netStats->recordIn(xfer, 1);
     size_t msgSz = xfer - getDelimiter().size();
-    std::string msgStr(buffers_begin(_streamBuf.data()), buffers_begin(_streamBuf.data()) + msgSz);
+    // `_streamBuf` input is contiguous, so the command can be used in place.
+    // It is consumed once nothing is looking at `msgStr`.
+    auto data = _streamBuf.data();
+    string_view msgStr(static_cast<char const*>(data.data()), msgSz);
+    LINFO("received msg: ", msgStr, " streamBuf size=", msgStr.size());
+    auto [responseStr, command, lane, independent] = _handleCommand(msgStr);
     _streamBuf.consume(xfer);
+    if (command == nullptr) {
+        asyncWrite(responseStr);
+    } else {
+        ++_cmdsInFlight;
+        _sendAck(responseStr, command, lane, independent, received);
+    }
+    // Keep reading while earlier commands run, unless the window is full.
+    if (_cmdsInFlight >= _commandWindow) {
+        LDEBUG("ComConnection::_readCommand window full connId=", _connId, " inFlight=", _cmdsInFlight);
+        _readPaused = true;
+        return;
+    }
+    _receiveCommand();
+}
 
-    LINFO("received msg: ", msgStr, " streamBuf size=", msgStr.size());
+ComConnection::Interpretation ComConnection::_handleCommand(string_view msgStr) {
+    auto serv = _server.lock();
+    if (!_cmdBucket.take()) {
+        ++_rateLimitedCount;
+        if (serv != nullptr) {
+            serv->countRateLimited();
+        }
+        LWARN("ComConnection::_handleCommand rate limited connId=", _connId,
+              " count=", _rateLimitedCount.load(), " rejecting ", msgStr);
+        return {getBusyResponse(msgStr, BUSY_RATE_LIMITED), nullptr, util::CommandExecutor::ROUTINE, false};
+    }
+    // A slot in the executor must be available before the command is acked.
+    // Power and safety commands may use slots that routine commands can't,
+    // so the lane is found first.
+    if (serv == nullptr || !serv->getCommandExecutor()->reserve(getLaneFor(msgStr))) {
+        LWARN("ComConnection::_handleCommand busy, rejecting ", msgStr);
+        return {getBusyResponse(msgStr, BUSY_EXECUTOR), nullptr, util::CommandExecutor::ROUTINE, false};
+    }
 
     // `interpretCommand()` will add a shared_from_this pointer to command
     // so it can send a response to the correct ComConnection, and
     // that ComConnection will still exist.
-    auto [responseStr, command] = interpretCommand(msgStr);
-    // This is really annoying, C++ 17 standard doesn't handle lambda
-    // capture of a tuple element properly, so copy command to cmd so
-    // it can go in the lambda capture.
-    auto cmd = command;
-    // The ack response must be sent before the command is run, or the final
-    // respsonse could be sent before the ack.
-    _sendResponse(responseStr);
-
-    // Running the command could take a while, so start a new thread.
-    auto cmdFunc = [cmd]() { cmd->runAction(nullptr); };
-    thread cThrd(cmdFunc);
-    cThrd.detach();
-}
-
-std::tuple<std::string, util::Command::Ptr> ComConnection::interpretCommand(std::string const& commandStr) {
+    auto interpreted = interpretCommand(msgStr);
+    if (get<1>(interpreted) == nullptr) {
+        serv->getCommandExecutor()->cancelReservation();
+    }
+    return interpreted;
+}
+
+ComConnection::Interpretation ComConnection::interpretCommand(string_view commandView) {
+    string commandStr(commandView);
     string ackMsg = makeTestAck(commandStr);
     // This lambda function will be run when `cmd->runAction()` is called.
     // It needs a shared_ptr to this to prevent segfaults if ComConnection was closed.
@@ -318,41 +226,239 @@ std::tuple<std::string, util::Command::Ptr> ComConnection::interpretCommand(std:
         thisPtr->asyncWrite(finalMsg);
     };
     auto cmd = make_shared<util::Command>(testFunc);
-    return {ackMsg, cmd};
+    return {ackMsg, cmd, util::CommandExecutor::ROUTINE, false};
 }
 
+util::CommandExecutor::Lane ComConnection::getLaneFor(string_view) { return util::CommandExecutor::ROUTINE; }
+
 void ComConnection::asyncWrite(string const& msg) {
     LDEBUG("ComConnection::asyncWrite ", msg);
-    string cmd = msg + ComConnection::getDelimiter();
-    boost::asio::async_write(_socket, boost::asio::buffer(cmd, cmd.size()),
-                             bind(&ComConnection::_asyncWriteSent, shared_from_this(), _1, _2));
+    _queueMsg(msg, nullptr);
 }
 
-void ComConnection::_asyncWriteSent(boost::system::error_code const& ec, size_t xfer) {
-    LDEBUG("ComConnection::_asyncWriteSent xfer=", xfer);
-    // Log if there was an error and nothing else to do.
-    ::isErrorCode(ec, __func__);
+void ComConnection::asyncWrite(string const& msg, WriteCallback const& onSent) {
+    LDEBUG("ComConnection::asyncWrite ", msg);
+    _queueMsg(msg, onSent);
+}
+
+void ComConnection::_sendAck(string const& ack, util::Command::Ptr const& cmd,
+                             util::CommandExecutor::Lane lane, bool independent, util::TIMEPOINT received) {
+    LDEBUG("ComConnection::_sendAck ack:", ack);
+    // The ack must be sent before the command is run, or the final
+    // response could be sent before the ack.
+    _queueMsg(ack,
+              bind(&ComConnection::_ackSent, shared_from_this(), cmd, lane, independent, received, _1, _2));
+}
+
+void ComConnection::asyncWriteBuffer(BufferPtr const& buf) {
+    LDEBUG("ComConnection::asyncWriteBuffer size=", buf->size());
+    _queueOut(buf, nullptr);
 }
 
-void ComConnection::_sendResponse(string const& command) {
-    LDEBUG("ComConnection::_sendResponse command:", command);
-    string cmd = command + ComConnection::getDelimiter();
-    boost::asio::async_write(_socket, boost::asio::buffer(cmd, cmd.size()),
-                             bind(&ComConnection::_responseSent, shared_from_this(), _1, _2));
+ComConnection::BufferPtr ComConnection::makeBuffer(string const& msg) {
+    auto out = make_shared<string>();
+    out->reserve(msg.size() + getDelimiter().size());
+    out->append(msg).append(getDelimiter());
+    return out;
 }
 
-void ComConnection::_responseSent(boost::system::error_code const& ec, size_t xfer) {
-    LDEBUG("ComConnection::_responseSent xfer=", xfer);
+void ComConnection::_queueMsg(string const& msg, WriteCallback const& onSent) {
+    _queueOut(makeBuffer(msg), onSent);
+}
+
+void ComConnection::_queueOut(BufferPtr const& out, WriteCallback const& onSent) {
+    auto self = shared_from_this();
+    auto queued = util::CLOCK::now();
+    boost::asio::dispatch(_strand, [self, out, onSent, queued]() {
+        self->_writeQueue.push_back({out, onSent, queued});
+        self->_startWrite();
+    });
+}
+
+void ComConnection::_startWrite() {
+    if (!_writing.empty() || _writeQueue.empty()) {
+        return;
+    }
+    // Everything queued since the last write goes out in one call.
+    vector<boost::asio::const_buffer> bufs;
+    while (!_writeQueue.empty() && _writing.size() < MAX_GATHER) {
+        auto& out = _writeQueue.front();
+        bufs.push_back(boost::asio::buffer(*out.msg));
+        _writing.push_back(move(out));
+        _writeQueue.pop_front();
+    }
+    ++_writeCallCount;
+    boost::asio::async_write(
+            _socket, bufs,
+            boost::asio::bind_executor(_strand,
+                                       bind(&ComConnection::_writeDone, shared_from_this(), _1, _2)));
+}
+
+void ComConnection::_writeDone(boost::system::error_code const& ec, size_t xfer) {
+    LDEBUG("ComConnection::_writeDone msgs=", _writing.size(), " xfer=", xfer);
+    _msgsWrittenCount += _writing.size();
+    vector<OutMsg> done;
+    swap(done, _writing);
+    bool failed = ::isErrorCode(ec, __func__);
+    if (!failed) {
+        auto now = util::CLOCK::now();
+        _lastWrite = now;
+        _netStats->recordOut(xfer, done.size());
+        for (auto const& out : done) {
+            auto delay = chrono::duration_cast<chrono::microseconds>(now - out.queued);
+            _netStats->recordQueueDelay(delay.count());
+        }
+    } else if (::isSocketError(ec)) {
+        _netStats->recordError();
+    }
+    if (failed) {
+        // Nothing else can be written, let everything waiting know.
+        for (auto& out : _writeQueue) {
+            done.push_back(move(out));
+        }
+        _writeQueue.clear();
+    }
+    for (auto& out : done) {
+        if (out.onSent) {
+            out.onSent(ec, failed ? 0 : out.msg->size());
+        }
+    }
+    _startWrite();
+}
+
+void ComConnection::_ackSent(util::Command::Ptr const& cmd, util::CommandExecutor::Lane lane,
+                             bool independent, util::TIMEPOINT received,
+                             boost::system::error_code const& ec, size_t xfer) {
+    LDEBUG("ComConnection::_ackSent xfer=", xfer);
+    auto ackSent = util::CLOCK::now();
+    auto serv = _server.lock();
+    if (serv == nullptr) {
+        _cmdFinished();
+        return;
+    }
+    auto exec = serv->getCommandExecutor();
     if (::isErrorCode(ec, __func__)) {
+        exec->cancelReservation();
+        _cmdFinished();
         return;
     }
-    _receiveCommand();
+    // Commands from this connection that change anything run one at a time
+    // in the order received. Independent ones, up to `_commandWindow` of them,
+    // may run alongside those and finish in any order.
+    auto self = shared_from_this();
+    auto wrapper = make_shared<util::Command>([self, cmd, received, ackSent](util::CmdData*) {
+        CmdTimes times(received, ackSent);
+        try {
+            cmd->runAction(&times);
+        } catch (exception const& ex) {
+            LERROR("ComConnection command threw connId=", self->_connId, " ", ex.what());
+        }
+        boost::asio::post(self->_strand, [self]() { self->_cmdFinished(); });
+    });
+    if (independent) {
+        exec->queReserved(wrapper, lane);
+    } else {
+        exec->queReserved(_connId, wrapper, lane);
+    }
+}
+
+void ComConnection::_cmdFinished() {
+    --_cmdsInFlight;
+    if (_readPaused) {
+        _readPaused = false;
+        _receiveCommand();
+    }
+}
+
+void ComConnection::_startTimers() {
+    _lastRead = util::CLOCK::now();
+    _lastWrite = _lastRead;
+    if (_idleTimeout.count() > 0) {
+        _waitTimer(_idleTimer, _idleTimeout, &ComConnection::_idleCheck);
+    }
+    if (_heartbeatInterval.count() > 0) {
+        _waitTimer(_heartbeatTimer, _heartbeatInterval, &ComConnection::_heartbeatCheck);
+    }
+}
+
+void ComConnection::_waitTimer(boost::asio::steady_timer& timer, chrono::milliseconds wait,
+                               void (ComConnection::*check)()) {
+    if (_shutdown) {
+        return;
+    }
+    timer.expires_after(wait);
+    // A pending wait must not keep the connection alive.
+    weak_ptr<ComConnection> weakThis = weak_from_this();
+    timer.async_wait([weakThis, check](boost::system::error_code const& ec) {
+        auto self = weakThis.lock();
+        if (ec || self == nullptr || self->_shutdown) {
+            return;
+        }
+        ((*self).*check)();
+    });
+}
+
+void ComConnection::_idleCheck() {
+    auto idle = chrono::duration_cast<chrono::milliseconds>(util::CLOCK::now() - _lastRead);
+    if (idle < _idleTimeout) {
+        // Something was read since the timer was set.
+        _waitTimer(_idleTimer, _idleTimeout - idle, &ComConnection::_idleCheck);
+        return;
+    }
+    LWARN("ComConnection::_idleCheck connId=", _connId, " nothing read for ", idle.count(), "ms, closing");
+    auto serv = _server.lock();
+    if (serv != nullptr) {
+        serv->countIdleTimeout();
+    }
+    _close();
+}
+
+void ComConnection::_heartbeatCheck() {
+    auto serv = _server.lock();
+    if (serv != nullptr) {
+        serv->countHeartbeatCheck();
+    }
+    if (!_writing.empty()) {
+        // A write is in progress, which may take a long time if the peer has
+        // stopped reading. `_lastWrite` won't change until it finishes, so
+        // check again after a full interval instead of right away.
+        _waitTimer(_heartbeatTimer, _heartbeatInterval, &ComConnection::_heartbeatCheck);
+        return;
+    }
+    auto quiet = chrono::duration_cast<chrono::milliseconds>(util::CLOCK::now() - _lastWrite);
+    if (quiet < _heartbeatInterval) {
+        // Something was written since the timer was set.
+        _waitTimer(_heartbeatTimer, _heartbeatInterval - quiet, &ComConnection::_heartbeatCheck);
+        return;
+    }
+    ++_heartbeatCount;
+    _queueMsg(HEARTBEAT_MSG, nullptr);
+    _waitTimer(_heartbeatTimer, _heartbeatInterval, &ComConnection::_heartbeatCheck);
+}
+
+void ComConnection::_close() {
+    shutdown();
+    boost::system::error_code ec;
+    _idleTimer.cancel();
+    _heartbeatTimer.cancel();
+    _socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+    _socket.close(ec);
+}
+
+nlohmann::json ComConnection::getNetStatsJson() {
+    nlohmann::json js = _netStats->getJson();
+    js["connId"] = _connId;
+    // A socket that is closed, or closing, gives a null sample.
+    js["tcp"] = TcpInfoSample::sample(_socket.native_handle()).getJson();
+    return js;
 }
 
 void ComConnection::shutdown() {
     if (_shutdown.exchange(true) == true) {
         return;
     }
+    LINFO("ComConnection::shutdown connId=", _connId, " writes=", _writeCallCount.load(),
+          " msgs=", _msgsWrittenCount.load(), " rateLimited=", _rateLimitedCount.load());
     if (_connectionActive.exchange(false)) {
         Globals::get().setTcpIpConnected(false);
     }
@@ -363,11 +469,29 @@ void ComConnection::shutdown() {
     } else {
         LERROR("ComConnection::shutdown server already destroyed");
     }
+    // The timers may only be touched in `_strand`. When called by the
+    // destructor, the timers are cancelled as they are destroyed.
+    weak_ptr<ComConnection> weakThis = weak_from_this();
+    boost::asio::post(_strand, [weakThis]() {
+        auto self = weakThis.lock();
+        if (self != nullptr) {
+            self->_idleTimer.cancel();
+            self->_heartbeatTimer.cancel();
+        }
+    });
     boost::system::error_code ec;
     _socket.shutdown(boost::asio::ip::tcp::socket::shutdown_send, ec);
     ::isErrorCode(ec, __func__);
 }
 
+void ComConnection::reject() {
+    // The connection was never tracked by the server, so `shutdown()` isn't needed.
+    _shutdown = true;
+    boost::system::error_code ec;
+    _socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+    _socket.close(ec);
+}
+
 string ComConnection::makeTestAck(string const& msg) {
     string ack = string("{Ack:") + msg + "}";
     return ack;
@@ -378,6 +502,15 @@ string ComConnection::makeTestFinal(string const& msg) {
     return final;
 }
 
+string ComConnection::getBusyResponse(string_view commandStr, string const&) {
+    return makeTestBusy(string(commandStr));
+}
+
+string ComConnection::makeTestBusy(string const& msg) {
+    string busy = string("{Busy:") + msg + "}";
+    return busy;
+}
+
 }  // namespace system
 }  // namespace m2cellcpp
 }  // namespace LSST
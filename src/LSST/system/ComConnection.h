@@ -22,16 +22,24 @@
 #define LSST_M2CELLCPP_SYSTEM_COMCONNECTION_H
 
 // System headers
+#include <atomic>
 #include <cstdint>
 #include <cstdio>
+#include <deque>
+#include <functional>
 #include <memory>
+#include <string_view>
 #include <vector>
 
 // Third party headers
 #include <boost/asio.hpp>
 
 // Project headers
+#include "system/NetStats.h"
+#include "util/clock_defs.h"
 #include "util/Command.h"
+#include "util/CommandExecutor.h"
+#include "util/TokenBucket.h"
 
 namespace LSST {
 namespace m2cellcpp {
@@ -42,16 +50,50 @@ class ComServer;
 /// io_context pointer definition.
 typedef std::shared_ptr<boost::asio::io_context> IoContextPtr;
 
-/// asio work guard definition to keep io_context run() from exiting early.
-
 /// This class is used to handle commands and responses over a connection
 /// until that connection is terminated.
+/// All reads and writes on `_socket` are done through `_strand`. Outgoing
+/// messages are put on `_writeQueue` and everything queued while a write is
+/// in progress is sent with the next single gather write.
+/// Commands are pipelined, the next command is read while earlier ones are
+/// still being acked or run, until `_commandWindow` commands from this
+/// connection are unfinished. Commands still run one at a time in the order
+/// they were received, except independent ones, like queries, which may run
+/// alongside them. Final responses can then be sent out of order and the
+/// client matches them to commands by their "sequence_id".
+/// Bytes and messages in and out, socket errors, and how long messages wait
+/// in `_writeQueue` are counted in `_netStats`, which adds them to the server's.
+/// If the server has an idle timeout, the connection is closed when nothing
+/// has been read for that long, and with a heartbeat interval, `HEARTBEAT_MSG`
+/// is sent when nothing has been written for that long. Each uses one
+/// `steady_timer` that only wakes up when its time may have run out.
 ///
-/// unit test: test_com.cpp
+/// unit test: tests/test_Com.cpp
 class ComConnection : public std::enable_shared_from_this<ComConnection> {
 public:
     using Ptr = std::shared_ptr<ComConnection>;
 
+    /// An immutable message, including the delimiter, that can be queued
+    /// on many connections without being copied.
+    using BufferPtr = std::shared_ptr<std::string const>;
+
+    /// Function called with the result of writing a message.
+    using WriteCallback = std::function<void(boost::system::error_code const&, size_t)>;
+
+    /// The response to send for a command, the `Command` to run, the executor
+    /// lane it waits in, and true if it is independent of the other commands
+    /// from this connection. See `interpretCommand()`.
+    using Interpretation = std::tuple<std::string, util::Command::Ptr, util::CommandExecutor::Lane, bool>;
+
+    /// Given to the `runAction()` of commands from `interpretCommand()`, so they
+    /// can find out when they were received and acked.
+    struct CmdTimes : public util::CmdData {
+        CmdTimes(util::TIMEPOINT received_, util::TIMEPOINT ackSent_)
+                : received(received_), ackSent(ackSent_) {}
+        util::TIMEPOINT received;  ///< When the command was read.
+        util::TIMEPOINT ackSent;   ///< When the ack was written.
+    };
+
     // Delimiter for all messages
     static std::string getDelimiter() { return "\r\n"; }
 
@@ -75,17 +117,48 @@ public:
     /// Shutdown this connection
     void shutdown();
 
-    /// Async write to client.
+    /// Close a connection that was accepted but won't be used, before
+    /// `beginProtocol()` is called.
+    void reject();
+
+    /// Queue `msg` to be written to the client. This is safe to call
+    /// from any thread, and messages are sent in the order queued.
     void asyncWrite(std::string const& msg);
 
-    /// Given the `commandStr`, return an appropriate ack and Command to run.
-    /// @return This, base version, just returns an ack string and a Command that will
-    ///         write a final string for testing.
+    /// Queue `msg` to be written, `onSent` is called in `_strand` once it has been written.
+    void asyncWrite(std::string const& msg, WriteCallback const& onSent);
+
+    /// Queue `buf`, which must come from `makeBuffer()`, to be written. The
+    /// buffer is shared, not copied, so it can be sent to many connections.
+    void asyncWriteBuffer(BufferPtr const& buf);
+
+    /// @return `msg` with the delimiter appended, in a buffer for `asyncWriteBuffer()`.
+    static BufferPtr makeBuffer(std::string const& msg);
+
+    /// Given the `commandStr`, return an appropriate ack, Command to run,
+    /// the executor lane the Command should wait in, and whether it is
+    /// independent. Commands that aren't independent run one at a time in
+    /// the order they were received, independent ones may run alongside them.
+    /// `commandStr` is a view into the read buffer and is only valid until
+    /// this returns, anything kept must be copied.
+    /// @return This, base version, just returns an ack string and a routine Command,
+    ///         that isn't independent, that will write a final string for testing.
     /// Important: All child functions must contain a copy of a shared_ptr to
     ///     this ComConnection to prevent segfaults. Capturing `this` is
     ///     not enough to ensure that this `ComConnection` still exists when
     ///     the `runAction()` thread finally finishes.
-    virtual std::tuple<std::string, util::Command::Ptr> interpretCommand(std::string const& commandStr);
+    virtual Interpretation interpretCommand(std::string_view commandStr);
+
+    /// Return the executor lane of `commandStr`, which is needed to reserve a
+    /// slot for it before `interpretCommand()` is called.
+    /// @return This, base version, returns ROUTINE.
+    virtual util::CommandExecutor::Lane getLaneFor(std::string_view commandStr);
+
+    /// Return the response sent instead of an ack when `commandStr` cannot be
+    /// run because the server's command executor is full or the connection's
+    /// rate limit was reached, `reason` says which.
+    /// @return This, base version, returns a string for testing.
+    virtual std::string getBusyResponse(std::string_view commandStr, std::string const& reason);
 
     uint64_t getConnId() const { return _connId; }
 
@@ -99,11 +172,52 @@ public:
     /// @return the final string, used for unit testing only.
     static std::string makeTestFinal(std::string const& msg);
 
+    /// @return the busy string, used for unit testing only.
+    static std::string makeTestBusy(std::string const& msg);
+
+    /// Return the number of async writes made on the socket.
+    uint64_t getWriteCallCount() const { return _writeCallCount; }
+
+    /// Return the number of messages written to the socket.
+    uint64_t getMsgsWrittenCount() const { return _msgsWrittenCount; }
+
+    /// Return the number of commands rejected by this connection's rate limit.
+    uint64_t getRateLimitedCount() const { return _rateLimitedCount; }
+
+    /// Return the number of heartbeats sent.
+    uint64_t getHeartbeatCount() const { return _heartbeatCount; }
+
+    /// Return the network statistics for this connection.
+    NetStats::Ptr getNetStats() const { return _netStats; }
+
+    /// Return the network statistics for this connection and a `TCP_INFO`
+    /// sample of its socket as json. This is safe to call from any thread.
+    nlohmann::json getNetStatsJson();
+
+    /// `user_info` of busy responses when the executor is full.
+    static constexpr char const* BUSY_EXECUTOR = "busy";
+
+    /// `user_info` of busy responses when the connection's rate limit was reached.
+    static constexpr char const* BUSY_RATE_LIMITED = "busy rate limited";
+
+    /// Sent when nothing else has been written for the server's heartbeat interval.
+    static constexpr char const* HEARTBEAT_MSG = R"({"id":"heartbeat"})";
+
+    /// Maximum number of messages sent in one gather write.
+    static constexpr size_t MAX_GATHER = 64;
+
 protected:
     /// @see ComConnection::create()
     ComConnection(IoContextPtr const& ioContext, uint64_t connId, std::shared_ptr<ComServer> const& server);
 
 private:
+    /// A message waiting to be written, including the delimiter.
+    struct OutMsg {
+        BufferPtr msg;           ///< Text to send.
+        WriteCallback onSent;    ///< Called after the write, may be empty.
+        util::TIMEPOINT queued;  ///< When the message was queued.
+    };
+
     /// Send a message with some basic information about the server.
     void _sendWelcomeMsg();
 
@@ -115,34 +229,81 @@ private:
     /// @param xfer The number of bytes received from a client.
     void _readCommand(boost::system::error_code const& ec, size_t xfer);
 
-    /// The callback on finishing (either successfully or not) of asynchronous
-    /// reads. The request will be parsed, analyzed and if everything is right
-    /// the file transfer will begin.
+    /// Reserve a slot for `msgStr` and interpret it.
+    /// @return the ack, or busy, response to send, the `Command` to run,
+    ///         which is nullptr if the command was rejected, its lane, and
+    ///         if it is independent.
+    Interpretation _handleCommand(std::string_view msgStr);
+
+    /// Send `ack` to the client, `cmd` is queued in `lane` once it has been sent.
+    /// @param independent True if `cmd` doesn't need to wait for earlier commands.
+    /// @param received The time the command was read.
+    void _sendAck(std::string const& ack, util::Command::Ptr const& cmd, util::CommandExecutor::Lane lane,
+                  bool independent, util::TIMEPOINT received);
+
+    /// The callback on finishing (either successfully or not) of writing the ack for `cmd`.
+    /// Called in `_strand`.
+    /// @param lane The executor lane for `cmd`.
+    /// @param independent True if `cmd` doesn't need to wait for earlier commands.
+    /// @param received The time the command was read.
     /// @param ec An error code to be evaluated.
-    /// @param xfer The number of bytes received from a client.
-    void _requestReceived(boost::system::error_code const& ec, size_t xfer);
+    /// @param xfer The number of bytes sent to a client in a response.
+    void _ackSent(util::Command::Ptr const& cmd, util::CommandExecutor::Lane lane, bool independent,
+                  util::TIMEPOINT received, boost::system::error_code const& ec, size_t xfer);
 
-    /// Begin sending a result back to a client
-    void _sendResponse(std::string const& command);
+    /// Called in `_strand` when a command from this connection has finished,
+    /// resumes reading if it was paused because the window was full.
+    void _cmdFinished();
 
-    /// The callback on finishing (either successfully or not) of asynchronous writes.
-    /// @param ec An error code to be evaluated.
-    /// @param xfer The number of bytes sent to a client in a response.
-    void _responseSent(boost::system::error_code const& ec, size_t xfer);
+    /// Add `msg` to `_writeQueue`, `onSent` is called once it has been written.
+    void _queueMsg(std::string const& msg, WriteCallback const& onSent);
+
+    /// Add `out`, which must already end with the delimiter, to `_writeQueue`.
+    void _queueOut(BufferPtr const& out, WriteCallback const& onSent);
+
+    /// Start a gather write of queued messages if no write is in progress.
+    /// Must be called in `_strand`.
+    void _startWrite();
 
-    /// The callback on finishing (either successfully or not) of asynchronous writes.
-    /// This is a dead end in that it only registers an error.
+    /// The callback on finishing (either successfully or not) of a gather write.
+    /// Must be called in `_strand`.
     /// @param ec An error code to be evaluated.
-    /// @param xfer The number of bytes sent to a client in a response.
-    void _asyncWriteSent(boost::system::error_code const& ec, size_t xfer);
+    /// @param xfer The number of bytes sent.
+    void _writeDone(boost::system::error_code const& ec, size_t xfer);
+
+    /// Start the idle and heartbeat timers that are turned on. Must be called in `_strand`.
+    void _startTimers();
 
-    /// Do a synchronous write using the asio socket and sending `msg`.
-    void _syncWrite(std::string const& msg);
+    /// Set `timer` to call `check` in `_strand` after `wait`.
+    void _waitTimer(boost::asio::steady_timer& timer, std::chrono::milliseconds wait,
+                    void (ComConnection::*check)());
+
+    /// Close the connection if nothing has been read for `_idleTimeout`,
+    /// otherwise wait until it could have been. Called in `_strand`.
+    void _idleCheck();
+
+    /// Send a heartbeat if nothing has been written for `_heartbeatInterval`,
+    /// and wait for the next time one could be needed. Called in `_strand`.
+    void _heartbeatCheck();
+
+    /// Shutdown the connection and close `_socket`, which ends reads and
+    /// writes in progress. Must be called in `_strand`.
+    void _close();
 
     /// A socket for communication with clients
     boost::asio::ip::tcp::socket _socket;
     IoContextPtr _ioContext;
 
+    /// Serializes all handlers for `_socket` and the members below.
+    boost::asio::strand<boost::asio::io_context::executor_type> _strand;
+
+    std::deque<OutMsg> _writeQueue;  ///< Messages waiting to be written.
+    std::vector<OutMsg> _writing;    ///< Messages in the current write.
+
+    std::atomic<uint64_t> _writeCallCount{0};    ///< Number of async writes.
+    std::atomic<uint64_t> _msgsWrittenCount{0};  ///< Number of messages written.
+    NetStats::Ptr _netStats;                     ///< Traffic, errors, and queue delays.
+
     /// Identifier for this connection
     uint64_t const _connId;
 
@@ -153,6 +314,25 @@ private:
     boost::asio::streambuf _streamBuf;
     std::string _buffer;
 
+    /// Maximum number of unfinished commands from this connection.
+    unsigned int const _commandWindow;
+    unsigned int _cmdsInFlight = 0;  ///< Commands read but not finished, `_strand` only.
+    bool _readPaused = false;        ///< True while reading waits for the window, `_strand` only.
+
+    /// Set in `beginProtocol()` and then only used in `_strand`.
+    std::chrono::milliseconds _idleTimeout{0};        ///< Close after reading nothing for this long.
+    std::chrono::milliseconds _heartbeatInterval{0};  ///< Heartbeat after writing nothing for this long.
+
+    util::TIMEPOINT _lastRead;                  ///< When a message was last read, `_strand` only.
+    util::TIMEPOINT _lastWrite;                 ///< When a write last finished, `_strand` only.
+    boost::asio::steady_timer _idleTimer;       ///< Runs `_idleCheck()`, `_strand` only.
+    boost::asio::steady_timer _heartbeatTimer;  ///< Runs `_heartbeatCheck()`, `_strand` only.
+    std::atomic<uint64_t> _heartbeatCount{0};   ///< Number of heartbeats sent.
+
+    /// Limits the command rate, set in `beginProtocol()` and then only used in `_strand`.
+    util::TokenBucket _cmdBucket;
+    std::atomic<uint64_t> _rateLimitedCount{0};  ///< Commands rejected by `_cmdBucket`.
+
     std::atomic<bool> _shutdown{false};          ///< Set to true to stop loops and shutdown.
     std::atomic<bool> _connectionActive{false};  ///< True when there is an active connection.
 
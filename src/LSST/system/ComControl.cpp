@@ -31,9 +31,12 @@
 #include <stdexcept>
 
 // Third party headers
+#include "nlohmann/json.hpp"
 
 // Project headers
 #include "control/NetCommandDefs.h"
+#include "util/CommandJournal.h"
+#include "util/JsonScan.h"
 #include "util/Log.h"
 
 using namespace std;
@@ -55,28 +58,73 @@ void ComControl::setupNormalFactory(control::NetCommandFactory::Ptr const& cmdFa
     cmdFactory->addNetCommand(control::NCmdSwitchCommandSource::createFactoryVersion());
     cmdFactory->addNetCommand(control::NCmdPower::createFactoryVersion());
     cmdFactory->addNetCommand(control::NCmdSystemShutdown::createFactoryVersion());
+    cmdFactory->addNetCommand(control::NCmdGetCommandStats::createFactoryVersion(cmdFactory->getStats()));
+    cmdFactory->addNetCommand(control::NCmdGetNetStats::createFactoryVersion());
+    cmdFactory->addNetCommand(control::NCmdBatch::createFactoryVersion(cmdFactory));
 }
 
-std::tuple<std::string, util::Command::Ptr> ComControl::interpretCommand(std::string const& commandStr) {
+ComConnection::Interpretation ComControl::interpretCommand(std::string_view commandStr) {
+    uint64_t connId = getConnId();
     control::NetCommand::Ptr netCmd;
     try {
-        netCmd = _cmdFactory->getCommandFor(commandStr);
+        netCmd = _cmdFactory->getCommandFor(commandStr, _seqIds);
     } catch (control::NetCommandException const& nex) {
         LWARN("ComControl::interpretCommand(", commandStr, " excecption thrown ", nex.what());
         netCmd = _cmdFactory->getNoAck();
     }
+    // Only commands that passed the parse and sequence_id checks are replayed,
+    // the others are journaled as REJECTED.
+    auto journalType = netCmd->isAcked() ? util::CommandJournal::COMMAND : util::CommandJournal::REJECTED;
+    util::CommandJournal::appendGlobal(journalType, connId, commandStr);
     auto ackMsg = netCmd->getAckJsonStr();
     // This lambda function will be run when `cmd->runAction()` is called.
     // It needs a shared_ptr to this to prevent segfaults if ComConnection was closed.
     auto thisPtr = shared_from_this();
-    auto func = [thisPtr, netCmd](util::CmdData*) {
+    auto stats = _cmdFactory->getStats();
+    auto func = [thisPtr, netCmd, stats, connId](util::CmdData* data) {
         LDEBUG("ComControl Running func ", netCmd->getName(), " seqId=", netCmd->getSeqId());
+        auto times = dynamic_cast<CmdTimes*>(data);
+        if (times != nullptr) {
+            netCmd->markStage(control::NetCommand::RECEIVED, times->received);
+            netCmd->markStage(control::NetCommand::ACK_SENT, times->ackSent);
+        }
+        netCmd->markStage(control::NetCommand::ACTION_START);
         netCmd->run();
+        netCmd->markStage(control::NetCommand::ACTION_END);
         string finalMsg = netCmd->getRespJsonStr();
-        thisPtr->asyncWrite(finalMsg);
+        util::CommandJournal::appendGlobal(util::CommandJournal::RESULT, connId, finalMsg);
+        thisPtr->asyncWrite(finalMsg, [netCmd, stats](boost::system::error_code const& ec, size_t) {
+            if (!ec) {
+                netCmd->markStage(control::NetCommand::FINAL_SENT);
+                stats->record(*netCmd);
+            }
+        });
     };
     auto cmd = make_shared<util::Command>(func);
-    return {ackMsg, cmd};
+    return {ackMsg, cmd, netCmd->getLane(), netCmd->isIndependent()};
+}
+
+util::CommandExecutor::Lane ComControl::getLaneFor(std::string_view commandStr) {
+    util::JsonScan scan(commandStr);
+    std::string_view cmdId;
+    if (!scan.getString("id", cmdId)) {
+        return util::CommandExecutor::ROUTINE;
+    }
+    return _cmdFactory->getLaneFor(cmdId);
+}
+
+std::string ComControl::getBusyResponse(std::string_view commandStr, std::string const& reason) {
+    // Only the sequence_id is needed, so avoid a full parse.
+    util::JsonScan scan(commandStr);
+    uint64_t seqId = 0;
+    scan.getUInt64("sequence_id", seqId);
+    auto busyMsg = _cmdFactory->getBusyNoAck(seqId, reason)->getAckJsonStr();
+    // Rejected commands are journaled, but not as COMMAND records, as a replay
+    // should only run the commands that were run.
+    uint64_t connId = getConnId();
+    util::CommandJournal::appendGlobal(util::CommandJournal::REJECTED, connId, commandStr);
+    util::CommandJournal::appendGlobal(util::CommandJournal::RESULT, connId, busyMsg);
+    return busyMsg;
 }
 
 }  // namespace system
@@ -56,20 +56,37 @@ public:
     /// Use `commandStr` to get a runnable command and ack string from `_cmdFactory`.
     /// @return a json string to use for the 'ack'
     /// @return a Command object that when run will do what the `commandStr` indicated should be done.
+    /// @return the lane from `NetCommand::getLane()`.
+    /// @return true if `NetCommand::isIndependent()`.
     ///    If the facotry doesn't recognize `commandStr` it return a `Noack` or similar message
     ///    and the returned command will be a noop. This is depends on the provided
     ///    `NetCommandFactory`, `_cmdFactory`.
-    std::tuple<std::string, util::Command::Ptr> interpretCommand(std::string const& commandStr) override;
+    Interpretation interpretCommand(std::string_view commandStr) override;
+
+    /// @return the lane of the command named by the "id" of `commandStr`, found
+    ///     without parsing the rest of it, ROUTINE if it's unknown.
+    util::CommandExecutor::Lane getLaneFor(std::string_view commandStr) override;
+
+    /// @return a `noack` json string, from the factory's `NCmdNoAck`, with the
+    ///     `sequence_id` from `commandStr`, if it has one, and `reason` for `user_info`.
+    ///     `commandStr` is journaled as a REJECTED record and the `noack` as a RESULT.
+    std::string getBusyResponse(std::string_view commandStr, std::string const& reason) override;
 
 protected:
     /// @see ComControl::create()
     ComControl(IoContextPtr const& ioContext, uint64_t connId, std::shared_ptr<ComServer> const& server,
                control::NetCommandFactory::Ptr const& cmdFactory)
-            : ComConnection(ioContext, connId, server), _cmdFactory(cmdFactory) {}
+            : ComConnection(ioContext, connId, server),
+              _cmdFactory(cmdFactory),
+              _seqIds(cmdFactory->makeSeqIdValidator()) {}
 
 private:
     /// Factory for producing commands to run.
     std::shared_ptr<control::NetCommandFactory> _cmdFactory;
+
+    /// Checks the "sequence_id" of commands from this connection, shared
+    /// with other connections when the factory's policy is STRICT.
+    control::SeqIdValidator::Ptr _seqIds;
 };
 
 }  // namespace system
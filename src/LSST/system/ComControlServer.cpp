@@ -44,6 +44,10 @@ std::weak_ptr<ComControlServer> ComControlServer::_globalComControlServer;
 ComControlServer::Ptr ComControlServer::create(IoContextPtr const& ioContext, int port,
                                                control::NetCommandFactory::Ptr const& cmdFactory,
                                                bool makeGlobal) {
+    // All commands must be in the factory by now, freezing it lets
+    // commands be looked up without locking.
+    cmdFactory->freeze();
+    cmdFactory->getStats()->setLogInterval(Config::get().getControlServerCommandStatsLogSec());
     Ptr comControlServ = Ptr(new ComControlServer(ioContext, port, cmdFactory));
     if (makeGlobal) {
         if (_globalComControlServer.use_count() > 0) {
@@ -23,8 +23,11 @@
 #include "system/ComServer.h"
 
 // System headers
+#include <cerrno>
 #include <functional>
+#include <sys/socket.h>
 #include <thread>
+#include <vector>
 
 // Project headers
 #include "faultmgr/FaultMgr.h"
@@ -48,10 +51,80 @@ ComServer::Ptr ComServer::create(IoContextPtr const& ioContext, int port) {
 ComServer::ComServer(IoContextPtr const& ioContext, int port)
         : _ioContext(ioContext),
           _port(port),
-          _acceptor(*_ioContext, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), _port)) {
+          _acceptBacklog(Config::get().getControlServerAcceptBacklog()),
+          _acceptorCount(Config::get().getControlServerAcceptors()),
+          _cmdExecutor(util::CommandExecutor::create(Config::get().getControlServerCommandThreads(),
+                                                     Config::get().getControlServerMaxCommandsInFlight(),
+                                                     Config::get().getControlServerLaneHeadroom())),
+          _commandWindow(Config::get().getControlServerCommandWindow()),
+          _commandRate(Config::get().getControlServerCommandRate()),
+          _commandBurst(Config::get().getControlServerCommandBurst()),
+          _maxConnections(Config::get().getControlServerMaxConnections()),
+          _idleTimeout(chrono::milliseconds(Config::get().getControlServerIdleTimeoutMs())),
+          _heartbeatInterval(chrono::milliseconds(Config::get().getControlServerHeartbeatMs())),
+          _tcpUserTimeout(chrono::milliseconds(Config::get().getControlServerTcpUserTimeoutMs())),
+          _ioContextPerThread(Config::get().getControlServerIoContextPerThread()),
+          _connCountReporter(ConnectionCountReporter::create(
+                  [](size_t count) { faultmgr::FaultMgr::get().reportComConnectionCount(count); })),
+          _netStatsInterval(Config::get().getControlServerNetStatsSec()),
+          _netStatsTimer(*_ioContext) {
+    // Only set SO_REUSEPORT when it's needed, as it also lets another
+    // server started by mistake share the port instead of failing.
+    _acceptorReusePort = _acceptorCount > 1;
+    _acceptor = _openAcceptor(_ioContext, _port, _acceptorReusePort);
+    _port = _acceptor->local_endpoint().port();
+}
+
+ComServer::AcceptorPtr ComServer::_openAcceptor(IoContextPtr const& ioContext, int port, bool reusePort) {
+    using tcp = boost::asio::ip::tcp;
+    auto acceptor = make_shared<tcp::acceptor>(*ioContext);
+    tcp::endpoint endpoint(tcp::v4(), port);
+    acceptor->open(endpoint.protocol());
     // Set the socket reuse option to allow recycling ports after catastrophic
     // failures.
-    _acceptor.set_option(boost::asio::socket_base::reuse_address(true));
+    acceptor->set_option(boost::asio::socket_base::reuse_address(true));
+    if (reusePort) {
+        int on = 1;
+        if (setsockopt(acceptor->native_handle(), SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0) {
+            throw boost::system::system_error(errno, boost::system::system_category(),
+                                              "ComServer SO_REUSEPORT port=" + to_string(port));
+        }
+    }
+    acceptor->bind(endpoint);
+    acceptor->listen(_acceptBacklog);
+    return acceptor;
+}
+
+void ComServer::_startAcceptors() {
+    unsigned int count = _acceptorCount;
+    if (count > 1 && !_acceptorReusePort) {
+        // The kernel only shares the port between sockets that were all
+        // bound with SO_REUSEPORT, so `_acceptor` is opened again.
+        LINFO("ComServer::_startAcceptors reopening port=", _port, " with SO_REUSEPORT");
+        _acceptor->close();
+        _acceptor = _openAcceptor(_ioContext, _port, true);
+        _acceptorReusePort = true;
+    }
+    for (unsigned int j = 1; j < count; ++j) {
+        // Each extra acceptor is run by a different connection thread when there are some.
+        IoContextPtr connIoContext;
+        if (!_connIoContexts.empty()) {
+            connIoContext = _connIoContexts[(j - 1) % _connIoContexts.size()];
+        }
+        auto acceptor = _openAcceptor((connIoContext != nullptr) ? connIoContext : _ioContext, _port, true);
+        _extraAcceptors.push_back(acceptor);
+        _beginAccept(acceptor, connIoContext);
+    }
+    LINFO("ComServer::_startAcceptors port=", _port, " acceptors=", count, " backlog=", _acceptBacklog);
+    _beginAccept(_acceptor, nullptr);
+}
+
+void ComServer::_stopAcceptors() {
+    for (auto const& acceptor : _extraAcceptors) {
+        boost::system::error_code ec;
+        acceptor->close(ec);
+    }
+    _extraAcceptors.clear();
 }
 
 ComServer::~ComServer() {
@@ -61,16 +134,35 @@ ComServer::~ComServer() {
         shutdown();
     }
     destroy();
+    _connCountReporter->stop();
+    NetStats::unregisterSource(getNetStatsName());
 }
 
 void ComServer::run() {
     LDEBUG("ComServer::run()");
+    int threadCount = Config::get().getControlServerThreads();
+    weak_ptr<ComServer> weakThis = shared_from_this();
+    NetStats::registerSource(getNetStatsName(), [weakThis]() {
+        auto serv = weakThis.lock();
+        return (serv == nullptr) ? nlohmann::json() : serv->getNetStatsJson();
+    });
+    _startNetStatsTimer();
+    if (_ioContextPerThread) {
+        _runPerThread(threadCount);
+    } else {
+        _runShared(threadCount);
+    }
+    NetStats::unregisterSource(getNetStatsName());
+    LDEBUG("ComServer::run() finished");
+    _state = STOPPED;
+}
+
+void ComServer::_runShared(int threadCount) {
     // Begin accepting immediately. Otherwise it will finish when it
     // discovers that there are outstanding operations.
-    _beginAccept();
+    _startAcceptors();
 
     // Launch all threads in the pool
-    int threadCount = Config::get().getControlServerThreads();
     vector<shared_ptr<thread>> threads(threadCount);
     for (auto&& ptr : threads) {
         ptr = shared_ptr<thread>(new thread([&]() { _ioContext->run(); }));
@@ -82,41 +174,138 @@ void ComServer::run() {
     for (auto&& ptr : threads) {
         ptr->join();
     }
-    LDEBUG("ComServer::run() finished");
-    _state = STOPPED;
+    _stopAcceptors();
+}
+
+void ComServer::_runPerThread(int threadCount) {
+    using WorkGuard = boost::asio::executor_work_guard<boost::asio::io_context::executor_type>;
+    // Only one thread runs each of these, which lets asio skip most of its locking.
+    vector<WorkGuard> guards;
+    for (int j = 0; j < threadCount; ++j) {
+        _connIoContexts.push_back(make_shared<boost::asio::io_context>(1));
+        guards.push_back(boost::asio::make_work_guard(*_connIoContexts.back()));
+    }
+    _startAcceptors();
+
+    vector<thread> threads;
+    for (auto const& ctx : _connIoContexts) {
+        threads.emplace_back([ctx]() { ctx->run(); });
+    }
+    _state = RUNNING;
+    LDEBUG("ComServer::run() RUNNING ioContextPerThread threads=", threadCount);
+
+    // This returns when `_ioContext` is stopped, which then stops the others.
+    _ioContext->run();
+    for (auto& guard : guards) {
+        guard.reset();
+    }
+    for (auto const& ctx : _connIoContexts) {
+        ctx->stop();
+    }
+    for (auto& thrd : threads) {
+        thrd.join();
+    }
+    _stopAcceptors();
+    _connIoContexts.clear();
 }
 
-void ComServer::_beginAccept() {
+IoContextPtr ComServer::_nextConnIoContext() {
+    if (_connIoContexts.empty()) {
+        return _ioContext;
+    }
+    return _connIoContexts[_connIoContextSeq++ % _connIoContexts.size()];
+}
+
+void ComServer::_startNetStatsTimer() {
+    if (_netStatsInterval.count() <= 0 || _shutdown) {
+        return;
+    }
+    _netStatsTimer.expires_after(_netStatsInterval);
+    weak_ptr<ComServer> weakThis = shared_from_this();
+    _netStatsTimer.async_wait([weakThis](boost::system::error_code const& ec) {
+        auto serv = weakThis.lock();
+        if (ec || serv == nullptr || serv->_shutdown) {
+            return;
+        }
+        string msg = makeNetStatsMsg();
+        LDEBUG("ComServer netStats ", msg);
+        serv->asyncWriteToAllComConn(msg);
+        serv->_startNetStatsTimer();
+    });
+}
+
+string ComServer::makeNetStatsMsg() {
+    nlohmann::json js;
+    js["id"] = "netStats";
+    js["servers"] = NetStats::getAllJson();
+    return js.dump();
+}
+
+nlohmann::json ComServer::getNetStatsJson() const {
+    vector<shared_ptr<ComConnection>> conns;
+    {
+        lock_guard<mutex> lg(_mapMtx);
+        for (auto&& elem : _connections) {
+            auto conn = elem.second.lock();
+            if (conn != nullptr) {
+                conns.push_back(conn);
+            }
+        }
+    }
+    nlohmann::json js;
+    js["total"] = _netStats->getJson();
+    js["connections"] = nlohmann::json::array();
+    for (auto const& conn : conns) {
+        js["connections"].push_back(conn->getNetStatsJson());
+    }
+    return js;
+}
+
+void ComServer::_beginAccept(AcceptorPtr const& acceptor, IoContextPtr const& connIoContext) {
     if (_state == STOPPED || _shutdown) {
         return;
     }
     auto connId = _connIdSeq++;
-    ComConnection::Ptr const connection = newComConnection(_ioContext, connId, shared_from_this());
-    _acceptor.async_accept(connection->socket(),
-                           bind(&ComServer::_handleAccept, shared_from_this(), connection, _1));
+    auto ioContext = (connIoContext != nullptr) ? connIoContext : _nextConnIoContext();
+    ComConnection::Ptr const connection = newComConnection(ioContext, connId, shared_from_this());
+    acceptor->async_accept(connection->socket(), bind(&ComServer::_handleAccept, shared_from_this(),
+                                                      acceptor, connIoContext, connection, _1));
 }
 
-void ComServer::_handleAccept(ComConnection::Ptr const& connection, boost::system::error_code const& ec) {
+void ComServer::_handleAccept(AcceptorPtr const& acceptor, IoContextPtr const& connIoContext,
+                              ComConnection::Ptr const& connection, boost::system::error_code const& ec) {
     LINFO("ComServer::_handleAccept");
     if (_state == STOPPED || _shutdown) {
         return;
     }
+    if (ec.value() == 0) {
+        ++_acceptedCount;
+    }
 
     size_t connectionSize;
     {
         lock_guard<mutex> lg(_mapMtx);
+        if (ec.value() == 0 && _connections.size() >= _maxConnections) {
+            ++_rejectedConnectionCount;
+            LWARN("ComServer::_handleAccept rejecting connection, already ", _connections.size(),
+                  " rejected=", _rejectedConnectionCount.load());
+            connection->reject();
+            _beginAccept(acceptor, connIoContext);
+            return;
+        }
         _connections.emplace(connection->getConnId(), connection);
         connectionSize = _connections.size();
     }
     // If going from 0 to 1, FaultMgr must clear the appropriate fault so the system can be turned on.
-    faultmgr::FaultMgr::get().reportComConnectionCount(connectionSize);
+    // That may change the model, so it is done in the reporter's thread instead of this one.
+    _connCountReporter->post(connectionSize);
 
     if (ec.value() == 0) {
         connection->beginProtocol();
     } else {
         LERROR("ComServer::_handleAccept ec:", ec.message());
     }
-    _beginAccept();
+    _beginAccept(acceptor, connIoContext);
 }
 
 void ComServer::shutdown() {
@@ -124,6 +313,15 @@ void ComServer::shutdown() {
     if (_shutdown.exchange(true) == true) {
         return;
     }
+    // The timer may only be touched in `_ioContext`. When called by the
+    // destructor, there's nothing to cancel the timer for.
+    weak_ptr<ComServer> weakThis = weak_from_this();
+    boost::asio::post(*_ioContext, [weakThis]() {
+        auto serv = weakThis.lock();
+        if (serv != nullptr) {
+            serv->_netStatsTimer.cancel();
+        }
+    });
     vector<weak_ptr<ComConnection>> vect;
     {
         lock_guard<mutex> lg(_mapMtx);
@@ -138,6 +336,10 @@ void ComServer::shutdown() {
             conn->shutdown();
         }
     }
+
+    // Give commands that are already running a chance to finish.
+    _cmdExecutor->shutdown(COMMAND_SHUTDOWN_TIMEOUT);
+    LINFO("ComServer::shutdown command lanes\n", _cmdExecutor->getLaneWaitSummary());
 }
 
 void ComServer::destroy() {
@@ -175,7 +377,7 @@ void ComServer::eraseConnection(uint64_t connId) {
         connectionSize = _connections.size();
     }
     // If going to 0, FaultMgr must set the appropriate fault to force safe mode.
-    faultmgr::FaultMgr::get().reportComConnectionCount(connectionSize);
+    _connCountReporter->post(connectionSize);
 }
 
 int ComServer::connectionCount() const {
@@ -203,11 +405,23 @@ ComConnection::Ptr ComServer::newComConnection(IoContextPtr const& ioContext, ui
 }
 
 void ComServer::asyncWriteToAllComConn(std::string const& msg) {
-    lock_guard<mutex> lg(_mapMtx);
-    for (auto&& elem : _connections) {
-        auto conn = elem.second.lock();
+    asyncWriteToAllComConn(ComConnection::makeBuffer(msg));
+}
+
+void ComServer::asyncWriteToAllComConn(ComConnection::BufferPtr const& buf) {
+    // `_mapMtx` is only held long enough to copy the list of connections.
+    vector<weak_ptr<ComConnection>> conns;
+    {
+        lock_guard<mutex> lg(_mapMtx);
+        conns.reserve(_connections.size());
+        for (auto&& elem : _connections) {
+            conns.push_back(elem.second);
+        }
+    }
+    for (auto&& wConn : conns) {
+        auto conn = wConn.lock();
         if (conn != nullptr) {
-            conn->asyncWrite(msg);
+            conn->asyncWriteBuffer(buf);
         }
     }
 }
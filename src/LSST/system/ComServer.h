@@ -22,16 +22,23 @@
 #define LSST_M2CELLCPP_SYSTEM_COMSERVER_H
 
 // System headers
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <memory>
 #include <map>
 #include <mutex>
+#include <vector>
 
 // Third party headers
 #include <boost/asio.hpp>
 
 // project headers
 #include "system/ComConnection.h"
+#include "system/ConnectionCountReporter.h"
+#include "system/NetStats.h"
+#include "system/WelcomeMsg.h"
+#include "util/CommandExecutor.h"
 
 namespace LSST {
 namespace m2cellcpp {
@@ -44,14 +51,44 @@ class ComConnection;
 /// receiving a connection, it creates a ComConnection object
 /// to handle the communications with the client. The server
 /// tracks open connections in _connections.
+/// Commands from all connections are run by `_cmdExecutor`, each
+/// connection may have up to `_commandWindow` commands unfinished at once,
+/// though only independent ones run at the same time.
 ///
-/// unit test: test_com.cpp
+/// By default, the server's threads all run the one `io_context` given to
+/// the constructor, so a connection's handlers can run on any of them.
+/// With `setIoContextPerThread(true)`, each thread runs its own
+/// `io_context` and new connections are given to them round-robin, so all
+/// of a connection's handlers run on one thread, and the thread that called
+/// `run()` runs the given `io_context`, which only accepts connections.
+/// Connections still use their strand, as commands and broadcasts write to
+/// them from other threads.
+///
+/// With more than one acceptor, see `setAcceptorCount()`, every acceptor
+/// binds the port with SO_REUSEPORT and the kernel spreads new connections
+/// across them, so a burst of reconnects isn't accepted one at a time.
+/// `_acceptor` is run by `_ioContext`. The others are run by the per-thread
+/// `io_context`s, and keep the connections they accept on their thread,
+/// or all by `_ioContext` when it is shared.
+///
+/// Changes in the number of connections are given to FaultMgr by
+/// `_connCountReporter` in its own thread, so the asio threads never wait
+/// on the fault or model locks.
+///
+/// Each connection's network statistics are added to `_netStats`. While
+/// running, the server registers `getNetStatsJson()` with `NetStats`, and
+/// every `_netStatsInterval` it sends a "netStats" message with the
+/// statistics of all registered servers to every connection. That message
+/// isn't part of the normal protocol, so it's off by default.
+///
+/// unit test: tests/test_Com.cpp
 class ComServer : public std::enable_shared_from_this<ComServer> {
 public:
     using Ptr = std::shared_ptr<ComServer>;
     enum State { CREATED = 0, RUNNING, STOPPED };
 
     /// A factory method to prevent issues with enable_shared_from_this.
+    /// A `port` of 0 listens on an ephemeral port, see `getPort()`.
     /// @return A pointer to the created ComServer object.
     static Ptr create(IoContextPtr const& ioContext, int port);
 
@@ -71,6 +108,29 @@ public:
 
     State getState() const { return _state; }
 
+    /// Return the port the server is listening on.
+    int getPort() const { return _port; }
+
+    /// Set to true to give each server thread its own `io_context`, this
+    /// must be called before `run()`. The config file value is used otherwise.
+    void setIoContextPerThread(bool perThread) { _ioContextPerThread = perThread; }
+
+    /// Return true if each server thread has its own `io_context`.
+    bool getIoContextPerThread() const { return _ioContextPerThread; }
+
+    /// Set the number of sockets accepting connections on the port, this
+    /// must be called before `run()`. The config file value is used otherwise.
+    void setAcceptorCount(unsigned int count) { _acceptorCount = std::max(count, 1u); }
+
+    /// Return the number of sockets accepting connections on the port.
+    unsigned int getAcceptorCount() const { return _acceptorCount; }
+
+    /// Return the `listen()` backlog of each accepting socket.
+    int getAcceptBacklog() const { return _acceptBacklog; }
+
+    /// Return the number of connections accepted, including rejected ones.
+    uint64_t getAcceptedCount() const { return _acceptedCount; }
+
     /// Return a new ComConnection object.
     virtual ComConnection::Ptr newComConnection(IoContextPtr const& ioContext, uint64_t connId,
                                                 std::shared_ptr<ComServer> const& server);
@@ -88,8 +148,13 @@ public:
     void setDoSendWelcomeMsgServ(bool doSend) { _doSendWelcomeMsgServ = doSend; }
 
     /// Async write the `msg` to all existing ComConnections for this ComServer.
+    /// `msg` is copied into one buffer that is shared by every connection.
     void asyncWriteToAllComConn(std::string const& msg);
 
+    /// Async write `buf`, from `ComConnection::makeBuffer()`, to all existing
+    /// ComConnections for this ComServer.
+    void asyncWriteToAllComConn(ComConnection::BufferPtr const& buf);
+
     /// Cause the server to stop responding to client requests.
     /// This also shutsdown all connections using this server.
     void shutdown();
@@ -98,21 +163,156 @@ public:
     /// `_ioContext`. This will essentially stop anything using `_ioContext`.
     void destroy();
 
+    /// Return the cached welcome message sent to new connections.
+    WelcomeMsg::Ptr getWelcomeMsg() const { return _welcomeMsg; }
+
+    /// Return the executor that runs commands for all connections.
+    util::CommandExecutor::Ptr getCommandExecutor() const { return _cmdExecutor; }
+
+    /// Return the maximum number of unfinished commands for one connection.
+    unsigned int getCommandWindow() const { return _commandWindow; }
+
+    /// Set the commands per second, `rate`, and `burst` allowed for connections
+    /// made after this is called. A `rate` of 0 means there is no limit.
+    /// The values from the config file are used otherwise.
+    void setCommandRateLimit(double rate, double burst) {
+        _commandRate = rate;
+        _commandBurst = burst;
+    }
+
+    /// Return the commands per second allowed for new connections, 0 is no limit.
+    double getCommandRate() const { return _commandRate; }
+
+    /// Return the number of commands new connections may send at once.
+    double getCommandBurst() const { return _commandBurst; }
+
+    /// Set the maximum number of open connections, new connections past
+    /// this are closed. The value from the config file is used otherwise.
+    void setMaxConnections(unsigned int maxConnections) { _maxConnections = maxConnections; }
+
+    /// Return the maximum number of open connections.
+    unsigned int getMaxConnections() const { return _maxConnections; }
+
+    /// Count a command rejected by a connection's rate limit.
+    void countRateLimited() { ++_rateLimitedCount; }
+
+    /// Return the number of commands rejected by connection rate limits.
+    uint64_t getRateLimitedCount() const { return _rateLimitedCount; }
+
+    /// Return the network statistics for all connections, including closed ones.
+    NetStats::Ptr getNetStats() const { return _netStats; }
+
+    /// Return the totals from `getNetStats()` and the statistics of each
+    /// open connection as json.
+    nlohmann::json getNetStatsJson() const;
+
+    /// Return the name the server registers its statistics with `NetStats` as.
+    std::string getNetStatsName() const { return "controlServer:" + std::to_string(_port); }
+
+    /// Set the time between "netStats" messages, 0 turns them off. This
+    /// must be called before `run()`, the config file value is used otherwise.
+    void setNetStatsInterval(std::chrono::seconds interval) { _netStatsInterval = interval; }
+
+    /// Return a "netStats" message with the statistics of all registered servers.
+    static std::string makeNetStatsMsg();
+
+    /// Return the reporter that gives connection counts to FaultMgr.
+    ConnectionCountReporter::Ptr getConnectionCountReporter() const { return _connCountReporter; }
+
+    /// Set the connection timeouts for connections made after this is called,
+    /// 0 turns each one off. The values from the config file are used otherwise.
+    /// @param idle - a connection that receives nothing for this long is closed.
+    /// @param heartbeat - a connection that sends nothing for this long sends a heartbeat.
+    /// @param tcpUser - a connection fails when data it sent isn't acknowledged for this long.
+    void setConnectionTimeouts(std::chrono::milliseconds idle, std::chrono::milliseconds heartbeat,
+                               std::chrono::milliseconds tcpUser) {
+        _idleTimeout = idle;
+        _heartbeatInterval = heartbeat;
+        _tcpUserTimeout = tcpUser;
+    }
+
+    /// Return how long new connections may receive nothing before being closed.
+    std::chrono::milliseconds getIdleTimeout() const { return _idleTimeout; }
+
+    /// Return how long new connections may send nothing before sending a heartbeat.
+    std::chrono::milliseconds getHeartbeatInterval() const { return _heartbeatInterval; }
+
+    /// Return how long data sent on new connections may go unacknowledged.
+    std::chrono::milliseconds getTcpUserTimeout() const { return _tcpUserTimeout; }
+
+    /// Count a connection closed by its idle timeout.
+    void countIdleTimeout() { ++_idleTimeoutCount; }
+
+    /// Return the number of connections closed by their idle timeout.
+    uint64_t getIdleTimeoutCount() const { return _idleTimeoutCount; }
+
+    /// Count a connection's heartbeat timer waking up.
+    void countHeartbeatCheck() { ++_heartbeatCheckCount; }
+
+    /// Return the number of times connection heartbeat timers have woken up.
+    uint64_t getHeartbeatCheckCount() const { return _heartbeatCheckCount; }
+
+    /// Return the number of connections closed because there were
+    /// already `getMaxConnections()` open.
+    uint64_t getRejectedConnectionCount() const { return _rejectedConnectionCount; }
+
+    /// Maximum time `shutdown()` waits for running commands to finish.
+    static constexpr std::chrono::milliseconds COMMAND_SHUTDOWN_TIMEOUT{5000};
+
 protected:
     /// Protected constructor to force use of create().
     ComServer(IoContextPtr const& ioContext, int port);
 
 private:
-    /// Begin (asynchronously) accepting connection requests.
-    void _beginAccept();
+    using AcceptorPtr = std::shared_ptr<boost::asio::ip::tcp::acceptor>;
+
+    /// Return an acceptor run by `ioContext` that is listening on `port`,
+    /// with SO_REUSEPORT set before binding if `reusePort` is true.
+    /// @throw boost::system::system_error if the port can't be bound.
+    AcceptorPtr _openAcceptor(IoContextPtr const& ioContext, int port, bool reusePort);
+
+    /// Open the extra acceptors and begin accepting on all of them.
+    void _startAcceptors();
+
+    /// Close the extra acceptors, which must be done before their `io_context`s are destroyed.
+    void _stopAcceptors();
+
+    /// Begin (asynchronously) accepting connection requests on `acceptor`.
+    /// Connections are run by `connIoContext`, or by `_nextConnIoContext()` if it is null.
+    void _beginAccept(AcceptorPtr const& acceptor, IoContextPtr const& connIoContext);
+
+    /// Handle a connection request from `_beginAccept()`.
+    void _handleAccept(AcceptorPtr const& acceptor, IoContextPtr const& connIoContext,
+                       ComConnection::Ptr const& connection, boost::system::error_code const& ec);
+
+    /// Run `threadCount` threads that all run `_ioContext`.
+    void _runShared(int threadCount);
 
-    /// Handle a connection request.
-    void _handleAccept(ComConnection::Ptr const& connection, boost::system::error_code const& ec);
+    /// Run `threadCount` threads, each with its own `io_context` from
+    /// `_connIoContexts`, and run `_ioContext` in this thread.
+    void _runPerThread(int threadCount);
+
+    /// Return the `io_context` for the next connection.
+    IoContextPtr _nextConnIoContext();
+
+    /// Start `_netStatsTimer` to send the next "netStats" message, unless
+    /// they are turned off.
+    void _startNetStatsTimer();
 
     IoContextPtr _ioContext;             ///< Pointer to the asio io_context
     std::atomic<State> _state{CREATED};  ///< Current state of the machine.
-    int _port;
-    boost::asio::ip::tcp::acceptor _acceptor;
+    int _port;  ///< Port being listened on, set from `_acceptor` when created with 0.
+
+    int const _acceptBacklog;                  ///< `listen()` backlog of each acceptor.
+    std::atomic<unsigned int> _acceptorCount;  ///< Number of acceptors, see `setAcceptorCount()`.
+    std::atomic<uint64_t> _acceptedCount{0};   ///< Connections accepted by all acceptors.
+
+    /// The first acceptor, opened by the constructor and run by `_ioContext`.
+    AcceptorPtr _acceptor;
+    bool _acceptorReusePort;  ///< True if `_acceptor` was bound with SO_REUSEPORT.
+
+    /// The other acceptors, which only exist while `run()` is running.
+    std::vector<AcceptorPtr> _extraAcceptors;
 
     std::atomic<bool> _shutdown{false};  ///< set to true the first time shutdown is called.
 
@@ -125,10 +325,47 @@ private:
     /// The source for connections Ids for the _connectionsMap.
     /// It should take hundreds or thousands of years for it
     /// uint64_t to wrap around.
-    uint64_t _connIdSeq{0};
+    std::atomic<uint64_t> _connIdSeq{0};
 
     /// When true, new connections will start by sending `_sendWelcomeMsg()`.
     std::atomic<bool> _doSendWelcomeMsgServ{true};
+
+    /// Runs commands for all connections.
+    util::CommandExecutor::Ptr _cmdExecutor;
+
+    /// Maximum number of unfinished commands for one connection.
+    unsigned int const _commandWindow;
+
+    std::atomic<double> _commandRate;              ///< Commands per second for new connections.
+    std::atomic<double> _commandBurst;             ///< Commands at once for new connections.
+    std::atomic<unsigned int> _maxConnections;     ///< Maximum open connections.
+    std::atomic<uint64_t> _rateLimitedCount{0};    ///< Commands rejected by rate limits.
+    std::atomic<uint64_t> _rejectedConnectionCount{0};  ///< Connections closed by `_maxConnections`.
+
+    std::atomic<std::chrono::milliseconds> _idleTimeout;        ///< See `setConnectionTimeouts()`.
+    std::atomic<std::chrono::milliseconds> _heartbeatInterval;  ///< See `setConnectionTimeouts()`.
+    std::atomic<std::chrono::milliseconds> _tcpUserTimeout;     ///< See `setConnectionTimeouts()`.
+    std::atomic<uint64_t> _idleTimeoutCount{0};     ///< Connections closed by `_idleTimeout`.
+    std::atomic<uint64_t> _heartbeatCheckCount{0};  ///< Heartbeat timer wake ups.
+
+    /// True if each server thread runs its own `io_context`.
+    std::atomic<bool> _ioContextPerThread;
+
+    /// The `io_context` of each thread when `_ioContextPerThread` is true, and
+    /// empty otherwise. It is only changed by `run()` before the first accept
+    /// and after `_ioContext` has stopped, so it isn't locked.
+    std::vector<IoContextPtr> _connIoContexts;
+    std::atomic<size_t> _connIoContextSeq{0};  ///< Picks the next entry in `_connIoContexts`.
+
+    /// Gives connection counts to FaultMgr without blocking the asio threads.
+    ConnectionCountReporter::Ptr _connCountReporter;
+
+    NetStats::Ptr _netStats{NetStats::create()};  ///< Totals for all connections.
+    std::chrono::seconds _netStatsInterval;       ///< Time between "netStats" messages.
+    boost::asio::steady_timer _netStatsTimer;     ///< Timer for "netStats" messages, `_ioContext` only.
+
+    /// Welcome message shared by all connections.
+    WelcomeMsg::Ptr _welcomeMsg{WelcomeMsg::create()};
 };
 
 }  // namespace system
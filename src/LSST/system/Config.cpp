@@ -84,6 +84,69 @@ void Config::verifyRequiredElements() {
         int threads = getControlServerThreads();
         LINFO("ControlServer:threads=", threads);
 
+        bool ioContextPerThread = getControlServerIoContextPerThread();
+        LINFO("ControlServer:ioContextPerThread=", ioContextPerThread);
+
+        int acceptors = getControlServerAcceptors();
+        LINFO("ControlServer:acceptors=", acceptors);
+
+        int acceptBacklog = getControlServerAcceptBacklog();
+        LINFO("ControlServer:acceptBacklog=", acceptBacklog);
+
+        int commandThreads = getControlServerCommandThreads();
+        LINFO("ControlServer:commandThreads=", commandThreads);
+
+        int maxCommandsInFlight = getControlServerMaxCommandsInFlight();
+        LINFO("ControlServer:maxCommandsInFlight=", maxCommandsInFlight);
+
+        int laneHeadroom = getControlServerLaneHeadroom();
+        LINFO("ControlServer:laneHeadroom=", laneHeadroom);
+
+        int commandWindow = getControlServerCommandWindow();
+        LINFO("ControlServer:commandWindow=", commandWindow);
+
+        int commandStatsLogSec = getControlServerCommandStatsLogSec();
+        LINFO("ControlServer:commandStatsLogSec=", commandStatsLogSec);
+
+        int netStatsSec = getControlServerNetStatsSec();
+        LINFO("ControlServer:netStatsSec=", netStatsSec);
+
+        int idleTimeoutMs = getControlServerIdleTimeoutMs();
+        LINFO("ControlServer:idleTimeoutMs=", idleTimeoutMs);
+
+        int heartbeatMs = getControlServerHeartbeatMs();
+        LINFO("ControlServer:heartbeatMs=", heartbeatMs);
+
+        int tcpUserTimeoutMs = getControlServerTcpUserTimeoutMs();
+        LINFO("ControlServer:tcpUserTimeoutMs=", tcpUserTimeoutMs);
+
+        int commandRate = getControlServerCommandRate();
+        LINFO("ControlServer:commandRate=", commandRate);
+
+        int commandBurst = getControlServerCommandBurst();
+        LINFO("ControlServer:commandBurst=", commandBurst);
+
+        int maxConnections = getControlServerMaxConnections();
+        LINFO("ControlServer:maxConnections=", maxConnections);
+
+        string seqIdPolicy = getControlServerSeqIdPolicy();
+        LINFO("ControlServer:seqIdPolicy=", seqIdPolicy);
+
+        int seqIdWindow = getControlServerSeqIdWindow();
+        LINFO("ControlServer:seqIdWindow=", seqIdWindow);
+
+        string journalPathPrefix = getCommandJournalPathPrefix();
+        LINFO("CommandJournal:pathPrefix=", journalPathPrefix);
+
+        int journalSegmentMB = getCommandJournalSegmentMB();
+        LINFO("CommandJournal:segmentMB=", journalSegmentMB);
+
+        int journalCommitMs = getCommandJournalCommitMs();
+        LINFO("CommandJournal:commitMs=", journalCommitMs);
+
+        int journalMaxSegments = getCommandJournalMaxSegments();
+        LINFO("CommandJournal:maxSegments=", journalMaxSegments);
+
         host = getTelemetryServerHost();
         LINFO("TelemetryServer:host=", host);
 
@@ -93,6 +156,9 @@ void Config::verifyRequiredElements() {
         threads = getTelemetryServerThreads();
         LINFO("TelemetryServer:threads=", threads);
 
+        double staleLimit = getTelemetryServerExternalStaleLimitSec();
+        LINFO("TelemetryServer:externalStaleLimitSec=", staleLimit);
+
         string logFileName = getLogFileName();
         LINFO("Log::fileName=", logFileName);
 
@@ -127,6 +193,113 @@ int Config::getControlServerThreads() {
     return getSectionKeyAsInt(section, key, 1, 3000);
 }
 
+bool Config::getControlServerIoContextPerThread() {
+    string section = "ControlServer";
+    string key = "ioContextPerThread";
+    return getSectionKeyAsInt(section, key, 0, 1) != 0;
+}
+
+int Config::getControlServerAcceptors() {
+    string section = "ControlServer";
+    string key = "acceptors";
+    return getSectionKeyAsInt(section, key, 1, 64);
+}
+
+int Config::getControlServerAcceptBacklog() {
+    string section = "ControlServer";
+    string key = "acceptBacklog";
+    return getSectionKeyAsInt(section, key, 1, 65535);
+}
+
+int Config::getControlServerCommandThreads() {
+    string section = "ControlServer";
+    string key = "commandThreads";
+    return getSectionKeyAsInt(section, key, 1, 100);
+}
+
+int Config::getControlServerMaxCommandsInFlight() {
+    string section = "ControlServer";
+    string key = "maxCommandsInFlight";
+    return getSectionKeyAsInt(section, key, 1, 100000);
+}
+
+int Config::getControlServerLaneHeadroom() {
+    string section = "ControlServer";
+    string key = "laneHeadroom";
+    return getSectionKeyAsInt(section, key, 0, 10000);
+}
+
+int Config::getControlServerCommandWindow() {
+    string section = "ControlServer";
+    string key = "commandWindow";
+    return getSectionKeyAsInt(section, key, 1, 1000);
+}
+
+int Config::getControlServerCommandStatsLogSec() {
+    string section = "ControlServer";
+    string key = "commandStatsLogSec";
+    return getSectionKeyAsInt(section, key, 0, 86400);
+}
+
+int Config::getControlServerNetStatsSec() {
+    string section = "ControlServer";
+    string key = "netStatsSec";
+    return getSectionKeyAsInt(section, key, 0, 86400);
+}
+
+int Config::getControlServerIdleTimeoutMs() {
+    string section = "ControlServer";
+    string key = "idleTimeoutMs";
+    return getSectionKeyAsInt(section, key, 0, 86400000);
+}
+
+int Config::getControlServerHeartbeatMs() {
+    string section = "ControlServer";
+    string key = "heartbeatMs";
+    return getSectionKeyAsInt(section, key, 0, 86400000);
+}
+
+int Config::getControlServerTcpUserTimeoutMs() {
+    string section = "ControlServer";
+    string key = "tcpUserTimeoutMs";
+    return getSectionKeyAsInt(section, key, 0, 86400000);
+}
+
+int Config::getControlServerCommandRate() {
+    string section = "ControlServer";
+    string key = "commandRate";
+    return getSectionKeyAsInt(section, key, 0, 1000000);
+}
+
+int Config::getControlServerCommandBurst() {
+    string section = "ControlServer";
+    string key = "commandBurst";
+    return getSectionKeyAsInt(section, key, 1, 1000000);
+}
+
+int Config::getControlServerMaxConnections() {
+    string section = "ControlServer";
+    string key = "maxConnections";
+    return getSectionKeyAsInt(section, key, 1, 10000);
+}
+
+string Config::getControlServerSeqIdPolicy() {
+    string section = "ControlServer";
+    string key = "seqIdPolicy";
+    string policy = getSectionKeyAsString(section, key);
+    if (policy != "strict" && policy != "perConnection" && policy != "windowed") {
+        throw ConfigException(ERR_LOC, section + ":" + key + "=" + policy +
+                                               " must be strict, perConnection, or windowed");
+    }
+    return policy;
+}
+
+int Config::getControlServerSeqIdWindow() {
+    string section = "ControlServer";
+    string key = "seqIdWindow";
+    return getSectionKeyAsInt(section, key, 1, 4096);
+}
+
 string Config::getControlServerHost() {
     string section = "ControlServer";
     string key = "host";
@@ -163,12 +336,54 @@ int Config::getTelemetryServerThreads() {
     return getSectionKeyAsInt(section, key, 1, 3000);
 }
 
+double Config::getTelemetryServerExternalStaleLimitSec() {
+    string section = "TelemetryServer";
+    string key = "externalStaleLimitSec";
+    return getSectionKeyAsDouble(section, key, 0.01, 3600.0);
+}
+
 string Config::getTelemetryServerHost() {
     string section = "TelemetryServer";
     string key = "host";
     return getSectionKeyAsString(section, key);
 }
 
+int Config::getTelemetryRelayPort() {
+    string section = "TelemetryRelay";
+    string key = "port";
+    return getSectionKeyAsInt(section, key, 1, 65535);
+}
+
+string Config::getTelemetryRelayItems() {
+    string section = "TelemetryRelay";
+    string key = "items";
+    return getSectionKeyAsString(section, key);
+}
+
+string Config::getCommandJournalPathPrefix() {
+    string section = "CommandJournal";
+    string key = "pathPrefix";
+    return getSectionKeyAsString(section, key);
+}
+
+int Config::getCommandJournalSegmentMB() {
+    string section = "CommandJournal";
+    string key = "segmentMB";
+    return getSectionKeyAsInt(section, key, 1, 1024);
+}
+
+int Config::getCommandJournalCommitMs() {
+    string section = "CommandJournal";
+    string key = "commitMs";
+    return getSectionKeyAsInt(section, key, 1, 10000);
+}
+
+int Config::getCommandJournalMaxSegments() {
+    string section = "CommandJournal";
+    string key = "maxSegments";
+    return getSectionKeyAsInt(section, key, 0, 100000);
+}
+
 int Config::getSectionKeyAsInt(string const& section, string const& key) {
     if (!_yaml[section][key]) {
         throw ConfigException(ERR_LOC, string("Config") + section + ": " + key + " is missing");
@@ -113,6 +113,119 @@ public:
     /// @throws `ConfigException` if it's missing or out of range.
     int getControlServerThreads();
 
+    /// Get the `ControlServer: ioContextPerThread` value from the config file.
+    /// When true, each `ControlServer: threads` thread runs its own io_context.
+    /// @return the `ControlServer: ioContextPerThread` value.
+    /// @throws `ConfigException` if it's missing or not 0 or 1.
+    bool getControlServerIoContextPerThread();
+
+    /// Get the `ControlServer: acceptors` value from the config file.
+    /// More than 1 opens that many sockets on the port with SO_REUSEPORT.
+    /// @return the `ControlServer: acceptors` int value.
+    /// @throws `ConfigException` if it's missing or out of range.
+    int getControlServerAcceptors();
+
+    /// Get the `ControlServer: acceptBacklog` value from the config file.
+    /// This is the `listen()` backlog of each accepting socket.
+    /// @return the `ControlServer: acceptBacklog` int value.
+    /// @throws `ConfigException` if it's missing or out of range.
+    int getControlServerAcceptBacklog();
+
+    /// Get the `ControlServer: commandThreads` value from the config file.
+    /// This is the number of threads used to run commands from clients.
+    /// @return the `ControlServer: commandThreads` int value.
+    /// @throws `ConfigException` if it's missing or out of range.
+    int getControlServerCommandThreads();
+
+    /// Get the `ControlServer: maxCommandsInFlight` value from the config file.
+    /// Commands received when this many are queued or running are rejected.
+    /// @return the `ControlServer: maxCommandsInFlight` int value.
+    /// @throws `ConfigException` if it's missing or out of range.
+    int getControlServerMaxCommandsInFlight();
+
+    /// Get the `ControlServer: laneHeadroom` value from the config file.
+    /// This many of `maxCommandsInFlight` are kept free of routine commands for
+    /// power commands, and as many again for safety commands.
+    /// @return the `ControlServer: laneHeadroom` int value.
+    /// @throws `ConfigException` if it's missing or out of range.
+    int getControlServerLaneHeadroom();
+
+    /// Get the `ControlServer: commandWindow` value from the config file.
+    /// This is the number of commands from one connection that may be
+    /// running at the same time, reading from the connection pauses while
+    /// this many are unfinished.
+    /// @return the `ControlServer: commandWindow` int value.
+    /// @throws `ConfigException` if it's missing or out of range.
+    int getControlServerCommandWindow();
+
+    /// Get the `ControlServer: commandStatsLogSec` value from the config file.
+    /// This is the number of seconds between logging summaries of command
+    /// latencies, 0 turns the summaries off.
+    /// @return the `ControlServer: commandStatsLogSec` int value.
+    /// @throws `ConfigException` if it's missing or out of range.
+    int getControlServerCommandStatsLogSec();
+
+    /// Get the `ControlServer: netStatsSec` value from the config file.
+    /// This is the number of seconds between "netStats" messages sent to
+    /// all clients, 0 turns them off.
+    /// @return the `ControlServer: netStatsSec` int value.
+    /// @throws `ConfigException` if it's missing or out of range.
+    int getControlServerNetStatsSec();
+
+    /// Get the `ControlServer: idleTimeoutMs` value from the config file.
+    /// This is the number of milliseconds a connection may go without
+    /// receiving a message before it is closed, 0 turns this off.
+    /// @return the `ControlServer: idleTimeoutMs` int value.
+    /// @throws `ConfigException` if it's missing or out of range.
+    int getControlServerIdleTimeoutMs();
+
+    /// Get the `ControlServer: heartbeatMs` value from the config file.
+    /// This is the number of milliseconds a connection may go without
+    /// sending a message before a heartbeat is sent, 0 turns this off.
+    /// @return the `ControlServer: heartbeatMs` int value.
+    /// @throws `ConfigException` if it's missing or out of range.
+    int getControlServerHeartbeatMs();
+
+    /// Get the `ControlServer: tcpUserTimeoutMs` value from the config file.
+    /// This is the number of milliseconds data sent on a connection may go
+    /// unacknowledged before the connection fails, 0 uses the system default.
+    /// @return the `ControlServer: tcpUserTimeoutMs` int value.
+    /// @throws `ConfigException` if it's missing or out of range.
+    int getControlServerTcpUserTimeoutMs();
+
+    /// Get the `ControlServer: commandRate` value from the config file.
+    /// This is the number of commands per second one connection may send
+    /// before they are rejected as busy, 0 means there is no limit.
+    /// @return the `ControlServer: commandRate` int value.
+    /// @throws `ConfigException` if it's missing or out of range.
+    int getControlServerCommandRate();
+
+    /// Get the `ControlServer: commandBurst` value from the config file.
+    /// This is the number of commands a connection may send at once before
+    /// `commandRate` applies.
+    /// @return the `ControlServer: commandBurst` int value.
+    /// @throws `ConfigException` if it's missing or out of range.
+    int getControlServerCommandBurst();
+
+    /// Get the `ControlServer: maxConnections` value from the config file.
+    /// New connections are closed while this many are open.
+    /// @return the `ControlServer: maxConnections` int value.
+    /// @throws `ConfigException` if it's missing or out of range.
+    int getControlServerMaxConnections();
+
+    /// Get the `ControlServer: seqIdPolicy` value from the config file.
+    /// This is how command "sequence_id"s are checked, see `control::SeqIdValidator`.
+    /// @return the `ControlServer: seqIdPolicy` value.
+    /// @throws `ConfigException` if it's missing or not "strict", "perConnection", or "windowed".
+    std::string getControlServerSeqIdPolicy();
+
+    /// Get the `ControlServer: seqIdWindow` value from the config file.
+    /// This is how far below a connection's highest "sequence_id" others are
+    /// accepted with the "windowed" `ControlServer: seqIdPolicy`.
+    /// @return the `ControlServer: seqIdWindow` int value.
+    /// @throws `ConfigException` if it's missing or out of range.
+    int getControlServerSeqIdWindow();
+
     /// Get the `TelemetryServer: host` value from the config file.
     /// @return the `TelemetryServer: host` value.
     /// @throws `ConfigException` if it's missing.
@@ -128,6 +241,51 @@ public:
     /// @throws `ConfigException` if it's missing or out of range.
     int getTelemetryServerThreads();
 
+    /// Get the `TelemetryServer: externalStaleLimitSec` value from the config file.
+    /// External feeds, like `tel_elevation`, older than this are stale.
+    /// @return the `TelemetryServer: externalStaleLimitSec` double value.
+    /// @throws `ConfigException` if it's missing or out of range.
+    double getTelemetryServerExternalStaleLimitSec();
+
+    /// Get the `TelemetryRelay: port` value from the config file.
+    /// This is only required by the telemetry relay application.
+    /// @return the `TelemetryRelay: port` int value.
+    /// @throws `ConfigException` if it's missing or out of range.
+    int getTelemetryRelayPort();
+
+    /// Get the `TelemetryRelay: items` value from the config file.
+    /// This is a comma separated list of item ids to relay, an empty
+    /// string relays all items.
+    /// This is only required by the telemetry relay application.
+    /// @return the `TelemetryRelay: items` value.
+    /// @throws `ConfigException` if it's missing.
+    std::string getTelemetryRelayItems();
+
+    /// Get the `CommandJournal: pathPrefix` value from the config file.
+    /// This is the path and base name of the command journal segments,
+    /// an empty string turns the journal off.
+    /// @return the `CommandJournal: pathPrefix` value.
+    /// @throws `ConfigException` if it's missing.
+    std::string getCommandJournalPathPrefix();
+
+    /// Get the `CommandJournal: segmentMB` value from the config file.
+    /// @return the `CommandJournal: segmentMB` int value.
+    /// @throws `ConfigException` if it's missing or out of range.
+    int getCommandJournalSegmentMB();
+
+    /// Get the `CommandJournal: commitMs` value from the config file.
+    /// This is the longest time a journal record waits to be written.
+    /// @return the `CommandJournal: commitMs` int value.
+    /// @throws `ConfigException` if it's missing or out of range.
+    int getCommandJournalCommitMs();
+
+    /// Get the `CommandJournal: maxSegments` value from the config file.
+    /// This is the most segments kept for the journals of all runs together,
+    /// older ones are removed, and 0 keeps all of them.
+    /// @return the `CommandJournal: maxSegments` int value.
+    /// @throws `ConfigException` if it's missing or out of range.
+    int getCommandJournalMaxSegments();
+
     /// Check all required entries from the Config.
     /// @throws `ConfigException` if any required elements are missing or
     ///         fail conversion.
@@ -0,0 +1,134 @@
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+// Class header
+#include "system/ConnectionCountReporter.h"
+
+// System headers
+#include <exception>
+
+// Project headers
+#include "util/Log.h"
+
+using namespace std;
+
+namespace LSST {
+namespace m2cellcpp {
+namespace system {
+
+ConnectionCountReporter::ConnectionCountReporter(ReportFunc const& report) : _report(report) {
+    _thrd = thread(&ConnectionCountReporter::_run, this);
+}
+
+ConnectionCountReporter::~ConnectionCountReporter() { stop(); }
+
+void ConnectionCountReporter::post(size_t count) {
+    {
+        lock_guard<mutex> lg(_mtx);
+        ++_posted;
+        if (!_stopped) {
+            _sawZero = _sawZero || (count == 0);
+            _latest = count;
+            _pending = true;
+            ++_pendingPosts;
+            _cv.notify_all();
+            return;
+        }
+    }
+    LWARN("ConnectionCountReporter::post after stop count=", count);
+    _callReport(count);
+    lock_guard<mutex> lg(_mtx);
+    ++_handled;
+    _cv.notify_all();
+}
+
+void ConnectionCountReporter::stop() {
+    {
+        lock_guard<mutex> lg(_mtx);
+        if (_stopped) {
+            return;
+        }
+        _stopped = true;
+    }
+    _cv.notify_all();
+    if (_thrd.joinable()) {
+        _thrd.join();
+    }
+}
+
+bool ConnectionCountReporter::waitForReported(chrono::milliseconds timeout) {
+    unique_lock<mutex> ulock(_mtx);
+    return _cv.wait_for(ulock, timeout, [this]() { return _handled == _posted; });
+}
+
+uint64_t ConnectionCountReporter::getPostedCount() const {
+    lock_guard<mutex> lg(_mtx);
+    return _posted;
+}
+
+uint64_t ConnectionCountReporter::getReportedCount() const {
+    lock_guard<mutex> lg(_mtx);
+    return _reported;
+}
+
+void ConnectionCountReporter::_run() {
+    unique_lock<mutex> ulock(_mtx);
+    while (true) {
+        _cv.wait(ulock, [this]() { return _pending || _stopped; });
+        if (!_pending) {
+            break;
+        }
+        size_t latest = _latest;
+        bool sawZero = _sawZero;
+        uint64_t posts = _pendingPosts;
+        _pendingPosts = 0;
+        _pending = false;
+        _sawZero = false;
+        ulock.unlock();
+
+        // The fault for having no connections must be set even if
+        // a connection has already been made again.
+        int calls = 1;
+        if (sawZero && latest != 0) {
+            _callReport(0);
+            ++calls;
+        }
+        _callReport(latest);
+
+        ulock.lock();
+        _reported += calls;
+        _handled += posts;
+        _cv.notify_all();
+    }
+}
+
+void ConnectionCountReporter::_callReport(size_t count) {
+    LDEBUG("ConnectionCountReporter::_callReport count=", count);
+    try {
+        _report(count);
+    } catch (exception const& ex) {
+        LERROR("ConnectionCountReporter::_callReport count=", count, " ", ex.what());
+    }
+}
+
+}  // namespace system
+}  // namespace m2cellcpp
+}  // namespace LSST
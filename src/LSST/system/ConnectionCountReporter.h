@@ -0,0 +1,109 @@
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+#ifndef LSST_M2CELLCPP_SYSTEM_CONNECTIONCOUNTREPORTER_H
+#define LSST_M2CELLCPP_SYSTEM_CONNECTIONCOUNTREPORTER_H
+
+// System headers
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace LSST {
+namespace m2cellcpp {
+namespace system {
+
+/// Reports changes in the number of ComServer connections from its own
+/// thread, so the asio threads that accept and close connections never
+/// wait on the fault manager or model locks that reporting may take.
+/// When several counts are posted before the thread gets to them, only the
+/// latest is reported, except that a count of 0 is never skipped. Going to
+/// 0 connections puts the system in safe mode, which must still happen
+/// when a network blip drops every connection and they come right back.
+///
+/// unit test: test_ConnectionCountReporter.cpp
+class ConnectionCountReporter {
+public:
+    using Ptr = std::shared_ptr<ConnectionCountReporter>;
+    using ReportFunc = std::function<void(size_t)>;
+
+    /// Create a reporter that calls `report` with the connection count
+    /// from its thread, which is started here.
+    static Ptr create(ReportFunc const& report) { return Ptr(new ConnectionCountReporter(report)); }
+
+    ConnectionCountReporter() = delete;
+    ConnectionCountReporter(ConnectionCountReporter const&) = delete;
+    ConnectionCountReporter& operator=(ConnectionCountReporter const&) = delete;
+
+    /// Calls `stop()`.
+    ~ConnectionCountReporter();
+
+    /// Post the current connection `count` to be reported. This doesn't
+    /// wait, unless `stop()` has been called, then `count` is reported
+    /// in this thread.
+    void post(size_t count);
+
+    /// Report anything posted and stop the thread.
+    void stop();
+
+    /// Wait up to `timeout` for everything posted so far to be reported.
+    /// @return true if everything posted has been reported.
+    bool waitForReported(std::chrono::milliseconds timeout);
+
+    /// Return the number of counts posted.
+    uint64_t getPostedCount() const;
+
+    /// Return the number of times `report` has been called.
+    uint64_t getReportedCount() const;
+
+private:
+    ConnectionCountReporter(ReportFunc const& report);
+
+    /// Report posted counts until `stop()` is called.
+    void _run();
+
+    /// Call `_report` with `count`, logging any exception it throws.
+    void _callReport(size_t count);
+
+    ReportFunc _report;  ///< Function that reports the count.
+
+    mutable std::mutex _mtx;      ///< Protects all members below.
+    std::condition_variable _cv;  ///< Notified when a count is posted or reported.
+    bool _pending = false;        ///< True if `_latest` has not been reported.
+    bool _sawZero = false;        ///< True if a 0 was posted since the last report.
+    size_t _latest = 0;           ///< The most recently posted count.
+    bool _stopped = false;        ///< Set to true by `stop()`.
+    uint64_t _posted = 0;         ///< Number of counts posted.
+    uint64_t _pendingPosts = 0;   ///< Number of counts posted since the last report.
+    uint64_t _handled = 0;        ///< Number of posted counts reported or coalesced.
+    uint64_t _reported = 0;       ///< Number of calls to `_report`.
+
+    std::thread _thrd;  ///< Runs `_run()`.
+};
+
+}  // namespace system
+}  // namespace m2cellcpp
+}  // namespace LSST
+
+#endif  // LSST_M2CELLCPP_SYSTEM_CONNECTIONCOUNTREPORTER_H
@@ -73,6 +73,9 @@ void Globals::setTcpIpConnected(bool connecting) {
     } else {
         --_tcpIpConnectedCount;
     }
+    if ((originalCount > 0) != (_tcpIpConnectedCount > 0)) {
+        ++_changeCount;
+    }
     if (_tcpIpConnectedCount <= 0) {
         // FUTURE: change state to SAFE MODE - power off ILC communication and actuator motor
         LWARN("No TCP/IP connections, going to OFFLINESTATE");
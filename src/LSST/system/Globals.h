@@ -111,7 +111,11 @@ public:
     int getSummaryState() const { return _summaryState; }
 
     /// Set summary system state to `val`. PLACEHOLDER
-    void setSummaryState(int val) { _summaryState = val; }
+    void setSummaryState(int val) {
+        if (_summaryState.exchange(val) != val) {
+            ++_changeCount;
+        }
+    }
 
     /// Return model digital input. PLACEHOLDER
     uint32_t getDigitalInput() const { return _digitalInput; }
@@ -127,9 +131,14 @@ public:
     bool setCommandSourceIsRemote(bool isRemote) {
         _commandSourceIsRemote = isRemote;
         _commandableByDds = isRemote;
+        ++_changeCount;
         return true;
     }
 
+    /// Return a count that changes whenever a value sent to clients when they
+    /// connect changes, so cached copies of those values can be checked cheaply.
+    uint64_t getChangeCount() const { return _changeCount; }
+
     /// Return true if "user_info" elements are being sent to clients in json messages.
     bool isSendUserInfo() const { return true; }
 
@@ -183,6 +192,8 @@ private:
 
     std::atomic<bool> _commandSourceIsRemote{
             false};  ///< Command source is remote when true, otherwise false.
+
+    std::atomic<uint64_t> _changeCount{0};  ///< Incremented when a value changes, see `getChangeCount()`.
 };
 
 }  // namespace system
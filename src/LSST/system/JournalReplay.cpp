@@ -0,0 +1,162 @@
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+// Class header
+#include "system/JournalReplay.h"
+
+// System headers
+#include <chrono>
+#include <future>
+#include <map>
+#include <sstream>
+#include <thread>
+
+// Project headers
+#include "system/ComClientAsync.h"
+#include "util/JsonScan.h"
+#include "util/Log.h"
+
+using namespace std;
+
+namespace LSST {
+namespace m2cellcpp {
+namespace system {
+
+string JournalReplay::Result::getSummary() const {
+    stringstream os;
+    os << "sent=" << sent << " skipped=" << skipped << " acked=" << acked << " noacked=" << noacked
+       << " busy=" << busy << " succeeded=" << succeeded << " failed=" << failed << " lost=" << lost
+       << " elapsedSec=" << elapsedSec << " ackLatency(" << ackLatency.getSummary() << ")";
+    return os.str();
+}
+
+JournalReplay::JournalReplay(vector<util::CommandJournal::Record> const& records, double speed)
+        : _speed(speed) {
+    for (auto const& rec : records) {
+        if (rec.type == util::CommandJournal::COMMAND) {
+            _commands.push_back(rec);
+        }
+    }
+}
+
+JournalReplay::Result JournalReplay::run(IoContextPtr const& ioContext, string const& host, int port) {
+    Result result;
+    auto const timeout = chrono::seconds(RESPONSE_TIMEOUT_SEC);
+
+    // Each connection is closed after its last command.
+    map<uint64_t, size_t> lastIndex;
+    for (size_t j = 0; j < _commands.size(); ++j) {
+        lastIndex[_commands[j].connId] = j;
+    }
+    map<uint64_t, ComClientAsync::Ptr> clients;
+    map<uint64_t, vector<future<nlohmann::json>>> finals;
+
+    // Wait for the final responses of everything sent on `connId`.
+    auto collectFinals = [&result, &finals, timeout](uint64_t connId) {
+        for (auto& fin : finals[connId]) {
+            if (fin.wait_for(timeout) != future_status::ready) {
+                ++result.lost;
+                continue;
+            }
+            try {
+                auto finJ = fin.get();
+                if (finJ.is_null()) {
+                    continue;  // Busy, counted with the ack.
+                }
+                (finJ.value("id", "") == "success") ? ++result.succeeded : ++result.failed;
+            } catch (exception const& ex) {
+                LWARN("JournalReplay lost final ", ex.what());
+                ++result.lost;
+            }
+        }
+        finals.erase(connId);
+    };
+
+    auto start = util::CLOCK::now();
+    uint64_t const firstMicros = _commands.empty() ? 0 : _commands.front().timeMicros;
+    for (size_t j = 0; j < _commands.size(); ++j) {
+        auto const& rec = _commands[j];
+        if (_speed > 0.0) {
+            auto offset = chrono::microseconds(uint64_t((rec.timeMicros - firstMicros) / _speed));
+            this_thread::sleep_until(start + offset);
+        }
+        uint64_t seqId = 0;
+        if (!util::JsonScan(rec.payload).getUInt64("sequence_id", seqId)) {
+            LWARN("JournalReplay skipping command without sequence_id ", rec.payload);
+            ++result.skipped;
+        } else {
+            auto& client = clients[rec.connId];
+            if (client == nullptr) {
+                client = ComClientAsync::create(ioContext, host, port);
+            }
+            auto sendTime = util::CLOCK::now();
+            auto resp = client->send(rec.payload, seqId);
+            ++result.sent;
+            if (resp.ack.wait_for(timeout) != future_status::ready) {
+                LWARN("JournalReplay no ack for ", rec.payload);
+                ++result.lost;
+            } else {
+                try {
+                    auto ackJ = resp.ack.get();
+                    auto micros = chrono::duration_cast<chrono::microseconds>(util::CLOCK::now() - sendTime);
+                    result.ackLatency.record(micros.count());
+                    if (ackJ.value("id", "") == "ack") {
+                        ++result.acked;
+                    } else {
+                        ++result.noacked;
+                        if (ackJ.value("user_info", "").rfind("busy", 0) == 0) {
+                            ++result.busy;
+                        }
+                    }
+                    finals[rec.connId].push_back(move(resp.fin));
+                } catch (exception const& ex) {
+                    LWARN("JournalReplay lost ack ", ex.what());
+                    ++result.lost;
+                }
+            }
+        }
+        if (lastIndex[rec.connId] == j) {
+            collectFinals(rec.connId);
+            auto iter = clients.find(rec.connId);
+            if (iter != clients.end()) {
+                iter->second->close();
+                clients.erase(iter);
+            }
+        }
+    }
+    result.elapsedSec = chrono::duration<double>(util::CLOCK::now() - start).count();
+    LINFO("JournalReplay ", result.getSummary());
+    return result;
+}
+
+vector<string> JournalReplay::getStateTransitions(vector<util::CommandJournal::Record> const& records) {
+    vector<string> states;
+    for (auto const& rec : records) {
+        if (rec.type == util::CommandJournal::STATE) {
+            states.push_back(rec.payload);
+        }
+    }
+    return states;
+}
+
+}  // namespace system
+}  // namespace m2cellcpp
+}  // namespace LSST
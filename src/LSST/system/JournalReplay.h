@@ -0,0 +1,98 @@
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+#ifndef LSST_M2CELLCPP_SYSTEM_JOURNALREPLAY_H
+#define LSST_M2CELLCPP_SYSTEM_JOURNALREPLAY_H
+
+// System headers
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Project headers
+#include "system/ComConnection.h"
+#include "util/CommandJournal.h"
+#include "util/LatencyHistogram.h"
+
+namespace LSST {
+namespace m2cellcpp {
+namespace system {
+
+/// Send the commands in a `util::CommandJournal` to a `ComControlServer`,
+/// in the order they were received, to reproduce a recorded session.
+/// Each recorded connection gets its own `ComClientAsync` connection, which
+/// is closed once its last command has its final response.
+/// Every command is acked before the next one is sent, so the server sees
+/// them in the recorded order even when they were recorded on different
+/// connections. The time between commands can be the recorded time, scaled
+/// by `speed`, or none at all, which also makes a journal a realistic
+/// command throughput benchmark.
+///
+/// unit test: test_CommandJournal.cpp
+class JournalReplay {
+public:
+    /// Counts of what happened to the replayed commands.
+    struct Result {
+        uint64_t sent = 0;                  ///< Commands sent.
+        uint64_t skipped = 0;               ///< Commands without a "sequence_id", which were not sent.
+        uint64_t acked = 0;                 ///< Commands that got an "ack".
+        uint64_t noacked = 0;               ///< Commands that got a "noack", including busy ones.
+        uint64_t busy = 0;                  ///< Commands rejected because the server was busy.
+        uint64_t succeeded = 0;             ///< Commands with a "success" final response.
+        uint64_t failed = 0;                ///< Commands with a "fail" final response.
+        uint64_t lost = 0;                  ///< Commands with a response that never arrived.
+        double elapsedSec = 0.0;            ///< Time taken by `run()`.
+        util::LatencyHistogram ackLatency;  ///< Microseconds from sending to the ack.
+
+        /// @return a one line summary of the counts and ack latency.
+        std::string getSummary() const;
+    };
+
+    /// Seconds to wait for any one response.
+    static constexpr int RESPONSE_TIMEOUT_SEC = 30;
+
+    /// @param records records read from a journal, only COMMAND records are sent.
+    /// @param speed 1.0 keeps the recorded time between commands, 2.0 halves it,
+    ///     and 0.0 sends each command as soon as the previous one is acked.
+    JournalReplay(std::vector<util::CommandJournal::Record> const& records, double speed);
+
+    JournalReplay() = delete;
+    JournalReplay(JournalReplay const&) = delete;
+    JournalReplay& operator=(JournalReplay const&) = delete;
+    ~JournalReplay() = default;
+
+    /// Replay the commands to the server at `host`:`port`.
+    /// @throw boost::system::system_error if a connection can't be made.
+    Result run(IoContextPtr const& ioContext, std::string const& host, int port);
+
+    /// @return the payloads of the STATE records in `records`, in order.
+    static std::vector<std::string> getStateTransitions(
+            std::vector<util::CommandJournal::Record> const& records);
+
+private:
+    std::vector<util::CommandJournal::Record> _commands;  ///< The COMMAND records to send.
+    double const _speed;                                  ///< Pace of the replay.
+};
+
+}  // namespace system
+}  // namespace m2cellcpp
+}  // namespace LSST
+
+#endif  // LSST_M2CELLCPP_SYSTEM_JOURNALREPLAY_H
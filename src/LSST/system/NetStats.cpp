@@ -0,0 +1,163 @@
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+// Class header
+#include "system/NetStats.h"
+
+// System headers
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <vector>
+
+// Project headers
+#include "util/Log.h"
+
+using namespace std;
+using json = nlohmann::json;
+
+namespace LSST {
+namespace m2cellcpp {
+namespace system {
+
+map<string, NetStats::SourceFunc> NetStats::_sources;
+mutex NetStats::_sourcesMtx;
+
+TcpInfoSample TcpInfoSample::sample(int fd) {
+    TcpInfoSample smp;
+    struct tcp_info info;
+    socklen_t len = sizeof(info);
+    if (fd < 0 || getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) != 0) {
+        return smp;
+    }
+    smp.valid = true;
+    smp.rttMicros = info.tcpi_rtt;
+    smp.rttVarMicros = info.tcpi_rttvar;
+    smp.retransmits = info.tcpi_total_retrans;
+    smp.unacked = info.tcpi_unacked;
+    smp.lost = info.tcpi_lost;
+    smp.sendCwnd = info.tcpi_snd_cwnd;
+    int outq = 0;
+    if (ioctl(fd, TIOCOUTQ, &outq) == 0 && outq > 0) {
+        smp.sendQueueBytes = outq;
+    }
+    return smp;
+}
+
+json TcpInfoSample::getJson() const {
+    if (!valid) {
+        return json();
+    }
+    json js;
+    js["rttMicros"] = rttMicros;
+    js["rttVarMicros"] = rttVarMicros;
+    js["retransmits"] = retransmits;
+    js["unacked"] = unacked;
+    js["lost"] = lost;
+    js["sendCwnd"] = sendCwnd;
+    js["sendQueueBytes"] = sendQueueBytes;
+    return js;
+}
+
+void NetStats::recordIn(uint64_t bytes, uint64_t msgs) {
+    _bytesIn += bytes;
+    _msgsIn += msgs;
+    if (_parent != nullptr) {
+        _parent->recordIn(bytes, msgs);
+    }
+}
+
+void NetStats::recordOut(uint64_t bytes, uint64_t msgs) {
+    _bytesOut += bytes;
+    _msgsOut += msgs;
+    if (_parent != nullptr) {
+        _parent->recordOut(bytes, msgs);
+    }
+}
+
+void NetStats::recordQueueDelay(uint64_t micros) {
+    ++_delayCount;
+    _delaySum += micros;
+    uint64_t prevMax = _delayMax;
+    while (micros > prevMax && !_delayMax.compare_exchange_weak(prevMax, micros)) {
+    }
+    if (_parent != nullptr) {
+        _parent->recordQueueDelay(micros);
+    }
+}
+
+void NetStats::recordError() {
+    ++_errors;
+    if (_parent != nullptr) {
+        _parent->recordError();
+    }
+}
+
+double NetStats::getQueueDelayMean() const {
+    uint64_t count = _delayCount;
+    return (count == 0) ? 0.0 : double(_delaySum) / count;
+}
+
+json NetStats::getJson() const {
+    json js;
+    js["bytesIn"] = _bytesIn.load();
+    js["bytesOut"] = _bytesOut.load();
+    js["msgsIn"] = _msgsIn.load();
+    js["msgsOut"] = _msgsOut.load();
+    js["errors"] = _errors.load();
+    js["queueDelayMeanMicros"] = getQueueDelayMean();
+    js["queueDelayMaxMicros"] = _delayMax.load();
+    return js;
+}
+
+void NetStats::registerSource(string const& name, SourceFunc const& source) {
+    LDEBUG("NetStats::registerSource ", name);
+    lock_guard<mutex> lg(_sourcesMtx);
+    _sources[name] = source;
+}
+
+void NetStats::unregisterSource(string const& name) {
+    LDEBUG("NetStats::unregisterSource ", name);
+    lock_guard<mutex> lg(_sourcesMtx);
+    _sources.erase(name);
+}
+
+json NetStats::getAllJson() {
+    // The sources are called without the lock, they may take their own.
+    vector<pair<string, SourceFunc>> sources;
+    {
+        lock_guard<mutex> lg(_sourcesMtx);
+        sources.assign(_sources.begin(), _sources.end());
+    }
+    json js = json::object();
+    for (auto const& [name, source] : sources) {
+        json srcJs = source();
+        if (!srcJs.is_null()) {
+            js[name] = move(srcJs);
+        }
+    }
+    return js;
+}
+
+}  // namespace system
+}  // namespace m2cellcpp
+}  // namespace LSST
@@ -0,0 +1,142 @@
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+#ifndef LSST_M2CELLCPP_SYSTEM_NETSTATS_H
+#define LSST_M2CELLCPP_SYSTEM_NETSTATS_H
+
+// System headers
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Third party headers
+#include <nlohmann/json.hpp>
+
+namespace LSST {
+namespace m2cellcpp {
+namespace system {
+
+/// Socket level statistics for a TCP connection, sampled from `TCP_INFO`.
+struct TcpInfoSample {
+    /// Return a sample of the TCP state of socket `fd`, which is not
+    /// valid if `fd` isn't an open TCP socket.
+    static TcpInfoSample sample(int fd);
+
+    /// Return the values as json, or null if not valid.
+    nlohmann::json getJson() const;
+
+    bool valid = false;           ///< True if the values below were read.
+    uint32_t rttMicros = 0;       ///< Smoothed round trip time.
+    uint32_t rttVarMicros = 0;    ///< Round trip time variance.
+    uint32_t retransmits = 0;     ///< Total segments retransmitted.
+    uint32_t unacked = 0;         ///< Segments sent but not yet acked.
+    uint32_t lost = 0;            ///< Segments thought to be lost.
+    uint32_t sendCwnd = 0;        ///< Congestion window in segments.
+    uint32_t sendQueueBytes = 0;  ///< Bytes in the socket send buffer.
+};
+
+/// Counts of the bytes and messages sent and received on connections,
+/// socket errors, and how long outgoing messages waited to be written.
+/// A connection's `NetStats` can have a parent, usually its server's,
+/// which is given everything recorded so it has the totals for all
+/// connections, including those that have closed.
+/// All members are thread safe, and recording is just a few atomic adds.
+///
+/// Servers register a function returning their statistics with
+/// `registerSource()`, so they can all be found with `getAllJson()`.
+///
+/// unit test: test_NetStats.cpp
+class NetStats {
+public:
+    using Ptr = std::shared_ptr<NetStats>;
+    using SourceFunc = std::function<nlohmann::json()>;
+
+    /// Return a new `NetStats` that also records everything in `parent`.
+    static Ptr create(Ptr const& parent = nullptr) { return Ptr(new NetStats(parent)); }
+
+    NetStats() = delete;
+    NetStats(NetStats const&) = delete;
+    NetStats& operator=(NetStats const&) = delete;
+    ~NetStats() = default;
+
+    /// Record `msgs` messages totaling `bytes` bytes received.
+    void recordIn(uint64_t bytes, uint64_t msgs);
+
+    /// Record `msgs` messages totaling `bytes` bytes sent.
+    void recordOut(uint64_t bytes, uint64_t msgs);
+
+    /// Record that a message waited `micros` microseconds from being
+    /// queued until it was written.
+    void recordQueueDelay(uint64_t micros);
+
+    /// Record a socket error, not including the peer closing the connection.
+    void recordError();
+
+    uint64_t getBytesIn() const { return _bytesIn; }             ///< Bytes received.
+    uint64_t getBytesOut() const { return _bytesOut; }           ///< Bytes sent.
+    uint64_t getMsgsIn() const { return _msgsIn; }               ///< Messages received.
+    uint64_t getMsgsOut() const { return _msgsOut; }             ///< Messages sent.
+    uint64_t getErrors() const { return _errors; }               ///< Socket errors.
+    uint64_t getQueueDelayCount() const { return _delayCount; }  ///< Queue delays recorded.
+    uint64_t getQueueDelayMax() const { return _delayMax; }      ///< Longest queue delay.
+
+    /// Return the mean queue delay in microseconds, 0 if none were recorded.
+    double getQueueDelayMean() const;
+
+    /// Return the counts as json.
+    nlohmann::json getJson() const;
+
+    /// Register `source` as `name`, replacing any source already using `name`.
+    static void registerSource(std::string const& name, SourceFunc const& source);
+
+    /// Remove the source registered as `name`.
+    static void unregisterSource(std::string const& name);
+
+    /// Return the json from every registered source, by name. Sources
+    /// returning null, such as for a server that is gone, are left out.
+    static nlohmann::json getAllJson();
+
+private:
+    NetStats(Ptr const& parent) : _parent(parent) {}
+
+    Ptr _parent;  ///< Also given everything recorded, may be nullptr.
+
+    std::atomic<uint64_t> _bytesIn{0};
+    std::atomic<uint64_t> _bytesOut{0};
+    std::atomic<uint64_t> _msgsIn{0};
+    std::atomic<uint64_t> _msgsOut{0};
+    std::atomic<uint64_t> _errors{0};
+    std::atomic<uint64_t> _delayCount{0};  ///< Number of queue delays recorded.
+    std::atomic<uint64_t> _delaySum{0};    ///< Sum of queue delays in microseconds.
+    std::atomic<uint64_t> _delayMax{0};    ///< Longest queue delay in microseconds.
+
+    static std::map<std::string, SourceFunc> _sources;  ///< Registered sources by name.
+    static std::mutex _sourcesMtx;                      ///< Protects `_sources`.
+};
+
+}  // namespace system
+}  // namespace m2cellcpp
+}  // namespace LSST
+
+#endif  // LSST_M2CELLCPP_SYSTEM_NETSTATS_H
@@ -0,0 +1,209 @@
+// -*- LSST-C++ -*-
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+// Class header
+#include "system/TelemetryClient.h"
+
+// System headers
+
+// Third party headers
+
+// Project headers
+#include "system/TelemetryCom.h"
+#include "util/Bug.h"
+#include "util/Log.h"
+
+using namespace std;
+namespace asio = boost::asio;
+
+namespace LSST {
+namespace m2cellcpp {
+namespace system {
+
+TelemetryClient::TelemetryClient(IoContextPtr const& ioContext, string const& host, int port)
+        : _ioContext(ioContext),
+          _host(host),
+          _port(port),
+          _strand(asio::make_strand(*ioContext)),
+          _socket(_strand),
+          _resolver(_strand),
+          _reconnectTimer(_strand) {}
+
+void TelemetryClient::_checkNotStarted(string const& note) {
+    if (_started) {
+        throw util::Bug(ERR_LOC, "TelemetryClient::" + note + " must be called before start()");
+    }
+}
+
+void TelemetryClient::setItemCallback(string const& id, ItemCallback const& cb) {
+    _checkNotStarted("setItemCallback");
+    _itemCallbacks[id] = cb;
+}
+
+void TelemetryClient::setDefaultCallback(ItemCallback const& cb) {
+    _checkNotStarted("setDefaultCallback");
+    _defaultCallback = cb;
+}
+
+void TelemetryClient::setConnectCallback(ConnectCallback const& cb) {
+    _checkNotStarted("setConnectCallback");
+    _connectCallback = cb;
+}
+
+void TelemetryClient::setBackoff(chrono::milliseconds backoffMin, chrono::milliseconds backoffMax) {
+    _checkNotStarted("setBackoff");
+    _backoffMin = backoffMin;
+    _backoffMax = max(backoffMin, backoffMax);
+    _backoff = _backoffMin;
+}
+
+void TelemetryClient::start() {
+    if (_started.exchange(true)) {
+        return;
+    }
+    asio::post(_strand, [self = shared_from_this()]() { self->_connect(); });
+}
+
+void TelemetryClient::stop() {
+    if (_stopped.exchange(true)) {
+        return;
+    }
+    asio::post(_strand, [self = shared_from_this()]() {
+        self->_reconnectTimer.cancel();
+        self->_resolver.cancel();
+        self->_disconnect();
+    });
+}
+
+void TelemetryClient::_connect() {
+    if (_stopped) {
+        return;
+    }
+    auto self = shared_from_this();
+    _resolver.async_resolve(
+            _host, to_string(_port),
+            [self](boost::system::error_code const& ec, asio::ip::tcp::resolver::results_type results) {
+                if (ec || self->_stopped) {
+                    LDEBUG("TelemetryClient resolve failed ", self->_host, " ", ec.message());
+                    self->_scheduleReconnect();
+                    return;
+                }
+                asio::async_connect(
+                        self->_socket, results,
+                        [self](boost::system::error_code const& ec, asio::ip::tcp::endpoint const&) {
+                            if (ec || self->_stopped) {
+                                LDEBUG("TelemetryClient connect failed ", self->_host, ":", self->_port, " ",
+                                       ec.message());
+                                boost::system::error_code ecClose;
+                                self->_socket.close(ecClose);
+                                self->_scheduleReconnect();
+                                return;
+                            }
+                            LINFO("TelemetryClient connected ", self->_host, ":", self->_port);
+                            self->_backoff = self->_backoffMin;
+                            self->_connected = true;
+                            ++(self->_connectCount);
+                            if (self->_connectCallback != nullptr) {
+                                self->_connectCallback(true);
+                            }
+                            self->_read();
+                        });
+            });
+}
+
+void TelemetryClient::_scheduleReconnect() {
+    if (_stopped) {
+        return;
+    }
+    _reconnectTimer.expires_after(_backoff);
+    _backoff = min(_backoff * 2, _backoffMax);
+    _reconnectTimer.async_wait([self = shared_from_this()](boost::system::error_code const& ec) {
+        if (ec) {
+            return;
+        }
+        self->_connect();
+    });
+}
+
+void TelemetryClient::_read() {
+    asio::async_read_until(_socket, _readBuf, TelemetryCom::TERMINATOR(),
+                           [self = shared_from_this()](boost::system::error_code const& ec, size_t) {
+                               self->_readHandler(ec);
+                           });
+}
+
+void TelemetryClient::_readHandler(boost::system::error_code const& ec) {
+    if (ec) {
+        LINFO("TelemetryClient read failed ", ec.message());
+        _disconnect();
+        _scheduleReconnect();
+        return;
+    }
+    // `async_read_until` may have read several messages, handle all the complete ones
+    // in place and leave any partial message in the buffer.
+    auto data = _readBuf.data();
+    string_view buf(static_cast<char const*>(data.data()), data.size());
+    string_view const terminator(TelemetryCom::TERMINATOR());
+    size_t start = 0;
+    size_t pos;
+    while ((pos = buf.find(terminator, start)) != string_view::npos) {
+        _dispatch(buf.substr(start, pos - start));
+        start = pos + terminator.size();
+    }
+    _readBuf.consume(start);
+    if (_stopped) {
+        _disconnect();
+        return;
+    }
+    _read();
+}
+
+void TelemetryClient::_disconnect() {
+    boost::system::error_code ec;
+    _socket.shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+    _socket.close(ec);
+    _readBuf.consume(_readBuf.size());
+    if (_connected.exchange(false) && _connectCallback != nullptr) {
+        _connectCallback(false);
+    }
+}
+
+void TelemetryClient::_dispatch(string_view msg) {
+    ++_msgCount;
+    util::JsonScan scan(msg);
+    string_view id;
+    if (!scan.isValid() || !scan.getString("id", id)) {
+        LWARN("TelemetryClient::_dispatch could not find id in ", msg);
+        return;
+    }
+    ItemView item(id, msg, scan);
+    auto iter = _itemCallbacks.find(id);
+    if (iter != _itemCallbacks.end()) {
+        iter->second(item);
+    } else if (_defaultCallback != nullptr) {
+        _defaultCallback(item);
+    }
+}
+
+}  // namespace system
+}  // namespace m2cellcpp
+}  // namespace LSST
@@ -0,0 +1,190 @@
+// -*- LSST-C++ -*-
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+#ifndef LSST_M2CELLCPP_SYSTEM_TELEMETRYCLIENT_H
+#define LSST_M2CELLCPP_SYSTEM_TELEMETRYCLIENT_H
+
+// System headers
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Third party headers
+#include <boost/asio.hpp>
+#include <nlohmann/json.hpp>
+
+// Project headers
+#include "system/ComConnection.h"
+#include "util/JsonScan.h"
+
+namespace LSST {
+namespace m2cellcpp {
+namespace system {
+
+/// This class is an asynchronous client for a `TelemetryCom` server, or a
+/// `TelemetryRelay`. All work happens on `_strand` in the threads running `_ioContext`.
+/// Each received item is handed to a callback as an `ItemView` that
+/// points into the receive buffer, so nothing is copied or parsed unless
+/// the callback asks for it.
+/// If the connection fails or is lost, it is retried with exponential backoff
+/// between `_backoffMin` and `_backoffMax` until `stop()` is called.
+/// Unit tests in tests/test_TelemetryClient.cpp
+class TelemetryClient : public std::enable_shared_from_this<TelemetryClient> {
+public:
+    using Ptr = std::shared_ptr<TelemetryClient>;
+
+    /// A view of a single telemetry message in the receive buffer.
+    /// It is only valid for the duration of the callback it was given to.
+    class ItemView {
+    public:
+        ItemView(std::string_view id, std::string_view msg, util::JsonScan const& scan)
+                : _id(id), _msg(msg), _scan(scan) {}
+        ItemView() = delete;
+        ItemView(ItemView const&) = delete;
+        ItemView& operator=(ItemView const&) = delete;
+
+        /// Return the "id" of the item.
+        std::string_view getId() const { return _id; }
+
+        /// Return the full json text of the message.
+        std::string_view getMsg() const { return _msg; }
+
+        /// Return the top level members of the message.
+        util::JsonScan const& getScan() const { return _scan; }
+
+        /// Return the message parsed into json, this is expensive.
+        /// @throws nlohmann::json::parse_error if the message is not valid json.
+        nlohmann::json parse() const { return nlohmann::json::parse(_msg); }
+
+    private:
+        std::string_view const _id;    ///< "id" of the item.
+        std::string_view const _msg;   ///< Complete message text.
+        util::JsonScan const& _scan;   ///< Scan of `_msg`.
+    };
+
+    /// Function called for each received item.
+    using ItemCallback = std::function<void(ItemView const& item)>;
+
+    /// Function called when the connection is made or lost.
+    using ConnectCallback = std::function<void(bool connected)>;
+
+    /// Return a new `TelemetryClient` that will connect to `host`:`port` using `ioContext`.
+    static Ptr create(IoContextPtr const& ioContext, std::string const& host, int port) {
+        return Ptr(new TelemetryClient(ioContext, host, port));
+    }
+
+    TelemetryClient() = delete;
+    TelemetryClient(TelemetryClient const&) = delete;
+    TelemetryClient& operator=(TelemetryClient const&) = delete;
+
+    ~TelemetryClient() = default;
+
+    /// Set `cb` to be called for every item with `id`.
+    /// @throws util::Bug if called after `start()`.
+    void setItemCallback(std::string const& id, ItemCallback const& cb);
+
+    /// Set `cb` to be called for items that do not have their own callback.
+    /// @throws util::Bug if called after `start()`.
+    void setDefaultCallback(ItemCallback const& cb);
+
+    /// Set `cb` to be called when the connection is made or lost.
+    /// @throws util::Bug if called after `start()`.
+    void setConnectCallback(ConnectCallback const& cb);
+
+    /// Set the minimum and maximum reconnect delays.
+    /// @throws util::Bug if called after `start()`.
+    void setBackoff(std::chrono::milliseconds backoffMin, std::chrono::milliseconds backoffMax);
+
+    /// Start connecting to the server.
+    void start();
+
+    /// Close the connection and stop reconnecting.
+    void stop();
+
+    /// Return true if currently connected.
+    bool isConnected() const { return _connected; }
+
+    /// Return the number of messages received.
+    uint64_t getMsgCount() const { return _msgCount; }
+
+    /// Return the number of successful connections made.
+    uint64_t getConnectCount() const { return _connectCount; }
+
+private:
+    TelemetryClient(IoContextPtr const& ioContext, std::string const& host, int port);
+
+    /// Resolve `_host` and try to connect.
+    void _connect();
+
+    /// Schedule `_connect()` after the current backoff and increase the backoff.
+    void _scheduleReconnect();
+
+    /// Start reading the next message(s).
+    void _read();
+
+    /// Handle data read into `_readBuf`.
+    void _readHandler(boost::system::error_code const& ec);
+
+    /// Close the socket and call the connect callback if connected.
+    void _disconnect();
+
+    /// Hand the message in `msg` to the appropriate callback.
+    void _dispatch(std::string_view msg);
+
+    /// Throw if `start()` has been called.
+    void _checkNotStarted(std::string const& note);
+
+    IoContextPtr _ioContext;                    ///< Context running all handlers.
+    std::string const _host;                    ///< Server host.
+    int const _port;                            ///< Server port.
+    /// All handlers run on this strand, so members need no mutex even when several
+    /// threads are running `_ioContext`.
+    boost::asio::strand<boost::asio::io_context::executor_type> _strand;
+    boost::asio::ip::tcp::socket _socket;       ///< Connection to the server.
+    boost::asio::ip::tcp::resolver _resolver;   ///< Resolves `_host`.
+    boost::asio::steady_timer _reconnectTimer;  ///< Delays reconnect attempts.
+    boost::asio::streambuf _readBuf;            ///< Receive buffer, items are viewed in place.
+
+    /// Callbacks for specific item ids, `less<>` allows lookup by `string_view`.
+    std::map<std::string, ItemCallback, std::less<>> _itemCallbacks;
+    ItemCallback _defaultCallback;      ///< Callback for items without their own callback.
+    ConnectCallback _connectCallback;   ///< Callback for connection changes.
+
+    std::chrono::milliseconds _backoffMin{100};   ///< Initial reconnect delay.
+    std::chrono::milliseconds _backoffMax{5000};  ///< Maximum reconnect delay.
+    std::chrono::milliseconds _backoff{100};      ///< Current reconnect delay.
+
+    std::atomic<bool> _started{false};       ///< Set to true by `start()`.
+    std::atomic<bool> _stopped{false};       ///< Set to true by `stop()`.
+    std::atomic<bool> _connected{false};     ///< True while connected.
+    std::atomic<uint64_t> _msgCount{0};      ///< Number of messages received.
+    std::atomic<uint64_t> _connectCount{0};  ///< Number of successful connections.
+};
+
+}  // namespace system
+}  // namespace m2cellcpp
+}  // namespace LSST
+
+#endif  // LSST_M2CELLCPP_SYSTEM_TELEMETRYCLIENT_H
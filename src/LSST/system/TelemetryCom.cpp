@@ -23,11 +23,14 @@
 #include "system/TelemetryCom.h"
 
 // System headers
+#include <cerrno>
+#include <chrono>
 
 // Third party headers
 
 // Project headers
 #include "util/Bug.h"
+#include "util/clock_defs.h"
 #include "util/Log.h"
 
 using namespace std;
@@ -37,6 +40,36 @@ namespace LSST {
 namespace m2cellcpp {
 namespace system {
 
+namespace {
+
+/// Size of the buffer used for each `read` call.
+size_t const READ_BUFFER_SIZE = 4096;
+
+/// Append everything read from `fd` to `inBuf` and call `handler` with
+/// each complete message, without its terminator. The bytes of any partial
+/// message are left in `inBuf`.
+/// @return the status of the `read` call.
+template <typename HANDLER>
+ssize_t readMessages(int fd, string& inBuf, HANDLER handler) {
+    char buffer[READ_BUFFER_SIZE];
+    ssize_t status = read(fd, buffer, sizeof(buffer));
+    if (status <= 0) {
+        return status;
+    }
+    inBuf.append(buffer, status);
+    size_t const termLen = strlen(TelemetryCom::TERMINATOR());
+    size_t start = 0;
+    size_t pos;
+    while ((pos = inBuf.find(TelemetryCom::TERMINATOR(), start)) != string::npos) {
+        handler(inBuf.substr(start, pos - start));
+        start = pos + termLen;
+    }
+    inBuf.erase(0, start);
+    return status;
+}
+
+}  // namespace
+
 atomic<uint32_t> TelemetryCom::_seqIdSource{0};
 
 TelemetryCom::TelemetryCom(TelemetryMap::Ptr const& telemMap, int port)
@@ -49,7 +82,7 @@ TelemetryCom::~TelemetryCom() {
     shutdownCom();
 
     // Shutdown and join client threads
-    lock_guard<mutex> htLock();
+    lock_guard<mutex> htLock(_handlerThreadsMtx);
     for (auto&& ht : _handlerThreads) {
         ht->servConnHShutdown();
         ht->joinAll();
@@ -62,6 +95,7 @@ int TelemetryCom::shutdownCom() {
     if (_shutdownComCalled.exchange(true)) {
         return 0;
     }
+    NetStats::unregisterSource(getNetStatsName());
     if (_serverRunning) {
         LINFO("TelemetryCom::shutdownCom() connecting to serversocket");
         int clientFd = _clientConnect();
@@ -113,6 +147,11 @@ bool TelemetryCom::waitForServerRunning(int seconds) {
 }
 
 void TelemetryCom::startServer() {
+    weak_ptr<TelemetryCom> weakThis = weak_from_this();
+    NetStats::registerSource(getNetStatsName(), [weakThis]() {
+        auto serv = weakThis.lock();
+        return (serv == nullptr) ? json() : serv->getNetStatsJson();
+    });
     thread servThrd(&TelemetryCom::_server, this);
     _serverThread = std::move(servThrd);
 }
@@ -160,8 +199,9 @@ void TelemetryCom::_server() {
         // Create an object to handle the new connection.
         LINFO("TelemetryCom::server() accepting new client");
         {
-            auto handlerThrd = ServerConnectionHandler::Ptr(new ServerConnectionHandler(sock, _telemetryMap));
-            lock_guard<mutex> htLock();
+            auto handlerThrd = ServerConnectionHandler::Ptr(
+                    new ServerConnectionHandler(sock, _telemetryMap, _ioStats, _netStats));
+            lock_guard<mutex> htLock(_handlerThreadsMtx);
             _handlerThreads.push_back(handlerThrd);
             // Check if any of the threads should be joined and removed.
             auto iter = _handlerThreads.begin();
@@ -192,32 +232,57 @@ void TelemetryCom::ServerConnectionHandler::_servConnHandler() {
     LDEBUG("TelemetryCom::ServerConnectionHandler::_servConnHandler starting sock=", _servConnHSock);
     unsigned int msgSentCount = 0;
     auto itemMap = _tItemMap->copyMap();
+    string outBuf;
     while (_connLoop) {
+        // Put all of the items into one buffer so they can be sent with a single system call.
+        outBuf.clear();
+        unsigned int msgCount = 0;
         for (auto const& elem : itemMap) {
             if (elem.second->getDoNotSend()) {
                 continue;
             }
-            auto js = elem.second->getJson();
-            string msg = to_string(js) + TelemetryCom::TERMINATOR();
-            // Calling send() after the client has been killed may result in SIGPIPE
-            // being sent to this program. A signal handler must be set in the main
-            // thread to catch SIGPIPE to prevent this program from crashing.
-            // There is no way of knowing if the client has been killed before
-            // calling send().
-            ssize_t status = send(_servConnHSock, msg.c_str(), msg.length(), 0);
-            LTRACE("TelemetryCom send status=", status, " msg=", msg);
-            int const logMsgOccasionally =
-                    10000;  // Log a message once in while to indicate communication is active.
-            if ((msgSentCount++) % logMsgOccasionally == 0) {
-                LINFO("TelemetryCom send sock=", _servConnHSock, " status=", status,
-                      " msgSentCount=", msgSentCount);
-            }
+            outBuf += to_string(elem.second->getJson());
+            outBuf += TelemetryCom::TERMINATOR();
+            ++msgCount;
+        }
+        // MSG_NOSIGNAL prevents SIGPIPE from being sent to this program if the
+        // client has been killed, `send` returns an error instead.
+        bool sendOk = true;
+        size_t offset = 0;
+        auto sendStart = util::CLOCK::now();
+        while (offset < outBuf.size()) {
+            ssize_t status =
+                    send(_servConnHSock, outBuf.data() + offset, outBuf.size() - offset, MSG_NOSIGNAL);
+            ++(_ioStats->sendCalls);
+            LTRACE("TelemetryCom send status=", status, " size=", outBuf.size() - offset);
             if (status < 0) {
+                int sendErr = errno;
                 LWARN("TelemetryCom::ServerConnectionHandler::_servConnHandler failure status=", status);
-                servConnHShutdown();
+                // EPIPE is the client closing the connection.
+                if (sendErr != EPIPE) {
+                    _netStats->recordError();
+                }
+                sendOk = false;
                 break;
             }
+            offset += status;
+        }
+        if (!sendOk) {
+            servConnHShutdown();
+            break;
+        }
+        _ioStats->msgsSent += msgCount;
+        _ioStats->bytesSent += outBuf.size();
+        _netStats->recordOut(outBuf.size(), msgCount);
+        // Time spent in `send`, waiting for room in the socket buffer.
+        auto sendMicros = chrono::duration_cast<chrono::microseconds>(util::CLOCK::now() - sendStart);
+        _netStats->recordQueueDelay(sendMicros.count());
+        // Log a message once in while to indicate communication is active.
+        unsigned int const logMsgOccasionally = 10000;
+        if (msgSentCount / logMsgOccasionally != (msgSentCount + msgCount) / logMsgOccasionally) {
+            LINFO("TelemetryCom send sock=", _servConnHSock, " msgSentCount=", msgSentCount + msgCount);
         }
+        msgSentCount += msgCount;
         this_thread::sleep_for(
                 50ms);  // Deliver telemetry update about 20 times per second. DM-39974 Add config entry
     }
@@ -229,38 +294,21 @@ void TelemetryCom::ServerConnectionHandler::_servConnHandler() {
 
 void TelemetryCom::ServerConnectionHandler::_servConnReader() {
     LDEBUG("TelemetryCom::::_servConnHandler starting sock=", _servConnHSock);
-    bool connOk = true;
-    string inMsg;
-    TItemTelElevation::Ptr telElevation = _tItemMap->getTelElevation();
-    TItemInclinometerAngleTma::Ptr inclinometerAngleTma = _tItemMap->getInclinometerAngleTma();
-    while (_connLoop && connOk) {
-        char buffer[3];
-        // Read one byte at a time to check every byte for terminator.
-        ssize_t status = read(_servConnHSock, buffer, 1);
+    string inBuf;
+    while (_connLoop) {
+        ssize_t status = readMessages(_servConnHSock, inBuf, [this](string const& inMsg) {
+            ++(_ioStats->msgsRead);
+            _netStats->recordIn(inMsg.size() + strlen(TelemetryCom::TERMINATOR()), 1);
+            _handleInMsg(inMsg);
+        });
+        ++(_ioStats->readCalls);
+        if (status < 0 && _connLoop) {
+            _netStats->recordError();
+        }
         if (status <= 0) {
             LINFO("TelemetryCom::::_servConnReader() read failed with status=", status);
-            connOk = false;
             break;
         }
-        char inChar = buffer[0];
-        if (inChar == '\n' && inMsg.back() == '\r') {
-            inMsg.pop_back();
-            TelemetryItem::Ptr updatedItem = _tItemMap->setItemFromJsonStr(inMsg);
-            if (updatedItem != nullptr) {
-                LDEBUG("TelemetryCom::::_servConnReader() inMsg=", inMsg, " updated=", updatedItem->dump());
-                if (updatedItem->getId() == telElevation->getId()) {
-                    double ang = telElevation->getActualPosition().getVal();
-                    inclinometerAngleTma->getInclinometer().setVal(ang);
-                    LTRACE("TelemetryCom::::_servConnReader() ang=", ang, " telE=", telElevation->dump(),
-                           " inclTma=", inclinometerAngleTma->dump());
-                }
-            } else {
-                LWARN("TelemetryCom::::_servConnReader() failed to find item in map inMsg=", inMsg);
-            }
-            inMsg.clear();
-        } else {
-            inMsg += inChar;
-        }
     }
     LDEBUG("TelemetryCom::ServerConnectionHandler::_servConnHandler close sock=", _servConnHSock);
     close(_servConnHSock);
@@ -268,6 +316,23 @@ void TelemetryCom::ServerConnectionHandler::_servConnReader() {
     LINFO("TelemetryCom::ServerConnectionHandler::_servConnHandler done sock=", _servConnHSock);
 }
 
+void TelemetryCom::ServerConnectionHandler::_handleInMsg(string const& inMsg) {
+    TelemetryItem::Ptr updatedItem = _tItemMap->setItemFromJsonStr(inMsg);
+    if (updatedItem == nullptr) {
+        LWARN("TelemetryCom::::_servConnReader() failed to find item in map inMsg=", inMsg);
+        return;
+    }
+    LDEBUG("TelemetryCom::::_servConnReader() inMsg=", inMsg, " updated=", updatedItem->dump());
+    TItemTelElevation::Ptr telElevation = _tItemMap->getTelElevation();
+    if (updatedItem->getId() == telElevation->getId()) {
+        TItemInclinometerAngleTma::Ptr inclinometerAngleTma = _tItemMap->getInclinometerAngleTma();
+        double ang = telElevation->getActualPosition().getVal();
+        inclinometerAngleTma->getInclinometer().setVal(ang);
+        LTRACE("TelemetryCom::::_servConnReader() ang=", ang, " telE=", telElevation->dump(),
+               " inclTma=", inclinometerAngleTma->dump());
+    }
+}
+
 bool TelemetryCom::ServerConnectionHandler::checkJoinAll() {
     lock_guard<mutex> lck(_joinMtx);
     if (_joinedHandler) {
@@ -333,31 +398,42 @@ void TelemetryCom::ServerConnectionHandler::_joinReader() {
     LDEBUG("TelemetryCom::::_joinReaderer() _servConnReadThrd trying to join");
 }
 
+json TelemetryCom::ServerConnectionHandler::getNetStatsJson() const {
+    json js = _netStats->getJson();
+    js["sock"] = _servConnHSock;
+    // Once the loop stops, the socket may be closed and its number reused.
+    js["tcp"] = _connLoop ? TcpInfoSample::sample(_servConnHSock).getJson() : json();
+    return js;
+}
+
+json TelemetryCom::getNetStatsJson() {
+    json js;
+    js["total"] = _netStats->getJson();
+    js["connections"] = json::array();
+    lock_guard<mutex> htLock(_handlerThreadsMtx);
+    for (auto const& handler : _handlerThreads) {
+        if (!handler->getJoinedAll()) {
+            js["connections"].push_back(handler->getNetStatsJson());
+        }
+    }
+    return js;
+}
+
 int TelemetryCom::client(int idNum) {
     int clientFd = _clientConnect();
     LINFO("TelemetryCom::client() start clientFd=", clientFd, " idNum=", idNum, "_seqId=", _seqId);
-    bool serverOk = true;
-    string inMsg;
-    while (_acceptLoop && serverOk) {
-        char buffer[3];
-        // Read one byte at a time to check every byte for terminator.
-        ssize_t status = read(clientFd, buffer, 1);
+    string inBuf;
+    while (_acceptLoop) {
+        ssize_t status = readMessages(clientFd, inBuf, [this, idNum, clientFd](string const& inMsg) {
+            LDEBUG("client idNUm=", idNum, " seq=", _seqId, " fd=", clientFd, " got message ", inMsg);
+            _telemetryMap->setItemFromJsonStr(inMsg);
+        });
         if (status <= 0) {
             LINFO("TelemetryCom::client() idNum=", idNum, " recv failed with status=", status);
-            serverOk = false;
             break;
         }
-        char inChar = buffer[0];
-        if (inChar == '\n' && inMsg.back() == '\r') {
-            inMsg.pop_back();
-            LDEBUG("client idNUm=", idNum, " seq=", _seqId, " fd=", clientFd, " got message ", inMsg);
-            _telemetryMap->setItemFromJsonStr(inMsg);
-            inMsg.clear();
-        } else {
-            inMsg += inChar;
-        }
     }
-    LINFO("TelemetryCom::client() closing jidNum=", idNum, " seq=", _seqId, " inMsg=", inMsg);
+    LINFO("TelemetryCom::client() closing jidNum=", idNum, " seq=", _seqId, " inBuf=", inBuf);
     close(clientFd);
     return 0;
 }
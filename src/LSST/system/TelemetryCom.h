@@ -38,6 +38,7 @@
 // Third party headers
 
 // project headers
+#include "system/NetStats.h"
 #include "system/TelemetryMap.h"
 
 namespace LSST {
@@ -47,7 +48,11 @@ namespace system {
 /// This class is used to manage telemetry communication socket connections.
 /// It sends out json descriptions of all items in the `_telemetryMap` on
 /// each client connection, sleeps for 0.05 seconds, and then repeats.
+/// All of the items for one cycle are sent with a single `send` call, and
+/// incoming data is read in blocks, to keep the number of system calls low.
 /// There is no set limit on the number of client connections.
+/// Each connection's traffic, socket errors, and how long each cycle's
+/// `send` took are counted in `NetStats` that add up to the server's.
 /// The class listens on a separate thread, and creates a
 /// `TelemetryCom::ServerConnectionHandler` for each client connection,
 /// which also starts it's own thread.
@@ -91,6 +96,31 @@ public:
     /// Get a pointer to the `TelemetryMap` in use by this instance.
     TelemetryMap::Ptr getTMap() const { return _telemetryMap; }
 
+    /// Counts of socket system calls and messages for all connections
+    /// handled by a `TelemetryCom` server.
+    class IoStats {
+    public:
+        using Ptr = std::shared_ptr<IoStats>;
+        std::atomic<uint64_t> sendCalls{0};  ///< Number of `send` calls.
+        std::atomic<uint64_t> readCalls{0};  ///< Number of `read` calls.
+        std::atomic<uint64_t> msgsSent{0};   ///< Number of telemetry messages sent.
+        std::atomic<uint64_t> bytesSent{0};  ///< Number of bytes sent.
+        std::atomic<uint64_t> msgsRead{0};   ///< Number of messages read.
+    };
+
+    /// Return the system call and message counts for this server.
+    IoStats const& getIoStats() const { return *_ioStats; }
+
+    /// Return the network statistics for all connections, including closed ones.
+    NetStats::Ptr getNetStats() const { return _netStats; }
+
+    /// Return the totals from `getNetStats()` and the statistics of each
+    /// open connection as json.
+    nlohmann::json getNetStatsJson();
+
+    /// Return the name the server registers its statistics with `NetStats` as.
+    std::string getNetStatsName() const { return "telemetryServer:" + std::to_string(_port); }
+
     /// This class is used to handle a unique client connection made to this
     /// `TelemetryCom` server. This handler will send out messages
     /// for all items in the `_telemetryMap`, briefly sleep and then
@@ -103,8 +133,14 @@ public:
         ServerConnectionHandler(ServerConnectionHandler const&) = delete;
 
         /// Create a new `ServerConnectionHandler` and start its threads to handle `sock`.
-        ServerConnectionHandler(int sock, TelemetryMap::Ptr const& tItemMap)
-                : _servConnHSock(sock), _tItemMap(tItemMap) {
+        /// System calls and messages are counted in `ioStats`, and network
+        /// statistics are added to `serverStats`.
+        ServerConnectionHandler(int sock, TelemetryMap::Ptr const& tItemMap, IoStats::Ptr const& ioStats,
+                                NetStats::Ptr const& serverStats)
+                : _servConnHSock(sock),
+                  _tItemMap(tItemMap),
+                  _ioStats(ioStats),
+                  _netStats(NetStats::create(serverStats)) {
             std::thread thrdH(&ServerConnectionHandler::_servConnHandler, this);
             _servConnHThrd = std::move(thrdH);
             std::thread thrdR(&ServerConnectionHandler::_servConnReader, this);
@@ -126,6 +162,10 @@ public:
         /// Lock `_joinMtx` and join all of our threads.
         void joinAll();
 
+        /// Return the network statistics for this connection and, while it
+        /// is open, a `TCP_INFO` sample of its socket as json.
+        nlohmann::json getNetStatsJson() const;
+
     private:
         /// This function writes all TelemetryItem's over the connection.
         void _servConnHandler();
@@ -133,6 +173,9 @@ public:
         /// This function reads json messages from the connection.
         void _servConnReader();
 
+        /// Set the value of the item described by the json in `inMsg`.
+        void _handleInMsg(std::string const& inMsg);
+
         /// Join `_servConnHThrd`. `_joinMtx` must be locked before calling
         void _joinHandler();
 
@@ -147,6 +190,8 @@ public:
 
         /// A map of all the telemetry values that need to be sent to the client.
         TelemetryMap::Ptr _tItemMap;
+        IoStats::Ptr _ioStats;          ///< System call and message counts for the server.
+        NetStats::Ptr _netStats;        ///< Network statistics for this connection.
         std::thread _servConnHThrd;     ///< The thread running the handler.
         std::thread _servConnReadThrd;  ///< The thread running the read thread.
 
@@ -185,6 +230,8 @@ private:
     std::atomic<bool> _acceptLoop{true};          ///< Set to false to stop the accept loop.
     std::atomic<bool> _shutdownComCalled{false};  ///< Set to true when `shutdownCom` has been called.
     std::atomic<bool> _serverRunning{false};      ///< Set to true once the server has started.
+    IoStats::Ptr _ioStats{new IoStats()};         ///< System call and message counts.
+    NetStats::Ptr _netStats{NetStats::create()};  ///< Network statistics for all connections.
 
     std::vector<ServerConnectionHandler::Ptr> _handlerThreads;  ///< List of all heandler threads.
     std::mutex _handlerThreadsMtx;                              ///< Protects `_handlerThreads`
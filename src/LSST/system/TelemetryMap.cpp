@@ -52,6 +52,8 @@ TelemetryItem::Ptr TelemetryMap::setItemFromJsonStr(string const& jsStr) {
 }
 
 TelemetryItem::Ptr TelemetryMap::setItemFromJson(nlohmann::json const& js) {
+    // Timestamp as early as possible so external feeds have accurate arrival times.
+    util::TIMEPOINT arrival = util::CLOCK::now();
     string id = js["id"];
     auto iter = _map.find(id);
     if (iter == _map.end()) {
@@ -62,9 +64,22 @@ TelemetryItem::Ptr TelemetryMap::setItemFromJson(nlohmann::json const& js) {
     LTRACE("TelemetryMap::setItemFromJson idExpected=", idExpected, " js=", js);
     // If set successfully, return a pointer to the set element, otherwise return nullptr.
     TelemetryItem::Ptr retPtr = (iter->second->setFromJson(js, idExpected)) ? (iter->second) : nullptr;
+    if (retPtr == _telElevation) {
+        _telElevationSignal->addSample(_telElevation->getActualPosition().getVal(), arrival);
+    }
     return retPtr;
 }
 
+void TelemetryMap::setExternalStaleLimitSec(double staleLimitSec) {
+    _telElevationSignal->setStaleLimitSec(staleLimitSec);
+}
+
+void TelemetryMap::setExternalStaleCallback(util::TimedSignal::StaleCallback const& func) {
+    _telElevationSignal->setStaleCallback(func);
+}
+
+bool TelemetryMap::checkExternalStale(util::TIMEPOINT tm) { return _telElevationSignal->checkStale(tm); }
+
 }  // namespace system
 }  // namespace m2cellcpp
 }  // namespace LSST
@@ -27,18 +27,35 @@
 
 // project headers
 #include "system/TelemetryItemDefs.h"
+#include "util/TimedSignal.h"
 
 namespace LSST {
 namespace m2cellcpp {
 namespace system {
 
 /// This class stores all the items that need to be sent through `TelemetryCom`.
+/// Items read from external feeds, like `tel_elevation`, are also timestamped
+/// on arrival and stored in a `util::TimedSignal` so that control code
+/// can get the value aligned to its own tick time.
 /// Unit tests in tests/test_TelemetryCom
 class TelemetryMap {
 public:
     using Ptr = std::shared_ptr<TelemetryMap>;
+
+    /// Number of samples kept for each external signal.
+    static constexpr size_t EXTERNAL_SIGNAL_CAPACITY = 8;
+    /// Default stale limit for external signals in seconds.
+    static constexpr double EXTERNAL_STALE_LIMIT_SEC = 2.0;
+    /// Maximum time to extrapolate past the newest external sample in seconds.
+    static constexpr double EXTERNAL_MAX_EXTRAPOLATION_SEC = 0.5;
+
     TelemetryMap() { _telElevation->setDoNotSend(true); }
-    TelemetryMap(TelemetryMap const& other) { _map = other.copyMap(); }
+    /// The copy shares the items in `other._map`, but gets its own external
+    /// signal histories, which start empty and use the stale limit of `other`.
+    TelemetryMap(TelemetryMap const& other) {
+        _map = other.copyMap();
+        _telElevationSignal->setStaleLimitSec(other._telElevationSignal->getStaleLimitSec());
+    }
     TelemetryMap& operator=(TelemetryMap const&) = delete;
     ~TelemetryMap() = default;
 
@@ -57,6 +74,27 @@ public:
     /// @return a pointer to the item if the item was found and set, otherwise nullptr.
     TelemetryItem::Ptr setItemFromJson(nlohmann::json const& js);
 
+    /// Return the telescope elevation angle, from `tel_elevation`, at time `tm`
+    /// using `mode` to interpolate or extrapolate from the received samples.
+    util::TimedSignal::Result getTelElevationAt(util::TIMEPOINT tm,
+                                                util::TimedSignal::Mode mode = util::TimedSignal::LINEAR) const {
+        return _telElevationSignal->getValueAt(tm, mode);
+    }
+
+    /// Return a pointer to `_telElevationSignal`.
+    util::TimedSignal::Ptr getTelElevationSignal() const { return _telElevationSignal; }
+
+    /// Set the stale limit for all external feeds to `staleLimitSec`.
+    void setExternalStaleLimitSec(double staleLimitSec);
+
+    /// Set the function called when any external feed becomes stale or recovers.
+    void setExternalStaleCallback(util::TimedSignal::StaleCallback const& func);
+
+    /// Check all external feeds for staleness at `tm`, which calls the stale callback
+    /// on changes.
+    /// @return true if any external feed is stale.
+    bool checkExternalStale(util::TIMEPOINT tm);
+
     /// Return true if all items in this map match and equall all items in `other`.
     bool compareMaps(TelemetryMap const& other);
 
@@ -165,6 +203,11 @@ private:
 
     // The following items are read from the telemetry channel
     TItemTelElevation::Ptr _telElevation = _addItem<TItemTelElevation>();  ///< "tel_elevation"
+
+    /// Timestamped history of `_telElevation->getActualPosition()`.
+    util::TimedSignal::Ptr _telElevationSignal{
+            new util::TimedSignal("tel_elevation", EXTERNAL_SIGNAL_CAPACITY, EXTERNAL_STALE_LIMIT_SEC,
+                                  EXTERNAL_MAX_EXTRAPOLATION_SEC)};
 };
 
 }  // namespace system
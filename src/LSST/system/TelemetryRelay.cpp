@@ -0,0 +1,380 @@
+// -*- LSST-C++ -*-
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+// Class header
+#include "system/TelemetryRelay.h"
+
+// System headers
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Third party headers
+
+// Project headers
+#include "system/TelemetryCom.h"
+#include "util/Bug.h"
+#include "util/JsonScan.h"
+#include "util/Log.h"
+
+using namespace std;
+
+namespace LSST {
+namespace m2cellcpp {
+namespace system {
+
+TelemetryRelay::TelemetryRelay(string const& upHost, int upPort, int downPort, set<string> const& filter)
+        : _upHost(upHost), _upPort(upPort), _downPort(downPort), _filter(filter) {
+    LDEBUG("TelemetryRelay::TelemetryRelay() up=", _upHost, ":", _upPort, " downPort=", _downPort,
+           " filter size=", _filter.size());
+}
+
+TelemetryRelay::~TelemetryRelay() {
+    LDEBUG("TelemetryRelay::~TelemetryRelay()");
+    shutdown();
+}
+
+void TelemetryRelay::start() {
+    thread upThrd(&TelemetryRelay::_upstream, this);
+    _upstreamThrd = move(upThrd);
+    thread servThrd(&TelemetryRelay::_server, this);
+    _serverThrd = move(servThrd);
+}
+
+void TelemetryRelay::shutdown() {
+    _loop = false;
+    if (_shutdownCalled.exchange(true)) {
+        return;
+    }
+    LINFO("TelemetryRelay::shutdown()");
+    {
+        // `_upstream` closes the socket, this just unblocks its `read`.
+        lock_guard<mutex> lg(_upMtx);
+        if (_upFd >= 0) {
+            ::shutdown(_upFd, SHUT_RDWR);
+        }
+    }
+    if (_serverThrd.joinable()) {
+        // Unblock `accept` in `_server` by connecting to it.
+        if (_serverRunning) {
+            int clientFd = socket(AF_INET, SOCK_STREAM, 0);
+            if (clientFd >= 0) {
+                struct sockaddr_in servAddr;
+                servAddr.sin_family = AF_INET;
+                servAddr.sin_port = htons(_downPort);
+                inet_pton(AF_INET, "127.0.0.1", &servAddr.sin_addr);
+                connect(clientFd, (struct sockaddr*)&servAddr, sizeof(servAddr));
+                close(clientFd);
+            }
+        }
+        _serverThrd.join();
+    }
+    if (_upstreamThrd.joinable()) {
+        _upstreamThrd.join();
+    }
+    vector<DownstreamClient::Ptr> clients;
+    {
+        lock_guard<mutex> lg(_mtx);
+        clients.swap(_clients);
+    }
+    for (auto&& client : clients) {
+        client->shutdown();
+        client->join();
+    }
+    LINFO("TelemetryRelay::shutdown() done");
+}
+
+bool TelemetryRelay::waitForServerRunning(int seconds) {
+    for (int j = 0; j < seconds * 10 && !_serverRunning; ++j) {
+        this_thread::sleep_for(100ms);
+    }
+    return _serverRunning;
+}
+
+size_t TelemetryRelay::getClientCount() {
+    lock_guard<mutex> lg(_mtx);
+    size_t count = 0;
+    for (auto const& client : _clients) {
+        if (!client->isDone()) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+size_t TelemetryRelay::getCacheSize() {
+    lock_guard<mutex> lg(_mtx);
+    return _cache.size();
+}
+
+bool TelemetryRelay::passesFilter(string const& id) const {
+    return _filter.empty() || _filter.find(id) != _filter.end();
+}
+
+string TelemetryRelay::extractId(string const& msg) {
+    // Only the id is needed, so avoid a full parse.
+    util::JsonScan scan(msg);
+    string_view id;
+    if (!scan.isValid() || !scan.getString("id", id)) {
+        LWARN("TelemetryRelay::extractId failed msg=", msg);
+        return string();
+    }
+    return string(id);
+}
+
+int TelemetryRelay::_upstreamConnect() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        LERROR("TelemetryRelay::_upstreamConnect() socket failed fd=", fd);
+        return -1;
+    }
+    struct sockaddr_in servAddr;
+    servAddr.sin_family = AF_INET;
+    servAddr.sin_port = htons(_upPort);
+    if (inet_pton(AF_INET, _upHost.c_str(), &servAddr.sin_addr) <= 0) {
+        LERROR("TelemetryRelay::_upstreamConnect() invalid host=", _upHost);
+        close(fd);
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr*)&servAddr, sizeof(servAddr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void TelemetryRelay::_upstream() {
+    string const terminator = TelemetryCom::TERMINATOR();
+    while (_loop) {
+        int fd = _upstreamConnect();
+        if (fd < 0) {
+            LDEBUG("TelemetryRelay::_upstream() connect failed ", _upHost, ":", _upPort);
+            for (int j = 0; j < 10 && _loop; ++j) {
+                this_thread::sleep_for(100ms);
+            }
+            continue;
+        }
+        {
+            lock_guard<mutex> lg(_upMtx);
+            if (!_loop) {
+                close(fd);
+                break;
+            }
+            _upFd = fd;
+        }
+        _upstreamConnected = true;
+        LINFO("TelemetryRelay::_upstream() connected ", _upHost, ":", _upPort);
+
+        string inBuf;
+        char buffer[16384];
+        while (_loop) {
+            ssize_t status = read(fd, buffer, sizeof(buffer));
+            if (status <= 0) {
+                LINFO("TelemetryRelay::_upstream() read failed with status=", status);
+                break;
+            }
+            inBuf.append(buffer, status);
+            size_t start = 0;
+            size_t pos;
+            while ((pos = inBuf.find(terminator, start)) != string::npos) {
+                _distribute(inBuf.substr(start, pos - start));
+                start = pos + terminator.size();
+            }
+            inBuf.erase(0, start);
+        }
+        _upstreamConnected = false;
+        {
+            lock_guard<mutex> lg(_upMtx);
+            close(fd);
+            _upFd = -1;
+        }
+    }
+    LINFO("TelemetryRelay::_upstream() done");
+}
+
+void TelemetryRelay::_distribute(string const& msg) {
+    string id = extractId(msg);
+    if (id.empty() || !passesFilter(id)) {
+        return;
+    }
+    lock_guard<mutex> lg(_mtx);
+    _cache[id] = msg;
+    for (auto const& client : _clients) {
+        client->queueMsg(id, msg);
+    }
+}
+
+void TelemetryRelay::_server() {
+    if ((_serverFd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+        throw util::Bug(ERR_LOC, "TelemetryRelay::_server() failed to create listening socket");
+    }
+    int opt = 1;
+    if (setsockopt(_serverFd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt))) {
+        throw util::Bug(ERR_LOC, "TelemetryRelay::_server() failed to setsockopt");
+    }
+    struct sockaddr_in address;
+    int addrlen = sizeof(address);
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(_downPort);
+    if (bind(_serverFd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        throw util::Bug(ERR_LOC, string("TelemetryRelay::_server() failed to bind ") + to_string(_downPort));
+    }
+    if (listen(_serverFd, 16) < 0) {
+        throw util::Bug(ERR_LOC, string("TelemetryRelay::_server() failed to listen ") + to_string(_downPort));
+    }
+    LINFO("TelemetryRelay::_server() listening port=", _downPort);
+
+    _serverRunning = true;
+    while (_loop) {
+        int sock = accept(_serverFd, (struct sockaddr*)&address, (socklen_t*)&addrlen);
+        if (!_loop) {
+            if (sock >= 0) {
+                close(sock);
+            }
+            continue;
+        }
+        if (sock < 0) {
+            LERROR("TelemetryRelay::_server() failed to accept on ", _downPort, " sock=", sock);
+            _loop = false;
+            continue;
+        }
+        LINFO("TelemetryRelay::_server() accepting new client");
+        auto client = make_shared<DownstreamClient>(sock);
+        vector<DownstreamClient::Ptr> finished;
+        {
+            lock_guard<mutex> lg(_mtx);
+            // Give the new client the full current state before any new messages.
+            for (auto const& elem : _cache) {
+                client->queueMsg(elem.first, elem.second);
+            }
+            _clients.push_back(client);
+            // Remove clients that have finished.
+            auto iter = _clients.begin();
+            while (iter != _clients.end()) {
+                if ((*iter)->isDone()) {
+                    finished.push_back(*iter);
+                    iter = _clients.erase(iter);
+                } else {
+                    ++iter;
+                }
+            }
+        }
+        for (auto&& fin : finished) {
+            LINFO("TelemetryRelay::_server() removing old client");
+            fin->join();
+        }
+    }
+    LINFO("TelemetryRelay::_server() shutting down");
+    ::shutdown(_serverFd, SHUT_RDWR);
+    close(_serverFd);
+    _serverRunning = false;
+}
+
+TelemetryRelay::DownstreamClient::DownstreamClient(int sock) : _sock(sock) {
+    thread thrd(&DownstreamClient::_writer, this);
+    _writerThrd = move(thrd);
+}
+
+TelemetryRelay::DownstreamClient::~DownstreamClient() {
+    shutdown();
+    join();
+}
+
+void TelemetryRelay::DownstreamClient::queueMsg(string const& id, string const& msg) {
+    if (!_loop) {
+        return;
+    }
+    {
+        lock_guard<mutex> lg(_mtx);
+        auto iter = _pending.find(id);
+        if (iter != _pending.end()) {
+            iter->second = msg;
+            return;
+        }
+        _pending.emplace(id, msg);
+        _order.push_back(id);
+    }
+    _cv.notify_one();
+}
+
+void TelemetryRelay::DownstreamClient::shutdown() {
+    if (!_loop.exchange(false)) {
+        return;
+    }
+    {
+        lock_guard<mutex> lg(_mtx);
+        if (!_sockClosed) {
+            ::shutdown(_sock, SHUT_RDWR);
+        }
+    }
+    _cv.notify_all();
+}
+
+void TelemetryRelay::DownstreamClient::join() {
+    lock_guard<mutex> lg(_joinMtx);
+    if (_writerThrd.joinable()) {
+        _writerThrd.join();
+    }
+}
+
+void TelemetryRelay::DownstreamClient::_writer() {
+    string const terminator = TelemetryCom::TERMINATOR();
+    string outBuf;
+    while (_loop) {
+        outBuf.clear();
+        {
+            unique_lock<mutex> uLock(_mtx);
+            _cv.wait(uLock, [this]() { return !_order.empty() || !_loop; });
+            // Gather everything that is waiting into a single write.
+            for (auto const& id : _order) {
+                outBuf += _pending[id];
+                outBuf += terminator;
+            }
+            _order.clear();
+            _pending.clear();
+        }
+        size_t sent = 0;
+        while (sent < outBuf.size() && _loop) {
+            ssize_t status = send(_sock, outBuf.data() + sent, outBuf.size() - sent, MSG_NOSIGNAL);
+            if (status <= 0) {
+                LINFO("TelemetryRelay::DownstreamClient::_writer send failed status=", status);
+                _loop = false;
+                break;
+            }
+            sent += status;
+        }
+    }
+    {
+        lock_guard<mutex> lg(_mtx);
+        ::shutdown(_sock, SHUT_RDWR);
+        close(_sock);
+        _sockClosed = true;
+    }
+    _done = true;
+    LINFO("TelemetryRelay::DownstreamClient::_writer done sock=", _sock);
+}
+
+}  // namespace system
+}  // namespace m2cellcpp
+}  // namespace LSST
@@ -0,0 +1,187 @@
+// -*- LSST-C++ -*-
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+#ifndef LSST_M2CELLCPP_SYSTEM_TELEMETRYRELAY_H
+#define LSST_M2CELLCPP_SYSTEM_TELEMETRYRELAY_H
+
+// System headers
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Third party headers
+
+// project headers
+
+namespace LSST {
+namespace m2cellcpp {
+namespace system {
+
+/// This class holds a single client connection to an upstream `TelemetryCom`
+/// server and re-serves the telemetry messages to any number of downstream
+/// clients. This lets the cRIO serve a single consumer regardless of how
+/// many GUIs, loggers, and tools are watching.
+/// The latest message for every item id is cached, so new downstream clients
+/// get the full telemetry state as soon as they connect.
+/// If `_filter` is not empty, only items with ids in `_filter` are relayed.
+/// Messages are passed through unchanged, they are not decoded into a `TelemetryMap`.
+/// Unit tests in tests/test_TelemetryRelay.cpp
+class TelemetryRelay : public std::enable_shared_from_this<TelemetryRelay> {
+public:
+    using Ptr = std::shared_ptr<TelemetryRelay>;
+
+    /// Return a new `TelemetryRelay` that reads from the `TelemetryCom` server at
+    /// `upHost`:`upPort` and serves downstream clients on `downPort`.
+    /// @param `filter` - ids of items to relay, an empty set relays all items.
+    static Ptr create(std::string const& upHost, int upPort, int downPort,
+                      std::set<std::string> const& filter = std::set<std::string>()) {
+        return Ptr(new TelemetryRelay(upHost, upPort, downPort, filter));
+    }
+
+    TelemetryRelay() = delete;
+    TelemetryRelay(TelemetryRelay const&) = delete;
+    TelemetryRelay& operator=(TelemetryRelay const&) = delete;
+
+    /// Ensure shutdown is called and threads are joined.
+    ~TelemetryRelay();
+
+    /// Start the upstream reader and downstream server threads.
+    void start();
+
+    /// Shutdown the upstream connection, the downstream server,
+    /// and all downstream clients, and join all threads.
+    void shutdown();
+
+    /// Wait up to `seconds` time for `_serverRunning` to be true.
+    /// @return true if the downstream server is running.
+    bool waitForServerRunning(int seconds);
+
+    /// Return true if the upstream connection is currently connected.
+    bool isUpstreamConnected() const { return _upstreamConnected; }
+
+    /// Return the number of downstream clients that are still active.
+    size_t getClientCount();
+
+    /// Return the number of items in the cache.
+    size_t getCacheSize();
+
+    /// Return true if the item with `id` should be relayed.
+    bool passesFilter(std::string const& id) const;
+
+    /// Return the `id` of the telemetry json message `msg`, or an empty string
+    /// if no id could be found.
+    static std::string extractId(std::string const& msg);
+
+    /// This class handles a single downstream client. Messages waiting to be sent
+    /// are conflated by item id, so a slow client only receives the latest
+    /// value of each item and the queue cannot grow beyond the number of items.
+    class DownstreamClient {
+    public:
+        using Ptr = std::shared_ptr<DownstreamClient>;
+
+        DownstreamClient() = delete;
+        DownstreamClient(DownstreamClient const&) = delete;
+        DownstreamClient& operator=(DownstreamClient const&) = delete;
+
+        /// Create a new client for `sock` and start its writer thread.
+        explicit DownstreamClient(int sock);
+
+        /// Shutdown and join the writer thread.
+        ~DownstreamClient();
+
+        /// Queue `msg` for item `id`, replacing any unsent message with the same `id`.
+        void queueMsg(std::string const& id, std::string const& msg);
+
+        /// Stop the writer thread and close the socket.
+        void shutdown();
+
+        /// Return true if the writer thread has finished.
+        bool isDone() const { return _done; }
+
+        /// Join the writer thread.
+        void join();
+
+    private:
+        /// Send all queued messages in a single write until `shutdown` is called.
+        void _writer();
+
+        int const _sock;                              ///< Socket for this client.
+        bool _sockClosed = false;                     ///< True once `_sock` has been closed.
+        std::deque<std::string> _order;               ///< Order ids were queued.
+        std::map<std::string, std::string> _pending;  ///< Latest unsent message for each id.
+        std::mutex _mtx;                 ///< Protects `_sockClosed`, `_order`, and `_pending`.
+        std::condition_variable _cv;     ///< Notified when messages are queued.
+        std::atomic<bool> _loop{true};   ///< Set to false to stop the writer.
+        std::atomic<bool> _done{false};  ///< Set to true when the writer is finished.
+        std::thread _writerThrd;         ///< Thread running `_writer`.
+        std::mutex _joinMtx;             ///< Protects `_writerThrd` joining.
+    };
+
+private:
+    /// Private constructor to force creation as shared pointer object.
+    TelemetryRelay(std::string const& upHost, int upPort, int downPort, std::set<std::string> const& filter);
+
+    /// Connect to the upstream server and read messages, reconnecting
+    /// after failures, until `shutdown` is called.
+    void _upstream();
+
+    /// Return a socket file descriptor connected to the upstream server, or -1.
+    int _upstreamConnect();
+
+    /// Bind a socket to `_downPort` and create a `DownstreamClient`
+    /// for each new connection until `shutdown` is called.
+    void _server();
+
+    /// Cache `msg` and send it to all downstream clients.
+    void _distribute(std::string const& msg);
+
+    std::string const _upHost;                    ///< Upstream `TelemetryCom` host.
+    int const _upPort;                            ///< Upstream `TelemetryCom` port.
+    int const _downPort;                          ///< Port for downstream clients.
+    std::set<std::string> const _filter;          ///< Ids of items to relay, empty relays all.
+    std::atomic<bool> _loop{true};                ///< Set to false to stop all threads.
+    std::atomic<bool> _shutdownCalled{false};     ///< Set to true when `shutdown` has been called.
+    std::atomic<bool> _serverRunning{false};      ///< Set to true once the downstream server is listening.
+    std::atomic<bool> _upstreamConnected{false};  ///< True while connected upstream.
+    int _upFd = -1;                               ///< Upstream socket file descriptor.
+    std::mutex _upMtx;                            ///< Protects `_upFd`.
+    int _serverFd = -1;                           ///< File descriptor for the downstream server socket.
+
+    std::map<std::string, std::string> _cache;    ///< Latest message for each item id.
+    std::vector<DownstreamClient::Ptr> _clients;  ///< All downstream clients.
+    std::mutex _mtx;                              ///< Protects `_cache` and `_clients`.
+
+    std::thread _upstreamThrd;  ///< Thread running `_upstream`.
+    std::thread _serverThrd;    ///< Thread running `_server`.
+};
+
+}  // namespace system
+}  // namespace m2cellcpp
+}  // namespace LSST
+
+#endif  // LSST_M2CELLCPP_SYSTEM_TELEMETRYRELAY_H
@@ -0,0 +1,247 @@
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+// Class header
+#include "system/WelcomeMsg.h"
+
+// System headers
+
+// Third party headers
+
+// Project headers
+#include "faultmgr/FaultMgr.h"
+#include "system/ComConnection.h"
+#include "system/Globals.h"
+#include "util/Log.h"
+
+using namespace std;
+
+using json = nlohmann::json;
+
+namespace LSST {
+namespace m2cellcpp {
+namespace system {
+
+WelcomeMsg::Inputs WelcomeMsg::Inputs::current() {
+    Inputs in;
+    in.globalsChangeCount = Globals::get().getChangeCount();
+    auto& faultMgr = faultmgr::FaultMgr::get();
+    in.summaryFaults = faultMgr.getSummaryFaults().getBitmap();
+    in.faultEnableMask = faultMgr.getFaultEnableMask().getBitmap();
+    return in;
+}
+
+bool WelcomeMsg::Inputs::operator==(Inputs const& other) const {
+    return globalsChangeCount == other.globalsChangeCount && summaryFaults == other.summaryFaults &&
+           faultEnableMask == other.faultEnableMask;
+}
+
+shared_ptr<string const> WelcomeMsg::getMsg() {
+    // Sending the welcome message leaves the summary state at 3, set it before
+    // checking for changes so this doesn't invalidate the cached copy.
+    Globals::get().setSummaryState(3);
+    Inputs in = Inputs::current();
+    lock_guard<mutex> lg(_mtx);
+    if (_msg == nullptr || !(in == _inputs)) {
+        _msg = _build();
+        _inputs = in;
+        ++_buildCount;
+        LDEBUG("WelcomeMsg::getMsg rebuilt size=", _msg->size(), " builds=", _buildCount.load());
+    }
+    return _msg;
+}
+
+void WelcomeMsg::_append(string& blob, json const& js) {
+    blob += to_string(js);
+    blob += ComConnection::getDelimiter();
+}
+
+shared_ptr<string const> WelcomeMsg::_build() {
+    // A bunch of one-time messages that indicate various system states.
+    // Seems like this should happen at telemetry startup.
+    auto blob = make_shared<string>();
+    Globals& globals = Globals::get();
+
+    // send tcp connected message
+    {
+        json js;
+        js["id"] = "tcpIpConnected";
+        js["isConnected"] = globals.getTcpIpConnected();
+        _append(*blob, js);
+    }
+
+    _append(*blob, globals.getCommandableByDdsJson());
+
+    // send hardpoint information mock_server.py:281 await
+    // self._message_event.write_hardpoint_list(hardpoints)
+    {
+        json js;
+        js["id"] = "hardpointList";
+        js["actuators"] = globals.getHardPointList();
+        _append(*blob, js);
+    }
+
+    // send interlock mock_server.py:283 await self._message_event.write_interlock(False)
+    {
+        json js;
+        js["id"] = "interlock";
+        js["state"] = globals.getInterlock();
+        _append(*blob, js);
+    }
+
+    // elev external source  mock_server.py:290 await
+    // self._message_event.write_inclination_telemetry_source(is_external_source)
+    {
+        json js;
+        js["id"] = "inclinationTelemetrySource";
+        js["source"] = globals.getTelemetrySource();
+        _append(*blob, js);
+    }
+
+    // temp offset mock_server.py:292 await self._message_event.write_temperature_offset(
+    {
+        json js;
+        js["id"] = "temperatureOffset";
+        js["ring"] = globals.getTemperatureOffsetsRing();
+        js["intake"] = globals.getTemperatureOffsetsIntake();
+        js["exhaust"] = globals.getTemperatureOffsetsExhaust();
+        _append(*blob, js);
+    }
+
+    // FUTURE: This is only for backward compatibility and will not be needed if the final version
+    {
+        json js;
+        js["id"] = "summaryState";
+        js["summaryState"] = 5;
+        _append(*blob, js);
+    }
+
+    // # Send the digital input and output
+    // digital_input = self.model.get_digital_input()
+    // await self._message_event.write_digital_input(digital_input)
+    {
+        json js;
+        js["id"] = "digitalInput";
+        js["value"] = globals.getDigitalInput();
+        _append(*blob, js);
+    }
+
+    // digital_output = self.model.get_digital_output()
+    // await self._message_event.write_digital_output(digital_output)
+    {
+        json js;
+        js["id"] = "digitalOutput";
+        js["value"] = globals.getDigitalOutput();
+        _append(*blob, js);
+    }
+
+    // await self._message_event.write_config()
+    // TODO: It looks like all of these values should come out of the configuration PLACEHOLDER DM-40317
+    // FUTURE: Also, can the gui (and future systems) be capable of handling a dump of the entire config in
+    // the json msg? Probably useful.
+    {
+        json js;
+        js["id"] = "config";
+        js["configuration"] = "Configurable_File_Description_20180831T092556_surrogate_handling.csv";
+        js["version"] = "20180831T092556";
+        js["controlParameters"] = "CtrlParameterFiles_2018-07-19_104314_surg";
+        js["lutParameters"] = "FinalHandlingLUTs";
+        js["powerWarningMotor"] = 5.0;
+        js["powerFaultMotor"] = 10.0;
+        js["powerThresholdMotor"] = 20.0;
+        js["powerWarningComm"] = 5.0;
+        js["powerFaultComm"] = 10.0;
+        js["powerThresholdComm"] = 10.0;
+        js["inPositionAxial"] = 0.158;
+        js["inPositionTangent"] = 1.1;
+        js["inPositionSample"] = 1.0;
+        js["timeoutSal"] = 15.0;
+        js["timeoutCrio"] = 1.0;
+        js["timeoutIlc"] = 3;
+        js["inclinometerDelta"] = 2.0;
+        js["inclinometerDiffEnabled"] = true;
+        js["cellTemperatureDelta"] = 2.0;
+        _append(*blob, js);
+    }
+
+    // await self._message_event.write_closed_loop_control_mode( ClosedLoopControlMode.Idle )
+    {
+        json js;
+        js["id"] = "closedLoopControlMode";
+        js["mode"] = globals.getClosedLoopControlMode();
+        _append(*blob, js);
+    }
+
+    // await self._message_event.write_enabled_faults_mask( self.model.error_handler.enabled_faults_mask )
+    {
+        json js;
+        js["id"] = "enabledFaultsMask";
+        js["mask"] = faultmgr::FaultMgr::get().getFaultEnableMask().getBitmap();
+        _append(*blob, js);
+    }
+
+    // await self._message_event.write_configuration_files()
+    // FUTURE: These files need to be located and added to this project DM-40317
+    // PLACEHOLDER
+    {
+        json js;
+        js["id"] = "configurationFiles";
+        js["files"] = {"Configurable_File_Description_PLACEHOLDER_M2_optical.csv",
+                       "Configurable_File_Description_PLACEHOLDER_M2_handling.csv",
+                       "Configurable_File_Description_PLACEHOLDER_surrogate_optical.csv",
+                       "Configurable_File_Description_PLACEHOLDER_surrogate_handling.csv"};
+        _append(*blob, js);
+    }
+
+    // FUTURE: This is only for backward compatibility and will not be needed if the final version
+    // PLACEHOLDER
+    {
+        json js;
+        js["id"] = "summaryState";
+        js["summaryState"] = 3;
+        _append(*blob, js);
+    }
+
+    // FUTURE: This is only for backward compatibility and will not be needed if the final version
+    // PLACEHOLDER
+    {
+        json js;
+        js["id"] = "forceBalanceSystemStatus";
+        js["status"] = false;
+        _append(*blob, js);
+    }
+
+    {
+        json js;
+        js["id"] = "summaryFaultsStatus";
+        // The value from the ts_m2gui simulator produces this value for
+        // 'js["status"] = 144115188075855872;'.
+        // FUTURE: Should see how this compares to the simulator as
+        // more systems are implemented.
+        js["status"] = faultmgr::FaultMgr::get().getSummaryFaults().getBitmap();
+        _append(*blob, js);
+    }
+    return blob;
+}
+
+}  // namespace system
+}  // namespace m2cellcpp
+}  // namespace LSST
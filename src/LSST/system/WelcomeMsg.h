@@ -0,0 +1,94 @@
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+#ifndef LSST_M2CELLCPP_SYSTEM_WELCOMEMSG_H
+#define LSST_M2CELLCPP_SYSTEM_WELCOMEMSG_H
+
+// System headers
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Third party headers
+#include "nlohmann/json.hpp"
+
+// Project headers
+
+namespace LSST {
+namespace m2cellcpp {
+namespace system {
+
+/// This class keeps a serialized copy of the messages sent to a client when it
+/// connects to a `ComServer`. The messages are built from `Globals` and
+/// `FaultMgr` values, and are only rebuilt when one of those values has
+/// changed, so a new connection costs one cached string and one write.
+/// unit test: tests/test_ComControl.cpp
+class WelcomeMsg {
+public:
+    using Ptr = std::shared_ptr<WelcomeMsg>;
+
+    /// Return a new `WelcomeMsg`.
+    static Ptr create() { return Ptr(new WelcomeMsg()); }
+
+    WelcomeMsg(WelcomeMsg const&) = delete;
+    WelcomeMsg& operator=(WelcomeMsg const&) = delete;
+    ~WelcomeMsg() = default;
+
+    /// Return all of the welcome messages, each followed by the
+    /// `ComConnection` delimiter, rebuilding them if needed.
+    std::shared_ptr<std::string const> getMsg();
+
+    /// Return the number of times the messages have been built.
+    uint64_t getBuildCount() const { return _buildCount; }
+
+private:
+    /// The values that decide if the cached messages are still valid.
+    struct Inputs {
+        uint64_t globalsChangeCount = 0;  ///< From `Globals::getChangeCount()`.
+        uint64_t summaryFaults = 0;       ///< Bitmap of `FaultMgr::getSummaryFaults()`.
+        uint64_t faultEnableMask = 0;     ///< Bitmap of `FaultMgr::getFaultEnableMask()`.
+
+        /// Return the current values.
+        static Inputs current();
+
+        bool operator==(Inputs const& other) const;
+    };
+
+    WelcomeMsg() = default;
+
+    /// Return a new string with all of the welcome messages.
+    std::shared_ptr<std::string const> _build();
+
+    /// Append `js` and the delimiter to `blob`.
+    static void _append(std::string& blob, nlohmann::json const& js);
+
+    std::shared_ptr<std::string const> _msg;  ///< Cached messages.
+    Inputs _inputs;                           ///< Values used to build `_msg`.
+    std::mutex _mtx;                          ///< Protects `_msg` and `_inputs`.
+    std::atomic<uint64_t> _buildCount{0};     ///< Number of times `_msg` was built.
+};
+
+}  // namespace system
+}  // namespace m2cellcpp
+}  // namespace LSST
+
+#endif  // LSST_M2CELLCPP_SYSTEM_WELCOMEMSG_H
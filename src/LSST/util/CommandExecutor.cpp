@@ -0,0 +1,222 @@
+// -*- LSST-C++ -*-
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+// Class header
+#include "util/CommandExecutor.h"
+
+// System headers
+#include <exception>
+#include <sstream>
+
+// Project headers
+#include "util/Bug.h"
+#include "util/Log.h"
+
+using namespace std;
+
+namespace LSST {
+namespace m2cellcpp {
+namespace util {
+
+namespace {
+
+/// The executor that owns this thread, if any. Threads belong to one
+/// executor's pool for their entire life, so this is never reset.
+thread_local CommandExecutor const* currentExecutor = nullptr;
+
+}  // namespace
+
+CommandExecutor::CommandExecutor(unsigned int threadCount, unsigned int maxInFlight,
+                                 unsigned int laneHeadroom)
+        : _laneQueue(LaneCommandQueue::create(LANE_COUNT)),
+          _pool(ThreadPool::newThreadPool(threadCount, _laneQueue)),
+          _maxInFlight(maxInFlight),
+          _laneHeadroom(laneHeadroom) {}
+
+string CommandExecutor::getLaneName(Lane lane) {
+    switch (lane) {
+        case ROUTINE:
+            return "routine";
+        case POWER:
+            return "power";
+        case SAFETY:
+            return "safety";
+        default:
+            return "unknown";
+    }
+}
+
+CommandExecutor::~CommandExecutor() {
+    // The pool must be shutdown before it is destroyed. Queued `Command`s hold
+    // a pointer to this, so nothing can be in flight at this point.
+    if (_poolShutdown.exchange(true)) {
+        return;
+    }
+    if (inExecutorThread()) {
+        LERROR("CommandExecutor destroyed in one of its own threads, threads not stopped");
+        return;
+    }
+    _pool->shutdownPool();
+}
+
+unsigned int CommandExecutor::getLaneLimit(Lane lane) const {
+    unsigned int higherLanes = (lane < LANE_COUNT) ? LANE_COUNT - 1 - lane : 0;
+    unsigned int kept = _laneHeadroom * higherLanes;
+    return (kept < _maxInFlight) ? _maxInFlight - kept : 1;
+}
+
+bool CommandExecutor::reserve(Lane lane) {
+    lock_guard<mutex> lg(_mtx);
+    if (_shutdown || _inFlight >= getLaneLimit(lane)) {
+        ++_rejectedCount;
+        return false;
+    }
+    ++_inFlight;
+    ++_reserved;
+    return true;
+}
+
+void CommandExecutor::cancelReservation() {
+    {
+        lock_guard<mutex> lg(_mtx);
+        if (_reserved == 0) {
+            throw Bug(ERR_LOC, "CommandExecutor::cancelReservation no reservations");
+        }
+        --_reserved;
+        --_inFlight;
+    }
+    _idleCv.notify_all();
+}
+
+void CommandExecutor::_useReservation(Command::Ptr const& cmd) {
+    if (cmd == nullptr) {
+        throw Bug(ERR_LOC, "CommandExecutor::queReserved cmd was nullptr");
+    }
+    if (_reserved == 0) {
+        throw Bug(ERR_LOC, "CommandExecutor::queReserved no reservations");
+    }
+    --_reserved;
+}
+
+void CommandExecutor::queReserved(uint64_t key, Command::Ptr const& cmd, Lane lane) {
+    lock_guard<mutex> lg(_mtx);
+    _useReservation(cmd);
+    auto iter = _waiting.find(key);
+    if (iter != _waiting.end()) {
+        // A `Command` with this key is running, this one has to wait.
+        iter->second.push_back({cmd, lane});
+        return;
+    }
+    _waiting[key];
+    _dispatch(key, true, cmd, lane);
+}
+
+void CommandExecutor::queReserved(Command::Ptr const& cmd, Lane lane) {
+    lock_guard<mutex> lg(_mtx);
+    _useReservation(cmd);
+    _dispatch(0, false, cmd, lane);
+}
+
+bool CommandExecutor::queCmd(uint64_t key, Command::Ptr const& cmd) {
+    if (!reserve()) {
+        return false;
+    }
+    queReserved(key, cmd);
+    return true;
+}
+
+void CommandExecutor::_dispatch(uint64_t key, bool ordered, Command::Ptr const& cmd, Lane lane) {
+    auto self = shared_from_this();
+    auto wrapper = make_shared<Command>([self, key, ordered, cmd](CmdData*) {
+        currentExecutor = self.get();
+        try {
+            cmd->runAction(nullptr);
+        } catch (exception const& ex) {
+            LERROR("CommandExecutor command for key=", key, " threw ", ex.what());
+        }
+        self->_finished(key, ordered);
+    });
+    _laneQueue->queCmd(wrapper, lane);
+}
+
+void CommandExecutor::_finished(uint64_t key, bool ordered) {
+    ++_completedCount;
+    {
+        lock_guard<mutex> lg(_mtx);
+        --_inFlight;
+        auto iter = ordered ? _waiting.find(key) : _waiting.end();
+        if (iter != _waiting.end()) {
+            auto& que = iter->second;
+            if (que.empty()) {
+                _waiting.erase(iter);
+            } else {
+                auto next = que.front();
+                que.pop_front();
+                _dispatch(key, true, next.cmd, next.lane);
+            }
+        }
+    }
+    _idleCv.notify_all();
+}
+
+string CommandExecutor::getLaneWaitSummary() const {
+    stringstream os;
+    for (unsigned int lane = 0; lane < LANE_COUNT; ++lane) {
+        os << getLaneName(static_cast<Lane>(lane)) << " wait(us) "
+           << _laneQueue->getWaitHistogram(lane).getSummary() << "\n";
+    }
+    return os.str();
+}
+
+unsigned int CommandExecutor::getInFlight() const {
+    lock_guard<mutex> lg(_mtx);
+    return _inFlight;
+}
+
+bool CommandExecutor::waitForIdle(chrono::milliseconds timeout) {
+    unique_lock<mutex> ulock(_mtx);
+    return _idleCv.wait_for(ulock, timeout, [this]() { return _inFlight == 0; });
+}
+
+bool CommandExecutor::inExecutorThread() const { return currentExecutor == this; }
+
+bool CommandExecutor::shutdown(chrono::milliseconds timeout) {
+    _shutdown = true;
+    if (inExecutorThread()) {
+        LWARN("CommandExecutor::shutdown called from an executor thread, threads not stopped");
+        return false;
+    }
+    if (!waitForIdle(timeout)) {
+        LWARN("CommandExecutor::shutdown timed out with ", getInFlight(), " commands in flight");
+        return false;
+    }
+    if (_poolShutdown.exchange(true)) {
+        return true;
+    }
+    _pool->shutdownPool();
+    LDEBUG("CommandExecutor::shutdown done");
+    return true;
+}
+
+}  // namespace util
+}  // namespace m2cellcpp
+}  // namespace LSST
@@ -0,0 +1,193 @@
+// -*- LSST-C++ -*-
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#ifndef LSST_M2CELLCPP_UTIL_COMMANDEXECUTOR_H
+#define LSST_M2CELLCPP_UTIL_COMMANDEXECUTOR_H
+
+// System headers
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Project headers
+#include "util/LaneCommandQueue.h"
+#include "util/LatencyHistogram.h"
+#include "util/ThreadPool.h"
+
+namespace LSST {
+namespace m2cellcpp {
+namespace util {
+
+/// This class runs `Command`s on a fixed size `ThreadPool`.
+/// Each `Command` is queued with a key, and `Command`s with the same
+/// key are run one at a time in the order they were queued, while
+/// `Command`s with different keys may run concurrently. `Command`s queued
+/// without a key run as soon as a thread is available.
+/// The number of `Command`s queued or running, in flight, is limited
+/// to `_maxInFlight`. A slot must be reserved with `reserve()` before a
+/// `Command` can be queued, so the caller knows if the `Command` will be
+/// accepted before doing anything else with it.
+/// Each `Command` is queued in a `Lane`. When threads are busy, `Command`s in
+/// higher lanes run before any waiting in lower lanes, so power and safety
+/// commands don't wait behind routine ones. Running `Command`s are not
+/// interrupted. `_laneHeadroom` slots are kept free of `Command`s in lower
+/// lanes for each lane above `ROUTINE`, so a flood of routine `Command`s
+/// can't stop power and safety `Command`s from being accepted.
+/// Unit tests in tests/test_CommandExecutor.cpp
+class CommandExecutor : public std::enable_shared_from_this<CommandExecutor> {
+public:
+    using Ptr = std::shared_ptr<CommandExecutor>;
+
+    /// Priority classes of `Command`s, higher values run first.
+    enum Lane {
+        ROUTINE = 0,  ///< Everything that isn't listed below.
+        POWER,        ///< Turning power on or off.
+        SAFETY,       ///< Commands that protect the hardware, like shutting down.
+        LANE_COUNT
+    };
+
+    /// Return the name of `lane`.
+    static std::string getLaneName(Lane lane);
+
+    /// Return a new `CommandExecutor` with `threadCount` threads that
+    /// allows up to `maxInFlight` `Command`s in flight, keeping `laneHeadroom`
+    /// of those slots for each lane above `ROUTINE`.
+    static Ptr create(unsigned int threadCount, unsigned int maxInFlight, unsigned int laneHeadroom = 0) {
+        return Ptr(new CommandExecutor(threadCount, maxInFlight, laneHeadroom));
+    }
+
+    CommandExecutor() = delete;
+    CommandExecutor(CommandExecutor const&) = delete;
+    CommandExecutor& operator=(CommandExecutor const&) = delete;
+
+    ~CommandExecutor();
+
+    /// Reserve a slot for a `Command` that will be queued in `lane`.
+    /// @return false if `getLaneLimit(lane)` slots are already in use or
+    ///         `shutdown()` has been called.
+    bool reserve(Lane lane = ROUTINE);
+
+    /// Release a slot from `reserve()` without using it.
+    void cancelReservation();
+
+    /// Queue `cmd` to run after all previously queued `Command`s with `key`,
+    /// using a slot from `reserve()`. Once it is its turn, it waits in `lane`.
+    /// @throws Bug if there are no reserved slots.
+    void queReserved(uint64_t key, Command::Ptr const& cmd, Lane lane = ROUTINE);
+
+    /// Queue `cmd` in `lane` to run as soon as a thread is available, without
+    /// waiting for any other `Command`, using a slot from `reserve()`.
+    /// @throws Bug if there are no reserved slots.
+    void queReserved(Command::Ptr const& cmd, Lane lane = ROUTINE);
+
+    /// Reserve a slot and queue `cmd` with `key`.
+    /// @return false if the `Command` was rejected, see `reserve()`.
+    bool queCmd(uint64_t key, Command::Ptr const& cmd);
+
+    /// Return the number of `Command`s queued or running, including reservations.
+    unsigned int getInFlight() const;
+
+    /// Return the maximum number of `Command`s allowed in flight.
+    unsigned int getMaxInFlight() const { return _maxInFlight; }
+
+    /// Return the number of `Command`s that may be in flight when reserving
+    /// a slot for `lane`. This is `_maxInFlight` less `_laneHeadroom` for
+    /// each higher lane, but at least 1.
+    unsigned int getLaneLimit(Lane lane) const;
+
+    /// Return the number of `Command`s that have finished running.
+    uint64_t getCompletedCount() const { return _completedCount; }
+
+    /// Return the number of times `reserve()` rejected a `Command`.
+    uint64_t getRejectedCount() const { return _rejectedCount; }
+
+    /// Return a histogram of the microseconds `Command`s in `lane` waited
+    /// for a thread.
+    LatencyHistogram getLaneWait(Lane lane) const { return _laneQueue->getWaitHistogram(lane); }
+
+    /// Return a line for each lane summarizing how long `Command`s waited for a thread.
+    std::string getLaneWaitSummary() const;
+
+    /// Wait up to `timeout` for there to be no `Command`s in flight.
+    /// @return true if there are no `Command`s in flight.
+    bool waitForIdle(std::chrono::milliseconds timeout);
+
+    /// Stop accepting `Command`s, wait up to `timeout` for the `Command`s
+    /// in flight to finish, and then stop the threads.
+    /// If called from one of this executor's threads, it cannot wait for
+    /// itself, so the threads are not stopped.
+    /// @return true if all `Command`s finished and the threads were stopped.
+    bool shutdown(std::chrono::milliseconds timeout);
+
+    /// Return true if the calling thread is running a `Command` for this executor.
+    bool inExecutorThread() const;
+
+private:
+    CommandExecutor(unsigned int threadCount, unsigned int maxInFlight, unsigned int laneHeadroom);
+
+    /// Use one of the reserved slots. `_mtx` must be locked.
+    /// @throws Bug if there are no reserved slots.
+    void _useReservation(Command::Ptr const& cmd);
+
+    /// A `Command` waiting in `_waiting` and its lane.
+    struct Waiting {
+        Command::Ptr cmd;
+        Lane lane;
+    };
+
+    /// Give `cmd` to the `ThreadPool` in `lane`, `ordered` is true if it was
+    /// queued with `key`. `_mtx` must be locked.
+    void _dispatch(uint64_t key, bool ordered, Command::Ptr const& cmd, Lane lane);
+
+    /// Called after a `Command` finishes. If it was queued with `key`,
+    /// dispatches the next `Command` with `key`, if there is one.
+    void _finished(uint64_t key, bool ordered);
+
+    LaneCommandQueue::Ptr _laneQueue;  ///< The queue for `_pool`, with a lane per `Lane`.
+    ThreadPool::Ptr _pool;            ///< Threads that run the `Command`s.
+    unsigned int const _maxInFlight;  ///< Maximum `Command`s in flight.
+    unsigned int const _laneHeadroom;  ///< Slots kept for each lane above `ROUTINE`.
+
+    /// `Command`s waiting for the running `Command` with the same key to finish.
+    /// A key is in the map only while one of its `Command`s is running.
+    std::map<uint64_t, std::deque<Waiting>> _waiting;
+    unsigned int _inFlight = 0;        ///< `Command`s running, waiting, or reserved.
+    unsigned int _reserved = 0;        ///< Slots reserved but not used yet.
+    mutable std::mutex _mtx;           ///< Protects `_waiting`, `_inFlight`, `_reserved`.
+    std::condition_variable _idleCv;   ///< Notified when `_inFlight` decreases.
+
+    std::atomic<bool> _shutdown{false};        ///< Set to true by `shutdown()`.
+    std::atomic<bool> _poolShutdown{false};    ///< Set to true once `_pool` is shutdown.
+    std::atomic<uint64_t> _completedCount{0};  ///< Number of `Command`s that have finished.
+    std::atomic<uint64_t> _rejectedCount{0};   ///< Number of rejected `Command`s.
+};
+
+}  // namespace util
+}  // namespace m2cellcpp
+}  // namespace LSST
+
+#endif  // LSST_M2CELLCPP_UTIL_COMMANDEXECUTOR_H
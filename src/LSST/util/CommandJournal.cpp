@@ -0,0 +1,430 @@
+// -*- LSST-C++ -*-
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+// Class header
+#include "util/CommandJournal.h"
+
+// System headers
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Project headers
+#include "util/Bug.h"
+#include "util/Log.h"
+
+using namespace std;
+
+namespace LSST {
+namespace m2cellcpp {
+namespace util {
+
+constexpr char CommandJournal::MAGIC[8];
+
+CommandJournal::Ptr CommandJournal::_global;
+mutex CommandJournal::_globalMtx;
+
+void CommandJournal::setGlobal(Ptr const& journal) {
+    lock_guard<mutex> lg(_globalMtx);
+    _global = journal;
+}
+
+CommandJournal::Ptr CommandJournal::getGlobal() {
+    lock_guard<mutex> lg(_globalMtx);
+    return _global;
+}
+
+CommandJournal::CommandJournal(string const& pathPrefix, size_t segmentSize,
+                               chrono::milliseconds commitInterval, unsigned int maxSegments,
+                               string const& groupPrefix)
+        : _pathPrefix(pathPrefix),
+          _segmentSize(segmentSize),
+          _commitInterval(commitInterval),
+          _maxSegments(maxSegments),
+          _groupPrefix(groupPrefix.empty() ? pathPrefix + "." : groupPrefix) {
+    if (_segmentSize < MIN_SEGMENT_SIZE) {
+        throw Bug(ERR_LOC, "CommandJournal segmentSize=" + to_string(_segmentSize) + " must be at least " +
+                                   to_string(MIN_SEGMENT_SIZE));
+    }
+    _openSegment();
+    LINFO("CommandJournal started ", segmentPath(_pathPrefix, _segNumber), " segmentSize=", _segmentSize,
+          " commitMs=", _commitInterval.count(), " maxSegments=", _maxSegments, " group=", _groupPrefix);
+    _writer = thread(&CommandJournal::_writeLoop, this);
+}
+
+CommandJournal::~CommandJournal() { close(); }
+
+bool CommandJournal::append(Type type, uint64_t connId, string_view payload) {
+    if (payload.size() + sizeof(MAGIC) + sizeof(RecordHeader) > _segmentSize) {
+        ++_droppedCount;
+        LWARN("CommandJournal::append record too large size=", payload.size());
+        return false;
+    }
+    RecordHeader hdr{};
+    hdr.size = payload.size();
+    hdr.type = type;
+    auto sinceEpoch = chrono::system_clock::now().time_since_epoch();
+    hdr.timeMicros = chrono::duration_cast<chrono::microseconds>(sinceEpoch).count();
+    hdr.connId = connId;
+    bool wake = false;
+    {
+        lock_guard<mutex> lg(_mtx);
+        if (_closed || _pending.size() >= MAX_PENDING_SEGMENTS * _segmentSize) {
+            ++_droppedCount;
+            return false;
+        }
+        _pending.append(reinterpret_cast<char const*>(&hdr), sizeof(hdr));
+        _pending.append(payload.data(), payload.size());
+        ++_appendSeq;
+        // Don't make a large buffer wait for the timer.
+        wake = _pending.size() >= _segmentSize / 4;
+    }
+    if (wake) {
+        _cv.notify_one();
+    }
+    return true;
+}
+
+void CommandJournal::flush() {
+    unique_lock<mutex> ulock(_mtx);
+    uint64_t target = _appendSeq;
+    _flushTo = max(_flushTo, target);
+    _cv.notify_one();
+    _doneCv.wait(ulock, [this, target]() { return _committedSeq >= target || _writerDone; });
+}
+
+void CommandJournal::close() {
+    {
+        lock_guard<mutex> lg(_mtx);
+        if (_closed) {
+            return;
+        }
+        _closed = true;
+    }
+    _cv.notify_one();
+    if (_writer.joinable()) {
+        _writer.join();
+    }
+    _closeSegment();
+    LINFO("CommandJournal closed written=", _writtenCount.load(), " dropped=", _droppedCount.load(),
+          " commits=", _commitCount.load());
+}
+
+void CommandJournal::_writeLoop() {
+    string data;  // Swapped with `_pending` so both keep their capacity.
+    unique_lock<mutex> ulock(_mtx);
+    while (true) {
+        _cv.wait_for(ulock, _commitInterval, [this]() {
+            return _closed || _flushTo > _committedSeq || _pending.size() >= _segmentSize / 4;
+        });
+        if (!_pending.empty()) {
+            data.swap(_pending);
+            uint64_t seq = _appendSeq;
+            uint64_t count = seq - _committedSeq;
+            ulock.unlock();
+            bool ok = _commit(data);
+            data.clear();
+            (ok ? _writtenCount : _droppedCount) += count;
+            ++_commitCount;
+            ulock.lock();
+            _committedSeq = seq;
+            _doneCv.notify_all();
+        }
+        if (_closed && _pending.empty()) {
+            break;
+        }
+    }
+    _writerDone = true;
+    _doneCv.notify_all();
+}
+
+bool CommandJournal::_commit(string const& data) {
+    size_t syncFrom = _used;
+    size_t pos = 0;
+    while (pos < data.size()) {
+        RecordHeader hdr;
+        memcpy(&hdr, data.data() + pos, sizeof(hdr));
+        size_t len = sizeof(hdr) + hdr.size;
+        if (_map == nullptr || _used + len > _segmentSize) {
+            if (_map != nullptr) {
+                _sync(syncFrom);
+                _closeSegment();
+                ++_segNumber;
+            }
+            try {
+                _openSegment();
+            } catch (Issue const& ex) {
+                LERROR("CommandJournal::_commit dropping records ", ex.what());
+                return false;
+            }
+            syncFrom = 0;
+        }
+        memcpy(_map + _used, data.data() + pos, len);
+        _used += len;
+        pos += len;
+    }
+    _sync(syncFrom);
+    return true;
+}
+
+void CommandJournal::_sync(size_t from) {
+    // msync needs a page aligned start.
+    static size_t const pageSize = sysconf(_SC_PAGESIZE);
+    size_t start = from - (from % pageSize);
+    if (msync(_map + start, _used - start, MS_SYNC) != 0) {
+        LERROR("CommandJournal msync failed ", strerror(errno));
+    }
+}
+
+void CommandJournal::_openSegment() {
+    string path = segmentPath(_pathPrefix, _segNumber);
+    // Never overwrite an existing journal.
+    _fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (_fd < 0) {
+        throw Issue(ERR_LOC, "CommandJournal could not create " + path + " " + strerror(errno));
+    }
+    // Reserve the blocks now so a full disk is found here instead of as a SIGBUS later.
+    // Only a file system that can't preallocate may fall back to a sparse file,
+    // anything else, like ENOSPC, means writing the mapping could fail.
+    int err = posix_fallocate(_fd, 0, _segmentSize);
+    if (err == EOPNOTSUPP || err == EINVAL) {
+        LWARN("CommandJournal could not preallocate ", path, " ", strerror(err), ", using a sparse file");
+        err = (ftruncate(_fd, _segmentSize) == 0) ? 0 : errno;
+    }
+    if (err != 0) {
+        ::close(_fd);
+        ::unlink(path.c_str());
+        _fd = -1;
+        throw Issue(ERR_LOC, "CommandJournal could not size " + path + " " + strerror(err));
+    }
+    void* addr = mmap(nullptr, _segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    if (addr == MAP_FAILED) {
+        err = errno;
+        ::close(_fd);
+        ::unlink(path.c_str());
+        _fd = -1;
+        throw Issue(ERR_LOC, "CommandJournal could not map " + path + " " + strerror(err));
+    }
+    _map = static_cast<char*>(addr);
+    memcpy(_map, MAGIC, sizeof(MAGIC));
+    _used = sizeof(MAGIC);
+    LDEBUG("CommandJournal opened ", path);
+    if (_maxSegments > 0) {
+        _removedCount += removeOldSegments(_groupPrefix, _maxSegments);
+    }
+}
+
+void CommandJournal::_closeSegment() {
+    if (_map == nullptr) {
+        return;
+    }
+    _sync(0);
+    munmap(_map, _segmentSize);
+    _map = nullptr;
+    if (ftruncate(_fd, _used) != 0) {
+        LWARN("CommandJournal could not truncate segment ", _segNumber.load(), " ", strerror(errno));
+    }
+    ::close(_fd);
+    _fd = -1;
+}
+
+string CommandJournal::segmentPath(string const& pathPrefix, unsigned int number) {
+    char num[16];
+    snprintf(num, sizeof(num), "%06u", number);
+    return pathPrefix + "." + num + ".jrnl";
+}
+
+bool CommandJournal::readSegment(string const& path, vector<Record>& out) {
+    ifstream file(path, ios::binary);
+    if (!file) {
+        return false;
+    }
+    string data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    if (data.size() < sizeof(MAGIC) || memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) {
+        LWARN("CommandJournal::readSegment bad header ", path);
+        return false;
+    }
+    _parseRecords(data, &out);
+    return true;
+}
+
+size_t CommandJournal::_parseRecords(string const& data, vector<Record>* out) {
+    size_t pos = sizeof(MAGIC);
+    while (pos + sizeof(RecordHeader) <= data.size()) {
+        RecordHeader hdr;
+        memcpy(&hdr, data.data() + pos, sizeof(hdr));
+        size_t payloadPos = pos + sizeof(hdr);
+        if (hdr.type == 0 || payloadPos + hdr.size > data.size()) {
+            // The end of the records, or a record cut short by a crash.
+            break;
+        }
+        if (out != nullptr) {
+            out->push_back({Type(hdr.type), hdr.timeMicros, hdr.connId, data.substr(payloadPos, hdr.size)});
+        }
+        pos = payloadPos + hdr.size;
+    }
+    return pos;
+}
+
+unsigned int CommandJournal::readAll(string const& pathPrefix, vector<Record>& out) {
+    unsigned int count = 0;
+    for (unsigned int number = firstSegment(pathPrefix); readSegment(segmentPath(pathPrefix, number), out);
+         ++number) {
+        ++count;
+    }
+    return count;
+}
+
+unsigned int CommandJournal::firstSegment(string const& pathPrefix) {
+    auto slash = pathPrefix.rfind('/');
+    string dir = (slash == string::npos) ? "." : pathPrefix.substr(0, slash + 1);
+    string base = ((slash == string::npos) ? pathPrefix : pathPrefix.substr(slash + 1)) + ".";
+    string const ext = ".jrnl";
+    DIR* dirp = opendir(dir.c_str());
+    if (dirp == nullptr) {
+        return 0;
+    }
+    bool found = false;
+    unsigned int first = 0;
+    while (dirent* ent = readdir(dirp)) {
+        // Names are `base` followed by a 6 digit number and `ext`.
+        string_view name(ent->d_name);
+        if (name.size() != base.size() + 6 + ext.size() || name.substr(0, base.size()) != base ||
+            name.substr(base.size() + 6) != ext) {
+            continue;
+        }
+        string digits(name.substr(base.size(), 6));
+        if (digits.find_first_not_of("0123456789") != string::npos) {
+            continue;
+        }
+        unsigned int number = strtoul(digits.c_str(), nullptr, 10);
+        if (!found || number < first) {
+            first = number;
+            found = true;
+        }
+    }
+    closedir(dirp);
+    return first;
+}
+
+vector<string> CommandJournal::_listSegments(string const& groupPrefix) {
+    vector<string> paths;
+    auto slash = groupPrefix.rfind('/');
+    string dir = (slash == string::npos) ? "" : groupPrefix.substr(0, slash + 1);
+    string base = (slash == string::npos) ? groupPrefix : groupPrefix.substr(slash + 1);
+    string const ext = ".jrnl";
+    DIR* dirp = opendir(dir.empty() ? "." : dir.c_str());
+    if (dirp == nullptr) {
+        return paths;
+    }
+    while (dirent* ent = readdir(dirp)) {
+        // Names start with `base`, and end with "." followed by a 6 digit number and `ext`.
+        string_view name(ent->d_name);
+        size_t const tail = 1 + 6 + ext.size();
+        if (name.size() < max(base.size(), tail) || name.substr(0, base.size()) != base ||
+            name.substr(name.size() - ext.size()) != ext || name[name.size() - tail] != '.') {
+            continue;
+        }
+        string_view digits = name.substr(name.size() - tail + 1, 6);
+        if (digits.find_first_not_of("0123456789") != string_view::npos) {
+            continue;
+        }
+        paths.push_back(dir + string(name));
+    }
+    closedir(dirp);
+    sort(paths.begin(), paths.end());
+    return paths;
+}
+
+unsigned int CommandJournal::removeOldSegments(string const& groupPrefix, unsigned int keep) {
+    auto paths = _listSegments(groupPrefix);
+    unsigned int removed = 0;
+    for (size_t j = 0; j + keep < paths.size(); ++j) {
+        if (::unlink(paths[j].c_str()) == 0) {
+            ++removed;
+            LDEBUG("CommandJournal removed ", paths[j]);
+        } else if (errno != ENOENT) {
+            LWARN("CommandJournal could not remove ", paths[j], " ", strerror(errno));
+        }
+    }
+    return removed;
+}
+
+unsigned int CommandJournal::trimSegments(string const& groupPrefix) {
+    unsigned int trimmed = 0;
+    for (auto const& path : _listSegments(groupPrefix)) {
+        // A closed segment ends with its last record, one that was never
+        // closed ends with the zero fill. Only those need to be read.
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            continue;
+        }
+        off_t size = lseek(fd, 0, SEEK_END);
+        char last = 1;
+        bool zeroFilled = size > 0 && pread(fd, &last, 1, size - 1) == 1 && last == 0;
+        ::close(fd);
+        if (!zeroFilled) {
+            continue;
+        }
+        ifstream file(path, ios::binary);
+        string data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        if (data.size() < sizeof(MAGIC) || memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) {
+            LWARN("CommandJournal::trimSegments bad header ", path);
+            continue;
+        }
+        size_t used = _parseRecords(data, nullptr);
+        if (used < data.size()) {
+            if (truncate(path.c_str(), used) == 0) {
+                ++trimmed;
+                LINFO("CommandJournal trimmed unclosed segment ", path, " from ", data.size(), " to ", used);
+            } else {
+                LWARN("CommandJournal could not trim ", path, " ", strerror(errno));
+            }
+        }
+    }
+    return trimmed;
+}
+
+string CommandJournal::getTypeName(Type type) {
+    switch (type) {
+        case COMMAND:
+            return "COMMAND";
+        case RESULT:
+            return "RESULT";
+        case STATE:
+            return "STATE";
+        case REJECTED:
+            return "REJECTED";
+    }
+    return "unknown(" + to_string(type) + ")";
+}
+
+}  // namespace util
+}  // namespace m2cellcpp
+}  // namespace LSST
@@ -0,0 +1,262 @@
+// -*- LSST-C++ -*-
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#ifndef LSST_M2CELLCPP_UTIL_COMMANDJOURNAL_H
+#define LSST_M2CELLCPP_UTIL_COMMANDJOURNAL_H
+
+// System headers
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace LSST {
+namespace m2cellcpp {
+namespace util {
+
+/// An append-only binary journal of the commands received by the controller
+/// and the state transitions that followed, so that a session can be replayed.
+///
+/// `append()` only copies the record into a memory buffer, it never waits on
+/// the disk. A writer thread moves everything buffered into the current
+/// segment, a preallocated memory-mapped file, every `commitInterval` or
+/// sooner if the buffer gets large, and then syncs it to disk (group commit).
+/// If the writer falls more than `MAX_PENDING_SEGMENTS` segments behind,
+/// records are dropped and counted rather than blocking the caller.
+///
+/// Segments are named `<pathPrefix>.<number>.jrnl` with numbers starting at 0.
+/// Each one starts with `MAGIC`, followed by records of a `RecordHeader` and
+/// `RecordHeader::size` payload bytes. The unused part of a segment is zero
+/// filled, so a zero type ends the segment. A closed segment is truncated to
+/// the bytes used.
+/// With `maxSegments` set, the oldest segments are removed each time a new one
+/// would make more than `maxSegments`. The limit can cover several journals,
+/// like one per run of the program, by giving them the same `groupPrefix`,
+/// so together they never use more than `maxSegments * segmentSize` bytes of disk.
+/// A segment that wasn't closed, because the program crashed, keeps its full
+/// size until `trimSegments()` is called on it.
+/// Unit tests in tests/test_CommandJournal.cpp
+class CommandJournal {
+public:
+    using Ptr = std::shared_ptr<CommandJournal>;
+
+    /// Kinds of records.
+    enum Type : uint8_t {
+        COMMAND = 1,  ///< The text of a received command that was acked.
+        RESULT = 2,   ///< The final response sent for a command.
+        STATE = 3,    ///< A state transition "oldState newState".
+        REJECTED = 4  ///< The text of a command that was noacked or rejected as busy.
+    };
+
+    /// Written before each record's payload, all values are little endian.
+    struct RecordHeader {
+        uint32_t size;        ///< Payload size in bytes.
+        uint8_t type;         ///< A `Type` value.
+        uint8_t pad[3];       ///< Always 0.
+        uint64_t timeMicros;  ///< System clock time the record was appended, in microseconds.
+        uint64_t connId;      ///< Connection id for COMMAND and RESULT records, 0 otherwise.
+    };
+
+    /// A record read back from a segment.
+    struct Record {
+        Type type;
+        uint64_t timeMicros;
+        uint64_t connId;
+        std::string payload;
+    };
+
+    /// First bytes of every segment.
+    static constexpr char MAGIC[8] = {'M', '2', 'J', 'R', 'N', 'L', '0', '1'};
+    /// Smallest allowed segment size.
+    static constexpr size_t MIN_SEGMENT_SIZE = 4096;
+    /// `append()` drops records while this many segments worth of data are waiting.
+    static constexpr size_t MAX_PENDING_SEGMENTS = 4;
+
+    /// Create a journal and start its writer thread.
+    /// @param pathPrefix path and base name of the segment files.
+    /// @param segmentSize size of each segment file in bytes, at least `MIN_SEGMENT_SIZE`.
+    /// @param commitInterval longest time a record waits before being written.
+    /// @param maxSegments most segments kept, older ones are removed, 0 keeps all of them.
+    /// @param groupPrefix all segments with paths starting with this count towards
+    ///     `maxSegments`, empty counts only this journal's segments.
+    /// @throw util::Bug if `segmentSize` is too small.
+    /// @throw util::Issue if the first segment cannot be created.
+    static Ptr create(std::string const& pathPrefix, size_t segmentSize,
+                      std::chrono::milliseconds commitInterval, unsigned int maxSegments = 0,
+                      std::string const& groupPrefix = std::string()) {
+        return Ptr(new CommandJournal(pathPrefix, segmentSize, commitInterval, maxSegments, groupPrefix));
+    }
+
+    /// Make `journal` the global journal, nullptr turns journaling off.
+    static void setGlobal(Ptr const& journal);
+
+    /// @return the global journal, which is nullptr if journaling is off.
+    static Ptr getGlobal();
+
+    /// Append a record to the global journal, if there is one.
+    static void appendGlobal(Type type, uint64_t connId, std::string_view payload) {
+        auto journal = getGlobal();
+        if (journal != nullptr) {
+            journal->append(type, connId, payload);
+        }
+    }
+
+    CommandJournal() = delete;
+    CommandJournal(CommandJournal const&) = delete;
+    CommandJournal& operator=(CommandJournal const&) = delete;
+
+    /// Calls `close()`.
+    ~CommandJournal();
+
+    /// Buffer a record to be written. This is safe to call from any thread
+    /// and does not wait on the disk.
+    /// @return false if the record was dropped because the writer is too far
+    ///     behind, the journal is closed, or the record doesn't fit in a segment.
+    bool append(Type type, uint64_t connId, std::string_view payload);
+
+    /// Write and sync everything appended so far.
+    void flush();
+
+    /// Write everything appended so far and stop the writer thread,
+    /// later calls to `append()` are dropped.
+    void close();
+
+    /// @return the number of records written to segments.
+    uint64_t getWrittenCount() const { return _writtenCount; }
+
+    /// @return the number of records dropped by `append()`.
+    uint64_t getDroppedCount() const { return _droppedCount; }
+
+    /// @return the number of commits done by the writer.
+    uint64_t getCommitCount() const { return _commitCount; }
+
+    /// @return the number of the segment currently being written.
+    unsigned int getSegmentNumber() const { return _segNumber; }
+
+    /// @return the number of old segments removed to stay within `_maxSegments`.
+    uint64_t getRemovedCount() const { return _removedCount; }
+
+    /// @return the path of segment `number` for `pathPrefix`.
+    static std::string segmentPath(std::string const& pathPrefix, unsigned int number);
+
+    /// Append the records in the segment at `path` to `out`.
+    /// @return false if the file can't be read or doesn't start with `MAGIC`.
+    static bool readSegment(std::string const& path, std::vector<Record>& out);
+
+    /// Append the records of every segment of `pathPrefix`, in order, to `out`,
+    /// starting with the oldest one that hasn't been removed.
+    /// @return the number of segments read.
+    static unsigned int readAll(std::string const& pathPrefix, std::vector<Record>& out);
+
+    /// @return the lowest segment number of `pathPrefix` on disk, 0 if there are none.
+    static unsigned int firstSegment(std::string const& pathPrefix);
+
+    /// Remove the oldest segments with paths starting with `groupPrefix`,
+    /// until no more than `keep` are left. Segments are ordered by their file names.
+    /// @return the number of segments removed.
+    static unsigned int removeOldSegments(std::string const& groupPrefix, unsigned int keep);
+
+    /// Truncate segments with paths starting with `groupPrefix` that were
+    /// never closed to the bytes their records use.
+    /// This must not be called while any of those segments are open.
+    /// @return the number of segments truncated.
+    static unsigned int trimSegments(std::string const& groupPrefix);
+
+    /// @return a printable name for `type`.
+    static std::string getTypeName(Type type);
+
+private:
+    CommandJournal(std::string const& pathPrefix, size_t segmentSize,
+                   std::chrono::milliseconds commitInterval, unsigned int maxSegments,
+                   std::string const& groupPrefix);
+
+    /// @return the paths of all segments starting with `groupPrefix`, sorted by name.
+    static std::vector<std::string> _listSegments(std::string const& groupPrefix);
+
+    /// Append the records in `data`, the contents of a segment after `MAGIC`,
+    /// to `out` if it isn't nullptr.
+    /// @return the number of bytes of `data` used by whole records, plus `MAGIC`.
+    static size_t _parseRecords(std::string const& data, std::vector<Record>* out);
+
+    /// Runs in `_writer`, committing `_pending` until closed.
+    void _writeLoop();
+
+    /// Copy `data` into the mapped segments, starting new ones as needed,
+    /// and sync what was copied.
+    /// @return false if a segment could not be opened and records were lost.
+    bool _commit(std::string const& data);
+
+    /// Sync the current segment from byte `from` to `_used`.
+    void _sync(size_t from);
+
+    /// Create, size, and map segment `_segNumber`, and then remove the
+    /// oldest segments of `_groupPrefix` if there are more than `_maxSegments`.
+    /// @throw util::Issue on failure.
+    void _openSegment();
+
+    /// Sync, unmap, and truncate the current segment to the bytes used.
+    void _closeSegment();
+
+    std::string const _pathPrefix;                    ///< Path and base name of the segments.
+    size_t const _segmentSize;                        ///< Size of each segment file.
+    std::chrono::milliseconds const _commitInterval;  ///< Longest wait between commits.
+    unsigned int const _maxSegments;                  ///< Most segments kept, 0 for no limit.
+    std::string const _groupPrefix;                   ///< Segments that share `_maxSegments`.
+
+    std::string _pending;              ///< Records appended but not yet committed.
+    uint64_t _appendSeq = 0;           ///< Number of records appended.
+    uint64_t _committedSeq = 0;        ///< Number of appended records committed.
+    uint64_t _flushTo = 0;             ///< `flush()` is waiting for this many records.
+    bool _closed = false;              ///< Set by `close()`.
+    bool _writerDone = false;          ///< Set when `_writer` exits.
+    std::mutex _mtx;                   ///< Protects the values above.
+    std::condition_variable _cv;       ///< Wakes `_writer`.
+    std::condition_variable _doneCv;   ///< Notified after each commit.
+
+    // These are only used by `_writer`, and by the constructor and `close()`.
+    int _fd = -1;          ///< File descriptor of the current segment.
+    char* _map = nullptr;  ///< Mapping of the current segment.
+    size_t _used = 0;      ///< Bytes used in the current segment.
+
+    std::atomic<unsigned int> _segNumber{0};  ///< Number of the current segment.
+    std::atomic<uint64_t> _writtenCount{0};   ///< Records written to segments.
+    std::atomic<uint64_t> _droppedCount{0};   ///< Records dropped by `append()`.
+    std::atomic<uint64_t> _commitCount{0};    ///< Commits done.
+    std::atomic<uint64_t> _removedCount{0};   ///< Old segments removed.
+
+    std::thread _writer;  ///< Runs `_writeLoop()`.
+
+    static Ptr _global;            ///< The global journal.
+    static std::mutex _globalMtx;  ///< Protects `_global`.
+};
+
+}  // namespace util
+}  // namespace m2cellcpp
+}  // namespace LSST
+
+#endif  // LSST_M2CELLCPP_UTIL_COMMANDJOURNAL_H
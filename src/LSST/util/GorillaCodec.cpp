@@ -0,0 +1,280 @@
+// -*- LSST-C++ -*-
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+// Class header
+#include "util/GorillaCodec.h"
+
+// System headers
+#include <algorithm>
+#include <cstring>
+
+// Project headers
+#include "util/Bug.h"
+
+using namespace std;
+
+namespace LSST {
+namespace m2cellcpp {
+namespace util {
+
+namespace {
+
+/// Size of the block header in bytes.
+size_t const BLOCK_HEADER_SIZE = 12;
+
+/// Return the bits of `val`.
+inline uint64_t doubleToBits(double val) {
+    uint64_t bits;
+    memcpy(&bits, &val, sizeof(bits));
+    return bits;
+}
+
+/// Return the double with bit pattern `bits`.
+inline double bitsToDouble(uint64_t bits) {
+    double val;
+    memcpy(&val, &bits, sizeof(val));
+    return val;
+}
+
+/// Write `val` into `buf` as 4 big endian bytes.
+inline void putUInt32(uint8_t* buf, uint32_t val) {
+    buf[0] = val >> 24;
+    buf[1] = val >> 16;
+    buf[2] = val >> 8;
+    buf[3] = val;
+}
+
+/// Return the 4 big endian bytes in `buf` as an integer.
+inline uint32_t getUInt32(uint8_t const* buf) {
+    return (uint32_t(buf[0]) << 24) | (uint32_t(buf[1]) << 16) | (uint32_t(buf[2]) << 8) | uint32_t(buf[3]);
+}
+
+}  // namespace
+
+void BitWriter::writeBits(uint64_t val, int nBits) {
+    while (nBits > 0) {
+        size_t byteIdx = _bitCount / 8;
+        int bitOff = _bitCount % 8;
+        if (byteIdx == _buf.size()) {
+            _buf.push_back(0);
+        }
+        int space = 8 - bitOff;
+        int take = min(space, nBits);
+        uint8_t chunk = (val >> (nBits - take)) & ((1u << take) - 1);
+        _buf[byteIdx] |= chunk << (space - take);
+        nBits -= take;
+        _bitCount += take;
+    }
+}
+
+uint64_t BitReader::readBits(int nBits) {
+    if (uint64_t(nBits) > _bitLimit - _bitPos) {
+        throw CodecException(ERR_LOC, "BitReader::readBits past end of data bitPos=" + to_string(_bitPos) +
+                                              " nBits=" + to_string(nBits));
+    }
+    uint64_t out = 0;
+    while (nBits > 0) {
+        size_t byteIdx = _bitPos / 8;
+        int bitOff = _bitPos % 8;
+        int space = 8 - bitOff;
+        int take = min(space, nBits);
+        uint64_t chunk = (_data[byteIdx] >> (space - take)) & ((1u << take) - 1);
+        out = (out << take) | chunk;
+        nBits -= take;
+        _bitPos += take;
+    }
+    return out;
+}
+
+void GorillaFloatEncoder::add(double val, BitWriter& writer) {
+    uint64_t bits = doubleToBits(val);
+    if (_first) {
+        _first = false;
+        _prev = bits;
+        writer.writeBits(bits, 64);
+        return;
+    }
+    uint64_t xorVal = bits ^ _prev;
+    _prev = bits;
+    if (xorVal == 0) {
+        writer.writeBit(false);
+        return;
+    }
+    writer.writeBit(true);
+    // The leading zero count has to fit in 5 bits.
+    int leading = min(__builtin_clzll(xorVal), 31);
+    int trailing = __builtin_ctzll(xorVal);
+    if (_prevLeading >= 0 && leading >= _prevLeading && trailing >= _prevTrailing) {
+        // The meaningful bits fit in the previous window.
+        writer.writeBit(false);
+        writer.writeBits(xorVal >> _prevTrailing, 64 - _prevLeading - _prevTrailing);
+        return;
+    }
+    writer.writeBit(true);
+    int significant = 64 - leading - trailing;
+    writer.writeBits(leading, 5);
+    // 64 significant bits does not fit in 6 bits, but 0 significant bits is
+    // impossible, so 0 represents 64.
+    writer.writeBits(significant & 0x3f, 6);
+    writer.writeBits(xorVal >> trailing, significant);
+    _prevLeading = leading;
+    _prevTrailing = trailing;
+}
+
+double GorillaFloatDecoder::next(BitReader& reader) {
+    if (_first) {
+        _first = false;
+        _prev = reader.readBits(64);
+        return bitsToDouble(_prev);
+    }
+    if (!reader.readBit()) {
+        return bitsToDouble(_prev);
+    }
+    if (reader.readBit()) {
+        _prevLeading = reader.readBits(5);
+        int significant = reader.readBits(6);
+        if (significant == 0) {
+            significant = 64;
+        }
+        _prevTrailing = 64 - _prevLeading - significant;
+        if (_prevTrailing < 0) {
+            throw CodecException(ERR_LOC, "GorillaFloatDecoder::next invalid window");
+        }
+    }
+    uint64_t xorVal = reader.readBits(64 - _prevLeading - _prevTrailing) << _prevTrailing;
+    _prev ^= xorVal;
+    return bitsToDouble(_prev);
+}
+
+void DeltaOfDeltaEncoder::add(int64_t val, BitWriter& writer) {
+    if (_count == 0) {
+        ++_count;
+        _prev = val;
+        writer.writeBits(uint64_t(val), 64);
+        return;
+    }
+    // Unsigned arithmetic so that extreme values wrap instead of overflowing.
+    uint64_t delta = uint64_t(val) - uint64_t(_prev);
+    int64_t dod = int64_t(delta - uint64_t(_prevDelta));
+    _prev = val;
+    _prevDelta = int64_t(delta);
+    // zigzag so small negative numbers are also small.
+    uint64_t zz = (uint64_t(dod) << 1) ^ uint64_t(dod >> 63);
+    if (zz == 0) {
+        writer.writeBit(false);
+    } else if (zz < (1ull << 7)) {
+        writer.writeBits(0b10, 2);
+        writer.writeBits(zz, 7);
+    } else if (zz < (1ull << 9)) {
+        writer.writeBits(0b110, 3);
+        writer.writeBits(zz, 9);
+    } else if (zz < (1ull << 12)) {
+        writer.writeBits(0b1110, 4);
+        writer.writeBits(zz, 12);
+    } else {
+        writer.writeBits(0b1111, 4);
+        writer.writeBits(zz, 64);
+    }
+}
+
+int64_t DeltaOfDeltaDecoder::next(BitReader& reader) {
+    if (_count == 0) {
+        ++_count;
+        _prev = int64_t(reader.readBits(64));
+        return _prev;
+    }
+    uint64_t zz = 0;
+    if (reader.readBit()) {
+        if (!reader.readBit()) {
+            zz = reader.readBits(7);
+        } else if (!reader.readBit()) {
+            zz = reader.readBits(9);
+        } else if (!reader.readBit()) {
+            zz = reader.readBits(12);
+        } else {
+            zz = reader.readBits(64);
+        }
+    }
+    uint64_t dod = (zz >> 1) ^ (~(zz & 1) + 1);
+    uint64_t delta = uint64_t(_prevDelta) + dod;
+    _prevDelta = int64_t(delta);
+    _prev = int64_t(uint64_t(_prev) + delta);
+    return _prev;
+}
+
+GorillaBlockEncoder::GorillaBlockEncoder(uint32_t columns) : _columns(columns), _colEncoders(columns) {}
+
+void GorillaBlockEncoder::addRow(int64_t timestamp, vector<double> const& vals) {
+    if (vals.size() != _columns) {
+        throw Bug(ERR_LOC, "GorillaBlockEncoder::addRow expected " + to_string(_columns) + " values, got " +
+                                   to_string(vals.size()));
+    }
+    _timeEncoder.add(timestamp, _writer);
+    for (uint32_t j = 0; j < _columns; ++j) {
+        _colEncoders[j].add(vals[j], _writer);
+    }
+    ++_rows;
+}
+
+vector<uint8_t> GorillaBlockEncoder::getBlock() const {
+    auto const& body = _writer.getBytes();
+    vector<uint8_t> block(BLOCK_HEADER_SIZE + body.size());
+    block[0] = 'G';
+    block[1] = 'R';
+    block[2] = 'L';
+    block[3] = FORMAT_VERSION;
+    putUInt32(&block[4], _columns);
+    putUInt32(&block[8], _rows);
+    copy(body.begin(), body.end(), block.begin() + BLOCK_HEADER_SIZE);
+    return block;
+}
+
+GorillaBlockDecoder::GorillaBlockDecoder(uint8_t const* data, size_t sizeBytes)
+        : _reader(data + min(sizeBytes, BLOCK_HEADER_SIZE),
+                  sizeBytes - min(sizeBytes, BLOCK_HEADER_SIZE)) {
+    if (sizeBytes < BLOCK_HEADER_SIZE || data[0] != 'G' || data[1] != 'R' || data[2] != 'L') {
+        throw CodecException(ERR_LOC, "GorillaBlockDecoder invalid header");
+    }
+    if (data[3] != GorillaBlockEncoder::FORMAT_VERSION) {
+        throw CodecException(ERR_LOC, "GorillaBlockDecoder unknown version " + to_string(data[3]));
+    }
+    _columns = getUInt32(&data[4]);
+    _rows = getUInt32(&data[8]);
+    _colDecoders.resize(_columns);
+}
+
+bool GorillaBlockDecoder::nextRow(int64_t& timestamp, vector<double>& vals) {
+    if (_rowsRead >= _rows) {
+        return false;
+    }
+    timestamp = _timeDecoder.next(_reader);
+    vals.resize(_columns);
+    for (uint32_t j = 0; j < _columns; ++j) {
+        vals[j] = _colDecoders[j].next(_reader);
+    }
+    ++_rowsRead;
+    return true;
+}
+
+}  // namespace util
+}  // namespace m2cellcpp
+}  // namespace LSST
@@ -0,0 +1,256 @@
+// -*- LSST-C++ -*-
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#ifndef LSST_M2CELLCPP_UTIL_GORILLACODEC_H
+#define LSST_M2CELLCPP_UTIL_GORILLACODEC_H
+
+/// The classes in this header implement the time series compression
+/// described in "Gorilla: A Fast, Scalable, In-Memory Time Series Database"
+/// (Pelkonen et al., 2015).
+/// Doubles are stored as the XOR of the value with the previous value, so
+/// values that change little only need their few changing bits stored.
+/// Integers, such as timestamps, are stored as the difference of differences,
+/// so regularly spaced values take a single bit.
+/// Both are lossless, decoded values have the same bit patterns as the originals.
+///
+/// `GorillaBlockEncoder` and `GorillaBlockDecoder` use these to store rows of
+/// timestamped vectors, like the 72 element arrays in `TItemAxialForce`,
+/// with each column compressed against its own previous value.
+
+// System headers
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Project headers
+#include "util/Issue.h"
+
+namespace LSST {
+namespace m2cellcpp {
+namespace util {
+
+/// Exception thrown when encoded data cannot be decoded.
+class CodecException : public util::Issue {
+public:
+    CodecException(Context const& ctx, std::string const& msg) : util::Issue(ctx, msg) {}
+};
+
+/// Append values of any bit length to a byte buffer, most significant bit first.
+class BitWriter {
+public:
+    BitWriter() = default;
+    BitWriter(BitWriter const&) = default;
+    BitWriter& operator=(BitWriter const&) = default;
+    ~BitWriter() = default;
+
+    /// Write the lowest `nBits` bits of `val`, `nBits` must be 0 to 64.
+    void writeBits(uint64_t val, int nBits);
+
+    /// Write a single bit.
+    void writeBit(bool bit) { writeBits(bit ? 1 : 0, 1); }
+
+    /// Return the number of bits written.
+    uint64_t getBitCount() const { return _bitCount; }
+
+    /// Return the bytes written, the last byte is padded with 0 bits.
+    std::vector<uint8_t> const& getBytes() const { return _buf; }
+
+private:
+    std::vector<uint8_t> _buf;  ///< Bytes written.
+    uint64_t _bitCount = 0;     ///< Number of bits written.
+};
+
+/// Read values of any bit length from a byte buffer written by `BitWriter`.
+class BitReader {
+public:
+    /// Read from `data`, which must remain valid for the life of this object.
+    BitReader(uint8_t const* data, size_t sizeBytes) : _data(data), _bitLimit(uint64_t(sizeBytes) * 8) {}
+    BitReader() = delete;
+    BitReader(BitReader const&) = default;
+    BitReader& operator=(BitReader const&) = default;
+    ~BitReader() = default;
+
+    /// Return the next `nBits` bits, `nBits` must be 0 to 64.
+    /// @throws CodecException if there are not enough bits.
+    uint64_t readBits(int nBits);
+
+    /// Return the next bit.
+    /// @throws CodecException if there are no bits left.
+    bool readBit() { return readBits(1) != 0; }
+
+    /// Return the number of bits read.
+    uint64_t getBitPos() const { return _bitPos; }
+
+private:
+    uint8_t const* _data;  ///< Buffer being read.
+    uint64_t _bitLimit;    ///< Number of bits in `_data`.
+    uint64_t _bitPos = 0;  ///< Number of bits read.
+};
+
+/// Encode a series of doubles as XOR deltas.
+class GorillaFloatEncoder {
+public:
+    GorillaFloatEncoder() = default;
+    GorillaFloatEncoder(GorillaFloatEncoder const&) = default;
+    GorillaFloatEncoder& operator=(GorillaFloatEncoder const&) = default;
+    ~GorillaFloatEncoder() = default;
+
+    /// Encode `val` into `writer`.
+    void add(double val, BitWriter& writer);
+
+private:
+    uint64_t _prev = 0;     ///< Bits of the previous value.
+    int _prevLeading = -1;  ///< Leading zeros of the previous window, -1 if there is no window.
+    int _prevTrailing = 0;  ///< Trailing zeros of the previous window.
+    bool _first = true;     ///< True until the first value is added.
+};
+
+/// Decode a series of doubles encoded by `GorillaFloatEncoder`.
+class GorillaFloatDecoder {
+public:
+    GorillaFloatDecoder() = default;
+    GorillaFloatDecoder(GorillaFloatDecoder const&) = default;
+    GorillaFloatDecoder& operator=(GorillaFloatDecoder const&) = default;
+    ~GorillaFloatDecoder() = default;
+
+    /// Return the next value from `reader`.
+    /// @throws CodecException if the data is truncated.
+    double next(BitReader& reader);
+
+private:
+    uint64_t _prev = 0;     ///< Bits of the previous value.
+    int _prevLeading = 0;   ///< Leading zeros of the current window.
+    int _prevTrailing = 0;  ///< Trailing zeros of the current window.
+    bool _first = true;     ///< True until the first value is read.
+};
+
+/// Encode a series of integers as delta of deltas.
+class DeltaOfDeltaEncoder {
+public:
+    DeltaOfDeltaEncoder() = default;
+    DeltaOfDeltaEncoder(DeltaOfDeltaEncoder const&) = default;
+    DeltaOfDeltaEncoder& operator=(DeltaOfDeltaEncoder const&) = default;
+    ~DeltaOfDeltaEncoder() = default;
+
+    /// Encode `val` into `writer`.
+    void add(int64_t val, BitWriter& writer);
+
+private:
+    int64_t _prev = 0;       ///< Previous value.
+    int64_t _prevDelta = 0;  ///< Previous delta.
+    int _count = 0;          ///< Number of values added.
+};
+
+/// Decode a series of integers encoded by `DeltaOfDeltaEncoder`.
+class DeltaOfDeltaDecoder {
+public:
+    DeltaOfDeltaDecoder() = default;
+    DeltaOfDeltaDecoder(DeltaOfDeltaDecoder const&) = default;
+    DeltaOfDeltaDecoder& operator=(DeltaOfDeltaDecoder const&) = default;
+    ~DeltaOfDeltaDecoder() = default;
+
+    /// Return the next value from `reader`.
+    /// @throws CodecException if the data is truncated.
+    int64_t next(BitReader& reader);
+
+private:
+    int64_t _prev = 0;       ///< Previous value.
+    int64_t _prevDelta = 0;  ///< Previous delta.
+    int _count = 0;          ///< Number of values read.
+};
+
+/// Encode rows of timestamped vectors of doubles into a self describing block.
+/// Every row must have `_columns` values. The block has a 12 byte header,
+/// "GRL" plus a version byte, the column count, and the row count, followed by
+/// the bit stream of the rows.
+/// Unit tests in tests/test_GorillaCodec.cpp
+class GorillaBlockEncoder {
+public:
+    /// Current block format version.
+    static constexpr uint8_t FORMAT_VERSION = 1;
+
+    /// Create an encoder for rows with `columns` values each.
+    explicit GorillaBlockEncoder(uint32_t columns);
+    GorillaBlockEncoder() = delete;
+    GorillaBlockEncoder(GorillaBlockEncoder const&) = default;
+    GorillaBlockEncoder& operator=(GorillaBlockEncoder const&) = default;
+    ~GorillaBlockEncoder() = default;
+
+    /// Add a row of `vals` with `timestamp`.
+    /// @throws util::Bug if `vals` does not have `_columns` values.
+    void addRow(int64_t timestamp, std::vector<double> const& vals);
+
+    /// Return the number of rows added.
+    uint32_t getRowCount() const { return _rows; }
+
+    /// Return the number of columns in each row.
+    uint32_t getColumnCount() const { return _columns; }
+
+    /// Return the encoded block, including the header.
+    std::vector<uint8_t> getBlock() const;
+
+private:
+    uint32_t _columns;                              ///< Number of values in each row.
+    uint32_t _rows = 0;                             ///< Number of rows added.
+    BitWriter _writer;                              ///< Encoded rows.
+    DeltaOfDeltaEncoder _timeEncoder;               ///< Encoder for timestamps.
+    std::vector<GorillaFloatEncoder> _colEncoders;  ///< Encoder for each column.
+};
+
+/// Decode a block encoded by `GorillaBlockEncoder`.
+/// Unit tests in tests/test_GorillaCodec.cpp
+class GorillaBlockDecoder {
+public:
+    /// Decode the header of the block in `data`, which must remain valid
+    /// for the life of this object.
+    /// @throws CodecException if the header is invalid.
+    GorillaBlockDecoder(uint8_t const* data, size_t sizeBytes);
+    GorillaBlockDecoder() = delete;
+    GorillaBlockDecoder(GorillaBlockDecoder const&) = default;
+    GorillaBlockDecoder& operator=(GorillaBlockDecoder const&) = default;
+    ~GorillaBlockDecoder() = default;
+
+    /// Return the number of rows in the block.
+    uint32_t getRowCount() const { return _rows; }
+
+    /// Return the number of columns in each row.
+    uint32_t getColumnCount() const { return _columns; }
+
+    /// Read the next row into `timestamp` and `vals`.
+    /// @return false if all rows have been read.
+    /// @throws CodecException if the data is truncated.
+    bool nextRow(int64_t& timestamp, std::vector<double>& vals);
+
+private:
+    uint32_t _columns = 0;                          ///< Number of values in each row.
+    uint32_t _rows = 0;                             ///< Number of rows in the block.
+    uint32_t _rowsRead = 0;                         ///< Number of rows read.
+    BitReader _reader;                              ///< Reader for the encoded rows.
+    DeltaOfDeltaDecoder _timeDecoder;               ///< Decoder for timestamps.
+    std::vector<GorillaFloatDecoder> _colDecoders;  ///< Decoder for each column.
+};
+
+}  // namespace util
+}  // namespace m2cellcpp
+}  // namespace LSST
+
+#endif  // LSST_M2CELLCPP_UTIL_GORILLACODEC_H
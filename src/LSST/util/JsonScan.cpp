@@ -0,0 +1,437 @@
+// -*- LSST-C++ -*-
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+// Class header
+#include "util/JsonScan.h"
+
+// System headers
+#include <charconv>
+
+using namespace std;
+
+namespace LSST {
+namespace m2cellcpp {
+namespace util {
+
+namespace {
+
+/// Return true if `c` is json whitespace.
+inline bool isWs(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+/// Advance `pos` past whitespace in `text`.
+inline void skipWs(string_view text, size_t& pos) {
+    while (pos < text.size() && isWs(text[pos])) {
+        ++pos;
+    }
+}
+
+/// Return the value of the hex digit `c`, or -1 if it isn't one.
+inline int hexVal(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/// `pos` must be just after a "\u". Set `code` to the value of the 4 hex
+/// digits at `pos` and advance `pos` past them.
+/// @return false if there aren't 4 hex digits.
+bool readHex4(string_view text, size_t& pos, unsigned int& code) {
+    if (pos + 4 > text.size()) {
+        return false;
+    }
+    code = 0;
+    for (size_t end = pos + 4; pos < end; ++pos) {
+        int val = hexVal(text[pos]);
+        if (val < 0) {
+            return false;
+        }
+        code = code * 16 + val;
+    }
+    return true;
+}
+
+/// `pos` must be at a backslash. Advance `pos` past the escape sequence.
+/// @return false if it isn't a json escape, or is an unpaired utf-16 surrogate.
+bool skipEscape(string_view text, size_t& pos) {
+    ++pos;
+    if (pos >= text.size()) {
+        return false;
+    }
+    char c = text[pos++];
+    if (c != 'u') {
+        return c == '"' || c == '\\' || c == '/' || c == 'b' || c == 'f' || c == 'n' || c == 'r' || c == 't';
+    }
+    unsigned int code;
+    if (!readHex4(text, pos, code)) {
+        return false;
+    }
+    if (code >= 0xDC00 && code <= 0xDFFF) {
+        return false;
+    }
+    if (code >= 0xD800 && code <= 0xDBFF) {
+        if (pos + 2 > text.size() || text[pos] != '\\' || text[pos + 1] != 'u') {
+            return false;
+        }
+        pos += 2;
+        return readHex4(text, pos, code) && code >= 0xDC00 && code <= 0xDFFF;
+    }
+    return true;
+}
+
+/// `pos` must be at the first byte of a multibyte utf-8 character.
+/// Advance `pos` past the character. Overlong encodings, surrogates, and
+/// values above U+10FFFF are rejected, as nlohmann::json does.
+/// @return false if it isn't a well formed utf-8 character.
+bool skipUtf8(string_view text, size_t& pos) {
+    auto byte = [&text](size_t p) -> unsigned int {
+        return (p < text.size()) ? static_cast<unsigned char>(text[p]) : 0;
+    };
+    unsigned int c = byte(pos);
+    size_t len;
+    unsigned int lo = 0x80;  // Range of the second byte.
+    unsigned int hi = 0xBF;
+    if (c >= 0xC2 && c <= 0xDF) {
+        len = 2;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+        len = 3;
+        lo = (c == 0xE0) ? 0xA0 : 0x80;
+        hi = (c == 0xED) ? 0x9F : 0xBF;
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        len = 4;
+        lo = (c == 0xF0) ? 0x90 : 0x80;
+        hi = (c == 0xF4) ? 0x8F : 0xBF;
+    } else {
+        return false;
+    }
+    unsigned int second = byte(pos + 1);
+    if (second < lo || second > hi) {
+        return false;
+    }
+    for (size_t j = 2; j < len; ++j) {
+        unsigned int next = byte(pos + j);
+        if (next < 0x80 || next > 0xBF) {
+            return false;
+        }
+    }
+    pos += len;
+    return true;
+}
+
+/// `pos` must be at an opening quote. Advance `pos` past the closing quote.
+/// @return false if the string is not terminated, or isn't a valid json string.
+bool skipString(string_view text, size_t& pos) {
+    ++pos;
+    while (pos < text.size()) {
+        unsigned char c = text[pos];
+        if (c == '"') {
+            ++pos;
+            return true;
+        }
+        if (c == '\\') {
+            if (!skipEscape(text, pos)) {
+                return false;
+            }
+            continue;
+        }
+        if (c < 0x20) {
+            return false;
+        }
+        if (c >= 0x80) {
+            if (!skipUtf8(text, pos)) {
+                return false;
+            }
+            continue;
+        }
+        ++pos;
+    }
+    return false;
+}
+
+/// Advance `pos` past the json number at `pos`.
+/// @return false if there isn't a valid json number at `pos`.
+bool skipNumber(string_view text, size_t& pos) {
+    auto isDigit = [&text](size_t p) { return p < text.size() && text[p] >= '0' && text[p] <= '9'; };
+    auto skipDigits = [&text, &pos, &isDigit]() {
+        if (!isDigit(pos)) {
+            return false;
+        }
+        while (isDigit(pos)) {
+            ++pos;
+        }
+        return true;
+    };
+    if (pos < text.size() && text[pos] == '-') {
+        ++pos;
+    }
+    if (isDigit(pos) && text[pos] == '0') {
+        ++pos;
+    } else if (!skipDigits()) {
+        return false;
+    }
+    if (pos < text.size() && text[pos] == '.') {
+        ++pos;
+        if (!skipDigits()) {
+            return false;
+        }
+    }
+    if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+        ++pos;
+        if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) {
+            ++pos;
+        }
+        if (!skipDigits()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Advance `pos` past the string, number, true, false, or null at `pos`.
+/// @return false if there isn't one at `pos`.
+bool skipScalar(string_view text, size_t& pos) {
+    if (pos >= text.size()) {
+        return false;
+    }
+    char c = text[pos];
+    if (c == '"') {
+        return skipString(text, pos);
+    }
+    if (c == '-' || (c >= '0' && c <= '9')) {
+        return skipNumber(text, pos);
+    }
+    for (string_view literal : {"true", "false", "null"}) {
+        if (text.substr(pos, literal.size()) == literal) {
+            pos += literal.size();
+            return true;
+        }
+    }
+    return false;
+}
+
+/// `pos` must be at the key of an object member. Advance `pos` past the key,
+/// the colon, and any whitespace before the value.
+/// @return false if there isn't a key and colon at `pos`.
+bool skipKey(string_view text, size_t& pos) {
+    if (pos >= text.size() || text[pos] != '"' || !skipString(text, pos)) {
+        return false;
+    }
+    skipWs(text, pos);
+    if (pos >= text.size() || text[pos] != ':') {
+        return false;
+    }
+    ++pos;
+    skipWs(text, pos);
+    return true;
+}
+
+/// Advance `pos` past the value starting at `pos`, checking it is valid json.
+/// Nested objects and arrays are tracked without recursion, so deep nesting
+/// can't overflow the stack.
+/// @return false if the value is not terminated or isn't valid json.
+bool skipValue(string_view text, size_t& pos) {
+    string open;  // '{' or '[' for each unclosed object or array.
+    while (true) {
+        // `pos` is at the start of a value.
+        if (pos >= text.size()) {
+            return false;
+        }
+        char c = text[pos];
+        if (c == '{' || c == '[') {
+            ++pos;
+            skipWs(text, pos);
+            if (pos < text.size() && text[pos] == ((c == '{') ? '}' : ']')) {
+                ++pos;
+            } else {
+                open.push_back(c);
+                if (c == '{' && !skipKey(text, pos)) {
+                    return false;
+                }
+                continue;
+            }
+        } else if (!skipScalar(text, pos)) {
+            return false;
+        }
+        // A value was completed, close any finished objects and arrays and
+        // find the start of the next value.
+        while (true) {
+            if (open.empty()) {
+                return true;
+            }
+            skipWs(text, pos);
+            if (pos >= text.size()) {
+                return false;
+            }
+            if (text[pos] == ((open.back() == '{') ? '}' : ']')) {
+                ++pos;
+                open.pop_back();
+                continue;
+            }
+            if (text[pos] != ',') {
+                return false;
+            }
+            ++pos;
+            skipWs(text, pos);
+            if (open.back() == '{' && !skipKey(text, pos)) {
+                return false;
+            }
+            break;
+        }
+    }
+}
+
+/// `pos` must be just after the end of a json value. Skip trailing
+/// whitespace, nothing else may follow the value.
+/// @return true if nothing but whitespace followed the value.
+bool atEnd(string_view text, size_t& pos) {
+    skipWs(text, pos);
+    return pos == text.size();
+}
+
+}  // namespace
+
+JsonScan::JsonScan(string_view text) : _text(text) { _valid = _scan(); }
+
+bool JsonScan::_scan() {
+    // Like nlohmann::json, skip a utf-8 byte order mark.
+    size_t pos = (_text.substr(0, 3) == "\xEF\xBB\xBF") ? 3 : 0;
+    skipWs(_text, pos);
+    if (pos >= _text.size() || _text[pos] != '{') {
+        return false;
+    }
+    ++pos;
+    skipWs(_text, pos);
+    if (pos < _text.size() && _text[pos] == '}') {
+        return atEnd(_text, ++pos);
+    }
+    _members.reserve(8);
+    while (pos < _text.size()) {
+        skipWs(_text, pos);
+        if (pos >= _text.size() || _text[pos] != '"') {
+            return false;
+        }
+        size_t keyStart = pos + 1;
+        if (!skipString(_text, pos)) {
+            return false;
+        }
+        string_view key = _text.substr(keyStart, pos - keyStart - 1);
+        _escapedKeys = _escapedKeys || key.find('\\') != string_view::npos;
+        skipWs(_text, pos);
+        if (pos >= _text.size() || _text[pos] != ':') {
+            return false;
+        }
+        ++pos;
+        skipWs(_text, pos);
+        size_t valStart = pos;
+        if (!skipValue(_text, pos)) {
+            return false;
+        }
+        _members.emplace_back(key, _text.substr(valStart, pos - valStart));
+        skipWs(_text, pos);
+        if (pos >= _text.size()) {
+            return false;
+        }
+        if (_text[pos] == '}') {
+            return atEnd(_text, ++pos);
+        }
+        if (_text[pos] != ',') {
+            return false;
+        }
+        ++pos;
+    }
+    return false;
+}
+
+bool JsonScan::splitArray(string_view raw, vector<string_view>& out) {
+    out.clear();
+    size_t pos = 0;
+    skipWs(raw, pos);
+    if (pos >= raw.size() || raw[pos] != '[') {
+        return false;
+    }
+    ++pos;
+    skipWs(raw, pos);
+    if (pos < raw.size() && raw[pos] == ']') {
+        return atEnd(raw, ++pos);
+    }
+    while (pos < raw.size()) {
+        size_t valStart = pos;
+        if (!skipValue(raw, pos)) {
+            return false;
+        }
+        out.push_back(raw.substr(valStart, pos - valStart));
+        skipWs(raw, pos);
+        if (pos >= raw.size()) {
+            return false;
+        }
+        if (raw[pos] == ']') {
+            return atEnd(raw, ++pos);
+        }
+        if (raw[pos] != ',') {
+            return false;
+        }
+        ++pos;
+        skipWs(raw, pos);
+    }
+    return false;
+}
+
+string_view JsonScan::getRaw(string_view key) const {
+    // Like nlohmann::json, the last of duplicate keys is used.
+    for (auto iter = _members.rbegin(); iter != _members.rend(); ++iter) {
+        if (iter->first == key) {
+            return iter->second;
+        }
+    }
+    return string_view();
+}
+
+bool JsonScan::getString(string_view key, string_view& out) const {
+    string_view raw = getRaw(key);
+    if (raw.size() < 2 || raw.front() != '"' || raw.back() != '"') {
+        return false;
+    }
+    out = raw.substr(1, raw.size() - 2);
+    return true;
+}
+
+bool JsonScan::getUInt64(string_view key, uint64_t& out) const {
+    string_view raw = getRaw(key);
+    if (raw.empty()) {
+        return false;
+    }
+    auto res = from_chars(raw.data(), raw.data() + raw.size(), out);
+    return res.ec == errc() && res.ptr == raw.data() + raw.size();
+}
+
+bool JsonScan::getInt64(string_view key, int64_t& out) const {
+    string_view raw = getRaw(key);
+    if (raw.empty()) {
+        return false;
+    }
+    auto res = from_chars(raw.data(), raw.data() + raw.size(), out);
+    return res.ec == errc() && res.ptr == raw.data() + raw.size();
+}
+
+}  // namespace util
+}  // namespace m2cellcpp
+}  // namespace LSST
@@ -0,0 +1,111 @@
+// -*- LSST-C++ -*-
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#ifndef LSST_M2CELLCPP_UTIL_JSONSCAN_H
+#define LSST_M2CELLCPP_UTIL_JSONSCAN_H
+
+// System headers
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace LSST {
+namespace m2cellcpp {
+namespace util {
+
+/// This class scans the top level members of a json object without building
+/// a json tree or copying anything. The keys and values are views into the
+/// original text, so the text must outlive this object.
+/// It is meant for quickly finding values like "id" and "sequence_id" so that
+/// messages can be routed before, or instead of, a full parse.
+/// The whole text is checked against the json grammar, so text this accepts
+/// is also accepted by nlohmann::json::parse, and the other way around.
+/// Keys are compared as raw text, so keys containing escape sequences
+/// must be given in their escaped form. If a key appears more than once,
+/// the last value is used, as nlohmann::json does.
+/// Unit tests in tests/test_TelemetryClient.cpp, splitArray in tests/test_NetCommand.cpp
+class JsonScan {
+public:
+    using Member = std::pair<std::string_view, std::string_view>;
+
+    /// Scan `text`, which should contain a single json object.
+    explicit JsonScan(std::string_view text);
+
+    JsonScan() = delete;
+    JsonScan(JsonScan const&) = default;
+    JsonScan& operator=(JsonScan const&) = default;
+    ~JsonScan() = default;
+
+    /// Return true if `text` was a valid json object, with nothing but
+    /// whitespace after it.
+    bool isValid() const { return _valid; }
+
+    /// Return the raw text of the value for `key`, or an empty view if not found.
+    /// String values include their quotes.
+    std::string_view getRaw(std::string_view key) const;
+
+    /// Set `out` to the contents of the string value for `key`, without quotes.
+    /// Escape sequences are not converted, the contents are valid utf-8.
+    /// @return false if `key` was not found or the value is not a string.
+    bool getString(std::string_view key, std::string_view& out) const;
+
+    /// Set `out` to the unsigned integer value for `key`.
+    /// @return false if `key` was not found or the value is not an unsigned integer.
+    bool getUInt64(std::string_view key, uint64_t& out) const;
+
+    /// Set `out` to the integer value for `key`.
+    /// @return false if `key` was not found or the value is not an integer.
+    bool getInt64(std::string_view key, int64_t& out) const;
+
+    /// Return true if any top level key contains an escape sequence, in which
+    /// case two keys that look different may be the same key once unescaped.
+    bool hasEscapedKeys() const { return _escapedKeys; }
+
+    /// Return all top level members found.
+    std::vector<Member> const& getMembers() const { return _members; }
+
+    /// Return the original text.
+    std::string_view getText() const { return _text; }
+
+    /// Split `raw`, the text of a json array, into the raw text of its
+    /// elements, which are views into `raw`.
+    /// @return false if `raw` isn't a valid json array.
+    static bool splitArray(std::string_view raw, std::vector<std::string_view>& out);
+
+private:
+    /// Scan `_text` and fill in `_members`.
+    /// @return true if the scan succeeded.
+    bool _scan();
+
+    std::string_view _text;        ///< Original json text.
+    std::vector<Member> _members;  ///< Top level keys (without quotes) and raw values.
+    bool _valid = false;           ///< True if `_text` could be scanned.
+    bool _escapedKeys = false;     ///< True if a top level key contains an escape sequence.
+};
+
+}  // namespace util
+}  // namespace m2cellcpp
+}  // namespace LSST
+
+#endif  // LSST_M2CELLCPP_UTIL_JSONSCAN_H
@@ -0,0 +1,87 @@
+// -*- LSST-C++ -*-
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+// Class header
+#include "util/LaneCommandQueue.h"
+
+// System headers
+#include <algorithm>
+
+using namespace std;
+
+namespace LSST {
+namespace m2cellcpp {
+namespace util {
+
+LaneCommandQueue::LaneCommandQueue(unsigned int laneCount)
+        : _lanes(max(laneCount, 1u)), _waits(max(laneCount, 1u)) {}
+
+void LaneCommandQueue::queCmd(Command::Ptr const& cmd, unsigned int lane) {
+    lane = min<unsigned int>(lane, _lanes.size() - 1);
+    {
+        lock_guard<mutex> lock(_mx);
+        _lanes[lane].push_back({cmd, CLOCK::now()});
+        ++_count;
+    }
+    notify(false);
+}
+
+Command::Ptr LaneCommandQueue::getCmd(bool wait) {
+    unique_lock<mutex> lock(_mx);
+    if (wait) {
+        _cv.wait(lock, [this]() { return _count > 0; });
+    }
+    if (_count == 0) {
+        return nullptr;
+    }
+    for (size_t lane = _lanes.size(); lane-- > 0;) {
+        auto& que = _lanes[lane];
+        if (!que.empty()) {
+            Entry entry = move(que.front());
+            que.pop_front();
+            --_count;
+            auto waited = chrono::duration_cast<chrono::microseconds>(CLOCK::now() - entry.queued);
+            _waits[lane].record(waited.count());
+            return entry.cmd;
+        }
+    }
+    return nullptr;
+}
+
+size_t LaneCommandQueue::size() {
+    lock_guard<mutex> lock(_mx);
+    return _count;
+}
+
+size_t LaneCommandQueue::size(unsigned int lane) {
+    lock_guard<mutex> lock(_mx);
+    return (lane < _lanes.size()) ? _lanes[lane].size() : 0;
+}
+
+LatencyHistogram LaneCommandQueue::getWaitHistogram(unsigned int lane) const {
+    lock_guard<mutex> lock(_mx);
+    return (lane < _waits.size()) ? _waits[lane] : LatencyHistogram();
+}
+
+}  // namespace util
+}  // namespace m2cellcpp
+}  // namespace LSST
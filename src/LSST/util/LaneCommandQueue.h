@@ -0,0 +1,101 @@
+// -*- LSST-C++ -*-
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#ifndef LSST_M2CELLCPP_UTIL_LANECOMMANDQUEUE_H
+#define LSST_M2CELLCPP_UTIL_LANECOMMANDQUEUE_H
+
+// System headers
+#include <deque>
+#include <vector>
+
+// Project headers
+#include "util/clock_defs.h"
+#include "util/EventThread.h"
+#include "util/LatencyHistogram.h"
+
+namespace LSST {
+namespace m2cellcpp {
+namespace util {
+
+/// A `CommandQueue` with a separate fifo for each of `laneCount` lanes.
+/// `getCmd()` always returns the oldest `Command` from the highest numbered
+/// lane that isn't empty, so `Command`s in higher lanes go ahead of any
+/// waiting in lower lanes. `Command`s queued with the base `queCmd()` go in
+/// lane 0. The time each `Command` waited in the queue is recorded in a
+/// histogram for its lane.
+/// Unit tests in tests/test_CommandExecutor.cpp
+class LaneCommandQueue : public CommandQueue {
+public:
+    using Ptr = std::shared_ptr<LaneCommandQueue>;
+
+    static Ptr create(unsigned int laneCount) { return Ptr(new LaneCommandQueue(laneCount)); }
+
+    LaneCommandQueue() = delete;
+    LaneCommandQueue(LaneCommandQueue const&) = delete;
+    LaneCommandQueue& operator=(LaneCommandQueue const&) = delete;
+    ~LaneCommandQueue() override = default;
+
+    /// Queue `cmd` in lane 0.
+    void queCmd(Command::Ptr const& cmd) override { queCmd(cmd, 0); }
+
+    /// Queue `cmd` in `lane`, lanes past the last are put in the last lane.
+    void queCmd(Command::Ptr const& cmd, unsigned int lane);
+
+    /// @return the oldest command from the highest lane with any.
+    /// @param wait If true, wait until a command is available.
+    Command::Ptr getCmd(bool wait = true) override;
+
+    /// @return the number of commands in all lanes.
+    size_t size() override;
+
+    /// @return the number of commands in `lane`.
+    size_t size(unsigned int lane);
+
+    /// @return the number of lanes.
+    unsigned int getLaneCount() const { return _lanes.size(); }
+
+    /// @return a copy of the histogram of microseconds commands waited in `lane`.
+    LatencyHistogram getWaitHistogram(unsigned int lane) const;
+
+private:
+    explicit LaneCommandQueue(unsigned int laneCount);
+
+    /// A queued `Command` and the time it was queued.
+    struct Entry {
+        Command::Ptr cmd;
+        TIMEPOINT queued;
+    };
+
+    /// Fifo for each lane, protected by `_mx`.
+    std::vector<std::deque<Entry>> _lanes;
+
+    /// Time commands waited in each lane, protected by `_mx`.
+    std::vector<LatencyHistogram> _waits;
+
+    size_t _count = 0;  ///< Commands in all lanes, protected by `_mx`.
+};
+
+}  // namespace util
+}  // namespace m2cellcpp
+}  // namespace LSST
+
+#endif  // LSST_M2CELLCPP_UTIL_LANECOMMANDQUEUE_H
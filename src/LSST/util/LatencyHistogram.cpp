@@ -0,0 +1,106 @@
+// -*- LSST-C++ -*-
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+// Class header
+#include "util/LatencyHistogram.h"
+
+// System headers
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+using namespace std;
+
+namespace LSST {
+namespace m2cellcpp {
+namespace util {
+
+unsigned int LatencyHistogram::bucketFor(uint64_t micros) {
+    if (micros < SUB_BUCKETS) {
+        return micros;
+    }
+    if (micros > MAX_VALUE) {
+        return BUCKET_COUNT - 1;
+    }
+    // Position of the highest bit set, the next SUB_BUCKET_BITS bits pick the sub-bucket.
+    unsigned int exponent = 63 - __builtin_clzll(micros);
+    unsigned int shift = exponent - SUB_BUCKET_BITS;
+    unsigned int sub = (micros >> shift) & (SUB_BUCKETS - 1);
+    return SUB_BUCKETS + shift * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::bucketMax(unsigned int index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    unsigned int shift = (index - SUB_BUCKETS) / SUB_BUCKETS;
+    uint64_t sub = (index - SUB_BUCKETS) % SUB_BUCKETS;
+    uint64_t lower = (SUB_BUCKETS + sub) << shift;
+    return lower + (uint64_t(1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t micros) {
+    ++_buckets[bucketFor(micros)];
+    ++_count;
+    _sum += micros;
+    _min = min(_min, micros);
+    _max = max(_max, micros);
+}
+
+void LatencyHistogram::merge(LatencyHistogram const& other) {
+    for (unsigned int j = 0; j < BUCKET_COUNT; ++j) {
+        _buckets[j] += other._buckets[j];
+    }
+    _count += other._count;
+    _sum += other._sum;
+    _min = min(_min, other._min);
+    _max = max(_max, other._max);
+}
+
+void LatencyHistogram::reset() { *this = LatencyHistogram(); }
+
+uint64_t LatencyHistogram::getPercentile(double pct) const {
+    if (_count == 0) {
+        return 0;
+    }
+    pct = clamp(pct, 0.0, 100.0);
+    uint64_t target = max<uint64_t>(1, ceil(pct * _count / 100.0));
+    uint64_t seen = 0;
+    for (unsigned int j = 0; j < BUCKET_COUNT; ++j) {
+        seen += _buckets[j];
+        if (seen >= target) {
+            return min(bucketMax(j), _max);
+        }
+    }
+    return _max;
+}
+
+string LatencyHistogram::getSummary() const {
+    stringstream os;
+    os << "count=" << _count << " min=" << getMin() << " p50=" << getPercentile(50.0)
+       << " p90=" << getPercentile(90.0) << " p99=" << getPercentile(99.0) << " max=" << _max;
+    return os.str();
+}
+
+}  // namespace util
+}  // namespace m2cellcpp
+}  // namespace LSST
@@ -0,0 +1,103 @@
+// -*- LSST-C++ -*-
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#ifndef LSST_M2CELLCPP_UTIL_LATENCYHISTOGRAM_H
+#define LSST_M2CELLCPP_UTIL_LATENCYHISTOGRAM_H
+
+// System headers
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace LSST {
+namespace m2cellcpp {
+namespace util {
+
+/// A fixed size histogram of durations in microseconds with log-linear
+/// buckets, in the style of HdrHistogram. Every power of two is split into
+/// `SUB_BUCKETS` equal buckets, so percentiles are within about 12% of the
+/// true value from 1 microsecond up to `MAX_VALUE`. Larger values are
+/// counted in the last bucket.
+/// This class is not thread safe.
+/// Unit tests in tests/test_LatencyHistogram.cpp
+class LatencyHistogram {
+public:
+    /// log2 of the number of buckets per power of two.
+    static constexpr unsigned int SUB_BUCKET_BITS = 3;
+    static constexpr unsigned int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    /// Values with a higher bit set than this go in the last bucket.
+    static constexpr unsigned int MAX_EXPONENT = 36;
+    static constexpr uint64_t MAX_VALUE = (uint64_t(1) << (MAX_EXPONENT + 1)) - 1;
+    static constexpr unsigned int BUCKET_COUNT = SUB_BUCKETS * (MAX_EXPONENT - SUB_BUCKET_BITS + 2);
+
+    LatencyHistogram() = default;
+    LatencyHistogram(LatencyHistogram const&) = default;
+    LatencyHistogram& operator=(LatencyHistogram const&) = default;
+    ~LatencyHistogram() = default;
+
+    /// Add a duration of `micros` microseconds.
+    void record(uint64_t micros);
+
+    /// Add all of the values recorded in `other`.
+    void merge(LatencyHistogram const& other);
+
+    /// Remove all recorded values.
+    void reset();
+
+    /// Return the number of values recorded.
+    uint64_t getCount() const { return _count; }
+
+    /// Return the smallest value recorded, 0 if there are none.
+    uint64_t getMin() const { return (_count == 0) ? 0 : _min; }
+
+    /// Return the largest value recorded.
+    uint64_t getMax() const { return _max; }
+
+    /// Return the mean of the values recorded, 0 if there are none.
+    double getMean() const { return (_count == 0) ? 0.0 : double(_sum) / _count; }
+
+    /// Return the value at or below which `pct` percent of the values fall,
+    /// given as the highest value in that value's bucket, but no more than `getMax()`.
+    uint64_t getPercentile(double pct) const;
+
+    /// Return a short summary "count=N min=.. p50=.. p90=.. p99=.. max=..".
+    std::string getSummary() const;
+
+    /// Return the bucket index for `micros`.
+    static unsigned int bucketFor(uint64_t micros);
+
+    /// Return the highest value that goes in bucket `index`.
+    static uint64_t bucketMax(unsigned int index);
+
+private:
+    std::array<uint64_t, BUCKET_COUNT> _buckets{};  ///< Count of values in each bucket.
+    uint64_t _count = 0;                            ///< Number of values recorded.
+    uint64_t _sum = 0;                              ///< Sum of values recorded.
+    uint64_t _min = UINT64_MAX;                     ///< Smallest value recorded.
+    uint64_t _max = 0;                              ///< Largest value recorded.
+};
+
+}  // namespace util
+}  // namespace m2cellcpp
+}  // namespace LSST
+
+#endif  // LSST_M2CELLCPP_UTIL_LATENCYHISTOGRAM_H
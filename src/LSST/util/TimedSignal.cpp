@@ -0,0 +1,176 @@
+// -*- LSST-C++ -*-
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+// Class header
+#include "util/TimedSignal.h"
+
+// System headers
+#include <algorithm>
+#include <sstream>
+
+// Project headers
+#include "util/Log.h"
+
+using namespace std;
+
+namespace LSST {
+namespace m2cellcpp {
+namespace util {
+
+string TimedSignal::Result::dump() const {
+    stringstream os;
+    os << "val=" << val << " ageSec=" << ageSec << " valid=" << valid << " stale=" << stale;
+    return os.str();
+}
+
+TimedSignal::TimedSignal(string const& name, size_t capacity, double staleLimitSec,
+                         double maxExtrapolationSec)
+        : _name(name),
+          _ring(max(capacity, size_t(2))),
+          _staleLimitSec(staleLimitSec),
+          _maxExtrapolationSec(maxExtrapolationSec) {}
+
+TimedSignal::Sample const& TimedSignal::_at(size_t index) const {
+    size_t const cap = _ring.size();
+    size_t oldest = (_head + cap - _count) % cap;
+    return _ring[(oldest + index) % cap];
+}
+
+bool TimedSignal::addSample(double val, TIMEPOINT tm) {
+    lock_guard<mutex> lg(_mtx);
+    if (_count > 0 && tm < _at(_count - 1).tm) {
+        LWARN("TimedSignal::addSample ", _name, " ignoring out of order sample");
+        return false;
+    }
+    _ring[_head].val = val;
+    _ring[_head].tm = tm;
+    _head = (_head + 1) % _ring.size();
+    if (_count < _ring.size()) {
+        ++_count;
+    }
+    return true;
+}
+
+TimedSignal::Result TimedSignal::getValueAt(TIMEPOINT tm, Mode mode) const {
+    Result res;
+    lock_guard<mutex> lg(_mtx);
+    if (_count == 0) {
+        return res;
+    }
+    res.valid = true;
+    Sample const& newest = _at(_count - 1);
+    res.ageSec = timePassedSec(newest.tm, tm);
+    res.stale = res.ageSec > _staleLimitSec;
+
+    // Before the oldest sample, there's nothing better than the oldest value.
+    Sample const& oldest = _at(0);
+    if (tm <= oldest.tm) {
+        res.val = oldest.val;
+        return res;
+    }
+
+    if (_count == 1 || mode == HOLD) {
+        // Use the newest sample at or before `tm`.
+        size_t idx = _count - 1;
+        while (idx > 0 && _at(idx).tm > tm) {
+            --idx;
+        }
+        res.val = _at(idx).val;
+        return res;
+    }
+
+    // Find the samples `a` and `b` that bracket `tm`. If `tm` is after the
+    // newest sample, `a` and `b` are the last two samples.
+    size_t idxB = 1;
+    while (idxB < _count - 1 && _at(idxB).tm < tm) {
+        ++idxB;
+    }
+    Sample const& a = _at(idxB - 1);
+    Sample const& b = _at(idxB);
+    double const span = timePassedSec(a.tm, b.tm);
+    if (span <= 0.0) {
+        res.val = b.val;
+        return res;
+    }
+    // Limit extrapolation past `b` to `_maxExtrapolationSec`.
+    double dt = timePassedSec(a.tm, tm);
+    dt = min(dt, span + _maxExtrapolationSec);
+    res.val = a.val + (b.val - a.val) * (dt / span);
+    return res;
+}
+
+bool TimedSignal::checkStale(TIMEPOINT tm) {
+    StaleCallback func;
+    bool stale;
+    string msg;
+    {
+        lock_guard<mutex> lg(_mtx);
+        if (_count == 0) {
+            return false;
+        }
+        double ageSec = timePassedSec(_at(_count - 1).tm, tm);
+        stale = ageSec > _staleLimitSec;
+        if (stale == _stale) {
+            return stale;
+        }
+        _stale = stale;
+        func = _staleCallback;
+        msg = _name + " ageSec=" + to_string(ageSec) + " staleLimitSec=" + to_string(_staleLimitSec);
+    }
+    LINFO("TimedSignal::checkStale stale=", stale, " ", msg);
+    if (func != nullptr) {
+        func(stale, msg);
+    }
+    return stale;
+}
+
+void TimedSignal::setStaleCallback(StaleCallback const& func) {
+    lock_guard<mutex> lg(_mtx);
+    _staleCallback = func;
+}
+
+void TimedSignal::setStaleLimitSec(double staleLimitSec) {
+    lock_guard<mutex> lg(_mtx);
+    _staleLimitSec = staleLimitSec;
+}
+
+double TimedSignal::getStaleLimitSec() const {
+    lock_guard<mutex> lg(_mtx);
+    return _staleLimitSec;
+}
+
+size_t TimedSignal::size() const {
+    lock_guard<mutex> lg(_mtx);
+    return _count;
+}
+
+string TimedSignal::dump() const {
+    stringstream os;
+    lock_guard<mutex> lg(_mtx);
+    os << "TimedSignal " << _name << " count=" << _count << " staleLimitSec=" << _staleLimitSec
+       << " maxExtrapolationSec=" << _maxExtrapolationSec << " stale=" << _stale;
+    return os.str();
+}
+
+}  // namespace util
+}  // namespace m2cellcpp
+}  // namespace LSST
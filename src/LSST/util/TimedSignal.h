@@ -0,0 +1,146 @@
+// -*- LSST-C++ -*-
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#ifndef LSST_M2CELLCPP_UTIL_TIMEDSIGNAL_H
+#define LSST_M2CELLCPP_UTIL_TIMEDSIGNAL_H
+
+// System headers
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Project headers
+#include "util/clock_defs.h"
+
+namespace LSST {
+namespace m2cellcpp {
+namespace util {
+
+/// This class keeps a small ring buffer of timestamped samples for a single
+/// signal that arrives asynchronously, such as `tel_elevation` from the
+/// telemetry socket. Control code can ask for the value of the signal at
+/// a specific time (usually the current control tick) and the value is
+/// interpolated between samples, or extrapolated past the newest sample.
+/// Extrapolation is limited to `_maxExtrapolationSec` past the newest sample,
+/// after which the value is held.
+/// If the newest sample is older than `_staleLimitSec`, the signal is stale.
+/// Unit tests in tests/test_TelemetryCom.cpp
+class TimedSignal {
+public:
+    using Ptr = std::shared_ptr<TimedSignal>;
+
+    /// Function called when the signal changes between stale and not stale.
+    /// `stale` is the new state, `msg` has information about the change.
+    using StaleCallback = std::function<void(bool stale, std::string const& msg)>;
+
+    /// How values are determined between and beyond samples.
+    enum Mode {
+        HOLD = 0,   ///< Use the value of the newest sample at or before the requested time.
+        LINEAR = 1  ///< Linear interpolation between samples, or extrapolation from the last two.
+    };
+
+    /// A single value and the time it was received.
+    struct Sample {
+        double val = 0.0;  ///< Value of the signal.
+        TIMEPOINT tm;      ///< Time the value was received.
+    };
+
+    /// Result of `getValueAt`.
+    struct Result {
+        double val = 0.0;     ///< Value of the signal at the requested time.
+        double ageSec = 0.0;  ///< Time in seconds between the newest sample and the requested time.
+        bool valid = false;   ///< False if there were no samples to use.
+        bool stale = true;    ///< True if `ageSec` > the stale limit or there were no samples.
+
+        /// Return a log worthy string version of this object.
+        std::string dump() const;
+    };
+
+    /// Create a TimedSignal.
+    /// @param `name` - name of the signal for log messages.
+    /// @param `capacity` - maximum number of samples kept, minimum of 2.
+    /// @param `staleLimitSec` - the signal is stale if the newest sample is older than this.
+    /// @param `maxExtrapolationSec` - maximum time past the newest sample to extrapolate.
+    TimedSignal(std::string const& name, size_t capacity, double staleLimitSec, double maxExtrapolationSec);
+
+    TimedSignal() = delete;
+    TimedSignal(TimedSignal const&) = delete;
+    TimedSignal& operator=(TimedSignal const&) = delete;
+    ~TimedSignal() = default;
+
+    /// Add a sample with value `val` that was received at `tm`.
+    /// Samples older than the newest sample are ignored, as they would be
+    /// out of order.
+    /// @return true if the sample was added.
+    bool addSample(double val, TIMEPOINT tm);
+
+    /// Return the value of the signal at `tm` using `mode`.
+    Result getValueAt(TIMEPOINT tm, Mode mode) const;
+
+    /// Check if the signal is stale at `tm` and call `_staleCallback` if the
+    /// stale state changed. The signal cannot become stale until at least
+    /// one sample has been received, so feeds that were never connected do not
+    /// trigger the callback.
+    /// @return true if the signal is stale.
+    bool checkStale(TIMEPOINT tm);
+
+    /// Set the function to call when the stale state changes.
+    void setStaleCallback(StaleCallback const& func);
+
+    /// Set the stale limit to `staleLimitSec`.
+    void setStaleLimitSec(double staleLimitSec);
+
+    /// Return the stale limit in seconds.
+    double getStaleLimitSec() const;
+
+    /// Return the number of samples in the buffer.
+    size_t size() const;
+
+    /// Return the name of the signal.
+    std::string getName() const { return _name; }
+
+    /// Return a log worthy string version of this object.
+    std::string dump() const;
+
+private:
+    /// Return the sample at `index`, where 0 is the oldest sample in the buffer.
+    /// `_mtx` must be held before calling.
+    Sample const& _at(size_t index) const;
+
+    std::string const _name;            ///< Name of the signal.
+    std::vector<Sample> _ring;          ///< Ring buffer of samples.
+    size_t _head = 0;                   ///< Index in `_ring` where the next sample will go.
+    size_t _count = 0;                  ///< Number of valid samples in `_ring`.
+    double _staleLimitSec;              ///< Maximum age of the newest sample before it is stale.
+    double const _maxExtrapolationSec;  ///< Maximum time to extrapolate past the newest sample.
+    bool _stale = false;                ///< Stale state last reported by `checkStale`.
+    StaleCallback _staleCallback;       ///< Called when `_stale` changes.
+    mutable std::mutex _mtx;            ///< Protects all members.
+};
+
+}  // namespace util
+}  // namespace m2cellcpp
+}  // namespace LSST
+
+#endif  // LSST_M2CELLCPP_UTIL_TIMEDSIGNAL_H
@@ -0,0 +1,65 @@
+// -*- LSST-C++ -*-
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+// Class header
+#include "util/TokenBucket.h"
+
+// System headers
+#include <algorithm>
+
+using namespace std;
+
+namespace LSST {
+namespace m2cellcpp {
+namespace util {
+
+TokenBucket::TokenBucket(double rate, double burst, TIMEPOINT now)
+        : _rate(max(rate, 0.0)), _burst(max(burst, 1.0)), _tokens(_burst), _last(now) {}
+
+void TokenBucket::_refill(TIMEPOINT now) {
+    if (now <= _last) {
+        return;
+    }
+    _tokens = min(_burst, _tokens + timePassedSec(_last, now) * _rate);
+    _last = now;
+}
+
+bool TokenBucket::take(TIMEPOINT now) {
+    if (!isLimited()) {
+        return true;
+    }
+    _refill(now);
+    if (_tokens < 1.0) {
+        return false;
+    }
+    _tokens -= 1.0;
+    return true;
+}
+
+double TokenBucket::getTokens(TIMEPOINT now) {
+    _refill(now);
+    return _tokens;
+}
+
+}  // namespace util
+}  // namespace m2cellcpp
+}  // namespace LSST
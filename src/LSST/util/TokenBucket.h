@@ -0,0 +1,77 @@
+// -*- LSST-C++ -*-
+/*
+ *  This file is part of LSST M2 support system package.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#ifndef LSST_M2CELLCPP_UTIL_TOKENBUCKET_H
+#define LSST_M2CELLCPP_UTIL_TOKENBUCKET_H
+
+// Project headers
+#include "util/clock_defs.h"
+
+namespace LSST {
+namespace m2cellcpp {
+namespace util {
+
+/// A token bucket rate limiter. The bucket holds up to `burst` tokens and
+/// is refilled at `rate` tokens per second, each `take()` uses one token.
+/// A `rate` of 0 means there is no limit.
+/// This class is not thread safe.
+/// Unit tests in tests/test_TokenBucket.cpp
+class TokenBucket {
+public:
+    /// Create a full bucket.
+    /// @param rate tokens added per second, 0 for no limit.
+    /// @param burst maximum tokens in the bucket, at least 1.
+    TokenBucket(double rate, double burst, TIMEPOINT now = CLOCK::now());
+
+    TokenBucket() = delete;
+    TokenBucket(TokenBucket const&) = default;
+    TokenBucket& operator=(TokenBucket const&) = default;
+    ~TokenBucket() = default;
+
+    /// Take a token if one is available at `now`.
+    /// @return false if the bucket is empty.
+    bool take(TIMEPOINT now = CLOCK::now());
+
+    /// @return the number of tokens available at `now`.
+    double getTokens(TIMEPOINT now = CLOCK::now());
+
+    /// @return true if there is a limit.
+    bool isLimited() const { return _rate > 0.0; }
+
+    double getRate() const { return _rate; }
+    double getBurst() const { return _burst; }
+
+private:
+    /// Add the tokens earned since `_last`.
+    void _refill(TIMEPOINT now);
+
+    double _rate;     ///< Tokens added per second.
+    double _burst;    ///< Maximum number of tokens.
+    double _tokens;   ///< Tokens available at `_last`.
+    TIMEPOINT _last;  ///< Time `_tokens` was last updated.
+};
+
+}  // namespace util
+}  // namespace m2cellcpp
+}  // namespace LSST
+
+#endif  // LSST_M2CELLCPP_UTIL_TOKENBUCKET_H
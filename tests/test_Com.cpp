@@ -23,8 +23,10 @@
 #define CATCH_CONFIG_MAIN
 
 // System headers
+#include <cstdio>
 #include <exception>
 #include <thread>
+#include <vector>
 
 // 3rd party headers
 #include <boost/asio.hpp>
@@ -74,6 +76,14 @@ TEST_CASE("Test Com echo", "[Com]") {
     IoContextPtr ioContext = make_shared<boost::asio::io_context>();
     int port = Config::get().getControlServerPort();
     auto serv = ComServer::create(ioContext, port);
+    REQUIRE(serv->getPort() == port);
+    {
+        // Port 0 listens on an ephemeral port.
+        IoContextPtr ephIoContext = make_shared<boost::asio::io_context>();
+        auto ephServ = ComServer::create(ephIoContext, 0);
+        REQUIRE(ephServ->getPort() > 0);
+        REQUIRE(ephServ->getPort() != port);
+    }
     atomic<bool> done{false};
     REQUIRE(serv->getState() == ComServer::CREATED);
     serv->setDoSendWelcomeMsgServ(false);
@@ -131,6 +141,148 @@ TEST_CASE("Test Com echo", "[Com]") {
         }
     }
 
+    // Broadcasts from several threads at once must arrive whole and in
+    // the order each thread sent them.
+    {
+        ComClient client(ioContext, "127.0.0.1", port);
+        // A command round trip makes sure the server is tracking the connection.
+        string cmd("before broadcast");
+        client.writeCommand(cmd);
+        REQUIRE(ComConnection::makeTestAck(cmd) == client.readCommand());
+        REQUIRE(ComConnection::makeTestFinal(cmd) == client.readCommand());
+        int const threadCount = 4;
+        int const msgCount = 250;
+        vector<thread> writers;
+        for (int t = 0; t < threadCount; ++t) {
+            writers.emplace_back([serv, t]() {
+                for (int j = 0; j < msgCount; ++j) {
+                    serv->asyncWriteToAllComConn("bcast " + to_string(t) + " " + to_string(j));
+                }
+            });
+        }
+        vector<int> next(threadCount, 0);
+        bool inOrder = true;
+        for (int j = 0; j < threadCount * msgCount; ++j) {
+            string msg = client.readCommand();
+            int t = -1;
+            int n = -1;
+            sscanf(msg.c_str(), "bcast %d %d", &t, &n);
+            inOrder = inOrder && t >= 0 && t < threadCount && n == next[t];
+            if (t >= 0 && t < threadCount) {
+                ++next[t];
+            }
+        }
+        for (auto& thrd : writers) {
+            thrd.join();
+        }
+        REQUIRE(inOrder);
+    }
+
+    // One broadcast buffer is shared by every connection.
+    {
+        auto buf = ComConnection::makeBuffer("shared");
+        REQUIRE(*buf == "shared" + ComConnection::getDelimiter());
+        ComClient clientA(ioContext, "127.0.0.1", port);
+        ComClient clientB(ioContext, "127.0.0.1", port);
+        for (auto client : {&clientA, &clientB}) {
+            string cmd("before shared broadcast");
+            client->writeCommand(cmd);
+            REQUIRE(ComConnection::makeTestAck(cmd) == client->readCommand());
+            REQUIRE(ComConnection::makeTestFinal(cmd) == client->readCommand());
+        }
+        serv->asyncWriteToAllComConn(buf);
+        REQUIRE(clientA.readCommand() == "shared");
+        REQUIRE(clientB.readCommand() == "shared");
+        // Only this test holds the buffer once it has been written.
+        for (int j = 0; buf.use_count() != 1 && j < 100; ++j) {
+            this_thread::sleep_for(10ms);
+        }
+        REQUIRE(buf.use_count() == 1);
+    }
+
+    // Commands past a connection's rate limit get a busy response.
+    {
+        serv->setCommandRateLimit(0.5, 2.0);
+        ComClient client(ioContext, "127.0.0.1", port);
+        for (int j = 0; j < 2; ++j) {
+            string cmd("limited " + to_string(j));
+            client.writeCommand(cmd);
+            REQUIRE(ComConnection::makeTestAck(cmd) == client.readCommand());
+            REQUIRE(ComConnection::makeTestFinal(cmd) == client.readCommand());
+        }
+        for (int j = 2; j < 4; ++j) {
+            string cmd("limited " + to_string(j));
+            client.writeCommand(cmd);
+            REQUIRE(ComConnection::makeTestBusy(cmd) == client.readCommand());
+        }
+        REQUIRE(serv->getRateLimitedCount() == 2);
+        serv->setCommandRateLimit(0.0, 1.0);
+    }
+
+    // Connections past the maximum are closed.
+    {
+        for (int j = 0; serv->connectionCount() != 0 && j < 100; ++j) {
+            this_thread::sleep_for(10ms);
+        }
+        REQUIRE(serv->connectionCount() == 0);
+        unsigned int maxConn = serv->getMaxConnections();
+        serv->setMaxConnections(1);
+        ComClient clientA(ioContext, "127.0.0.1", port);
+        string cmd("only connection");
+        clientA.writeCommand(cmd);
+        REQUIRE(ComConnection::makeTestAck(cmd) == clientA.readCommand());
+        REQUIRE(ComConnection::makeTestFinal(cmd) == clientA.readCommand());
+        ComClient clientB(ioContext, "127.0.0.1", port);
+        REQUIRE_THROWS(clientB.readCommand());
+        REQUIRE(serv->getRejectedConnectionCount() == 1);
+        REQUIRE(serv->connectionCount() == 1);
+        serv->setMaxConnections(maxConn);
+    }
+
+    // A quiet connection gets heartbeats, and is closed when the client sends nothing.
+    {
+        serv->setConnectionTimeouts(300ms, 50ms, 0ms);
+        ComClient client(ioContext, "127.0.0.1", port);
+        string cmd("before heartbeat");
+        client.writeCommand(cmd);
+        REQUIRE(ComConnection::makeTestAck(cmd) == client.readCommand());
+        REQUIRE(ComConnection::makeTestFinal(cmd) == client.readCommand());
+        auto start = util::CLOCK::now();
+        int heartbeats = 0;
+        bool onlyHeartbeats = true;
+        try {
+            while (true) {
+                onlyHeartbeats = onlyHeartbeats && client.readCommand() == ComConnection::HEARTBEAT_MSG;
+                ++heartbeats;
+            }
+        } catch (boost::system::system_error const& ex) {
+            LDEBUG("idle connection closed ", ex.what());
+        }
+        REQUIRE(onlyHeartbeats);
+        REQUIRE(heartbeats >= 2);
+        REQUIRE(util::CLOCK::now() - start < 2s);
+        REQUIRE(serv->getIdleTimeoutCount() == 1);
+        serv->setConnectionTimeouts(0ms, 0ms, 0ms);
+    }
+
+    // The heartbeat timer doesn't spin while a write is stuck because the client stopped reading.
+    {
+        serv->setConnectionTimeouts(0ms, 50ms, 0ms);
+        ComClient client(ioContext, "127.0.0.1", port);
+        string cmd("before stalled write");
+        client.writeCommand(cmd);
+        REQUIRE(ComConnection::makeTestAck(cmd) == client.readCommand());
+        REQUIRE(ComConnection::makeTestFinal(cmd) == client.readCommand());
+        // Much more than the socket buffers hold, and the client never reads it.
+        serv->asyncWriteToAllComConn(ComConnection::makeBuffer(string(64 * 1024 * 1024, 'x')));
+        this_thread::sleep_for(100ms);
+        uint64_t checks = serv->getHeartbeatCheckCount();
+        this_thread::sleep_for(500ms);
+        // About one check per interval, not one per millisecond.
+        REQUIRE(serv->getHeartbeatCheckCount() - checks <= 15);
+        serv->setConnectionTimeouts(0ms, 0ms, 0ms);
+    }
+
     serv->shutdown();
     REQUIRE(serv->connectionCount() == 0);
 
@@ -157,4 +309,47 @@ TEST_CASE("Test Com echo", "[Com]") {
     REQUIRE(serv->getState() == ComServer::STOPPED);
     serv.reset();
     LDEBUG("server reset");
+
+    // The same echo with an io_context for each server thread, and several
+    // acceptors sharing the port with SO_REUSEPORT.
+    {
+        IoContextPtr acceptIoContext = make_shared<boost::asio::io_context>();
+        auto ptServ = ComServer::create(acceptIoContext, 0);
+        ptServ->setDoSendWelcomeMsgServ(false);
+        ptServ->setIoContextPerThread(true);
+        REQUIRE(ptServ->getIoContextPerThread());
+        REQUIRE(ptServ->getAcceptorCount() == 1);
+        REQUIRE(ptServ->getAcceptBacklog() == Config::get().getControlServerAcceptBacklog());
+        ptServ->setAcceptorCount(3);
+        REQUIRE(ptServ->getAcceptorCount() == 3);
+        int ptPort = ptServ->getPort();
+        thread ptThrd([ptServ]() { ptServ->run(); });
+        for (int j = 0; (ptServ->getState() != ComServer::RUNNING) && j < 10; ++j) {
+            sleep(1);
+        }
+        REQUIRE(ptServ->getState() == ComServer::RUNNING);
+        {
+            // More clients than threads, so some threads have several connections.
+            vector<shared_ptr<ComClient>> clients;
+            for (int j = 0; j < 2 * Config::get().getControlServerThreads(); ++j) {
+                clients.push_back(make_shared<ComClient>(acceptIoContext, "127.0.0.1", ptPort));
+            }
+            for (int round = 0; round < 3; ++round) {
+                for (size_t j = 0; j < clients.size(); ++j) {
+                    string cmd = "per thread " + to_string(j) + " " + to_string(round);
+                    clients[j]->writeCommand(cmd);
+                    REQUIRE(clients[j]->readCommand() == ComConnection::makeTestAck(cmd));
+                    REQUIRE(clients[j]->readCommand() == ComConnection::makeTestFinal(cmd));
+                }
+            }
+            REQUIRE(ptServ->connectionCount() == int(clients.size()));
+            REQUIRE(ptServ->getAcceptedCount() == clients.size());
+            REQUIRE(ptServ->getPort() == ptPort);
+        }
+        ptServ->shutdown();
+        // Stopping the accepting io_context stops the others.
+        acceptIoContext->stop();
+        ptThrd.join();
+        REQUIRE(ptServ->getState() == ComServer::STOPPED);
+    }
 }
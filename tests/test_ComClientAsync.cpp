@@ -0,0 +1,181 @@
+/*
+ * This file is part of LSST ts_m2cellcpp test suite.
+ *
+ * Developed for the Vera C. Rubin Observatory Telescope & Site Software Systems.
+ * This product includes software developed by the Vera C.Rubin Observatory Project
+ * (https://www.lsst.org). See the COPYRIGHT file at the top-level directory of
+ * this distribution for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define CATCH_CONFIG_MAIN
+
+// System headers
+#include <future>
+#include <thread>
+#include <vector>
+
+// 3rd party headers
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_session.hpp>
+
+// Project headers
+#include "control/Context.h"
+#include "control/FpgaIo.h"
+#include "control/MotionEngine.h"
+#include "control/PowerSystem.h"
+#include "faultmgr/FaultMgr.h"
+#include "simulator/SimCore.h"
+#include "system/ComClientAsync.h"
+#include "system/ComControlServer.h"
+#include "system/Config.h"
+#include "system/Globals.h"
+#include "util/Log.h"
+
+using namespace std;
+using namespace LSST::m2cellcpp::system;
+using namespace LSST::m2cellcpp;
+
+TEST_CASE("Test ComClientAsync", "[ComClientAsync]") {
+    util::Log::getLog().useEnvironmentLogLvl();
+    string cfgPath = Config::getEnvironmentCfgPath("../configs");
+    Config::setup(cfgPath + "unitTestCfg.yaml");
+    Globals::setup(Config::get());
+
+    simulator::SimCore::Ptr simCore(new LSST::m2cellcpp::simulator::SimCore());
+    faultmgr::FaultMgr::setup();
+    control::FpgaIo::setup(simCore);
+    control::MotionEngine::setup();
+    control::Context::setup();
+
+    // Power system and FpgaIo timeouts are not useful in this, turn them off.
+    control::Context::Ptr context = control::Context::get();
+    context->model.getPowerSystem()->stopTimeoutLoop();
+    control::FpgaIo::getPtr()->stopLoop();
+    control::MotionEngine::getPtr()->engineStop();
+
+    // Start a ComControlServer
+    IoContextPtr ioContext = make_shared<boost::asio::io_context>();
+    int port = Config::get().getControlServerPort();
+    auto cmdFactory = control::NetCommandFactory::create();
+    ComControl::setupNormalFactory(cmdFactory);
+    auto serv = ComControlServer::create(ioContext, port, cmdFactory);
+    serv->setNetStatsInterval(chrono::seconds(1));
+
+    atomic<bool> done{false};
+    thread servThrd([&serv, &done]() {
+        serv->run();
+        done = true;
+    });
+    for (int j = 0; (serv->getState() != ComServer::RUNNING) && j < 10; ++j) {
+        sleep(1);
+    }
+    REQUIRE(serv->getState() == ComServer::RUNNING);
+
+    auto client = ComClientAsync::create(ioContext, "127.0.0.1", port);
+    auto timeout = chrono::milliseconds(5000);
+
+    // The welcome message is queued by "id".
+    auto welcomeJ = client->waitForId("summaryFaultsStatus", timeout);
+    REQUIRE(welcomeJ["id"] == "summaryFaultsStatus");
+    REQUIRE(client->getQueuedCount("summaryFaultsStatus") == 0);
+    REQUIRE(client->waitForId("notAnId", chrono::milliseconds(10)).is_null());
+
+    {
+        auto sendTime = util::CLOCK::now();
+        auto resp = client->send(R"({"id":"cmd_ack","sequence_id": 1 })", 1);
+        auto ackJ = resp.ack.get();
+        auto finJ = resp.fin.get();
+        REQUIRE(ackJ["id"] == "ack");
+        REQUIRE(finJ["sequence_id"] == 1);
+        REQUIRE(finJ["id"] == "success");
+        REQUIRE(resp.readTimes->ack >= sendTime);
+        REQUIRE(resp.readTimes->fin >= resp.readTimes->ack);
+    }
+    {
+        auto resp = client->send(R"({"id":"cmd_ak","sequence_id": 2 })", 2);
+        REQUIRE(resp.ack.get()["id"] == "noack");
+        REQUIRE(resp.fin.get()["id"] == "fail");
+    }
+
+    // Several threads sending at once, all responses go to the right futures.
+    {
+        int const threadCount = 4;
+        int const perThread = 20;
+        atomic<int> nextSeqId{3};
+        atomic<bool> allGood{true};
+        vector<thread> senders;
+        for (int t = 0; t < threadCount; ++t) {
+            senders.emplace_back([&]() {
+                vector<pair<int, ComClientAsync::Responses>> sent;
+                for (int j = 0; j < perThread; ++j) {
+                    // The server requires increasing sequence_ids, so
+                    // the id and the write must not be separated.
+                    static mutex seqMtx;
+                    lock_guard<mutex> lg(seqMtx);
+                    int seqId = nextSeqId++;
+                    string jStr = R"({"id":"cmd_echo","sequence_id":)" + to_string(seqId) +
+                                  R"(, "msg":"async )" + to_string(seqId) + R"("})";
+                    sent.emplace_back(seqId, client->send(jStr, seqId));
+                }
+                for (auto& [seqId, resp] : sent) {
+                    auto ackJ = resp.ack.get();
+                    auto finJ = resp.fin.get();
+                    if (ackJ["id"] != "ack" || finJ["msg"] != "async " + to_string(seqId)) {
+                        allGood = false;
+                    }
+                }
+            });
+        }
+        for (auto& thrd : senders) {
+            thrd.join();
+        }
+        REQUIRE(allGood);
+        REQUIRE(client->getPendingCount() == 0);
+    }
+
+    // Network statistics from the command and the periodic message.
+    {
+        auto resp = client->send(R"({"id":"cmd_getNetStats","sequence_id": 100 })", 100);
+        REQUIRE(resp.ack.get()["id"] == "ack");
+        auto finJ = resp.fin.get();
+        REQUIRE(finJ["id"] == "success");
+        auto servJ = finJ["netStats"][serv->getNetStatsName()];
+        REQUIRE(servJ["total"]["msgsIn"] >= 83);
+        REQUIRE(servJ["total"]["msgsOut"] >= 2 * 82);
+        REQUIRE(servJ["connections"].size() == 1);
+        REQUIRE(servJ["connections"][0]["connId"].is_number());
+        REQUIRE(servJ["connections"][0]["tcp"]["rttMicros"].is_number());
+
+        auto statsJ = client->waitForId("netStats", timeout);
+        REQUIRE(statsJ["id"] == "netStats");
+        REQUIRE(statsJ["servers"].contains(serv->getNetStatsName()));
+    }
+
+    // Losing the connection fails anything still waiting.
+    serv->shutdown();
+    for (int j = 0; client->isConnected() && j < 50; ++j) {
+        this_thread::sleep_for(chrono::milliseconds(100));
+    }
+    REQUIRE_FALSE(client->isConnected());
+    REQUIRE_THROWS(client->send(R"({"id":"cmd_ack","sequence_id": 500 })", 500));
+    client->close();
+
+    ioContext->stop();
+    for (int j = 0; !done && j < 10; ++j) {
+        sleep(1);
+    }
+    servThrd.join();
+}
@@ -42,6 +42,54 @@ using namespace std;
 using namespace LSST::m2cellcpp::system;
 using namespace LSST::m2cellcpp;
 
+namespace {
+
+/// The "sequence_id" of each `NCmdTestSleep` in the order they finished.
+mutex sleepMtx;
+vector<uint64_t> sleepFinished;
+
+/// Command for testing that sleeps for "ms" milliseconds and then records
+/// its "sequence_id" in `sleepFinished`. It's only independent when "independent"
+/// is true, otherwise it's treated like a command that changes something.
+class NCmdTestSleep : public control::NetCommand {
+public:
+    struct Params {
+        int ms = 0;
+        bool independent = false;
+    };
+
+    static Ptr createFactoryVersion() { return Ptr(new NCmdTestSleep()); }
+
+    std::string getCommandName() const override { return "cmd_testSleep"; }
+
+    bool isIndependent() const override { return _params.independent; }
+
+    NetCommand::Ptr createNewNetCommand(control::NetCommandArgs const& args) override {
+        return Ptr(new NCmdTestSleep(args));
+    }
+
+protected:
+    bool action() override {
+        this_thread::sleep_for(chrono::milliseconds(_params.ms));
+        lock_guard<mutex> lg(sleepMtx);
+        sleepFinished.push_back(getSeqId());
+        return true;
+    }
+
+private:
+    NCmdTestSleep(control::NetCommandArgs const& args) : NetCommand(args) {
+        static constexpr array<control::NetField<Params>, 2> fields{
+                {{"ms", &Params::ms}, {"independent", &Params::independent}}};
+        args.decode(fields, _params);
+        setAckId("ack");
+    }
+    NCmdTestSleep() : NetCommand() {}
+
+    Params _params;
+};
+
+}  // namespace
+
 TEST_CASE("Test ComControl", "[ComControl]") {
     util::Log::getLog().useEnvironmentLogLvl();
     string cfgPath = Config::getEnvironmentCfgPath("../configs");
@@ -65,6 +113,7 @@ TEST_CASE("Test ComControl", "[ComControl]") {
     int port = Config::get().getControlServerPort();
     auto cmdFactory = control::NetCommandFactory::create();
     ComControl::setupNormalFactory(cmdFactory);
+    cmdFactory->addNetCommand(NCmdTestSleep::createFactoryVersion());
     auto serv = ComControlServer::create(ioContext, port, cmdFactory);
 
     atomic<bool> done{false};
@@ -88,6 +137,26 @@ TEST_CASE("Test ComControl", "[ComControl]") {
         int welcomeCount = client.readWelcomeMsg();
         LDEBUG("welcomeCount=", welcomeCount);
         REQUIRE(welcomeCount == 16);
+
+        // Another connection gets the same cached welcome message.
+        auto welcomeMsg = serv->getWelcomeMsg();
+        uint64_t builds = welcomeMsg->getBuildCount();
+        REQUIRE(builds >= 1);
+        {
+            ComClient client2(ioContext, "127.0.0.1", port);
+            REQUIRE(client2.readWelcomeMsg() == 16);
+        }
+        REQUIRE(welcomeMsg->getBuildCount() == builds);
+        auto cached = welcomeMsg->getMsg();
+        REQUIRE(welcomeMsg->getMsg() == cached);
+
+        // Changing a value in the message causes it to be rebuilt.
+        bool remote = Globals::get().getCommandableByDds();
+        Globals::get().setCommandSourceIsRemote(!remote);
+        auto rebuilt = welcomeMsg->getMsg();
+        REQUIRE(rebuilt != cached);
+        REQUIRE(welcomeMsg->getBuildCount() == builds + 1);
+        Globals::get().setCommandSourceIsRemote(remote);
         {
             string note("Correct NCmdAck");
             LDEBUG(note);
@@ -123,6 +192,112 @@ TEST_CASE("Test ComControl", "[ComControl]") {
             REQUIRE(finJ["sequence_id"] == seqId);
             REQUIRE(finJ["id"] == "fail");
         }
+        {
+            string note = "Pipelined NCmdEcho";
+            LDEBUG(note);
+            // Send more commands than the window before reading anything, and
+            // then collect the responses in reverse order.
+            int const first = 4;
+            int const count = 3 * Config::get().getControlServerCommandWindow();
+            for (int seqId = first; seqId < first + count; ++seqId) {
+                string jStr = R"({"id":"cmd_echo","sequence_id":)" + to_string(seqId) +
+                              R"(, "msg":"pipe )" + to_string(seqId) + R"("})";
+                client.cmdSendPipelined(jStr, seqId);
+            }
+            REQUIRE(client.getPipelinedCount() == size_t(count));
+            for (int seqId = first + count - 1; seqId >= first; --seqId) {
+                auto [ackJ, finJ] = client.cmdRecvPipelined(seqId, note);
+                REQUIRE(ackJ["sequence_id"] == seqId);
+                REQUIRE(ackJ["id"] == "ack");
+                REQUIRE(finJ["sequence_id"] == seqId);
+                REQUIRE(finJ["id"] == "success");
+                REQUIRE(finJ["msg"] == "pipe " + to_string(seqId));
+            }
+            REQUIRE(client.getPipelinedCount() == 0);
+        }
+        {
+            string note = "NCmdBatch";
+            LDEBUG(note);
+            int seqId = 90;
+            string jStr = R"({"id":"cmd_batch","sequence_id":90,"commands":[)"
+                          R"({"id":"cmd_echo","sequence_id":91,"msg":"b1"},)"
+                          R"({"id":"cmd_echo","sequence_id":92,"msg":"b2"}]})";
+            auto [ackJ, finJ] = client.cmdSendRecv(jStr, seqId, note);
+            REQUIRE(ackJ["id"] == "ack");
+            REQUIRE(finJ["id"] == "success");
+            REQUIRE(finJ["results"].size() == 2);
+            REQUIRE(finJ["results"][1]["sequence_id"] == 92);
+            REQUIRE(finJ["results"][1]["msg"] == "b2");
+        }
+        {
+            string note = "NCmdGetCommandStats";
+            LDEBUG(note);
+            int seqId = 100;
+            string jStr = R"({"id":"cmd_getCommandStats","sequence_id": 100 })";
+            auto [ackJ, finJ] = client.cmdSendRecv(jStr, seqId, note);
+            REQUIRE(ackJ["id"] == "ack");
+            REQUIRE(finJ["id"] == "success");
+            // Every echo above has had its final response written.
+            auto echoJ = finJ["commandStats"]["cmd_echo"];
+            int echoCount = 1 + 3 * Config::get().getControlServerCommandWindow();
+            REQUIRE(echoJ["total"]["count"] == echoCount);
+            REQUIRE(echoJ["queue"]["count"] == echoCount);
+            REQUIRE(echoJ["total"]["max"] >= echoJ["action"]["max"]);
+            REQUIRE(finJ["commandStats"]["cmd_ak"]["total"]["count"] == 1);
+        }
+        {
+            string note = "Rate limited";
+            LDEBUG(note);
+            // Commands past the rate limit get a busy noack and no final message.
+            serv->setCommandRateLimit(0.5, 1.0);
+            ComClient limited(ioContext, "127.0.0.1", port);
+            REQUIRE(limited.readWelcomeMsg() == 16);
+            auto [ackJ, finJ] = limited.cmdSendRecv(R"({"id":"cmd_ack","sequence_id": 101 })", 101, note);
+            REQUIRE(ackJ["id"] == "ack");
+            limited.cmdSendPipelined(R"({"id":"cmd_ack","sequence_id": 102 })", 102);
+            auto [busyJ, noFinJ] = limited.cmdRecvPipelined(102, note);
+            REQUIRE(busyJ["id"] == "noack");
+            REQUIRE(busyJ["sequence_id"] == 102);
+            REQUIRE(busyJ["user_info"] == ComConnection::BUSY_RATE_LIMITED);
+            REQUIRE(noFinJ.is_null());
+            REQUIRE(serv->getRateLimitedCount() == 1);
+            serv->setCommandRateLimit(Config::get().getControlServerCommandRate(),
+                                      Config::get().getControlServerCommandBurst());
+        }
+        {
+            string note = "Commands that aren't independent run in order";
+            LDEBUG(note);
+            REQUIRE(Config::get().getControlServerCommandWindow() > 1);
+            // The second command is read while the first is still running,
+            // but it must not run until the first has finished.
+            auto sleepCmd = [](int seqId, int ms, bool independent) {
+                return R"({"id":"cmd_testSleep","sequence_id":)" + to_string(seqId) + R"(,"ms":)" +
+                       to_string(ms) + R"(,"independent":)" + (independent ? "true" : "false") + "}";
+            };
+            sleepFinished.clear();
+            client.cmdSendPipelined(sleepCmd(110, 300, false), 110);
+            client.cmdSendPipelined(sleepCmd(111, 0, false), 111);
+            for (int seqId : {110, 111}) {
+                auto [ackJ, finJ] = client.cmdRecvPipelined(seqId, note);
+                REQUIRE(ackJ["id"] == "ack");
+                REQUIRE(finJ["id"] == "success");
+            }
+            {
+                lock_guard<mutex> lg(sleepMtx);
+                REQUIRE(sleepFinished == vector<uint64_t>{110, 111});
+            }
+
+            // Independent commands run alongside each other, so the short one finishes first.
+            sleepFinished.clear();
+            client.cmdSendPipelined(sleepCmd(112, 300, true), 112);
+            client.cmdSendPipelined(sleepCmd(113, 0, true), 113);
+            for (int seqId : {112, 113}) {
+                auto [ackJ, finJ] = client.cmdRecvPipelined(seqId, note);
+                REQUIRE(finJ["id"] == "success");
+            }
+            lock_guard<mutex> lg(sleepMtx);
+            REQUIRE(sleepFinished == vector<uint64_t>{113, 112});
+        }
     }
 
     // Shutdown the server
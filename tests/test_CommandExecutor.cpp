@@ -0,0 +1,285 @@
+/*
+ * This file is part of LSST ts_m2cellcpp test suite.
+ *
+ * Developed for the Vera C. Rubin Observatory Telescope & Site Software Systems.
+ * This product includes software developed by the Vera C.Rubin Observatory Project
+ * (https://www.lsst.org). See the COPYRIGHT file at the top-level directory of
+ * this distribution for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define CATCH_CONFIG_MAIN
+
+// System headers
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// 3rd party headers
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_session.hpp>
+
+// Project headers
+#include "util/Bug.h"
+#include "util/CommandExecutor.h"
+#include "util/Log.h"
+
+using namespace std;
+using namespace LSST::m2cellcpp::util;
+
+TEST_CASE("Test CommandExecutor ordering", "[CommandExecutor]") {
+    LSST::m2cellcpp::util::Log::getLog().useEnvironmentLogLvl();
+    auto exec = CommandExecutor::create(4, 1000);
+
+    // Commands with the same key run in order, one at a time.
+    int const keys = 3;
+    int const perKey = 50;
+    mutex mtx;
+    vector<vector<int>> order(keys);
+    vector<atomic<int>> running(keys);
+    atomic<bool> overlap{false};
+    for (int j = 0; j < perKey; ++j) {
+        for (int k = 0; k < keys; ++k) {
+            auto cmd = make_shared<Command>([&, j, k](CmdData*) {
+                if (++running[k] > 1) {
+                    overlap = true;
+                }
+                this_thread::sleep_for(chrono::microseconds(100));
+                {
+                    lock_guard<mutex> lg(mtx);
+                    order[k].push_back(j);
+                }
+                --running[k];
+            });
+            REQUIRE(exec->queCmd(k, cmd));
+        }
+    }
+    REQUIRE(exec->waitForIdle(chrono::milliseconds(10000)));
+    REQUIRE_FALSE(overlap);
+    for (int k = 0; k < keys; ++k) {
+        REQUIRE(order[k].size() == perKey);
+        for (int j = 0; j < perKey; ++j) {
+            REQUIRE(order[k][j] == j);
+        }
+    }
+    REQUIRE(exec->getCompletedCount() == keys * perKey);
+    REQUIRE(exec->getInFlight() == 0);
+
+    // Commands with different keys run concurrently.
+    atomic<int> concurrent{0};
+    atomic<int> maxConcurrent{0};
+    for (int k = 0; k < 4; ++k) {
+        auto cmd = make_shared<Command>([&](CmdData*) {
+            int c = ++concurrent;
+            int m = maxConcurrent;
+            while (c > m && !maxConcurrent.compare_exchange_weak(m, c)) {
+            }
+            this_thread::sleep_for(chrono::milliseconds(100));
+            --concurrent;
+        });
+        REQUIRE(exec->queCmd(100 + k, cmd));
+    }
+    REQUIRE(exec->waitForIdle(chrono::milliseconds(10000)));
+    REQUIRE(maxConcurrent > 1);
+
+    // Commands without a key run concurrently.
+    concurrent = 0;
+    maxConcurrent = 0;
+    for (int k = 0; k < 4; ++k) {
+        auto cmd = make_shared<Command>([&](CmdData*) {
+            int c = ++concurrent;
+            int m = maxConcurrent;
+            while (c > m && !maxConcurrent.compare_exchange_weak(m, c)) {
+            }
+            this_thread::sleep_for(chrono::milliseconds(100));
+            --concurrent;
+        });
+        REQUIRE(exec->reserve());
+        exec->queReserved(cmd);
+    }
+    REQUIRE(exec->waitForIdle(chrono::milliseconds(10000)));
+    REQUIRE(maxConcurrent > 1);
+    REQUIRE_THROWS_AS(exec->queReserved(make_shared<Command>()), Bug);
+    REQUIRE(exec->shutdown(chrono::milliseconds(1000)));
+}
+
+TEST_CASE("Test CommandExecutor limits", "[CommandExecutor]") {
+    LSST::m2cellcpp::util::Log::getLog().useEnvironmentLogLvl();
+    unsigned int const maxInFlight = 5;
+    auto exec = CommandExecutor::create(2, maxInFlight);
+    REQUIRE(exec->getMaxInFlight() == maxInFlight);
+
+    REQUIRE_THROWS_AS(exec->cancelReservation(), Bug);
+    REQUIRE_THROWS_AS(exec->queReserved(1, make_shared<Command>()), Bug);
+
+    // Block the threads so nothing finishes until `release` is set.
+    atomic<bool> release{false};
+    auto blocker = [&release](CmdData*) {
+        while (!release) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+    };
+    for (unsigned int j = 0; j < maxInFlight - 1; ++j) {
+        REQUIRE(exec->queCmd(j % 3, make_shared<Command>(blocker)));
+    }
+    REQUIRE(exec->reserve());
+    REQUIRE(exec->getInFlight() == maxInFlight);
+    REQUIRE_FALSE(exec->reserve());
+    REQUIRE_FALSE(exec->queCmd(7, make_shared<Command>(blocker)));
+    REQUIRE(exec->getRejectedCount() == 2);
+    exec->cancelReservation();
+    REQUIRE(exec->getInFlight() == maxInFlight - 1);
+    REQUIRE_FALSE(exec->waitForIdle(chrono::milliseconds(50)));
+
+    // An exception in a `Command` does not stop the executor.
+    REQUIRE(exec->queCmd(9, make_shared<Command>([](CmdData*) { throw runtime_error("test"); })));
+
+    release = true;
+    REQUIRE(exec->waitForIdle(chrono::milliseconds(5000)));
+    REQUIRE(exec->getCompletedCount() == maxInFlight);
+
+    // Nothing is accepted after shutdown.
+    REQUIRE(exec->shutdown(chrono::milliseconds(1000)));
+    REQUIRE_FALSE(exec->reserve());
+    REQUIRE_FALSE(exec->queCmd(1, make_shared<Command>()));
+}
+
+TEST_CASE("Test CommandExecutor shutdown from command", "[CommandExecutor]") {
+    LSST::m2cellcpp::util::Log::getLog().useEnvironmentLogLvl();
+    auto exec = CommandExecutor::create(2, 10);
+    REQUIRE_FALSE(exec->inExecutorThread());
+
+    // A `Command` calling shutdown cannot wait for itself.
+    atomic<bool> inThread{false};
+    atomic<bool> shutdownResult{true};
+    CommandExecutor::Ptr execCopy = exec;
+    REQUIRE(exec->queCmd(1, make_shared<Command>([&inThread, &shutdownResult, execCopy](CmdData*) {
+        inThread = execCopy->inExecutorThread();
+        shutdownResult = execCopy->shutdown(chrono::milliseconds(1000));
+    })));
+    execCopy.reset();
+    REQUIRE(exec->waitForIdle(chrono::milliseconds(5000)));
+    REQUIRE(inThread);
+    REQUIRE_FALSE(shutdownResult);
+    REQUIRE_FALSE(exec->reserve());
+    REQUIRE(exec->shutdown(chrono::milliseconds(1000)));
+}
+
+TEST_CASE("Test CommandExecutor lanes", "[CommandExecutor]") {
+    LSST::m2cellcpp::util::Log::getLog().useEnvironmentLogLvl();
+    auto exec = CommandExecutor::create(1, 100);
+
+    // Block the only thread so everything else has to wait in its lane.
+    atomic<bool> started{false};
+    atomic<bool> release{false};
+    REQUIRE(exec->queCmd(0, make_shared<Command>([&](CmdData*) {
+        started = true;
+        while (!release) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+    })));
+    while (!started) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+
+    mutex mtx;
+    string order;
+    auto makeCmd = [&](char c) {
+        return make_shared<Command>([&mtx, &order, c](CmdData*) {
+            lock_guard<mutex> lg(mtx);
+            order += c;
+        });
+    };
+    for (int j = 0; j < 3; ++j) {
+        REQUIRE(exec->reserve());
+        exec->queReserved(makeCmd('r'));
+    }
+    REQUIRE(exec->reserve());
+    exec->queReserved(makeCmd('p'), CommandExecutor::POWER);
+    REQUIRE(exec->reserve());
+    exec->queReserved(makeCmd('r'), CommandExecutor::ROUTINE);
+    REQUIRE(exec->reserve());
+    exec->queReserved(makeCmd('s'), CommandExecutor::SAFETY);
+    REQUIRE(exec->reserve());
+    exec->queReserved(makeCmd('P'), CommandExecutor::POWER);
+    release = true;
+    REQUIRE(exec->waitForIdle(chrono::milliseconds(10000)));
+
+    // Higher lanes go first, and each lane is in the order queued.
+    REQUIRE(order == "spPrrrr");
+    REQUIRE(exec->getLaneWait(CommandExecutor::ROUTINE).getCount() == 5);
+    REQUIRE(exec->getLaneWait(CommandExecutor::POWER).getCount() == 2);
+    REQUIRE(exec->getLaneWait(CommandExecutor::SAFETY).getCount() == 1);
+    REQUIRE(exec->getLaneWaitSummary().find("safety wait(us) count=1") != string::npos);
+    REQUIRE(CommandExecutor::getLaneName(CommandExecutor::POWER) == "power");
+    REQUIRE(exec->shutdown(chrono::milliseconds(1000)));
+}
+
+TEST_CASE("Test CommandExecutor lane headroom", "[CommandExecutor]") {
+    LSST::m2cellcpp::util::Log::getLog().useEnvironmentLogLvl();
+    // 2 slots are kept for power and 2 more for safety, so routine
+    // commands can only use 6 of the 10.
+    auto exec = CommandExecutor::create(1, 10, 2);
+    REQUIRE(exec->getLaneLimit(CommandExecutor::ROUTINE) == 6);
+    REQUIRE(exec->getLaneLimit(CommandExecutor::POWER) == 8);
+    REQUIRE(exec->getLaneLimit(CommandExecutor::SAFETY) == 10);
+    REQUIRE(CommandExecutor::create(1, 3, 2)->getLaneLimit(CommandExecutor::ROUTINE) == 1);
+
+    // Block the only thread with a routine command.
+    atomic<bool> started{false};
+    atomic<bool> release{false};
+    REQUIRE(exec->queCmd(0, make_shared<Command>([&](CmdData*) {
+        started = true;
+        while (!release) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+    })));
+    while (!started) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+
+    mutex mtx;
+    string order;
+    auto makeCmd = [&](char c) {
+        return make_shared<Command>([&mtx, &order, c](CmdData*) {
+            lock_guard<mutex> lg(mtx);
+            order += c;
+        });
+    };
+    // Fill the executor with routine commands, from different keys.
+    uint64_t key = 1;
+    while (exec->reserve(CommandExecutor::ROUTINE)) {
+        exec->queReserved(key++, makeCmd('r'), CommandExecutor::ROUTINE);
+    }
+    REQUIRE(exec->getInFlight() == 6);
+
+    // A safety command is still accepted and runs before the routine ones.
+    REQUIRE(exec->reserve(CommandExecutor::SAFETY));
+    exec->queReserved(key++, makeCmd('s'), CommandExecutor::SAFETY);
+    REQUIRE(exec->reserve(CommandExecutor::POWER));
+    exec->queReserved(key++, makeCmd('p'), CommandExecutor::POWER);
+    REQUIRE(exec->getInFlight() == 8);
+    REQUIRE_FALSE(exec->reserve(CommandExecutor::POWER));
+    REQUIRE(exec->reserve(CommandExecutor::SAFETY));
+    exec->cancelReservation();
+
+    release = true;
+    REQUIRE(exec->waitForIdle(chrono::milliseconds(10000)));
+    REQUIRE(order == "sprrrrr");
+    REQUIRE(exec->shutdown(chrono::milliseconds(1000)));
+}
@@ -0,0 +1,365 @@
+/*
+ * This file is part of LSST ts_m2cellcpp test suite.
+ *
+ * Developed for the Vera C. Rubin Observatory Telescope & Site Software Systems.
+ * This product includes software developed by the Vera C.Rubin Observatory Project
+ * (https://www.lsst.org). See the COPYRIGHT file at the top-level directory of
+ * this distribution for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define CATCH_CONFIG_MAIN
+
+// System headers
+#include <chrono>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+// 3rd party headers
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_session.hpp>
+
+// Project headers
+#include "control/Context.h"
+#include "control/FpgaIo.h"
+#include "control/MotionEngine.h"
+#include "control/PowerSystem.h"
+#include "faultmgr/FaultMgr.h"
+#include "simulator/SimCore.h"
+#include "system/ComClient.h"
+#include "system/ComControlServer.h"
+#include "system/Config.h"
+#include "system/Globals.h"
+#include "system/JournalReplay.h"
+#include "util/Bug.h"
+#include "util/CommandJournal.h"
+#include "util/Log.h"
+
+using namespace std;
+using namespace LSST::m2cellcpp;
+using util::CommandJournal;
+
+namespace {
+
+/// @return a journal path prefix in /tmp that no other test run uses.
+string tmpPrefix(string const& name) {
+    return "/tmp/test_CommandJournal_" + to_string(getpid()) + "_" + name;
+}
+
+/// Remove the segments of `prefix`.
+void removeJournal(string const& prefix) {
+    for (unsigned int j = CommandJournal::firstSegment(prefix);
+         unlink(CommandJournal::segmentPath(prefix, j).c_str()) == 0; ++j) {
+    }
+}
+
+}  // namespace
+
+TEST_CASE("Test CommandJournal", "[CommandJournal]") {
+    util::Log::getLog().useEnvironmentLogLvl();
+    string prefix = tmpPrefix("basic");
+    removeJournal(prefix);
+
+    // Small segments so the records span several of them.
+    size_t const segSize = CommandJournal::MIN_SEGMENT_SIZE;
+    int const count = 200;
+    {
+        auto journal = CommandJournal::create(prefix, segSize, 5ms);
+        REQUIRE_THROWS_AS(CommandJournal::create(prefix, segSize, 5ms), util::Issue);
+        REQUIRE_THROWS_AS(CommandJournal::create(prefix + "x", segSize - 1, 5ms), util::Bug);
+
+        for (int j = 0; j < count; ++j) {
+            CommandJournal::Type type = (j % 10 == 9) ? CommandJournal::STATE : CommandJournal::COMMAND;
+            string payload = R"({"id":"cmd_echo","sequence_id":)" + to_string(j) + R"(,"msg":"journal"})";
+            REQUIRE(journal->append(type, j % 3, payload));
+        }
+        // A record larger than a segment is dropped.
+        REQUIRE_FALSE(journal->append(CommandJournal::COMMAND, 1, string(segSize, 'x')));
+        journal->flush();
+        REQUIRE(journal->getWrittenCount() == count);
+        REQUIRE(journal->getDroppedCount() == 1);
+        REQUIRE(journal->getSegmentNumber() > 1);
+
+        // The writer commits more than one record at a time.
+        REQUIRE(journal->getCommitCount() < uint64_t(count));
+
+        journal->close();
+        REQUIRE_FALSE(journal->append(CommandJournal::COMMAND, 1, "closed"));
+    }
+
+    vector<CommandJournal::Record> records;
+    unsigned int segments = CommandJournal::readAll(prefix, records);
+    REQUIRE(segments > 2);
+    REQUIRE(records.size() == size_t(count));
+    for (int j = 0; j < count; ++j) {
+        auto const& rec = records[j];
+        CommandJournal::Type type = (j % 10 == 9) ? CommandJournal::STATE : CommandJournal::COMMAND;
+        REQUIRE(rec.type == type);
+        REQUIRE(rec.connId == uint64_t(j % 3));
+        REQUIRE(rec.payload.find(R"("sequence_id":)" + to_string(j) + ",") != string::npos);
+        if (j > 0) {
+            REQUIRE(rec.timeMicros >= records[j - 1].timeMicros);
+        }
+    }
+    REQUIRE(CommandJournal::getTypeName(CommandJournal::STATE) == "STATE");
+    REQUIRE(CommandJournal::getTypeName(CommandJournal::REJECTED) == "REJECTED");
+    removeJournal(prefix);
+}
+
+TEST_CASE("Test CommandJournal maxSegments", "[CommandJournal]") {
+    util::Log::getLog().useEnvironmentLogLvl();
+    string prefix = tmpPrefix("maxSegments");
+    removeJournal(prefix);
+
+    size_t const segSize = CommandJournal::MIN_SEGMENT_SIZE;
+    unsigned int const maxSegments = 3;
+    int const count = 500;
+    unsigned int lastSegment = 0;
+    {
+        auto journal = CommandJournal::create(prefix, segSize, 5ms, maxSegments);
+        for (int j = 0; j < count; ++j) {
+            string payload = R"({"id":"cmd_echo","sequence_id":)" + to_string(j) + R"(,"msg":"journal"})";
+            REQUIRE(journal->append(CommandJournal::COMMAND, 1, payload));
+            if (j % 50 == 0) {
+                journal->flush();
+            }
+        }
+        journal->flush();
+        lastSegment = journal->getSegmentNumber();
+        REQUIRE(lastSegment > 2 * maxSegments);
+        REQUIRE(journal->getRemovedCount() == lastSegment + 1 - maxSegments);
+        journal->close();
+    }
+
+    // Only the newest segments are left, ending with the last record.
+    REQUIRE(access(CommandJournal::segmentPath(prefix, 0).c_str(), F_OK) != 0);
+    REQUIRE(CommandJournal::firstSegment(prefix) == lastSegment + 1 - maxSegments);
+    vector<CommandJournal::Record> records;
+    REQUIRE(CommandJournal::readAll(prefix, records) == maxSegments);
+    REQUIRE(records.size() < size_t(count));
+    REQUIRE(records.back().payload.find(R"("sequence_id":)" + to_string(count - 1) + ",") != string::npos);
+    removeJournal(prefix);
+    REQUIRE(CommandJournal::firstSegment(prefix) == 0);
+}
+
+TEST_CASE("Test CommandJournal runs share maxSegments", "[CommandJournal]") {
+    util::Log::getLog().useEnvironmentLogLvl();
+    // Two runs, named like the ones from ControlMain, share a group.
+    string group = tmpPrefix("runs") + "_";
+    string runA = group + "20260101_000000";
+    string runB = group + "20260101_000100";
+    removeJournal(runA);
+    removeJournal(runB);
+
+    size_t const segSize = CommandJournal::MIN_SEGMENT_SIZE;
+    unsigned int const maxSegments = 3;
+    string const payload(1000, 'p');
+    {
+        auto journal = CommandJournal::create(runA, segSize, 5ms, maxSegments, group);
+        for (int j = 0; j < 5; ++j) {
+            REQUIRE(journal->append(CommandJournal::COMMAND, 1, payload));
+        }
+        journal->flush();
+        REQUIRE(journal->getSegmentNumber() == 1);
+        journal->close();
+    }
+    // Make the last segment look like a run that crashed before closing it.
+    string crashed = CommandJournal::segmentPath(runA, 1);
+    vector<CommandJournal::Record> records;
+    REQUIRE(CommandJournal::readSegment(crashed, records));
+    REQUIRE(records.size() == 2);
+    struct stat st;
+    REQUIRE(stat(crashed.c_str(), &st) == 0);
+    off_t closedSize = st.st_size;
+    REQUIRE(truncate(crashed.c_str(), segSize) == 0);
+    REQUIRE(CommandJournal::trimSegments(group) == 1);
+    REQUIRE(CommandJournal::trimSegments(group) == 0);
+    REQUIRE(stat(crashed.c_str(), &st) == 0);
+    REQUIRE(st.st_size == closedSize);
+    records.clear();
+    REQUIRE(CommandJournal::readSegment(crashed, records));
+    REQUIRE(records.size() == 2);
+
+    // The second run removes the first run's oldest segments, not only its own.
+    {
+        auto journal = CommandJournal::create(runB, segSize, 5ms, maxSegments, group);
+        for (int j = 0; j < 5; ++j) {
+            REQUIRE(journal->append(CommandJournal::COMMAND, 1, payload));
+        }
+        journal->flush();
+        REQUIRE(journal->getSegmentNumber() == 1);
+        REQUIRE(journal->getRemovedCount() == 1);
+        journal->close();
+    }
+    REQUIRE(access(CommandJournal::segmentPath(runA, 0).c_str(), F_OK) != 0);
+    REQUIRE(access(crashed.c_str(), F_OK) == 0);
+    REQUIRE(CommandJournal::removeOldSegments(group, 1) == 2);
+    REQUIRE(access(crashed.c_str(), F_OK) != 0);
+    REQUIRE(access(CommandJournal::segmentPath(runB, 1).c_str(), F_OK) == 0);
+    removeJournal(runB);
+}
+
+TEST_CASE("Test JournalReplay", "[CommandJournal]") {
+    util::Log::getLog().useEnvironmentLogLvl();
+    string cfgPath = system::Config::getEnvironmentCfgPath("../configs");
+    system::Config::setup(cfgPath + "unitTestCfg.yaml");
+    system::Globals::setup(system::Config::get());
+
+    simulator::SimCore::Ptr simCore(new simulator::SimCore());
+    faultmgr::FaultMgr::setup();
+    control::FpgaIo::setup(simCore);
+    control::MotionEngine::setup();
+    control::Context::setup();
+    control::Context::get()->model.getPowerSystem()->stopTimeoutLoop();
+    control::FpgaIo::getPtr()->stopLoop();
+    control::MotionEngine::getPtr()->engineStop();
+
+    // One server to record a session and a second one, with a fresh
+    // factory, to replay it to.
+    system::IoContextPtr ioContext = make_shared<boost::asio::io_context>();
+    int port = system::Config::get().getControlServerPort();
+    int replayPort = port + 10;
+    auto recFactory = control::NetCommandFactory::create();
+    system::ComControl::setupNormalFactory(recFactory);
+    auto recServ = system::ComControlServer::create(ioContext, port, recFactory);
+    auto repFactory = control::NetCommandFactory::create();
+    system::ComControl::setupNormalFactory(repFactory);
+    auto repServ = system::ComControlServer::create(ioContext, replayPort, repFactory);
+    thread recThrd([&recServ]() { recServ->run(); });
+    thread repThrd([&repServ]() { repServ->run(); });
+    for (int j = 0; (recServ->getState() != system::ComServer::RUNNING ||
+                     repServ->getState() != system::ComServer::RUNNING) &&
+                    j < 10;
+         ++j) {
+        sleep(1);
+    }
+
+    string recPrefix = tmpPrefix("recorded");
+    string repPrefix = tmpPrefix("replayed");
+    removeJournal(recPrefix);
+    removeJournal(repPrefix);
+
+    // Record commands from two connections.
+    auto recJournal = CommandJournal::create(recPrefix, CommandJournal::MIN_SEGMENT_SIZE, 5ms);
+    CommandJournal::setGlobal(recJournal);
+    {
+        system::ComClient clientA(ioContext, "127.0.0.1", port);
+        system::ComClient clientB(ioContext, "127.0.0.1", port);
+        clientA.readWelcomeMsg();
+        clientB.readWelcomeMsg();
+        clientA.cmdSendRecv(R"({"id":"cmd_ack","sequence_id":1})", 1, "rec");
+        clientB.cmdSendRecv(R"({"id":"cmd_echo","sequence_id":2,"msg":"B"})", 2, "rec");
+        clientA.cmdSendRecv(R"({"id":"cmd_echo","sequence_id":3,"msg":"A"})", 3, "rec");
+        clientB.cmdSendRecv(R"({"id":"cmd_unknown","sequence_id":4})", 4, "rec");
+    }
+    CommandJournal::setGlobal(nullptr);
+    recJournal->close();
+
+    vector<CommandJournal::Record> recorded;
+    REQUIRE(CommandJournal::readAll(recPrefix, recorded) == 1);
+    // Each command has a COMMAND and a RESULT record, except the noacked
+    // cmd_unknown, which has a REJECTED record instead of a COMMAND record.
+    REQUIRE(recorded.size() == 8);
+    REQUIRE(recorded[0].connId != recorded[2].connId);
+    REQUIRE(recorded[6].type == CommandJournal::REJECTED);
+    REQUIRE(recorded[6].payload == R"({"id":"cmd_unknown","sequence_id":4})");
+
+    // Replay, at 10 times the recorded pace, to the second server.
+    auto repJournal = CommandJournal::create(repPrefix, CommandJournal::MIN_SEGMENT_SIZE, 5ms);
+    CommandJournal::setGlobal(repJournal);
+    system::JournalReplay replay(recorded, 10.0);
+    auto result = replay.run(ioContext, "127.0.0.1", replayPort);
+    CommandJournal::setGlobal(nullptr);
+    repJournal->close();
+    LINFO("replay ", result.getSummary());
+    REQUIRE(result.sent == 3);
+    REQUIRE(result.acked == 3);
+    REQUIRE(result.noacked == 0);
+    REQUIRE(result.succeeded == 3);
+    REQUIRE(result.failed == 0);
+    REQUIRE(result.lost == 0);
+    REQUIRE(result.ackLatency.getCount() == 3);
+
+    // The replayed session received the same commands in the same order,
+    // with the same results. The noacked command wasn't replayed.
+    vector<CommandJournal::Record> replayed;
+    REQUIRE(CommandJournal::readAll(repPrefix, replayed) == 1);
+    REQUIRE(replayed.size() == 6);
+    for (auto type : {CommandJournal::COMMAND, CommandJournal::RESULT}) {
+        vector<string> rec;
+        vector<string> rep;
+        for (auto const& r : recorded) {
+            if (r.type == type && r.payload.find(R"("sequence_id":4)") == string::npos) {
+                rec.push_back(r.payload);
+            }
+        }
+        for (auto const& r : replayed) {
+            if (r.type == type) rep.push_back(r.payload);
+        }
+        REQUIRE(rec.size() == 3);
+        REQUIRE(rec == rep);
+    }
+    REQUIRE(system::JournalReplay::getStateTransitions(recorded) ==
+            system::JournalReplay::getStateTransitions(replayed));
+    removeJournal(recPrefix);
+    removeJournal(repPrefix);
+
+    // Commands rejected before they are interpreted are journaled as REJECTED
+    // along with their busy noack.
+    string rejPrefix = tmpPrefix("rejected");
+    removeJournal(rejPrefix);
+    auto rejJournal = CommandJournal::create(rejPrefix, CommandJournal::MIN_SEGMENT_SIZE, 5ms);
+    CommandJournal::setGlobal(rejJournal);
+    recServ->setCommandRateLimit(0.5, 1.0);
+    {
+        system::ComClient clientC(ioContext, "127.0.0.1", port);
+        clientC.readWelcomeMsg();
+        auto [ackJ, finJ] = clientC.cmdSendRecv(R"({"id":"cmd_ack","sequence_id":5})", 5, "rej");
+        REQUIRE(ackJ["id"] == "ack");
+        clientC.cmdSendPipelined(R"({"id":"cmd_ack","sequence_id":6})", 6);
+        auto [busyJ, noFinJ] = clientC.cmdRecvPipelined(6, "rej");
+        REQUIRE(busyJ["user_info"] == system::ComConnection::BUSY_RATE_LIMITED);
+    }
+    CommandJournal::setGlobal(nullptr);
+    rejJournal->close();
+    vector<CommandJournal::Record> rejRecords;
+    REQUIRE(CommandJournal::readAll(rejPrefix, rejRecords) == 1);
+    int rejectedCount = 0;
+    int busyCount = 0;
+    for (auto const& r : rejRecords) {
+        if (r.type == CommandJournal::REJECTED) {
+            ++rejectedCount;
+            REQUIRE(r.payload == R"({"id":"cmd_ack","sequence_id":6})");
+        } else if (r.type == CommandJournal::RESULT &&
+                   r.payload.find(system::ComConnection::BUSY_RATE_LIMITED) != string::npos) {
+            ++busyCount;
+        }
+    }
+    REQUIRE(rejectedCount == 1);
+    REQUIRE(busyCount == 1);
+    // COMMAND and RESULT for the accepted command, REJECTED and RESULT for the other.
+    REQUIRE(rejRecords.size() == 4);
+    removeJournal(rejPrefix);
+
+    recServ->shutdown();
+    repServ->shutdown();
+    for (int j = 0; (recServ->connectionCount() != 0 || repServ->connectionCount() != 0) && j < 10; ++j) {
+        sleep(1);
+    }
+    ioContext->stop();
+    recThrd.join();
+    repThrd.join();
+}
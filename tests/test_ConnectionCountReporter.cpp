@@ -0,0 +1,111 @@
+/*
+ * This file is part of LSST ts_m2cellcpp test suite.
+ *
+ * Developed for the Vera C. Rubin Observatory Telescope & Site Software Systems.
+ * This product includes software developed by the Vera C.Rubin Observatory Project
+ * (https://www.lsst.org). See the COPYRIGHT file at the top-level directory of
+ * this distribution for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#define CATCH_CONFIG_MAIN
+
+// System headers
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <vector>
+
+// 3rd party headers
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_session.hpp>
+
+// Project headers
+#include "system/ConnectionCountReporter.h"
+#include "util/Log.h"
+
+using namespace std;
+using namespace LSST::m2cellcpp;
+using namespace LSST::m2cellcpp::system;
+
+TEST_CASE("Test ConnectionCountReporter", "[ConnectionCountReporter]") {
+    util::Log::getLog().useEnvironmentLogLvl();
+    auto const timeout = chrono::seconds(10);
+
+    mutex mtx;
+    vector<size_t> reports;
+    promise<void> release;
+    shared_future<void> released = release.get_future().share();
+    promise<void> firstCall;
+    bool first = true;
+    auto reporter = ConnectionCountReporter::create([&](size_t count) {
+        bool wait = false;
+        {
+            lock_guard<mutex> lg(mtx);
+            reports.push_back(count);
+            wait = first;
+            first = false;
+        }
+        if (wait) {
+            // Hold the reporter's thread so the next posts pile up.
+            firstCall.set_value();
+            released.wait();
+        }
+    });
+
+    // post() doesn't wait for the report.
+    reporter->post(1);
+    REQUIRE(firstCall.get_future().wait_for(timeout) == future_status::ready);
+
+    // A blip, everything drops and reconnects while the reporter is busy,
+    // only the 0 and the latest count are reported.
+    for (size_t count : {2, 1, 0, 1, 2, 3}) {
+        reporter->post(count);
+    }
+    REQUIRE(reporter->getPostedCount() == 7);
+    REQUIRE_FALSE(reporter->waitForReported(chrono::milliseconds(10)));
+    release.set_value();
+    REQUIRE(reporter->waitForReported(timeout));
+    {
+        lock_guard<mutex> lg(mtx);
+        REQUIRE(reports == vector<size_t>{1, 0, 3});
+    }
+    REQUIRE(reporter->getReportedCount() == 3);
+
+    // Without a 0, only the latest count is reported.
+    reporter->post(4);
+    REQUIRE(reporter->waitForReported(timeout));
+    {
+        lock_guard<mutex> lg(mtx);
+        REQUIRE(reports.back() == 4);
+    }
+
+    // After stop, posts are reported in the caller's thread.
+    reporter->stop();
+    reporter->post(0);
+    REQUIRE(reporter->waitForReported(timeout));
+    {
+        lock_guard<mutex> lg(mtx);
+        REQUIRE(reports.back() == 0);
+    }
+    REQUIRE(reporter->getPostedCount() == 9);
+
+    // An exception from the report is logged and doesn't stop the reporter.
+    auto throwing = ConnectionCountReporter::create([](size_t) { throw runtime_error("no FaultMgr"); });
+    throwing->post(1);
+    throwing->post(0);
+    REQUIRE(throwing->waitForReported(timeout));
+}
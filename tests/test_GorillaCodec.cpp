@@ -0,0 +1,255 @@
+/*
+ * This file is part of LSST ts_m2cellcpp test suite.
+ *
+ * Developed for the Vera C. Rubin Observatory Telescope & Site Software Systems.
+ * This product includes software developed by the Vera C.Rubin Observatory Project
+ * (https://www.lsst.org). See the COPYRIGHT file at the top-level directory of
+ * this distribution for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define CATCH_CONFIG_MAIN
+
+// System headers
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+
+// 3rd party headers
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_session.hpp>
+
+// Project headers
+#include "util/Bug.h"
+#include "util/GorillaCodec.h"
+#include "util/Log.h"
+
+using namespace std;
+using namespace LSST::m2cellcpp::util;
+
+namespace {
+
+/// Return true if `a` and `b` have identical bit patterns.
+bool sameBits(double a, double b) { return memcmp(&a, &b, sizeof(a)) == 0; }
+
+/// Encode `vals`, decode them, and return true if every decoded value
+/// has the same bits as the original.
+bool floatRoundTrip(vector<double> const& vals) {
+    BitWriter writer;
+    GorillaFloatEncoder enc;
+    for (double v : vals) {
+        enc.add(v, writer);
+    }
+    auto const& bytes = writer.getBytes();
+    BitReader reader(bytes.data(), bytes.size());
+    GorillaFloatDecoder dec;
+    for (double v : vals) {
+        if (!sameBits(v, dec.next(reader))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Encode `vals`, decode them, and return true if they all match.
+bool intRoundTrip(vector<int64_t> const& vals) {
+    BitWriter writer;
+    DeltaOfDeltaEncoder enc;
+    for (int64_t v : vals) {
+        enc.add(v, writer);
+    }
+    auto const& bytes = writer.getBytes();
+    BitReader reader(bytes.data(), bytes.size());
+    DeltaOfDeltaDecoder dec;
+    for (int64_t v : vals) {
+        if (v != dec.next(reader)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+TEST_CASE("Test BitWriter BitReader", "[GorillaCodec]") {
+    LSST::m2cellcpp::util::Log::getLog().useEnvironmentLogLvl();
+
+    BitWriter writer;
+    writer.writeBit(true);
+    writer.writeBits(0x5, 3);
+    writer.writeBits(0xdeadbeefcafef00d, 64);
+    writer.writeBits(0, 0);
+    writer.writeBits(0x1ff, 9);
+    REQUIRE(writer.getBitCount() == 77);
+    REQUIRE(writer.getBytes().size() == 10);
+
+    auto const& bytes = writer.getBytes();
+    BitReader reader(bytes.data(), bytes.size());
+    REQUIRE(reader.readBit() == true);
+    REQUIRE(reader.readBits(3) == 0x5);
+    REQUIRE(reader.readBits(64) == 0xdeadbeefcafef00d);
+    REQUIRE(reader.readBits(9) == 0x1ff);
+    REQUIRE(reader.getBitPos() == 77);
+    // The padding bits are readable, past them is not.
+    REQUIRE(reader.readBits(3) == 0);
+    REQUIRE_THROWS_AS(reader.readBit(), CodecException);
+}
+
+TEST_CASE("Test GorillaFloat round trip", "[GorillaCodec]") {
+    LSST::m2cellcpp::util::Log::getLog().useEnvironmentLogLvl();
+    double const inf = numeric_limits<double>::infinity();
+    double const nan = numeric_limits<double>::quiet_NaN();
+    double const denorm = numeric_limits<double>::denorm_min();
+
+    REQUIRE(floatRoundTrip({}));
+    REQUIRE(floatRoundTrip({42.0}));
+    REQUIRE(floatRoundTrip({1.0, 1.0, 1.0, 1.0}));
+    REQUIRE(floatRoundTrip({0.0, -0.0, 0.0, -0.0}));
+    REQUIRE(floatRoundTrip({nan, 1.0, -nan, inf, -inf, inf, nan}));
+    REQUIRE(floatRoundTrip({denorm, -denorm, denorm * 3, numeric_limits<double>::min(),
+                            numeric_limits<double>::max(), numeric_limits<double>::lowest()}));
+
+    // Every bit changing needs a 64 bit window.
+    uint64_t allBits = ~uint64_t(0);
+    double allOnes;
+    memcpy(&allOnes, &allBits, sizeof(allOnes));
+    REQUIRE(floatRoundTrip({0.0, allOnes, 0.0, allOnes, 1.0}));
+
+    // Slowly varying values, like force readings, should compress.
+    vector<double> sine;
+    for (int j = 0; j < 1000; ++j) {
+        sine.push_back(150.0 + 3.0 * sin(j * 0.01));
+    }
+    REQUIRE(floatRoundTrip(sine));
+
+    vector<double> constant(1000, 123.456);
+    BitWriter writer;
+    GorillaFloatEncoder enc;
+    for (double v : constant) {
+        enc.add(v, writer);
+    }
+    REQUIRE(writer.getBitCount() == 64 + 999);
+
+    // Random bit patterns, the worst case.
+    mt19937_64 rng(29);
+    vector<double> randVals;
+    for (int j = 0; j < 2000; ++j) {
+        uint64_t bits = rng();
+        double v;
+        memcpy(&v, &bits, sizeof(v));
+        randVals.push_back(v);
+    }
+    REQUIRE(floatRoundTrip(randVals));
+}
+
+TEST_CASE("Test DeltaOfDelta round trip", "[GorillaCodec]") {
+    LSST::m2cellcpp::util::Log::getLog().useEnvironmentLogLvl();
+    int64_t const iMax = numeric_limits<int64_t>::max();
+    int64_t const iMin = numeric_limits<int64_t>::min();
+
+    REQUIRE(intRoundTrip({}));
+    REQUIRE(intRoundTrip({-5}));
+    REQUIRE(intRoundTrip({iMin, iMax, iMin, 0, iMax, iMax, -1, 1}));
+
+    // Regular timestamps take 1 bit each after the first two.
+    vector<int64_t> stamps;
+    int64_t t0 = 1700000000000000000;
+    for (int j = 0; j < 1000; ++j) {
+        stamps.push_back(t0 + int64_t(j) * 20000000);
+    }
+    REQUIRE(intRoundTrip(stamps));
+    BitWriter writer;
+    DeltaOfDeltaEncoder enc;
+    for (int64_t v : stamps) {
+        enc.add(v, writer);
+    }
+    REQUIRE(writer.getBitCount() < 64 + 68 + 1000);
+
+    // Jitter crossing every bucket size.
+    mt19937_64 rng(2029);
+    vector<int64_t> jitter;
+    int64_t t = 0;
+    for (int j = 0; j < 5000; ++j) {
+        int shift = j % 40;
+        t += 1000 + int64_t(rng() >> (63 - shift)) - (int64_t(1) << shift) / 2;
+        jitter.push_back(t);
+    }
+    REQUIRE(intRoundTrip(jitter));
+}
+
+TEST_CASE("Test GorillaBlock", "[GorillaCodec]") {
+    LSST::m2cellcpp::util::Log::getLog().useEnvironmentLogLvl();
+
+    // Synthetic axial force rows, 72 columns sampled every 20ms.
+    uint32_t const columns = 72;
+    uint32_t const rows = 500;
+    mt19937_64 rng(72);
+    normal_distribution<double> noise(0.0, 0.05);
+    vector<vector<double>> data(rows, vector<double>(columns));
+    vector<int64_t> stamps(rows);
+    GorillaBlockEncoder enc(columns);
+    for (uint32_t r = 0; r < rows; ++r) {
+        stamps[r] = 1700000000000000000 + int64_t(r) * 20000000;
+        for (uint32_t c = 0; c < columns; ++c) {
+            // Readings are rounded to the resolution of the load cells.
+            data[r][c] = round((100.0 + c + 2.0 * sin(r * 0.02 + c) + noise(rng)) * 1000.0) / 1000.0;
+        }
+        enc.addRow(stamps[r], data[r]);
+    }
+    REQUIRE(enc.getRowCount() == rows);
+    REQUIRE(enc.getColumnCount() == columns);
+    REQUIRE_THROWS_AS(enc.addRow(0, vector<double>(columns - 1)), Bug);
+
+    vector<uint8_t> block = enc.getBlock();
+    size_t rawSize = rows * (columns + 1) * sizeof(double);
+    LINFO("GorillaBlock raw=", rawSize, " encoded=", block.size());
+    REQUIRE(block.size() < rawSize);
+
+    GorillaBlockDecoder dec(block.data(), block.size());
+    REQUIRE(dec.getRowCount() == rows);
+    REQUIRE(dec.getColumnCount() == columns);
+    int64_t ts;
+    vector<double> vals;
+    bool allMatch = true;
+    for (uint32_t r = 0; r < rows; ++r) {
+        REQUIRE(dec.nextRow(ts, vals));
+        allMatch = allMatch && ts == stamps[r] && vals.size() == columns;
+        for (uint32_t c = 0; c < columns && allMatch; ++c) {
+            allMatch = sameBits(vals[c], data[r][c]);
+        }
+    }
+    REQUIRE(allMatch);
+    REQUIRE_FALSE(dec.nextRow(ts, vals));
+
+    // Bad headers and truncated data.
+    REQUIRE_THROWS_AS(GorillaBlockDecoder(block.data(), 5), CodecException);
+    vector<uint8_t> badMagic = block;
+    badMagic[0] = 'X';
+    REQUIRE_THROWS_AS(GorillaBlockDecoder(badMagic.data(), badMagic.size()), CodecException);
+    vector<uint8_t> badVersion = block;
+    badVersion[3] = GorillaBlockEncoder::FORMAT_VERSION + 1;
+    REQUIRE_THROWS_AS(GorillaBlockDecoder(badVersion.data(), badVersion.size()), CodecException);
+
+    GorillaBlockDecoder truncDec(block.data(), block.size() / 2);
+    bool threw = false;
+    try {
+        while (truncDec.nextRow(ts, vals)) {
+        }
+    } catch (CodecException const& ex) {
+        threw = true;
+    }
+    REQUIRE(threw);
+}
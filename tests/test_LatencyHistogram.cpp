@@ -0,0 +1,108 @@
+/*
+ * This file is part of LSST ts_m2cellcpp test suite.
+ *
+ * Developed for the Vera C. Rubin Observatory Telescope & Site Software Systems.
+ * This product includes software developed by the Vera C.Rubin Observatory Project
+ * (https://www.lsst.org). See the COPYRIGHT file at the top-level directory of
+ * this distribution for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#define CATCH_CONFIG_MAIN
+
+// System headers
+#include <cstdint>
+
+// 3rd party headers
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_session.hpp>
+
+// Project headers
+#include "util/LatencyHistogram.h"
+#include "util/Log.h"
+
+using namespace std;
+using namespace LSST::m2cellcpp::util;
+
+TEST_CASE("Test LatencyHistogram buckets", "[LatencyHistogram]") {
+    // Small values get their own bucket.
+    for (uint64_t v = 0; v < LatencyHistogram::SUB_BUCKETS; ++v) {
+        REQUIRE(LatencyHistogram::bucketFor(v) == v);
+        REQUIRE(LatencyHistogram::bucketMax(v) == v);
+    }
+
+    // Every value is no more than the max of its bucket, and more than
+    // the max of the bucket before it.
+    for (uint64_t v = 1; v < 100000; v += 7) {
+        unsigned int b = LatencyHistogram::bucketFor(v);
+        REQUIRE(v <= LatencyHistogram::bucketMax(b));
+        REQUIRE(v > LatencyHistogram::bucketMax(b - 1));
+    }
+
+    // Buckets are within 1/SUB_BUCKETS of their value.
+    uint64_t big = 1234567;
+    uint64_t bMax = LatencyHistogram::bucketMax(LatencyHistogram::bucketFor(big));
+    REQUIRE(bMax >= big);
+    REQUIRE(bMax - big <= big / LatencyHistogram::SUB_BUCKETS);
+
+    // Values that are too large go in the last bucket.
+    REQUIRE(LatencyHistogram::bucketFor(LatencyHistogram::MAX_VALUE) == LatencyHistogram::BUCKET_COUNT - 1);
+    REQUIRE(LatencyHistogram::bucketFor(UINT64_MAX) == LatencyHistogram::BUCKET_COUNT - 1);
+    REQUIRE(LatencyHistogram::bucketMax(LatencyHistogram::BUCKET_COUNT - 1) == LatencyHistogram::MAX_VALUE);
+}
+
+TEST_CASE("Test LatencyHistogram percentiles", "[LatencyHistogram]") {
+    LatencyHistogram hist;
+    REQUIRE(hist.getCount() == 0);
+    REQUIRE(hist.getMin() == 0);
+    REQUIRE(hist.getMax() == 0);
+    REQUIRE(hist.getPercentile(50.0) == 0);
+    REQUIRE(hist.getMean() == 0.0);
+
+    for (uint64_t v = 1; v <= 1000; ++v) {
+        hist.record(v);
+    }
+    REQUIRE(hist.getCount() == 1000);
+    REQUIRE(hist.getMin() == 1);
+    REQUIRE(hist.getMax() == 1000);
+    REQUIRE(hist.getMean() == 500.5);
+    uint64_t p50 = hist.getPercentile(50.0);
+    REQUIRE(p50 >= 500);
+    REQUIRE(p50 <= 500 + 500 / LatencyHistogram::SUB_BUCKETS);
+    uint64_t p99 = hist.getPercentile(99.0);
+    REQUIRE(p99 >= 990);
+    REQUIRE(p99 <= 1000);
+    REQUIRE(hist.getPercentile(100.0) == 1000);
+    REQUIRE(hist.getPercentile(0.0) == 1);
+    LINFO("hist ", hist.getSummary());
+
+    // Merging doubles the counts without changing the percentiles.
+    LatencyHistogram other(hist);
+    hist.merge(other);
+    REQUIRE(hist.getCount() == 2000);
+    REQUIRE(hist.getPercentile(50.0) == p50);
+    REQUIRE(hist.getMean() == 500.5);
+
+    // An outlier only moves the top.
+    hist.record(50000000);
+    REQUIRE(hist.getMax() == 50000000);
+    REQUIRE(hist.getPercentile(50.0) == p50);
+    REQUIRE(hist.getPercentile(100.0) == 50000000);
+
+    hist.reset();
+    REQUIRE(hist.getCount() == 0);
+    REQUIRE(hist.getPercentile(99.0) == 0);
+}
@@ -24,7 +24,16 @@
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/catch_session.hpp>
 
+#include <atomic>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include "control/NetCommandDefs.h"
 #include "control/NetCommandFactory.h"
+#include "control/SeqIdValidator.h"
+#include "util/Bug.h"
+#include "util/JsonScan.h"
 #include "util/Log.h"
 
 using namespace std;
@@ -248,4 +257,398 @@ TEST_CASE("Test NetCommandFactory", "[Factory]") {
         LDEBUG("ackJson=", ackJ.dump());
         LDEBUG("respJson=", respJ.dump());
     }
+
+    {
+        string note = "NCmdEcho from a view into a larger buffer ";
+        LDEBUG(note);
+        string buf = "{\"id\":\"cmd_echo\",\"sequence_id\": 5, \"msg\":\"in a buffer\" }\r\n{\"id\":";
+        string_view jView(buf.data(), buf.find("\r\n"));
+        auto inNCmd = factory->getCommandFor(jView);
+        REQUIRE(dynamic_pointer_cast<NCmdEcho>(inNCmd) != nullptr);
+        REQUIRE(inNCmd->getSeqId() == 5);
+        REQUIRE(inNCmd->run() == true);
+        auto respJ = nlohmann::json::parse(inNCmd->getRespJsonStr());
+        REQUIRE(respJ["msg"] == "in a buffer");
+    }
+
+    {
+        string note = "Unparsable jStr ";
+        LDEBUG(note);
+        string truncated = "{\"id\":\"cmd_ack\",\"sequence_id\": ";
+        REQUIRE_THROWS_AS(factory->getCommandFor(truncated), NetCommandException);
+        REQUIRE_THROWS_AS(factory->getCommandFor("{\"id\":\"cmd_ack\"}"), NetCommandException);
+        // A sequence_id the scanner doesn't handle is still accepted by the full parser.
+        auto inNCmd = factory->getCommandFor("{\"id\":\"cmd_ack\",\"sequence_id\": 6e0 }");
+        REQUIRE(dynamic_pointer_cast<NCmdAck>(inNCmd) != nullptr);
+        REQUIRE(inNCmd->getSeqId() == 6);
+    }
+
+    {
+        string note = "Unparsable jStr doesn't use its sequence_id ";
+        LDEBUG(note);
+        // Each of these has a readable id and sequence_id, but isn't json.
+        for (string bad : {R"({"id":"cmd_ack","sequence_id":7,"x":tru})",
+                           R"({"id":"cmd_ack","sequence_id":7}garbage)",
+                           R"({"id":"cmd_ack","sequence_id":7,"x":01})",
+                           R"({"id":"cmd_ack","sequence_id":7,"x":[1,]})",
+                           R"({"id":"cmd_ack","sequence_id":7,"x":"\q"})"}) {
+            REQUIRE_THROWS_AS(factory->getCommandFor(bad), NetCommandException);
+        }
+        auto inNCmd = factory->getCommandFor(R"({"id":"cmd_ack","sequence_id":7})");
+        REQUIRE(dynamic_pointer_cast<NCmdAck>(inNCmd) != nullptr);
+        REQUIRE(inNCmd->getSeqId() == 7);
+    }
+}
+
+TEST_CASE("Test NetCommand wire format", "[NetCommand]") {
+    // The ack and response are written without nlohmann::json, they must
+    // be the same as what nlohmann::json writes for the same values.
+    auto factory = NetCommandFactory::create();
+    factory->addNetCommand(NCmdAck::createFactoryVersion());
+    factory->addNetCommand(NCmdEcho::createFactoryVersion());
+    factory->addNetCommand(NCmdSwitchCommandSource::createFactoryVersion());
+
+    auto sameAsNlohmann = [](string const& str) { return str == nlohmann::json::parse(str).dump(); };
+
+    {
+        auto cmd = factory->getCommandFor(R"({"id":"cmd_ack","sequence_id": 1 })");
+        REQUIRE(sameAsNlohmann(cmd->getAckJsonStr()));
+        REQUIRE(cmd->run() == true);
+        REQUIRE(cmd->getRespJsonStr() == R"({"id":"success","sequence_id":1,"user_info":""})");
+    }
+    {
+        // Quotes, backslashes, and control characters must be escaped.
+        string msg = "q\"b\\n\nt\tc\x01\x1f/\xc3\xa9";
+        nlohmann::json inJ = {{"id", "cmd_echo"}, {"sequence_id", 2}, {"msg", msg}};
+        auto cmd = factory->getCommandFor(inJ.dump());
+        REQUIRE(dynamic_pointer_cast<NCmdEcho>(cmd) != nullptr);
+        REQUIRE(sameAsNlohmann(cmd->getAckJsonStr()));
+        REQUIRE(cmd->run() == true);
+        string respStr = cmd->getRespJsonStr();
+        REQUIRE(sameAsNlohmann(respStr));
+        REQUIRE(nlohmann::json::parse(respStr)["msg"] == msg);
+    }
+    {
+        // The noack user_info contains the escaped name of the bad command.
+        nlohmann::json inJ = {{"id", "cmd_\"x\\\n\x02"}, {"sequence_id", 3}};
+        auto cmd = factory->getCommandFor(inJ.dump());
+        REQUIRE(dynamic_pointer_cast<NCmdNoAck>(cmd) != nullptr);
+        string ackStr = cmd->getAckJsonStr();
+        REQUIRE(sameAsNlohmann(ackStr));
+        string userInfo = nlohmann::json::parse(ackStr)["user_info"];
+        REQUIRE(userInfo.find(inJ["id"].get<string>()) != string::npos);
+        REQUIRE(cmd->run() == false);
+        REQUIRE(cmd->getRespJsonStr() == R"({"id":"fail","sequence_id":3,"user_info":""})");
+    }
+    {
+        // Typed fields with the wrong type or missing are rejected.
+        string jStr = R"({"id":"cmd_switchCommandSource","sequence_id": 4, "isRemote":1})";
+        REQUIRE(dynamic_pointer_cast<NCmdNoAck>(factory->getCommandFor(jStr)) != nullptr);
+        jStr = R"({"id":"cmd_switchCommandSource","sequence_id": 5})";
+        REQUIRE(dynamic_pointer_cast<NCmdNoAck>(factory->getCommandFor(jStr)) != nullptr);
+        jStr = R"({"id":"cmd_switchCommandSource","sequence_id": 6, "isRemote":false})";
+        auto cmd = factory->getCommandFor(jStr);
+        REQUIRE(dynamic_pointer_cast<NCmdSwitchCommandSource>(cmd) != nullptr);
+        REQUIRE(cmd->getAckJsonStr() ==
+                R"({"id":"ack","sequence_id":6,"user_info":"cmd_switchCommandSource 0"})");
+    }
+    {
+        // Text that nlohmann::json can't parse is rejected before a command is made,
+        // and ComControl answers it with the factory default noack.
+        for (string bad : {R"({"id":"cmd_ack","sequence_id":7,"x":tru})",
+                           R"({"id":"cmd_ack","sequence_id":7}garbage)",
+                           "{\"id\":\"cmd_echo\",\"sequence_id\":7,\"msg\":\"\xff\xfe\"}",
+                           "{\"id\":\"cmd_echo\",\"sequence_id\":7,\"msg\":\"\xc0\xaf\"}",
+                           "{\"id\":\"cmd_echo\",\"sequence_id\":7,\"msg\":\"\xed\xa0\x80\"}",
+                           "{\"id\":\"cmd_echo\",\"sequence_id\":7,\"msg\":\"\xe2\x82\"}"}) {
+            REQUIRE(nlohmann::json::accept(bad) == false);
+            REQUIRE_THROWS_AS(factory->getCommandFor(bad), NetCommandException);
+        }
+        REQUIRE(factory->getNoAck()->getAckJsonStr() ==
+                R"({"id":"noack","sequence_id":0,"user_info":"factory default noack"})");
+    }
+    {
+        // The last of duplicate keys is used, including keys that are only the same once unescaped.
+        auto cmd = factory->getCommandFor(R"({"id":"cmd_ack","id":"cmd_echo","sequence_id":7,)"
+                                          R"("msg":"first","sequence_id":8,"msg":"last"})");
+        REQUIRE(dynamic_pointer_cast<NCmdEcho>(cmd) != nullptr);
+        REQUIRE(cmd->getSeqId() == 8);
+        REQUIRE(cmd->run() == true);
+        REQUIRE(nlohmann::json::parse(cmd->getRespJsonStr())["msg"] == "last");
+        cmd = factory->getCommandFor(R"({"id":"cmd_ack","i\u0064":"cmd_echo","sequence_id":9,"msg":"x",)"
+                                     R"("ms\u0067":"escaped"})");
+        REQUIRE(dynamic_pointer_cast<NCmdEcho>(cmd) != nullptr);
+        REQUIRE(cmd->run() == true);
+        REQUIRE(nlohmann::json::parse(cmd->getRespJsonStr())["msg"] == "escaped");
+    }
+    {
+        // Multibyte utf-8 is passed through unchanged.
+        string utf8 = "\xc3\xa9\xf0\x9f\x98\x80";
+        auto cmd = factory->getCommandFor(R"({"id":"cmd_echo","sequence_id":10,"msg":")" + utf8 + R"("})");
+        REQUIRE(cmd->run() == true);
+        string respStr = cmd->getRespJsonStr();
+        REQUIRE(sameAsNlohmann(respStr));
+        REQUIRE(nlohmann::json::parse(respStr)["msg"] == utf8);
+    }
+}
+
+TEST_CASE("Test NetCommandFactory freeze", "[Factory]") {
+    auto factory = NetCommandFactory::create();
+    factory->addNetCommand(NCmdAck::createFactoryVersion());
+    REQUIRE(factory->isFrozen() == false);
+    factory->freeze();
+    REQUIRE(factory->isFrozen() == true);
+    REQUIRE_THROWS_AS(factory->addNetCommand(NCmdEcho::createFactoryVersion()), NetCommandException);
+
+    // Lookups still work, and the command that wasn't added is unknown.
+    auto cmd = factory->getCommandFor(R"({"id":"cmd_ack","sequence_id": 1 })");
+    REQUIRE(dynamic_pointer_cast<NCmdAck>(cmd) != nullptr);
+    cmd = factory->getCommandFor(R"({"id":"cmd_echo","sequence_id": 2, "msg":"m" })");
+    REQUIRE(dynamic_pointer_cast<NCmdNoAck>(cmd) != nullptr);
+
+    // Power and shutdown commands go ahead of routine ones.
+    using LSST::m2cellcpp::util::CommandExecutor;
+    REQUIRE(cmd->getLane() == CommandExecutor::ROUTINE);
+    REQUIRE(NCmdPower::createFactoryVersion()->getLane() == CommandExecutor::POWER);
+    REQUIRE(NCmdSystemShutdown::createFactoryVersion()->getLane() == CommandExecutor::SAFETY);
+
+    // The lane can be found from the "id" before the command is created.
+    auto laneFactory = NetCommandFactory::create();
+    laneFactory->addNetCommand(NCmdAck::createFactoryVersion());
+    laneFactory->addNetCommand(NCmdSystemShutdown::createFactoryVersion());
+    REQUIRE(laneFactory->getLaneFor("cmd_ack") == CommandExecutor::ROUTINE);
+    REQUIRE(laneFactory->getLaneFor("cmd_systemShutdown") == CommandExecutor::SAFETY);
+    REQUIRE(laneFactory->getLaneFor("cmd_unknown") == CommandExecutor::ROUTINE);
+}
+
+TEST_CASE("Test NetCommandStats", "[NetCommand]") {
+    auto factory = NetCommandFactory::create();
+    factory->addNetCommand(NCmdEcho::createFactoryVersion());
+    factory->freeze();
+    auto stats = factory->getStats();
+
+    // The factory stamps the stages it handles.
+    auto start = LSST::m2cellcpp::util::CLOCK::now();
+    auto cmd = factory->getCommandFor(R"({"id":"cmd_echo","sequence_id": 1, "msg":"m" })");
+    REQUIRE(cmd->hasStage(NetCommand::SCANNED));
+    REQUIRE(cmd->hasStage(NetCommand::LOOKED_UP));
+    REQUIRE(cmd->hasStage(NetCommand::CREATED));
+    REQUIRE(cmd->hasStage(NetCommand::RECEIVED) == false);
+    REQUIRE(cmd->getStageTime(NetCommand::SCANNED) >= start);
+
+    // Intervals with a missing stage aren't recorded.
+    stats->record(*cmd);
+    auto hists = stats->getHistograms("cmd_echo");
+    REQUIRE(hists[NetCommandStats::LOOKUP].getCount() == 1);
+    REQUIRE(hists[NetCommandStats::CREATE].getCount() == 1);
+    REQUIRE(hists[NetCommandStats::SCAN].getCount() == 0);
+    REQUIRE(hists[NetCommandStats::TOTAL].getCount() == 0);
+
+    cmd->markStage(NetCommand::RECEIVED, start - chrono::microseconds(100));
+    cmd->markStage(NetCommand::FINAL_SENT, start + chrono::microseconds(900));
+    stats->record(*cmd);
+    hists = stats->getHistograms("cmd_echo");
+    REQUIRE(hists[NetCommandStats::LOOKUP].getCount() == 2);
+    REQUIRE(hists[NetCommandStats::TOTAL].getCount() == 1);
+    REQUIRE(hists[NetCommandStats::TOTAL].getMax() == 1000);
+
+    auto js = stats->getJson();
+    REQUIRE(js["cmd_echo"]["total"]["count"] == 1);
+    REQUIRE(js["cmd_echo"]["total"]["p50"] == 1000);
+    REQUIRE(js["cmd_echo"]["queue"]["count"] == 0);
+    REQUIRE(stats->getSummary().find("cmd_echo") != string::npos);
+
+    stats->reset();
+    REQUIRE(stats->getJson().empty());
+    REQUIRE(stats->getHistograms("cmd_echo")[NetCommandStats::TOTAL].getCount() == 0);
+}
+
+TEST_CASE("Test JsonScan splitArray", "[NetCommand]") {
+    LSST::m2cellcpp::util::Log::getLog().useEnvironmentLogLvl();
+    using LSST::m2cellcpp::util::JsonScan;
+
+    // Arrays are split into the raw text of their elements, which is how
+    // `NCmdBatch` separates its commands.
+    vector<string_view> elems;
+    REQUIRE(JsonScan::splitArray(R"([ {"a":[1,2]}, "s,]", 3 ,true])", elems));
+    REQUIRE(elems.size() == 4);
+    REQUIRE(elems[0] == R"({"a":[1,2]})");
+    REQUIRE(elems[1] == R"("s,]")");
+    REQUIRE(elems[2] == "3");
+    REQUIRE(elems[3] == "true");
+    REQUIRE(JsonScan::splitArray("[]", elems));
+    REQUIRE(elems.empty());
+    REQUIRE(JsonScan::splitArray("[1,2", elems) == false);
+    REQUIRE(JsonScan::splitArray(R"({"a":1})", elems) == false);
+}
+
+TEST_CASE("Test NCmdBatch", "[NetCommand]") {
+    auto factory = NetCommandFactory::create();
+    factory->addNetCommand(NCmdAck::createFactoryVersion());
+    factory->addNetCommand(NCmdEcho::createFactoryVersion());
+    factory->addNetCommand(NCmdBatch::createFactoryVersion(factory));
+    factory->freeze();
+
+    // One ack and one final response for all of the items.
+    string jStr = R"({"id":"cmd_batch","sequence_id":10,"commands":[)"
+                  R"({"id":"cmd_echo","sequence_id":11,"msg":"one"},)"
+                  R"({"id":"cmd_ack","sequence_id":12},)"
+                  R"({"id":"cmd_echo","sequence_id":13,"msg":"three"}]})";
+    auto cmd = factory->getCommandFor(jStr);
+    auto batch = dynamic_pointer_cast<NCmdBatch>(cmd);
+    REQUIRE(batch != nullptr);
+    REQUIRE(batch->getItems().size() == 3);
+    auto ackJ = nlohmann::json::parse(cmd->getAckJsonStr());
+    REQUIRE(ackJ["id"] == "ack");
+    REQUIRE(ackJ["sequence_id"] == 10);
+    REQUIRE(ackJ["user_info"] == "cmd_batch 3");
+    REQUIRE(cmd->getLane() == LSST::m2cellcpp::util::CommandExecutor::ROUTINE);
+
+    REQUIRE(cmd->run());
+    auto finJ = nlohmann::json::parse(cmd->getRespJsonStr());
+    REQUIRE(finJ["id"] == "success");
+    REQUIRE(finJ["sequence_id"] == 10);
+    auto const& results = finJ["results"];
+    REQUIRE(results.size() == 3);
+    REQUIRE(results[0]["id"] == "success");
+    REQUIRE(results[0]["sequence_id"] == 11);
+    REQUIRE(results[0]["msg"] == "one");
+    REQUIRE(results[1]["sequence_id"] == 12);
+    REQUIRE(results[2]["msg"] == "three");
+
+    // Batches that can't be run completely are noacked.
+    auto noAckFor = [&factory](string const& str) {
+        auto bad = factory->getCommandFor(str);
+        REQUIRE(dynamic_pointer_cast<NCmdNoAck>(bad) != nullptr);
+        return nlohmann::json::parse(bad->getAckJsonStr())["user_info"].get<string>();
+    };
+    // Unknown item.
+    string info = noAckFor(R"({"id":"cmd_batch","sequence_id":20,"commands":[)"
+                           R"({"id":"cmd_ack","sequence_id":21},{"id":"cmd_nope","sequence_id":22}]})");
+    REQUIRE(info.find("sequence_id=22") != string::npos);
+    // Items out of order.
+    noAckFor(R"({"id":"cmd_batch","sequence_id":30,"commands":[)"
+             R"({"id":"cmd_ack","sequence_id":32},{"id":"cmd_ack","sequence_id":31}]})");
+    // Nested, empty, and missing.
+    noAckFor(R"({"id":"cmd_batch","sequence_id":40,"commands":[)"
+             R"({"id":"cmd_batch","sequence_id":41,"commands":[]}]})");
+    noAckFor(R"({"id":"cmd_batch","sequence_id":50,"commands":[]})");
+    noAckFor(R"({"id":"cmd_batch","sequence_id":60})");
+}
+
+TEST_CASE("Test SeqIdValidator", "[Factory]") {
+    string why;
+    {
+        // Ids must increase.
+        auto strict = SeqIdValidator::create();
+        REQUIRE(strict->getWindow() == 0);
+        REQUIRE_FALSE(strict->check(0, why));
+        REQUIRE(strict->check(1, why));
+        REQUIRE_FALSE(strict->check(1, why));
+        REQUIRE(strict->check(3, why));
+        REQUIRE_FALSE(strict->check(2, why));
+        REQUIRE(why == "previous sequence_id was 3");
+        REQUIRE(strict->getHighest() == 3);
+        REQUIRE(strict->getRejectedCount() == 3);
+    }
+    {
+        // Ids may be out of order within the window, but only used once.
+        auto windowed = SeqIdValidator::create(4);
+        REQUIRE(windowed->check(10, why));
+        REQUIRE(windowed->check(8, why));
+        REQUIRE(windowed->check(9, why));
+        REQUIRE_FALSE(windowed->check(8, why));
+        REQUIRE(why == "sequence_id 8 was already used");
+        REQUIRE(windowed->check(7, why));
+        REQUIRE_FALSE(windowed->check(6, why));
+        REQUIRE(windowed->check(12, why));
+        REQUIRE(windowed->check(11, why));
+        REQUIRE_FALSE(windowed->check(0, why));
+        REQUIRE(windowed->getHighest() == 12);
+        REQUIRE(windowed->getRejectedCount() == 3);
+    }
+    {
+        // The window works for ids near the largest possible id.
+        auto windowed = SeqIdValidator::create(4);
+        uint64_t const top = numeric_limits<uint64_t>::max();
+        REQUIRE(windowed->check(top - 1, why));
+        REQUIRE(windowed->check(top - 3, why));
+        REQUIRE_FALSE(windowed->check(top - 5, why));
+        REQUIRE(windowed->check(top, why));
+        REQUIRE(windowed->getHighest() == top);
+    }
+    REQUIRE_THROWS_AS(SeqIdValidator::create(SeqIdValidator::MAX_WINDOW + 1), LSST::m2cellcpp::util::Bug);
+    for (auto policy : {SeqIdValidator::STRICT, SeqIdValidator::PER_CONNECTION, SeqIdValidator::WINDOWED}) {
+        REQUIRE(SeqIdValidator::parsePolicy(SeqIdValidator::getPolicyName(policy)) == policy);
+    }
+    REQUIRE_THROWS_AS(SeqIdValidator::parsePolicy("loose"), LSST::m2cellcpp::util::Bug);
+
+    // Threads checking the same ids at once never get an id accepted twice.
+    for (unsigned int window : {0u, 64u}) {
+        auto shared = SeqIdValidator::create(window);
+        uint64_t const idCount = 2000;
+        vector<atomic<int>> accepted(idCount + 1);
+        vector<thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&shared, &accepted, idCount]() {
+                string threadWhy;
+                for (uint64_t id = 1; id <= idCount; ++id) {
+                    if (shared->check(id, threadWhy)) {
+                        ++accepted[id];
+                    }
+                }
+            });
+        }
+        for (auto& thrd : threads) {
+            thrd.join();
+        }
+        bool onceEach = true;
+        int total = 0;
+        for (auto const& count : accepted) {
+            onceEach = onceEach && count <= 1;
+            total += count;
+        }
+        REQUIRE(onceEach);
+        REQUIRE(shared->getHighest() == idCount);
+        REQUIRE(total + shared->getRejectedCount() == 4 * idCount);
+    }
+
+    // The factory gives each connection its own validator unless the policy is STRICT.
+    auto factory = NetCommandFactory::create();
+    factory->addNetCommand(NCmdAck::createFactoryVersion());
+    factory->addNetCommand(NCmdBatch::createFactoryVersion(factory));
+    factory->freeze();
+    auto isAck = [&factory](string const& str, SeqIdValidator::Ptr const& seqIds) {
+        return factory->getCommandFor(str, seqIds)->isAcked();
+    };
+    string ack5 = R"({"id":"cmd_ack","sequence_id":5})";
+    REQUIRE(factory->getSeqIdPolicy() == SeqIdValidator::STRICT);
+    auto connA = factory->makeSeqIdValidator();
+    auto connB = factory->makeSeqIdValidator();
+    REQUIRE(connA == connB);
+    REQUIRE(isAck(ack5, connA));
+    REQUIRE_FALSE(isAck(ack5, connB));
+
+    factory->setSeqIdPolicy(SeqIdValidator::PER_CONNECTION, 0);
+    connA = factory->makeSeqIdValidator();
+    connB = factory->makeSeqIdValidator();
+    REQUIRE(connA != connB);
+    REQUIRE(isAck(ack5, connA));
+    REQUIRE(isAck(ack5, connB));
+    REQUIRE_FALSE(isAck(ack5, connA));
+
+    // Batch items are checked by the batch's validator.
+    string batch = R"({"id":"cmd_batch","sequence_id":10,"commands":[)"
+                   R"({"id":"cmd_ack","sequence_id":11},{"id":"cmd_ack","sequence_id":12}]})";
+    REQUIRE(isAck(batch, connA));
+    REQUIRE(connA->getHighest() == 12);
+    REQUIRE(connB->getHighest() == 5);
+
+    REQUIRE_THROWS_AS(factory->setSeqIdPolicy(SeqIdValidator::WINDOWED, 0), LSST::m2cellcpp::util::Bug);
+    factory->setSeqIdPolicy(SeqIdValidator::WINDOWED, 8);
+    auto connW = factory->makeSeqIdValidator();
+    REQUIRE(connW->getWindow() == 8);
+    REQUIRE(isAck(R"({"id":"cmd_ack","sequence_id":20})", connW));
+    REQUIRE(isAck(R"({"id":"cmd_ack","sequence_id":15})", connW));
+    REQUIRE_FALSE(isAck(R"({"id":"cmd_ack","sequence_id":15})", connW));
 }
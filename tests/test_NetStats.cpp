@@ -0,0 +1,104 @@
+/*
+ * This file is part of LSST ts_m2cellcpp test suite.
+ *
+ * Developed for the Vera C. Rubin Observatory Telescope & Site Software Systems.
+ * This product includes software developed by the Vera C.Rubin Observatory Project
+ * (https://www.lsst.org). See the COPYRIGHT file at the top-level directory of
+ * this distribution for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#define CATCH_CONFIG_MAIN
+
+// System headers
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// 3rd party headers
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_session.hpp>
+
+// Project headers
+#include "system/NetStats.h"
+#include "util/Log.h"
+
+using namespace std;
+using namespace LSST::m2cellcpp;
+using namespace LSST::m2cellcpp::system;
+
+TEST_CASE("Test NetStats", "[NetStats]") {
+    util::Log::getLog().useEnvironmentLogLvl();
+
+    // Everything recorded on a connection is added to its server.
+    auto server = NetStats::create();
+    auto connA = NetStats::create(server);
+    auto connB = NetStats::create(server);
+    connA->recordIn(100, 2);
+    connA->recordOut(300, 3);
+    connB->recordOut(50, 1);
+    connA->recordQueueDelay(10);
+    connA->recordQueueDelay(30);
+    connB->recordQueueDelay(200);
+    connB->recordError();
+    REQUIRE(connA->getBytesIn() == 100);
+    REQUIRE(connA->getMsgsOut() == 3);
+    REQUIRE(connA->getErrors() == 0);
+    REQUIRE(connA->getQueueDelayMean() == 20.0);
+    REQUIRE(connA->getQueueDelayMax() == 30);
+    REQUIRE(server->getBytesIn() == 100);
+    REQUIRE(server->getBytesOut() == 350);
+    REQUIRE(server->getMsgsOut() == 4);
+    REQUIRE(server->getErrors() == 1);
+    REQUIRE(server->getQueueDelayCount() == 3);
+    REQUIRE(server->getQueueDelayMax() == 200);
+    auto js = server->getJson();
+    REQUIRE(js["bytesOut"] == 350);
+    REQUIRE(js["queueDelayMeanMicros"] == 80.0);
+    REQUIRE(NetStats::create()->getQueueDelayMean() == 0.0);
+
+    // Registered sources, those returning null are left out.
+    NetStats::registerSource("testA", [server]() { return server->getJson(); });
+    NetStats::registerSource("testGone", []() { return nlohmann::json(); });
+    auto allJ = NetStats::getAllJson();
+    REQUIRE(allJ["testA"]["bytesIn"] == 100);
+    REQUIRE_FALSE(allJ.contains("testGone"));
+    NetStats::unregisterSource("testA");
+    NetStats::unregisterSource("testGone");
+    REQUIRE(NetStats::getAllJson().empty());
+
+    // TCP_INFO needs a TCP socket.
+    REQUIRE_FALSE(TcpInfoSample::sample(-1).valid);
+    REQUIRE(TcpInfoSample::sample(-1).getJson().is_null());
+    int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    REQUIRE(bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+    REQUIRE(listen(listenFd, 1) == 0);
+    socklen_t len = sizeof(addr);
+    REQUIRE(getsockname(listenFd, (struct sockaddr*)&addr, &len) == 0);
+    int clientFd = socket(AF_INET, SOCK_STREAM, 0);
+    REQUIRE(connect(clientFd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+    auto smp = TcpInfoSample::sample(clientFd);
+    REQUIRE(smp.valid);
+    REQUIRE(smp.sendCwnd > 0);
+    REQUIRE(smp.getJson()["rttMicros"].is_number());
+    close(clientFd);
+    close(listenFd);
+}
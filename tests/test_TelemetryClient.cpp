@@ -0,0 +1,180 @@
+/*
+ * This file is part of LSST ts_m2cellcpp test suite.
+ *
+ * Developed for the Vera C. Rubin Observatory Telescope & Site Software Systems.
+ * This product includes software developed by the Vera C.Rubin Observatory Project
+ * (https://www.lsst.org). See the COPYRIGHT file at the top-level directory of
+ * this distribution for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define CATCH_CONFIG_MAIN
+
+// System headers
+#include <csignal>
+#include <exception>
+
+// 3rd party headers
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_session.hpp>
+
+// Project headers
+#include "system/TelemetryClient.h"
+#include "system/TelemetryCom.h"
+#include "system/TelemetryMap.h"
+#include "util/JsonScan.h"
+#include "util/Log.h"
+
+using namespace std;
+using namespace LSST::m2cellcpp::system;
+using LSST::m2cellcpp::util::JsonScan;
+
+TEST_CASE("Test JsonScan", "[JsonScan]") {
+    LSST::m2cellcpp::util::Log::getLog().useEnvironmentLogLvl();
+
+    string jStr = R"({"a":[1,{"id":"no"}],"id":"cmd_echo", "msg":"x\"y}", "n" : {"q":"}"},)"
+                  R"("sequence_id":12345,"neg":-7,"f":1.5,"t":true})";
+    JsonScan scan(jStr);
+    REQUIRE(scan.isValid());
+    REQUIRE(scan.getMembers().size() == 8);
+    string_view id;
+    REQUIRE(scan.getString("id", id));
+    REQUIRE(id == "cmd_echo");
+    string_view msg;
+    REQUIRE(scan.getString("msg", msg));
+    REQUIRE(msg == R"(x\"y})");
+    REQUIRE(scan.getRaw("n") == R"({"q":"}"})");
+    REQUIRE(scan.getRaw("a") == R"([1,{"id":"no"}])");
+    uint64_t seqId = 0;
+    REQUIRE(scan.getUInt64("sequence_id", seqId));
+    REQUIRE(seqId == 12345);
+    int64_t neg = 0;
+    REQUIRE(scan.getInt64("neg", neg));
+    REQUIRE(neg == -7);
+    REQUIRE(scan.getUInt64("neg", seqId) == false);
+    REQUIRE(scan.getUInt64("f", seqId) == false);
+    REQUIRE(scan.getString("sequence_id", id) == false);
+    REQUIRE(scan.getRaw("t") == "true");
+    REQUIRE(scan.getRaw("missing").empty());
+
+    REQUIRE(JsonScan("{}").isValid());
+    REQUIRE(JsonScan("").isValid() == false);
+    REQUIRE(JsonScan("junk").isValid() == false);
+    REQUIRE(JsonScan(R"({"id":"abc")").isValid() == false);
+    REQUIRE(JsonScan(R"({"id":"abc)").isValid() == false);
+    REQUIRE(JsonScan(R"({"id" "abc"})").isValid() == false);
+
+    // Only valid json is accepted, the same as nlohmann::json.
+    for (string jsonStr : {R"({"a":tru})", R"({"a":1}x)", R"({"a":1}{})", R"({"a":01})", R"({"a":1.})",
+                           R"({"a":-})", R"({"a":1e})", R"({"a":[1,]})", R"({"a":{"b":1,}})",
+                           R"({"a":{1:2}})", R"({"a":"\q"})", R"({"a":"\u12"})", R"({"a":"\ud800"})",
+                           R"({"a":"\udc00"})", "{\"a\":\"\t\"}", R"({"a":[{"b":[}]})", R"({"a":1,})"}) {
+        REQUIRE(nlohmann::json::accept(jsonStr) == false);
+        REQUIRE(JsonScan(jsonStr).isValid() == false);
+    }
+    for (string jsonStr : {R"( {"a":true} )", R"({"a":-0.5e+3,"b":null,"c":false})", R"({"a":[[],{},[{}]]})",
+                           R"({"a":"\"\\\/\b\f\n\r\té😀"})", "\xEF\xBB\xBF{}"}) {
+        REQUIRE(nlohmann::json::accept(jsonStr));
+        REQUIRE(JsonScan(jsonStr).isValid());
+    }
+    // Deep nesting is checked without recursion.
+    string deep = "{\"a\":" + string(100000, '[') + string(100000, ']') + "}";
+    REQUIRE(JsonScan(deep).isValid());
+    REQUIRE(JsonScan(deep.substr(1)).isValid() == false);
+}
+
+TEST_CASE("Test TelemetryClient", "[TelemetryClient]") {
+    LSST::m2cellcpp::util::Log::getLog().useEnvironmentLogLvl();
+    signal(SIGPIPE, SIG_IGN);
+
+    int const port = 10095;
+    auto servTelemetryMap = TelemetryMap::Ptr(new TelemetryMap());
+    servTelemetryMap->getPowerStatus()->getMotorVoltage().setVal(-3.0);
+    servTelemetryMap->getPowerStatus()->getCommCurrent().setVal(6.0);
+    servTelemetryMap->getPosition()->getZ().setVal(3.0);
+
+    auto ioContext = make_shared<boost::asio::io_context>();
+    auto client = TelemetryClient::create(ioContext, "127.0.0.1", port);
+    client->setBackoff(20ms, 200ms);
+
+    // Callbacks run on the io_context thread, so they count problems
+    // instead of using REQUIRE.
+    auto clientMap = TelemetryMap::Ptr(new TelemetryMap());
+    atomic<int> powerStatusCount{0};
+    atomic<int> otherCount{0};
+    atomic<int> connectChanges{0};
+    atomic<int> badItems{0};
+    client->setItemCallback("powerStatus", [&](TelemetryClient::ItemView const& item) {
+        if (item.getId() != "powerStatus") ++badItems;
+        clientMap->setItemFromJson(item.parse());
+        ++powerStatusCount;
+    });
+    client->setDefaultCallback([&](TelemetryClient::ItemView const& item) {
+        string_view id;
+        if (!item.getScan().getString("id", id) || id != item.getId()) ++badItems;
+        ++otherCount;
+    });
+    client->setConnectCallback([&](bool connected) { ++connectChanges; });
+
+    // Start the client before the server exists, it should keep retrying.
+    client->start();
+    REQUIRE_THROWS(client->setDefaultCallback(nullptr));
+    thread ioThrd([ioContext]() {
+        auto work = boost::asio::make_work_guard(*ioContext);
+        ioContext->run();
+    });
+    this_thread::sleep_for(300ms);
+    REQUIRE(client->isConnected() == false);
+    REQUIRE(client->getConnectCount() == 0);
+
+    auto serv = TelemetryCom::create(servTelemetryMap, port);
+    serv->startServer();
+    REQUIRE(serv->waitForServerRunning(5) == true);
+    for (int j = 0; j < 50 && powerStatusCount < 3; ++j) {
+        this_thread::sleep_for(100ms);
+    }
+    REQUIRE(client->isConnected() == true);
+    REQUIRE(client->getConnectCount() == 1);
+    REQUIRE(powerStatusCount >= 3);
+    REQUIRE(otherCount > powerStatusCount);
+    REQUIRE(clientMap->getPowerStatus()->compareItem(*servTelemetryMap->getPowerStatus()));
+
+    // Lose the server and bring up a new one, the client should reconnect.
+    serv->shutdownCom();
+    serv.reset();
+    for (int j = 0; j < 50 && client->isConnected(); ++j) {
+        this_thread::sleep_for(100ms);
+    }
+    REQUIRE(client->isConnected() == false);
+    servTelemetryMap->getPowerStatus()->getMotorVoltage().setVal(-9.0);
+    serv = TelemetryCom::create(servTelemetryMap, port);
+    serv->startServer();
+    REQUIRE(serv->waitForServerRunning(5) == true);
+    for (int j = 0; j < 50 && client->getConnectCount() < 2; ++j) {
+        this_thread::sleep_for(100ms);
+    }
+    REQUIRE(client->getConnectCount() == 2);
+    this_thread::sleep_for(300ms);
+    REQUIRE(clientMap->getPowerStatus()->compareItem(*servTelemetryMap->getPowerStatus()));
+
+    client->stop();
+    this_thread::sleep_for(200ms);
+    REQUIRE(client->isConnected() == false);
+    REQUIRE(connectChanges == 4);
+    REQUIRE(badItems == 0);
+    serv->shutdownCom();
+    ioContext->stop();
+    ioThrd.join();
+}
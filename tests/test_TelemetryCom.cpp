@@ -35,6 +35,7 @@
 #include "system/TelemetryItem.h"
 #include "system/TelemetryMap.h"
 #include "util/Log.h"
+#include "util/TimedSignal.h"
 
 using namespace std;
 using namespace LSST::m2cellcpp::system;
@@ -166,6 +167,107 @@ TEST_CASE("Test TelemetryItem", "[TelemetryItem]") {
     LDEBUG("TelemetryItem::test() end");
 }
 
+TEST_CASE("Test TimedSignal", "[TimedSignal]") {
+    LSST::m2cellcpp::util::Log::getLog().useEnvironmentLogLvl();
+    using LSST::m2cellcpp::util::TimedSignal;
+    using LSST::m2cellcpp::util::TIMEPOINT;
+    using LSST::m2cellcpp::util::CLOCK;
+
+    TIMEPOINT t0 = CLOCK::now();
+    auto tAt = [&t0](double sec) {
+        return t0 + chrono::duration_cast<CLOCK::duration>(chrono::duration<double>(sec));
+    };
+
+    double staleLimit = 1.0;
+    double maxExtrap = 0.5;
+    TimedSignal sig("testSig", 4, staleLimit, maxExtrap);
+    bool staleCalled = false;
+    bool staleVal = false;
+    sig.setStaleCallback([&staleCalled, &staleVal](bool stale, string const& msg) {
+        staleCalled = true;
+        staleVal = stale;
+    });
+
+    // No samples, so nothing valid, and stale is never reported.
+    auto res = sig.getValueAt(tAt(0.0), TimedSignal::LINEAR);
+    REQUIRE(res.valid == false);
+    REQUIRE(res.stale == true);
+    REQUIRE(sig.checkStale(tAt(100.0)) == false);
+    REQUIRE(staleCalled == false);
+
+    // A single sample can only be held.
+    REQUIRE(sig.addSample(10.0, tAt(0.0)));
+    res = sig.getValueAt(tAt(0.2), TimedSignal::LINEAR);
+    REQUIRE(res.valid);
+    REQUIRE(res.val == 10.0);
+    REQUIRE(res.stale == false);
+
+    // Interpolation between samples.
+    REQUIRE(sig.addSample(20.0, tAt(0.1)));
+    REQUIRE(sig.addSample(30.0, tAt(0.2)));
+    res = sig.getValueAt(tAt(0.15), TimedSignal::LINEAR);
+    REQUIRE(abs(res.val - 25.0) < 0.0001);
+    res = sig.getValueAt(tAt(0.15), TimedSignal::HOLD);
+    REQUIRE(res.val == 20.0);
+
+    // Before the oldest sample, the oldest value is used.
+    res = sig.getValueAt(tAt(-1.0), TimedSignal::LINEAR);
+    REQUIRE(res.val == 10.0);
+
+    // Extrapolation past the newest sample.
+    res = sig.getValueAt(tAt(0.3), TimedSignal::LINEAR);
+    REQUIRE(abs(res.val - 40.0) < 0.0001);
+    REQUIRE(abs(res.ageSec - 0.1) < 0.0001);
+    res = sig.getValueAt(tAt(0.3), TimedSignal::HOLD);
+    REQUIRE(res.val == 30.0);
+
+    // Extrapolation is limited to `maxExtrap` past the newest sample.
+    res = sig.getValueAt(tAt(5.0), TimedSignal::LINEAR);
+    REQUIRE(abs(res.val - 80.0) < 0.0001);
+    REQUIRE(res.stale == true);
+
+    // Out of order samples are rejected and the ring buffer only keeps `capacity` samples.
+    REQUIRE(sig.addSample(0.0, tAt(0.05)) == false);
+    REQUIRE(sig.addSample(40.0, tAt(0.3)));
+    REQUIRE(sig.addSample(50.0, tAt(0.4)));
+    REQUIRE(sig.size() == 4);
+    res = sig.getValueAt(tAt(0.0), TimedSignal::LINEAR);
+    REQUIRE(res.val == 20.0);
+
+    // Staleness transitions call the callback once for each change.
+    REQUIRE(sig.checkStale(tAt(0.5)) == false);
+    REQUIRE(staleCalled == false);
+    REQUIRE(sig.checkStale(tAt(2.0)) == true);
+    REQUIRE(staleCalled == true);
+    REQUIRE(staleVal == true);
+    staleCalled = false;
+    REQUIRE(sig.checkStale(tAt(3.0)) == true);
+    REQUIRE(staleCalled == false);
+    REQUIRE(sig.addSample(60.0, tAt(3.0)));
+    REQUIRE(sig.checkStale(tAt(3.1)) == false);
+    REQUIRE(staleCalled == true);
+    REQUIRE(staleVal == false);
+
+    // TelemetryMap timestamps `tel_elevation` on arrival.
+    TelemetryMap tMap;
+    REQUIRE(tMap.getTelElevationAt(CLOCK::now()).valid == false);
+    REQUIRE(tMap.setItemFromJsonStr(R"({"id":"tel_elevation","actualPosition":45.5,"compName":"MTMount"})") !=
+            nullptr);
+    auto elev = tMap.getTelElevationAt(CLOCK::now());
+    REQUIRE(elev.valid);
+    REQUIRE(elev.val == 45.5);
+    REQUIRE(elev.stale == false);
+    REQUIRE(tMap.getTelElevationSignal()->size() == 1);
+
+    // A copy has its own signal history with the same stale limit.
+    tMap.setExternalStaleLimitSec(4.5);
+    TelemetryMap tMapCopy(tMap);
+    REQUIRE(tMapCopy.getTelElevationSignal() != tMap.getTelElevationSignal());
+    REQUIRE(tMapCopy.getTelElevationSignal()->getStaleLimitSec() == 4.5);
+    REQUIRE(tMapCopy.getTelElevationSignal()->size() == 0);
+    REQUIRE(tMap.getTelElevationSignal()->size() == 1);
+}
+
 TEST_CASE("Test TelemetryCom", "[TelemetryCom]") {
     LINFO("Creating serv");
     int const port = 10081;
@@ -310,8 +412,17 @@ TEST_CASE("Test TelemetryCom", "[TelemetryCom]") {
         clientThreads.emplace_back(&TelemetryCom::client, client, j);
     }
     sleep(2);
+
+    // Each client has its own network statistics while connected.
+    {
+        auto netJ = NetStats::getAllJson()[serv->getNetStatsName()];
+        REQUIRE(netJ["connections"].size() == 10);
+        REQUIRE(netJ["connections"][0]["tcp"]["rttMicros"].is_number());
+        REQUIRE(netJ["total"]["msgsOut"] > 0);
+    }
     LDEBUG("Stopping server");
     serv->shutdownCom();
+    REQUIRE_FALSE(NetStats::getAllJson().contains(serv->getNetStatsName()));
     LDEBUG("serv joined");
     for (auto& thrd : clientThreads) {
         LDEBUG("client joining");
@@ -319,6 +430,15 @@ TEST_CASE("Test TelemetryCom", "[TelemetryCom]") {
     }
     LDEBUG("clients joined");
 
+    // All of the items in a cycle should go out in one send call.
+    auto const& ioStats = serv->getIoStats();
+    LINFO("TelemetryCom sendCalls=", ioStats.sendCalls.load(), " msgsSent=", ioStats.msgsSent.load(),
+          " bytesSent=", ioStats.bytesSent.load());
+    REQUIRE(ioStats.msgsSent > 0);
+    REQUIRE(ioStats.sendCalls * 10 < ioStats.msgsSent);
+    REQUIRE(serv->getNetStats()->getMsgsOut() == ioStats.msgsSent);
+    REQUIRE(serv->getNetStats()->getBytesOut() == ioStats.bytesSent);
+
     // Test that client data matches the server data.
     for (auto const& client : clients) {
         TelemetryMap::Ptr clientMap = client->getTMap();
@@ -0,0 +1,133 @@
+/*
+ * This file is part of LSST ts_m2cellcpp test suite.
+ *
+ * Developed for the Vera C. Rubin Observatory Telescope & Site Software Systems.
+ * This product includes software developed by the Vera C.Rubin Observatory Project
+ * (https://www.lsst.org). See the COPYRIGHT file at the top-level directory of
+ * this distribution for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define CATCH_CONFIG_MAIN
+
+// System headers
+#include <csignal>
+#include <exception>
+
+// 3rd party headers
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_session.hpp>
+
+// Project headers
+#include "system/TelemetryCom.h"
+#include "system/TelemetryMap.h"
+#include "system/TelemetryRelay.h"
+#include "util/Log.h"
+
+using namespace std;
+using namespace LSST::m2cellcpp::system;
+
+TEST_CASE("Test TelemetryRelay", "[TelemetryRelay]") {
+    LSST::m2cellcpp::util::Log::getLog().useEnvironmentLogLvl();
+    signal(SIGPIPE, SIG_IGN);
+
+    REQUIRE(TelemetryRelay::extractId(R"({"id":"powerStatus","motorVoltage":1.0})") == "powerStatus");
+    REQUIRE(TelemetryRelay::extractId("junk").empty());
+
+    int const servPort = 10091;
+    int const relayPort = 10092;
+    int const filterPort = 10093;
+
+    auto servTelemetryMap = TelemetryMap::Ptr(new TelemetryMap());
+    servTelemetryMap->getPowerStatus()->getMotorVoltage().setVal(-3.0);
+    servTelemetryMap->getPowerStatus()->getCommCurrent().setVal(6.0);
+    servTelemetryMap->getPosition()->getX().setVal(6.0);
+    servTelemetryMap->getNetForcesTotal()->getFz().setVal(8.0);
+    vector<double> posVectIn;
+    for (int j = 1; j <= 72; ++j) {
+        posVectIn.push_back(j * 1.5);
+    }
+    servTelemetryMap->getAxialEncoderPositions()->getPosition().setVals(posVectIn);
+
+    auto serv = TelemetryCom::create(servTelemetryMap, servPort);
+    serv->startServer();
+    REQUIRE(serv->waitForServerRunning(5) == true);
+
+    // One relay for everything, one relay that only passes "position".
+    auto relay = TelemetryRelay::create("127.0.0.1", servPort, relayPort);
+    relay->start();
+    REQUIRE(relay->waitForServerRunning(5) == true);
+    auto filterRelay = TelemetryRelay::create("127.0.0.1", servPort, filterPort, {"position"});
+    filterRelay->start();
+    REQUIRE(filterRelay->waitForServerRunning(5) == true);
+    REQUIRE(filterRelay->passesFilter("position") == true);
+    REQUIRE(filterRelay->passesFilter("powerStatus") == false);
+
+    // Wait for the caches to fill.
+    for (int j = 0; j < 50 && relay->getCacheSize() < servTelemetryMap->copyMap().size() - 1; ++j) {
+        this_thread::sleep_for(100ms);
+    }
+    REQUIRE(relay->isUpstreamConnected() == true);
+    // `tel_elevation` is not sent by the server.
+    REQUIRE(relay->getCacheSize() == servTelemetryMap->copyMap().size() - 1);
+
+    // Several clients of each relay.
+    vector<TelemetryCom::Ptr> clients;
+    vector<TelemetryCom::Ptr> filterClients;
+    vector<thread> clientThreads;
+    for (int j = 0; j < 5; ++j) {
+        auto cMap = TelemetryMap::Ptr(new TelemetryMap());
+        auto client = TelemetryCom::create(cMap, relayPort);
+        clients.push_back(client);
+        clientThreads.emplace_back(&TelemetryCom::client, client, j);
+
+        auto fMap = TelemetryMap::Ptr(new TelemetryMap());
+        auto fClient = TelemetryCom::create(fMap, filterPort);
+        filterClients.push_back(fClient);
+        clientThreads.emplace_back(&TelemetryCom::client, fClient, j + 100);
+    }
+    sleep(1);
+    REQUIRE(relay->getClientCount() == 5);
+    REQUIRE(filterRelay->getClientCount() == 5);
+
+    // Stop the upstream server, the relay keeps its cache.
+    serv->shutdownCom();
+    serv.reset();
+    this_thread::sleep_for(300ms);
+
+    // A client connecting after the upstream is gone still gets the full state.
+    auto lateMap = TelemetryMap::Ptr(new TelemetryMap());
+    auto lateClient = TelemetryCom::create(lateMap, relayPort);
+    clients.push_back(lateClient);
+    clientThreads.emplace_back(&TelemetryCom::client, lateClient, 99);
+    sleep(1);
+
+    relay->shutdown();
+    filterRelay->shutdown();
+    for (auto& thrd : clientThreads) {
+        thrd.join();
+    }
+
+    for (auto const& client : clients) {
+        REQUIRE(client->getTMap()->compareMaps(*servTelemetryMap) == true);
+    }
+    TelemetryMap defaultMap;
+    for (auto const& fClient : filterClients) {
+        auto fMap = fClient->getTMap();
+        REQUIRE(fMap->getPosition()->compareItem(*servTelemetryMap->getPosition()) == true);
+        REQUIRE(fMap->getPowerStatus()->compareItem(*defaultMap.getPowerStatus()) == true);
+        REQUIRE(fMap->getPowerStatus()->compareItem(*servTelemetryMap->getPowerStatus()) == false);
+    }
+}
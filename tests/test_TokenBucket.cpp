@@ -0,0 +1,83 @@
+/*
+ * This file is part of LSST ts_m2cellcpp test suite.
+ *
+ * Developed for the Vera C. Rubin Observatory Telescope & Site Software Systems.
+ * This product includes software developed by the Vera C.Rubin Observatory Project
+ * (https://www.lsst.org). See the COPYRIGHT file at the top-level directory of
+ * this distribution for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#define CATCH_CONFIG_MAIN
+
+// System headers
+#include <chrono>
+
+// 3rd party headers
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_session.hpp>
+
+// Project headers
+#include "util/TokenBucket.h"
+
+using namespace std;
+using namespace LSST::m2cellcpp::util;
+
+TEST_CASE("Test TokenBucket", "[TokenBucket]") {
+    TIMEPOINT start = CLOCK::now();
+    {
+        // No limit.
+        TokenBucket bucket(0.0, 1.0, start);
+        REQUIRE_FALSE(bucket.isLimited());
+        for (int j = 0; j < 1000; ++j) {
+            REQUIRE(bucket.take(start));
+        }
+    }
+    {
+        // 10 per second with a burst of 3.
+        TokenBucket bucket(10.0, 3.0, start);
+        REQUIRE(bucket.isLimited());
+        REQUIRE(bucket.take(start));
+        REQUIRE(bucket.take(start));
+        REQUIRE(bucket.take(start));
+        REQUIRE_FALSE(bucket.take(start));
+
+        // A token every 100ms.
+        auto t = start + chrono::milliseconds(50);
+        REQUIRE_FALSE(bucket.take(t));
+        t = start + chrono::milliseconds(101);
+        REQUIRE(bucket.take(t));
+        REQUIRE_FALSE(bucket.take(t));
+
+        // The bucket never holds more than the burst.
+        t += chrono::seconds(10);
+        REQUIRE(bucket.getTokens(t) == 3.0);
+        REQUIRE(bucket.take(t));
+        REQUIRE(bucket.take(t));
+        REQUIRE(bucket.take(t));
+        REQUIRE_FALSE(bucket.take(t));
+
+        // Time going backwards doesn't add tokens.
+        REQUIRE_FALSE(bucket.take(start));
+    }
+    {
+        // The burst is at least 1.
+        TokenBucket bucket(1.0, 0.0, start);
+        REQUIRE(bucket.getBurst() == 1.0);
+        REQUIRE(bucket.take(start));
+        REQUIRE_FALSE(bucket.take(start));
+    }
+}